@@ -0,0 +1,142 @@
+; LC-3b Benchmark: CRC-16 and string processing
+; Packs a string of words into bytes while counting them, upper cases
+; the bytes in place, takes their CRC-16 (polynomial xA001, bit by bit),
+; reverses them in place and takes the CRC-16 again. The length and both
+; CRCs are checked against constants on every pass.
+; Expected: R0 = x600D if every check passed, x0BAD otherwise
+
+.ORIG x3000
+
+    LEA R6, CONST
+    LDW R0, R6, #7
+    LEA R6, PASSES
+    STW R0, R6, #0
+PASS:
+    ; Pack, R1 = word string, R2 = byte buffer, R3 = length
+    LEA R6, CONST
+    LDW R1, R6, #0
+    LDW R2, R6, #1
+    AND R3, R3, #0
+PACK:
+    LDW R4, R1, #0
+    STB R4, R2, #0
+    BRz PACKED
+    ADD R1, R1, #2
+    ADD R2, R2, #1
+    ADD R3, R3, #1
+    BRnzp PACK
+PACKED:
+    LDW R4, R6, #2
+    XOR R4, R4, R3
+    BRnp FAIL
+    LEA R6, LENGTH
+    STW R3, R6, #0
+
+    ; Upper case, R1 = byte, R5 = -'a'
+    LEA R6, CONST
+    LDW R1, R6, #1
+    LDW R5, R6, #6
+UPPER:
+    LDB R4, R1, #0
+    BRz UPPERED
+    ADD R2, R4, R5      ; c - 'a'
+    BRn NEXTC
+    ADD R2, R2, #-13
+    ADD R2, R2, #-13    ; c - 'z' - 1
+    BRzp NEXTC
+    ADD R4, R4, #-16
+    ADD R4, R4, #-16
+    STB R4, R1, #0
+NEXTC:
+    ADD R1, R1, #1
+    BRnzp UPPER
+UPPERED:
+    LEA R6, CONST
+    LDW R1, R6, #1
+    LEA R6, LENGTH
+    LDW R2, R6, #0
+    JSR CRC16
+    LEA R6, CONST
+    LDW R4, R6, #3
+    XOR R4, R4, R3
+    BRnp FAIL
+
+    ; Reverse, R1 = front, R2 = back, R3 = swaps
+    LDW R1, R6, #1
+    LEA R5, LENGTH
+    LDW R3, R5, #0
+    ADD R2, R1, R3
+    ADD R2, R2, #-1
+    RSHFL R3, R3, #1
+REVERSE:
+    LDB R4, R1, #0
+    LDB R5, R2, #0
+    STB R5, R1, #0
+    STB R4, R2, #0
+    ADD R1, R1, #1
+    ADD R2, R2, #-1
+    ADD R3, R3, #-1
+    BRp REVERSE
+    LDW R1, R6, #1
+    LEA R6, LENGTH
+    LDW R2, R6, #0
+    JSR CRC16
+    LEA R6, CONST
+    LDW R4, R6, #4
+    XOR R4, R4, R3
+    BRnp FAIL
+
+    LEA R6, PASSES
+    LDW R0, R6, #0
+    ADD R0, R0, #-1
+    STW R0, R6, #0
+    BRp PASS
+
+    LEA R6, CONST
+    LDW R0, R6, #8      ; R0 = x600D
+    HALT
+FAIL:
+    LEA R6, CONST
+    LDW R0, R6, #9      ; R0 = x0BAD
+    HALT
+
+    ; CRC-16 of R2 bytes at R1, R3 = CRC, R6 = polynomial
+CRC16:
+    AND R3, R3, #0
+    LEA R6, CONST
+    LDW R6, R6, #5
+CBYTE:
+    LDB R4, R1, #0
+    XOR R3, R3, R4
+    AND R5, R5, #0
+    ADD R5, R5, #8
+CBIT:
+    AND R4, R3, #1
+    RSHFL R3, R3, #1
+    ADD R4, R4, #0
+    BRz CNEXT
+    XOR R3, R3, R6
+CNEXT:
+    ADD R5, R5, #-1
+    BRp CBIT
+    ADD R1, R1, #1
+    ADD R2, R2, #-1
+    BRp CBYTE
+    RET
+
+CONST:  .FILL TEXT
+        .FILL BUFFER
+        .FILL #102      ; length of TEXT
+        .FILL #-12881   ; xCDAF, CRC-16 of the upper case bytes
+        .FILL #-5572    ; xEA3C, CRC-16 of them reversed
+        .FILL #-24575   ; xA001
+        .FILL #-97      ; -'a'
+        .FILL #8        ; passes
+        .FILL x600D
+        .FILL x0BAD
+PASSES: .FILL #0
+LENGTH: .FILL #0
+TEXT:   .STRINGZ "The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs! LC-3b 0123456789"
+BUFFER: .BLKW #64
+
+.END
@@ -0,0 +1,489 @@
+; LC-3b Benchmark: Dhrystone-style mix
+; The main loop of Dhrystone 2.1 on words: procedure calls with values
+; and pointers, a record copy through a global pointer, string copy and
+; compare, a switch through a jump table, one and two dimensional
+; arrays, and multiply and divide done in software. Every iteration is
+; the same, so the locals are summed up and checked at the end together
+; with the arrays and records.
+; Expected: R0 = x600D if every check passed, x0BAD otherwise
+
+.ORIG x3000
+
+    LEA R5, CONST
+    LDW R6, R5, #16     ; R6 = stack pointer, the stack grows down
+    LDW R0, R5, #0
+    LEA R5, VARS
+    STW R0, R5, #6      ; iterations left
+LOOP:
+    JSR PROC5
+    JSR PROC4
+    LEA R5, VARS
+    AND R0, R0, #0
+    ADD R0, R0, #2
+    STW R0, R5, #0      ; I1 = 2
+    ADD R0, R0, #1
+    STW R0, R5, #1      ; I2 = 3
+    LEA R5, CONST
+    LDW R0, R5, #2
+    LDW R1, R5, #3
+    JSR STRCPY          ; STR2 = "DHRYSTONE PROGRAM, 2'ND STRING"
+    LEA R5, VARS
+    AND R0, R0, #0
+    ADD R0, R0, #1
+    STW R0, R5, #3      ; ENUM = 1
+    LEA R5, CONST
+    LDW R0, R5, #1
+    LDW R1, R5, #2
+    JSR STRCMP
+    LEA R5, VARS
+    STW R0, R5, #4      ; CMP = strcmp(STR1, STR2)
+    AND R1, R1, #0
+    ADD R0, R0, #0
+    BRzp NOTLESS
+    ADD R1, R1, #1
+NOTLESS:
+    LEA R5, GLOB
+    STW R1, R5, #1      ; BOOL = CMP < 0
+WHILE:
+    LEA R5, VARS
+    LDW R0, R5, #0
+    LDW R1, R5, #1
+    XOR R2, R1, #-1
+    ADD R2, R2, #1
+    ADD R2, R0, R2
+    BRzp ENDWHILE       ; while I1 < I2
+    LSHF R2, R0, #2
+    ADD R2, R2, R0
+    XOR R3, R1, #-1
+    ADD R3, R3, #1
+    ADD R2, R2, R3
+    STW R2, R5, #2      ; I3 = 5 * I1 - I2
+    JSR PROC7
+    LEA R5, VARS
+    STW R0, R5, #2      ; I3 = PROC7(I1, I2)
+    LDW R0, R5, #0
+    ADD R0, R0, #1
+    STW R0, R5, #0      ; I1 = I1 + 1
+    BRnzp WHILE
+ENDWHILE:
+    LDW R1, R5, #2
+    JSR PROC8           ; PROC8(I1, I3)
+    LEA R5, GLOB
+    LDW R0, R5, #4
+    JSR PROC1           ; PROC1(PTRG)
+    LEA R5, CONST
+    LDW R0, R5, #4
+    LEA R5, VARS
+    STW R0, R5, #7      ; for CH = 'A' to CH2
+FOR:
+    LEA R5, VARS
+    LDW R0, R5, #7
+    LEA R5, GLOB
+    LDW R1, R5, #3
+    XOR R1, R1, #-1
+    ADD R1, R1, #1
+    ADD R1, R0, R1
+    BRp ENDFOR
+    LEA R5, CONST
+    LDW R1, R5, #5
+    JSR FUNC1
+    LEA R5, VARS
+    LDW R1, R5, #3
+    XOR R1, R1, R0
+    BRnp NEXTCH         ; if ENUM = FUNC1(CH, 'C')
+    AND R0, R0, #0
+    JSR PROC6
+    LEA R5, VARS
+    STW R0, R5, #3      ; ENUM = PROC6(0)
+NEXTCH:
+    LDW R0, R5, #7
+    ADD R0, R0, #1
+    STW R0, R5, #7
+    BRnzp FOR
+ENDFOR:
+    LEA R5, VARS
+    LDW R0, R5, #1
+    LDW R1, R5, #0
+    JSR MUL
+    LEA R5, VARS
+    STW R0, R5, #1      ; I2 = I2 * I1
+    LDW R1, R5, #2
+    JSR DIV
+    LEA R5, VARS
+    STW R0, R5, #0      ; I1 = I2 / I3
+    LDW R1, R5, #1
+    LDW R2, R5, #2
+    XOR R2, R2, #-1
+    ADD R2, R2, #1
+    ADD R1, R1, R2
+    LSHF R2, R1, #3
+    XOR R1, R1, #-1
+    ADD R1, R1, #1
+    ADD R1, R2, R1
+    XOR R0, R0, #-1
+    ADD R0, R0, #1
+    ADD R1, R1, R0
+    STW R1, R5, #1      ; I2 = 7 * (I2 - I3) - I1
+    LDW R0, R5, #0
+    JSR PROC2
+    LEA R5, VARS
+    STW R0, R5, #0      ; I1 = PROC2(I1)
+    LDW R1, R5, #1
+    ADD R0, R0, R1
+    LDW R1, R5, #2
+    ADD R0, R0, R1
+    LDW R1, R5, #3
+    ADD R0, R0, R1
+    LDW R1, R5, #4
+    ADD R0, R0, R1
+    LEA R4, GLOB
+    LDW R1, R4, #1
+    ADD R0, R0, R1
+    LDW R1, R5, #5
+    ADD R0, R0, R1
+    STW R0, R5, #5      ; SUM += I1 + I2 + I3 + ENUM + CMP + BOOL
+    LDW R0, R5, #6
+    ADD R0, R0, #-1
+    STW R0, R5, #6
+    BRp LOOP
+
+    LEA R4, CONST
+    LDW R0, R5, #5
+    LDW R1, R4, #6
+    XOR R0, R0, R1
+    BRnp FAIL           ; the sum of the locals
+    LDW R1, R4, #8
+    LDW R2, R4, #9
+    ADD R1, R1, R2
+    LDW R0, R1, #0
+    LDW R1, R4, #0
+    XOR R0, R0, R1
+    BRnp FAIL           ; ARR2[8][7], incremented every iteration
+    LDW R1, R4, #11
+    LDW R0, R1, #3
+    ADD R0, R0, #-16
+    ADD R0, R0, #-2
+    BRnp FAIL           ; RECB.INT = 18
+    LDW R0, R1, #2
+    ADD R0, R0, #-1
+    BRnp FAIL           ; RECB.ENUM = 1
+    LDW R1, R4, #10
+    LDW R0, R1, #3
+    ADD R0, R0, #-16
+    ADD R0, R0, #-1
+    BRnp FAIL           ; RECA.INT = 17
+    LDW R0, R4, #12     ; R0 = x600D
+    HALT
+FAIL:
+    LEA R4, CONST
+    LDW R0, R4, #13     ; R0 = x0BAD
+    HALT
+
+CONST:  .FILL #150      ; iterations
+        .FILL STR1
+        .FILL STR2
+        .FILL STR2C
+        .FILL #65       ; 'A'
+        .FILL #67       ; 'C'
+        .FILL #3900     ; 26 per iteration
+        .FILL ARR1
+        .FILL ARR2
+        .FILL #174      ; ARR2[8][7]
+        .FILL RECA
+        .FILL RECB
+        .FILL x600D
+        .FILL x0BAD
+        .FILL #66       ; 'B'
+        .FILL #-101
+        .FILL STACK
+GLOB:   .FILL #0        ; INTG
+        .FILL #0        ; BOOL
+        .FILL #0        ; CH1
+        .FILL #0        ; CH2
+        .FILL RECA      ; PTRG
+VARS:   .BLKW #8        ; I1, I2, I3, ENUM, CMP, SUM, iterations, CH
+CASES:  .FILL CASE0
+        .FILL CASE1
+        .FILL CASE2
+        .FILL CASE3
+        .FILL CASE4
+
+    ; CH1 = 'A', BOOL = false
+PROC5:
+    LEA R5, CONST
+    LDW R0, R5, #4
+    LEA R5, GLOB
+    STW R0, R5, #2
+    AND R0, R0, #0
+    STW R0, R5, #1
+    RET
+
+    ; BOOL = BOOL or CH1 = 'A', CH2 = 'B'
+PROC4:
+    LEA R5, GLOB
+    LEA R4, CONST
+    LDW R0, R5, #2
+    LDW R1, R4, #4
+    XOR R0, R0, R1
+    BRnp P4CHAR
+    AND R0, R0, #0
+    ADD R0, R0, #1
+    STW R0, R5, #1
+P4CHAR:
+    LDW R0, R4, #14
+    STW R0, R5, #3
+    RET
+
+    ; Copy the string at R1 to R0
+STRCPY:
+    LDW R2, R1, #0
+    STW R2, R0, #0
+    ADD R0, R0, #2
+    ADD R1, R1, #2
+    ADD R2, R2, #0
+    BRnp STRCPY
+    RET
+
+    ; R0 = the first difference of the strings at R0 and R1, or 0
+STRCMP:
+    LDW R2, R0, #0
+    LDW R3, R1, #0
+    XOR R4, R3, #-1
+    ADD R4, R4, #1
+    ADD R4, R2, R4
+    BRnp SCDONE
+    ADD R2, R2, #0
+    BRz SCDONE
+    ADD R0, R0, #2
+    ADD R1, R1, #2
+    BRnzp STRCMP
+SCDONE:
+    ADD R0, R4, #0
+    RET
+
+    ; R0 = R0 + R1 + 2
+PROC7:
+    ADD R0, R0, #2
+    ADD R0, R0, R1
+    RET
+
+    ; Array stores around LOC = R0 + 5, R1 = I3
+PROC8:
+    ADD R0, R0, #5
+    LEA R5, CONST
+    LDW R2, R5, #7
+    LSHF R3, R0, #1
+    ADD R2, R2, R3
+    STW R1, R2, #0      ; ARR1[LOC] = I3
+    LDW R3, R2, #0
+    STW R3, R2, #1      ; ARR1[LOC + 1] = ARR1[LOC]
+    STW R0, R2, #30     ; ARR1[LOC + 30] = LOC
+    LDW R2, R5, #8
+    LSHF R3, R0, #4
+    ADD R2, R2, R3
+    LSHF R3, R0, #2
+    ADD R2, R2, R3
+    LSHF R3, R0, #1
+    ADD R2, R2, R3      ; R2 = ARR2[LOC][LOC], rows of 10
+    STW R0, R2, #0
+    STW R0, R2, #1      ; ARR2[LOC][LOC + 1] = LOC
+    LDW R3, R2, #-1
+    ADD R3, R3, #1
+    STW R3, R2, #-1     ; ARR2[LOC][LOC - 1] += 1
+    STW R1, R2, #10     ; ARR2[LOC + 1][LOC] = ARR1[LOC]
+    LEA R5, GLOB
+    AND R3, R3, #0
+    ADD R3, R3, #5
+    STW R3, R5, #0      ; INTG = 5
+    RET
+
+    ; Record at R0: NEXT, DISCR, ENUM, INT and 3 words of payload
+PROC1:
+    ADD R6, R6, #-4
+    STW R7, R6, #0
+    STW R0, R6, #1
+    LDW R1, R0, #0      ; R1 = NEXT
+    AND R2, R2, #0
+    ADD R2, R2, #7
+    ADD R3, R0, #0
+    ADD R4, R1, #0
+P1COPY:
+    LDW R5, R3, #0
+    STW R5, R4, #0
+    ADD R3, R3, #2
+    ADD R4, R4, #2
+    ADD R2, R2, #-1
+    BRp P1COPY          ; *NEXT = *R0
+    AND R2, R2, #0
+    ADD R2, R2, #5
+    STW R2, R0, #3      ; INT = 5
+    STW R2, R1, #3      ; NEXT.INT = INT
+    LDW R2, R0, #0
+    STW R2, R1, #0      ; NEXT.NEXT = NEXT
+    ADD R0, R1, #0
+    JSR PROC3
+    LDW R0, R6, #1
+    LDW R1, R0, #0
+    LDW R2, R1, #1
+    BRnp P1ELSE         ; if NEXT.DISCR = 0
+    AND R2, R2, #0
+    ADD R2, R2, #6
+    STW R2, R1, #3      ; NEXT.INT = 6
+    LDW R0, R0, #2
+    JSR PROC6
+    LDW R1, R6, #1
+    LDW R3, R1, #0
+    STW R0, R3, #2      ; NEXT.ENUM = PROC6(ENUM)
+    LEA R5, GLOB
+    LDW R2, R5, #4
+    LDW R2, R2, #0
+    STW R2, R3, #0      ; NEXT.NEXT = PTRG.NEXT
+    LDW R0, R3, #3
+    AND R1, R1, #0
+    ADD R1, R1, #10
+    JSR PROC7
+    STW R0, R3, #3      ; NEXT.INT = PROC7(NEXT.INT, 10)
+    BRnzp P1RET
+P1ELSE:
+    AND R2, R2, #0
+    ADD R2, R2, #7
+P1BACK:
+    LDW R5, R1, #0
+    STW R5, R0, #0
+    ADD R0, R0, #2
+    ADD R1, R1, #2
+    ADD R2, R2, #-1
+    BRp P1BACK          ; *R0 = *NEXT
+P1RET:
+    LDW R7, R6, #0
+    ADD R6, R6, #4
+    RET
+
+    ; R0.NEXT = PTRG.NEXT, PTRG.INT = PROC7(10, INTG)
+PROC3:
+    ADD R6, R6, #-2
+    STW R7, R6, #0
+    LEA R5, GLOB
+    LDW R1, R5, #4
+    BRz P3NULL
+    LDW R2, R1, #0
+    STW R2, R0, #0
+P3NULL:
+    LDW R1, R5, #0
+    AND R0, R0, #0
+    ADD R0, R0, #10
+    JSR PROC7
+    LEA R5, GLOB
+    LDW R1, R5, #4
+    STW R0, R1, #3
+    LDW R7, R6, #0
+    ADD R6, R6, #2
+    RET
+
+    ; R0 = the enumeration that follows R0, a switch on a jump table
+PROC6:
+    LEA R1, CASES
+    LSHF R2, R0, #1
+    ADD R1, R1, R2
+    LDW R1, R1, #0
+    JMP R1
+CASE0:
+    AND R0, R0, #0
+    RET
+CASE1:
+    LEA R5, GLOB
+    LDW R1, R5, #0
+    LEA R5, CONST
+    LDW R2, R5, #15
+    AND R0, R0, #0
+    ADD R1, R1, R2
+    BRzp CASE1END       ; INTG > 100
+    ADD R0, R0, #3
+CASE1END:
+    RET
+CASE2:
+    AND R0, R0, #0
+    ADD R0, R0, #1
+    RET
+CASE3:
+    RET
+CASE4:
+    AND R0, R0, #0
+    ADD R0, R0, #2
+    RET
+
+    ; R0 = 1 and CH1 = R0 if R0 = R1, else 0
+FUNC1:
+    XOR R2, R0, R1
+    BRnp F1DIFF
+    LEA R5, GLOB
+    STW R0, R5, #2
+    AND R0, R0, #0
+    ADD R0, R0, #1
+    RET
+F1DIFF:
+    AND R0, R0, #0
+    RET
+
+    ; R0 = R0 + 10 - 1 - INTG if CH1 = 'A'
+PROC2:
+    ADD R0, R0, #10
+    LEA R5, GLOB
+    LEA R4, CONST
+    LDW R1, R5, #2
+    LDW R2, R4, #4
+    XOR R1, R1, R2
+    BRnp P2DONE
+    ADD R0, R0, #-1
+    LDW R1, R5, #0
+    XOR R1, R1, #-1
+    ADD R1, R1, #1
+    ADD R0, R0, R1
+P2DONE:
+    RET
+
+    ; R0 = R0 * R1, shift and add
+MUL:
+    AND R2, R2, #0
+MULBIT:
+    AND R3, R1, #1
+    BRz MULSHIFT
+    ADD R2, R2, R0
+MULSHIFT:
+    LSHF R0, R0, #1
+    RSHFL R1, R1, #1
+    BRnp MULBIT
+    ADD R0, R2, #0
+    RET
+
+    ; R0 = R0 / R1 for positive numbers, repeated subtraction
+DIV:
+    AND R2, R2, #0
+    XOR R1, R1, #-1
+    ADD R1, R1, #1
+DIVSUB:
+    ADD R0, R0, R1
+    BRn DIVDONE
+    ADD R2, R2, #1
+    BRnzp DIVSUB
+DIVDONE:
+    ADD R0, R2, #0
+    RET
+
+STR1:   .STRINGZ "DHRYSTONE PROGRAM, 1'ST STRING"
+STR2C:  .STRINGZ "DHRYSTONE PROGRAM, 2'ND STRING"
+STR2:   .BLKW #31
+RECA:   .FILL RECB      ; NEXT
+        .FILL #0        ; DISCR
+        .FILL #2        ; ENUM
+        .FILL #40       ; INT
+        .FILL #65
+        .FILL #66
+        .FILL #67
+RECB:   .BLKW #7
+ARR1:   .BLKW #50
+ARR2:   .BLKW #100
+        .BLKW #32
+STACK:  .FILL #0
+
+.END
@@ -0,0 +1,180 @@
+; LC-3b Benchmark: matrix multiply
+; Fills two 12x12 matrices with 4-bit xorshift numbers and multiplies
+; them with shift-and-add multiplies, C = A * B. The sum of C is checked
+; against the sum over k of column k of A times row k of B, which must be
+; the same, and against a constant.
+; Expected: R0 = x600D if every check passed, x0BAD otherwise
+
+.ORIG x3000
+
+    ; Fill A and B, which follows it, R1 = element, R2 = count
+    LEA R6, CONST
+    LDW R1, R6, #0
+    LDW R2, R6, #3
+    LDW R3, R6, #4      ; R3 = xorshift state
+FILL:
+    LSHF R4, R3, #7
+    XOR R3, R3, R4
+    RSHFL R4, R3, #9
+    XOR R3, R3, R4
+    LSHF R4, R3, #8
+    XOR R3, R3, R4
+    AND R4, R3, #15
+    STW R4, R1, #0
+    ADD R1, R1, #2
+    ADD R2, R2, #-1
+    BRp FILL
+
+    ; C = A * B, the rows of A, columns of B and elements of C are kept
+    ; in VARS: A row, B column, C element, rows left, columns left
+    LEA R6, CONST
+    LDW R0, R6, #0
+    LDW R1, R6, #2
+    LEA R6, VARS
+    STW R0, R6, #0
+    STW R1, R6, #2
+    AND R0, R0, #0
+    ADD R0, R0, #12
+    STW R0, R6, #3
+ROW:
+    LEA R6, CONST
+    LDW R1, R6, #1
+    LEA R6, VARS
+    STW R1, R6, #1
+    AND R0, R0, #0
+    ADD R0, R0, #12
+    STW R0, R6, #4
+COLUMN:
+    ; R0 = A[i][k], R1 = B[k][j], R2 = k left, R7 = C[i][j]
+    LEA R6, VARS
+    LDW R0, R6, #0
+    LDW R1, R6, #1
+    AND R2, R2, #0
+    ADD R2, R2, #12
+    AND R7, R7, #0
+DOT:
+    LDW R3, R0, #0
+    LDW R4, R1, #0
+    BRz NEXTK
+MULTIPLY:
+    AND R5, R4, #1
+    BRz SHIFT
+    ADD R7, R7, R3
+SHIFT:
+    LSHF R3, R3, #1
+    RSHFL R4, R4, #1
+    BRnp MULTIPLY
+NEXTK:
+    ADD R0, R0, #2
+    ADD R1, R1, #12
+    ADD R1, R1, #12     ; next row of B
+    ADD R2, R2, #-1
+    BRp DOT
+    LEA R6, VARS
+    LDW R0, R6, #2
+    STW R7, R0, #0
+    ADD R0, R0, #2
+    STW R0, R6, #2
+    LDW R1, R6, #1
+    ADD R1, R1, #2
+    STW R1, R6, #1
+    LDW R0, R6, #4
+    ADD R0, R0, #-1
+    STW R0, R6, #4
+    BRp COLUMN
+    LDW R0, R6, #0
+    ADD R0, R0, #12
+    ADD R0, R0, #12     ; next row of A
+    STW R0, R6, #0
+    LDW R0, R6, #3
+    ADD R0, R0, #-1
+    STW R0, R6, #3
+    BRp ROW
+
+    ; Sum of C
+    LEA R6, CONST
+    LDW R1, R6, #2
+    LDW R2, R6, #5
+    AND R7, R7, #0
+SUMC:
+    LDW R3, R1, #0
+    ADD R7, R7, R3
+    ADD R1, R1, #2
+    ADD R2, R2, #-1
+    BRp SUMC
+    LEA R6, VARS
+    STW R7, R6, #5
+
+    ; Sum over k of column k of A times row k of B, R0 = A[0][k],
+    ; R1 = B[k][0], R2 = k left, R3 = column sum, R4 = row sum
+    LEA R6, CONST
+    LDW R0, R6, #0
+    LDW R1, R6, #1
+    AND R2, R2, #0
+    ADD R2, R2, #12
+    AND R7, R7, #0
+SUMK:
+    AND R3, R3, #0
+    ADD R6, R0, #0
+    AND R5, R5, #0
+    ADD R5, R5, #12
+COLA:
+    LDW R4, R6, #0
+    ADD R3, R3, R4
+    ADD R6, R6, #12
+    ADD R6, R6, #12
+    ADD R5, R5, #-1
+    BRp COLA
+    AND R4, R4, #0
+    AND R5, R5, #0
+    ADD R5, R5, #12
+ROWB:
+    LDW R6, R1, #0
+    ADD R4, R4, R6
+    ADD R1, R1, #2
+    ADD R5, R5, #-1
+    BRp ROWB
+PRODUCT:
+    AND R5, R4, #1
+    BRz PSHIFT
+    ADD R7, R7, R3
+PSHIFT:
+    LSHF R3, R3, #1
+    RSHFL R4, R4, #1
+    BRnp PRODUCT
+    ADD R0, R0, #2
+    ADD R2, R2, #-1
+    BRp SUMK
+
+    LEA R6, VARS
+    LDW R6, R6, #5
+    XOR R6, R6, R7
+    BRnp FAIL
+    LEA R6, CONST
+    LDW R6, R6, #6
+    XOR R6, R6, R7
+    BRnp FAIL
+
+    LEA R6, CONST
+    LDW R0, R6, #7      ; R0 = x600D
+    HALT
+FAIL:
+    LEA R6, CONST
+    LDW R0, R6, #8      ; R0 = x0BAD
+    HALT
+
+CONST:  .FILL MATA
+        .FILL MATB
+        .FILL MATC
+        .FILL #288      ; elements of A and B
+        .FILL x1234     ; seed
+        .FILL #144      ; elements of C
+        .FILL #-21725   ; xAB23, sum of C
+        .FILL x600D
+        .FILL x0BAD
+VARS:   .BLKW #6
+MATA:   .BLKW #144
+MATB:   .BLKW #144
+MATC:   .BLKW #144
+
+.END
@@ -0,0 +1,161 @@
+; LC-3b Benchmark: recursive calls
+; Computes fib(16) with the doubly recursive definition, then solves the
+; towers of Hanoi for 10 discs recursively. Every move pops a disc off one
+; peg and pushes it on another, and fails if it lands on a smaller disc.
+; Expected: R0 = x600D if fib(16) = 987, all 1023 moves were legal and
+; every disc ended up on the last peg, x0BAD otherwise
+
+.ORIG x3000
+
+    LEA R6, STACK       ; R6 = stack pointer, the stack grows down
+    AND R0, R0, #0
+    ADD R0, R0, #15
+    ADD R0, R0, #1
+    JSR FIB
+    LEA R5, CONST
+    LDW R5, R5, #0
+    XOR R5, R5, R0
+    BRnp FAIL
+
+    ; Stack the discs 10 to 1 on peg 0, R3 = its top
+    LEA R3, PEG0
+    AND R0, R0, #0
+    ADD R0, R0, #10
+DISCS:
+    ADD R3, R3, #2
+    STW R0, R3, #0
+    ADD R0, R0, #-1
+    BRp DISCS
+    LEA R5, TOPS
+    STW R3, R5, #0
+
+    AND R0, R0, #0
+    ADD R0, R0, #10     ; n
+    AND R1, R1, #0      ; from
+    ADD R2, R1, #2      ; to
+    ADD R3, R1, #1      ; via
+    JSR HANOI
+
+    LEA R5, CONST
+    LDW R4, R5, #1
+    LEA R6, MOVES
+    LDW R6, R6, #0
+    XOR R4, R4, R6
+    BRnp FAIL
+    LEA R5, TOPS
+    LDW R4, R5, #0
+    LEA R6, PEG0
+    XOR R4, R4, R6
+    BRnp FAIL
+    LDW R4, R5, #1
+    LEA R6, PEG1
+    XOR R4, R4, R6
+    BRnp FAIL
+    LDW R4, R5, #2
+    LEA R6, PEG2
+    ADD R6, R6, #10
+    ADD R6, R6, #10     ; 10 discs above the bottom
+    XOR R4, R4, R6
+    BRnp FAIL
+
+    LEA R6, CONST
+    LDW R0, R6, #2      ; R0 = x600D
+    HALT
+FAIL:
+    LEA R6, CONST
+    LDW R0, R6, #3      ; R0 = x0BAD
+    HALT
+
+    ; R0 = fib(R0), clobbers R1
+FIB:
+    ADD R1, R0, #-2
+    BRn FIBRET          ; fib(0) = 0, fib(1) = 1
+    ADD R6, R6, #-4
+    STW R7, R6, #1
+    STW R0, R6, #0
+    ADD R0, R0, #-1
+    JSR FIB
+    LDW R1, R6, #0
+    STW R0, R6, #0      ; fib(n - 1) takes the place of n
+    ADD R0, R1, #-2
+    JSR FIB
+    LDW R1, R6, #0
+    ADD R0, R0, R1
+    LDW R7, R6, #1
+    ADD R6, R6, #4
+FIBRET:
+    RET
+
+    ; Move R0 discs from peg R1 to peg R2 over peg R3, clobbers R0-R5
+HANOI:
+    ADD R0, R0, #0
+    BRz HANOIRET
+    ADD R6, R6, #-10
+    STW R7, R6, #0
+    STW R0, R6, #1
+    STW R1, R6, #2
+    STW R2, R6, #3
+    STW R3, R6, #4
+    ADD R0, R0, #-1
+    ADD R4, R2, #0
+    ADD R2, R3, #0
+    ADD R3, R4, #0
+    JSR HANOI           ; n - 1 discs from -> via
+    LDW R1, R6, #2
+    LDW R2, R6, #3
+    JSR MOVE
+    LDW R0, R6, #1
+    ADD R0, R0, #-1
+    LDW R1, R6, #4
+    LDW R2, R6, #3
+    LDW R3, R6, #2
+    JSR HANOI           ; n - 1 discs via -> to
+    LDW R7, R6, #0
+    ADD R6, R6, #10
+HANOIRET:
+    RET
+
+    ; Move the top disc of peg R1 to peg R2, clobbers R0 and R3-R5
+MOVE:
+    LEA R5, TOPS
+    LSHF R4, R1, #1
+    ADD R4, R5, R4
+    LDW R3, R4, #0
+    LDW R0, R3, #0      ; R0 = disc
+    ADD R3, R3, #-2
+    STW R3, R4, #0
+    LSHF R4, R2, #1
+    ADD R4, R5, R4
+    LDW R3, R4, #0
+    LDW R5, R3, #0      ; R5 = disc it lands on
+    XOR R5, R5, #-1
+    ADD R5, R5, #1
+    ADD R5, R0, R5
+    BRzp FAIL
+    ADD R3, R3, #2
+    STW R0, R3, #0
+    STW R3, R4, #0
+    LEA R5, MOVES
+    LDW R4, R5, #0
+    ADD R4, R4, #1
+    STW R4, R5, #0
+    RET
+
+CONST:  .FILL #987      ; fib(16)
+        .FILL #1023     ; moves of 10 discs
+        .FILL x600D
+        .FILL x0BAD
+MOVES:  .FILL #0
+TOPS:   .FILL PEG0
+        .FILL PEG1
+        .FILL PEG2
+PEG0:   .FILL #99       ; larger than any disc
+        .BLKW #10
+PEG1:   .FILL #99
+        .BLKW #10
+PEG2:   .FILL #99
+        .BLKW #10
+        .BLKW #80
+STACK:  .FILL #0
+
+.END
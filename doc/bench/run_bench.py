@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+LC-3b Benchmark Runner
+Runs the benchmark programs headless, checks that each one passed its own
+checks and reports the simulated cycles and instructions with the host
+throughput. Compared with a baseline, it fails when a program retires a
+different number of instructions, or its cycles move by more than the
+tolerance, or the host throughput drops by more than the speed tolerance.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(os.path.dirname(BENCH_DIR))
+sys.path.insert(0, os.path.join(REPO_DIR, 'doc', 'test'))
+
+from lc3b_assembler import LC3bAssembler
+
+PASSED = 0x600D  # R0 of a program whose checks passed
+
+
+def assemble(program: str) -> str:
+    """Assemble program.asm into program.obj unless the object is up to date"""
+    source = os.path.join(BENCH_DIR, program + '.asm')
+    target = os.path.join(BENCH_DIR, program + '.obj')
+    if not os.path.exists(target) or os.path.getmtime(target) < os.path.getmtime(source):
+        with open(os.devnull, 'w') as quiet:
+            stdout, sys.stdout = sys.stdout, quiet
+            try:
+                LC3bAssembler().assemble_file(source, target)
+            finally:
+                sys.stdout = stdout
+    return target
+
+
+def run(args, program: str) -> dict:
+    """Run one program, the fastest of --repeat runs, and return its results"""
+    command = [args.sim, '-rdump', '-format', 'json'] + args.options + [args.ucode, assemble(program)]
+    best = None
+    for _ in range(args.repeat):
+        start = time.perf_counter()
+        process = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+        seconds = time.perf_counter() - start
+        if process.returncode != 0:
+            return {'error': process.stderr.strip() or 'exit status %d' % process.returncode}
+        if best is None or seconds < best['seconds']:
+            best = json.loads(process.stdout)
+            best['seconds'] = seconds
+    best['passed'] = best['halted'] and best['registers'][0] == PASSED
+    best['kips'] = best['instructions'] / best['seconds'] / 1000
+    best['kcps'] = best['cycles'] / best['seconds'] / 1000
+    return best
+
+
+def compare(args, result: dict, expected: dict) -> list:
+    """The ways result regressed from its baseline"""
+    problems = []
+    if result['instructions'] != expected['instructions']:
+        problems.append('instructions %d, baseline %d' % (result['instructions'], expected['instructions']))
+    change = 100.0 * (result['cycles'] - expected['cycles']) / expected['cycles']
+    if abs(change) > args.tolerance:
+        problems.append('cycles %+.2f%%' % change)
+    if args.speed_tolerance is not None and 'kips' in expected:
+        change = 100.0 * (result['kips'] - expected['kips']) / expected['kips']
+        if change < -args.speed_tolerance:
+            problems.append('KIPS %+.1f%%' % change)
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Run the LC-3b benchmark suite.',
+                                     epilog='Options after -- are passed to the simulator, e.g. -- -width 2 -bpred gshare')
+    parser.add_argument('--sim', default=os.path.join(REPO_DIR, 'build', 'source', 'lC3b'), help='simulator executable')
+    parser.add_argument('--ucode', default=os.path.join(REPO_DIR, 'doc', 'test', 'ucode'), help='micro-code file')
+    parser.add_argument('--baseline', default=os.path.join(BENCH_DIR, 'baseline.json'), help='baseline file')
+    parser.add_argument('--record', action='store_true', help='write the results to the baseline instead of comparing')
+    parser.add_argument('--tolerance', type=float, default=2.0, help='allowed change of the cycles, percent (2)')
+    parser.add_argument('--speed-tolerance', type=float, help='allowed drop of the host KIPS, percent (not checked)')
+    parser.add_argument('--repeat', type=int, default=1, help='runs per program, the fastest counts (1)')
+    parser.add_argument('programs', nargs='*', help='programs to run (all)')
+    argv = sys.argv[1:]
+    split = argv.index('--') if '--' in argv else len(argv)
+    args = parser.parse_args(argv[:split])
+    args.options = argv[split + 1:]
+    args.repeat = max(args.repeat, 1)
+    if not os.access(args.sim, os.X_OK) or os.path.isdir(args.sim):
+        sys.exit('Error: --sim %s is not an executable simulator, build it or pass --sim' % args.sim)
+
+    programs = args.programs or sorted(name[:-4] for name in os.listdir(BENCH_DIR) if name.endswith('.asm'))
+    key = ' '.join(args.options) or 'default'
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    expected = baseline.get(key, {})
+
+    print('Configuration: %s' % key)
+    print('%-10s %10s %12s %6s %9s %9s %9s  %s' % ('Program', 'Cycles', 'Instructions', 'IPC', 'Host s', 'KIPS', 'KCPS', 'Status'))
+    failed = 0
+    recorded = {}
+    for program in programs:
+        result = run(args, program)
+        if 'error' in result:
+            print('%-10s %s' % (program, result['error']))
+            failed += 1
+            continue
+
+        problems = [] if result['passed'] else ['self-check failed, R0 = x%04X' % result['registers'][0]]
+        if not args.record and program in expected:
+            problems += compare(args, result, expected[program])
+        failed += bool(problems)
+        status = '; '.join(problems) or ('ok' if args.record or program in expected else 'ok, no baseline')
+        print('%-10s %10d %12d %6.3f %9.3f %9.1f %9.1f  %s' % (program, result['cycles'], result['instructions'],
+              result['instructions'] / result['cycles'], result['seconds'], result['kips'], result['kcps'], status))
+        recorded[program] = {'cycles': result['cycles'], 'instructions': result['instructions'], 'kips': round(result['kips'], 1)}
+
+    if args.record and not failed:
+        baseline[key] = recorded
+        with open(args.baseline, 'w') as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print('Baseline of %s written to %s' % (key, args.baseline))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,157 @@
+; LC-3b Benchmark: insertion sort and binary search
+; Fills an array with 16-bit xorshift numbers, sorts it with insertion
+; sort, checks the order and that the sum did not change, then looks up
+; every element, which must be found, and every element + 1, which is
+; odd and must be missed.
+; Expected: R0 = x600D if every check passed, x0BAD otherwise
+
+.ORIG x3000
+
+    ; Fill the array, R1 = element, R2 = count, R3 = xorshift state
+    LEA R6, CONST
+    LDW R1, R6, #0      ; R1 = ARRAY
+    LDW R2, R6, #1      ; R2 = N
+    LDW R3, R6, #2      ; R3 = seed
+    LDW R5, R6, #3      ; R5 = x7FFE, even 15-bit values
+    AND R6, R6, #0      ; R6 = sum of the array
+FILL:
+    LSHF R4, R3, #7
+    XOR R3, R3, R4
+    RSHFL R4, R3, #9
+    XOR R3, R3, R4
+    LSHF R4, R3, #8
+    XOR R3, R3, R4
+    AND R4, R3, R5
+    STW R4, R1, #0
+    ADD R6, R6, R4
+    ADD R1, R1, #2
+    ADD R2, R2, #-1
+    BRp FILL
+    LEA R4, SUM
+    STW R6, R4, #0
+
+    ; Insertion sort, R1 = a[i], R2 = elements left, R3 = key,
+    ; R0 = -key, R4 = a[j]. The 0 in front of the array stops the scan.
+    LEA R6, CONST
+    LDW R1, R6, #0
+    LDW R2, R6, #1
+    ADD R2, R2, #-1
+    ADD R1, R1, #2      ; i = 1
+OUTER:
+    LDW R3, R1, #0
+    XOR R0, R3, #-1
+    ADD R0, R0, #1
+    ADD R4, R1, #-2     ; j = i - 1
+INNER:
+    LDW R5, R4, #0
+    ADD R6, R5, R0      ; a[j] - key
+    BRnz PLACE
+    STW R5, R4, #1      ; a[j + 1] = a[j]
+    ADD R4, R4, #-2
+    BRnzp INNER
+PLACE:
+    STW R3, R4, #1      ; a[j + 1] = key
+    ADD R1, R1, #2
+    ADD R2, R2, #-1
+    BRp OUTER
+
+    ; Check the order and the sum, R3 = previous element, R6 = sum
+    LEA R6, CONST
+    LDW R1, R6, #0
+    LDW R2, R6, #1
+    ADD R2, R2, #-1
+    LDW R3, R1, #0
+    ADD R6, R3, #0
+CHECK:
+    ADD R1, R1, #2
+    LDW R4, R1, #0
+    ADD R6, R6, R4
+    XOR R5, R3, #-1
+    ADD R5, R5, #1
+    ADD R5, R4, R5      ; a[i] - a[i - 1]
+    BRn FAIL
+    ADD R3, R4, #0
+    ADD R2, R2, #-1
+    BRp CHECK
+    LEA R5, SUM
+    LDW R5, R5, #0
+    XOR R5, R5, R6
+    BRnp FAIL
+
+    ; Look every element up, then the odd value after it
+    LEA R6, CONST
+    LDW R1, R6, #0
+    LDW R2, R6, #1
+SEARCH:
+    LDW R0, R1, #0
+    JSR BSEARCH
+    ADD R5, R5, #0
+    BRn FAIL
+    ADD R0, R0, #1
+    JSR BSEARCH
+    ADD R5, R5, #0
+    BRzp FAIL
+    ADD R1, R1, #2
+    ADD R2, R2, #-1
+    BRp SEARCH
+
+    LEA R6, CONST
+    LDW R0, R6, #4      ; R0 = x600D
+    HALT
+FAIL:
+    LEA R6, CONST
+    LDW R0, R6, #5      ; R0 = x0BAD
+    HALT
+
+    ; Binary search for R0, R5 = its index or -1. R1 and R2 are saved,
+    ; R1 = -key, R3 = low, R4 = high, R5 = middle.
+BSEARCH:
+    LEA R6, SAVE
+    STW R1, R6, #0
+    STW R2, R6, #1
+    XOR R1, R0, #-1
+    ADD R1, R1, #1
+    AND R3, R3, #0
+    LEA R4, CONST
+    LDW R4, R4, #1
+    ADD R4, R4, #-1
+BLOOP:
+    XOR R6, R3, #-1
+    ADD R6, R6, #1
+    ADD R6, R4, R6      ; high - low
+    BRn BMISS
+    ADD R5, R3, R4
+    RSHFL R5, R5, #1
+    LSHF R6, R5, #1
+    LEA R2, ARRAY
+    ADD R6, R6, R2
+    LDW R6, R6, #0
+    ADD R6, R6, R1      ; a[middle] - key
+    BRz BDONE
+    BRp BLOWER
+    ADD R3, R5, #1
+    BRnzp BLOOP
+BLOWER:
+    ADD R4, R5, #-1
+    BRnzp BLOOP
+BMISS:
+    AND R5, R5, #0
+    ADD R5, R5, #-1
+BDONE:
+    LEA R6, SAVE
+    LDW R1, R6, #0
+    LDW R2, R6, #1
+    RET
+
+CONST:  .FILL ARRAY
+        .FILL #160      ; N
+        .FILL x1234     ; seed
+        .FILL x7FFE
+        .FILL x600D
+        .FILL x0BAD
+SUM:    .FILL #0
+SAVE:   .BLKW #2
+        .FILL #0        ; smaller than any element
+ARRAY:  .BLKW #160
+
+.END
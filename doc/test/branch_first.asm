@@ -0,0 +1,14 @@
+; Regression test: a branch that is the first instruction fetched
+; Resolved in decode, the branch must redirect fetch once, so the first
+; ADD is skipped.
+; Expected: R1 = x0001
+
+        .ORIG x3000
+
+        BRnzp SKIP          ; First instruction, always taken
+        ADD R1, R1, #1      ; Skipped
+SKIP    ADD R1, R1, #1      ; R1 = 1
+
+        TRAP x25            ; HALT
+
+        .END
@@ -184,7 +184,7 @@ class LC3bAssembler:
         
         dr = self.parse_register(parts[1], line_num)
         sr = self.parse_register(parts[2], line_num)
-        amount = self.parse_immediate(parts[3], line_num, 4)
+        amount = self.parse_immediate(parts[3], line_num, 5)  # amount4 is unsigned
         
         if amount > 15:
             raise AssemblerError(f"Line {line_num}: Shift amount must be 0-15")
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+LC-3b Regression Tests
+Runs small programs through the simulator and the batch runner in the
+configurations that once went wrong and checks the registers they halt
+with, their statistics or where they stop. The exit status is 1 if any
+test failed.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(os.path.dirname(TEST_DIR))
+BENCH_DIR = os.path.join(REPO_DIR, 'doc', 'bench')
+sys.path.insert(0, TEST_DIR)
+
+from lc3b_assembler import LC3bAssembler
+
+
+def assemble(program: str, directory: str = TEST_DIR) -> str:
+    """Assemble program.asm into program.obj unless the object is up to date"""
+    source = os.path.join(directory, program + '.asm')
+    target = os.path.join(directory, program + '.obj')
+    if not os.path.exists(target) or os.path.getmtime(target) < os.path.getmtime(source):
+        with open(os.devnull, 'w') as quiet:
+            stdout, sys.stdout = sys.stdout, quiet
+            try:
+                LC3bAssembler().assemble_file(source, target)
+            finally:
+                sys.stdout = stdout
+    return target
+
+
+def registers(args, program: str, options: list, run: str = 'go') -> dict:
+    """Run program to HALT at the prompt, with run, and return the registers it ended with"""
+    command = [args.sim] + options + [args.ucode, assemble(program)]
+    with tempfile.TemporaryDirectory() as scratch:  # go writes dumpsim.txt
+        process = subprocess.run(command, input=run + '\nrdump\nquit\n', cwd=scratch, stdout=subprocess.PIPE,
+                                 stderr=subprocess.PIPE, universal_newlines=True, timeout=args.timeout)
+    return {int(number): int(value, 16) for number, value in re.findall(r'^([0-7]): 0x([0-9A-Fa-f]{4})$',
+                                                                       process.stdout, re.MULTILINE)}
+
+
+def statistics(args, program: str, options: list, directory: str = TEST_DIR) -> dict:
+    """Run program headless and return the statistics it registered"""
+    command = [args.sim, '-stats', '-format', 'json'] + options + [args.ucode, assemble(program, directory)]
+    with tempfile.TemporaryDirectory() as scratch:
+        process = subprocess.run(command, cwd=scratch, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                                 universal_newlines=True, timeout=args.timeout)
+    if process.returncode != 0:
+        raise subprocess.SubprocessError(process.stderr.strip() or 'exit status %d' % process.returncode)
+    return json.loads(process.stdout)['statistics']['stats']
+
+
+def expect_registers(program: str, options: list, expected: dict, run: str = 'go'):
+    """A test that program halts with the expected registers"""
+    def test(args) -> list:
+        found = registers(args, program, options, run)
+        return ['R%d = x%04X, expected x%04X' % (number, found[number], value) if number in found else
+                'R%d not dumped' % number for number, value in expected.items() if found.get(number) != value]
+    return test
+
+
+def expect_error(options: list, batch: bool = False):
+    """A test that the simulator, or the batch runner, rejects options with exit status 1 and the error on standard error"""
+    def test(args) -> list:
+        command = [args.batch] + options if batch else [args.sim] + options + [args.ucode, assemble('example')]
+        with tempfile.TemporaryDirectory() as scratch:
+            process = subprocess.run(command, cwd=scratch, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                                     universal_newlines=True, timeout=args.timeout)
+        problems = [] if process.returncode == 1 else ['exit status %d' % process.returncode]
+        return problems + ([] if process.stderr.startswith('Error: ') else ['no error on standard error'])
+    return test
+
+
+def expect_batch_limits(args) -> list:
+    """A test that the batch runner stops a job at the -cycles or -insts of its line, or else at its own -cycles"""
+    program = assemble('sort', BENCH_DIR)
+    jobs = [(['-cycles', '1000'], 'cycles', 1000), (['-insts', '50'], 'instructions', 50), ([], 'cycles', 2000)]
+    with tempfile.TemporaryDirectory() as scratch:
+        job_file = os.path.join(scratch, 'jobs.txt')
+        with open(job_file, 'w') as f:
+            for options, _, _ in jobs:
+                f.write(' '.join(options + [args.ucode, program]) + '\n')
+        process = subprocess.run([args.batch, '-cycles', '2000', job_file], cwd=scratch, stdout=subprocess.PIPE,
+                                 stderr=subprocess.PIPE, universal_newlines=True, timeout=args.timeout)
+    results = re.findall(r'^\S+\s+(halted|limit)\s+cycles (\d+)\s+instructions (\d+)', process.stdout, re.MULTILINE)
+    if process.returncode != 0 or len(results) != len(jobs):
+        return [process.stdout.strip() or process.stderr.strip() or 'exit status %d' % process.returncode]
+    problems = []
+    for (options, counter, limit), (ended, cycles, instructions) in zip(jobs, results):
+        count = int(cycles) if counter == 'cycles' else int(instructions)
+        if ended != 'limit' or count != limit:
+            problems.append('job %s %s after %d %s, expected the limit at %d' %
+                            (' '.join(options) or '-', ended, count, counter, limit))
+    return problems
+
+
+def expect_filled(program: str, options: list, directory: str = TEST_DIR, most: int = 8):
+    """A test that the CPI stack charges no more than the first fill of the pipeline to it being empty"""
+    def test(args) -> list:
+        empty = statistics(args, program, options, directory)['pipeline.cpi_stack']['empty']
+        return ['%d cycles charged to an empty pipeline' % empty] if empty > most else []
+    return test
+
+
+TESTS = [
+    # a branch resolved in decode as the first instruction fetched redirected fetch twice
+    ('branch_first -resolve de', expect_registers('branch_first', ['-resolve', 'de'], {1: 0x0001})),
+    ('branch_first -resolve agex', expect_registers('branch_first', ['-resolve', 'agex'], {1: 0x0001})),
+    ('branch_first -resolve mem', expect_registers('branch_first', ['-resolve', 'mem'], {1: 0x0001})),
+    ('branch_first -resolve de -width 2', expect_registers('branch_first', ['-resolve', 'de', '-width', '2'], {1: 0x0001})),
+    # a block decoded from code that was written afterwards kept running
+    ('self_modify ff', expect_registers('self_modify', [], {1: 0x0006}, 'ff 1000')),
+    ('self_modify ff -jit', expect_registers('self_modify', ['-jit'], {1: 0x0006}, 'ff 1000')),
+    # the cycles a younger lane waited in decode on a source went to the empty pipeline
+    ('cpi_stack example -width 2', expect_filled('example', ['-width', '2'])),
+    ('cpi_stack example -width 2 -bpred static', expect_filled('example', ['-width', '2', '-bpred', 'static'])),
+    ('cpi_stack example -width 2 -bpred gshare', expect_filled('example', ['-width', '2', '-bpred', 'gshare'])),
+    ('cpi_stack dhry -width 2 -bpred static', expect_filled('dhry', ['-width', '2', '-bpred', 'static'], BENCH_DIR)),
+    # the batch runner ignored the limits of the job lines and ran them to HALT
+    ('batch limits', expect_batch_limits),
+    # a bad option printed its error on standard output and exited with status 255
+    ('error -bogus', expect_error(['-bogus'])),
+    # values that were not numbers became 0, negative counts wrapped around
+    ('error -cycles abc', expect_error(['-cycles', 'abc'])),
+    ('error -insts -5', expect_error(['-insts', '-5'])),
+    ('error -sample -1', expect_error(['-sample', '-1'])),
+    # the batch runner printed its errors and usage on standard output
+    ('batch error -j abc', expect_error(['-j', 'abc', 'jobs.txt'], batch=True)),
+    ('batch error no job file', expect_error(['-cycles', '10'], batch=True)),
+    ('batch error missing job file', expect_error(['missing.txt'], batch=True)),
+]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Run the LC-3b regression tests.')
+    parser.add_argument('--sim', default=os.path.join(REPO_DIR, 'build', 'source', 'lC3b'), help='simulator executable')
+    parser.add_argument('--batch', default=os.path.join(REPO_DIR, 'build', 'source', 'lC3b-batch'), help='batch runner executable')
+    parser.add_argument('--ucode', default=os.path.join(TEST_DIR, 'ucode'), help='micro-code file')
+    parser.add_argument('--timeout', type=float, default=120, help='seconds a run may take (120)')
+    parser.add_argument('tests', nargs='*', help='tests to run, by a part of their name (all)')
+    args = parser.parse_args()
+    args.sim, args.batch, args.ucode = os.path.abspath(args.sim), os.path.abspath(args.batch), os.path.abspath(args.ucode)
+
+    failed = 0
+    for name, test in TESTS:
+        if args.tests and not any(part in name for part in args.tests):
+            continue
+        try:
+            problems = test(args)
+        except (OSError, subprocess.SubprocessError) as error:
+            problems = [str(error)]
+        failed += bool(problems)
+        print('%-44s %s' % (name, '; '.join(problems) or 'ok'))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
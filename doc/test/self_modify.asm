@@ -0,0 +1,27 @@
+; Regression test: a store into the code the functional core runs
+; Each pass adds one more than the last, by rewriting the immediate of
+; PATCH. The third pass runs a block decoded in the second, so it must
+; have been dropped. The store to DATA shares a page with the code and
+; must not disturb it.
+; Expected: R1 = x0006
+
+        .ORIG x3000
+
+        AND R1, R1, #0
+        AND R2, R2, #0
+        ADD R2, R2, #3      ; Three passes
+        LEA R3, PATCH
+LOOP    LEA R5, DATA
+        STW R2, R5, #0      ; Data in the page of the code
+PATCH   ADD R1, R1, #1      ; Adds 1, then 2, then 3
+        LDW R4, R3, #0
+        ADD R4, R4, #1
+        STW R4, R3, #0
+        ADD R2, R2, #-1
+        BRp LOOP
+
+        TRAP x25            ; HALT
+
+DATA    .FILL x0000
+
+        .END
@@ -0,0 +1,92 @@
+/***************************************************************/
+/* BatchRunner.h: LC-3b Batch Runner Class Header File         */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/*
+* One simulation of a batch: the arguments of the command line without
+* the program name (options, micro-code file, program files) and the
+* cycles it may run, 0 runs it until HALT. -cycles or -insts among the
+* options take the place of max_cycles.
+*/
+struct BatchJob {
+  std::string name;
+  std::vector<std::string> arguments;
+  int max_cycles;
+};
+
+/*
+* The outcome of a job. A job that failed has its error and no state.
+*/
+struct BatchResult {
+  std::string name;
+  bool ok;
+  std::string error;
+  bool halted;        // reached HALT, otherwise stopped at a limit
+  int cycles;
+  uint64_t instructions;
+  uint16_t pc;
+  uint16_t regs[8];
+  double seconds;     // host time of the job
+};
+
+/*
+* Totals over the jobs of a batch
+*/
+struct BatchSummary {
+  int jobs;
+  int failed;
+  int halted;
+  uint64_t cycles;
+  uint64_t instructions;
+  double cpu_seconds;   // host time summed over the jobs
+  double wall_seconds;  // host time of the batch
+  int threads;
+};
+
+/*
+* Runs independent simulations on a pool of worker threads, one per
+* hardware thread unless told otherwise. Each simulator instance is
+* silent and owned by the worker running it, so the workers share
+* nothing but the job queues. Every worker has its own queue the jobs
+* are dealt into round robin; it takes its jobs from the back and, once
+* its queue is empty, steals from the front of the others', so a worker
+* that drew short jobs helps out with the long ones.
+*/
+class BatchRunner
+{
+  public:
+  BatchRunner(int threads = 0);
+  ~BatchRunner(){}
+
+  std::vector<BatchResult> Run(const std::vector<BatchJob> & jobs);
+  const BatchSummary & Summary() const { return summary; }
+  void dump(FILE * file, const std::vector<BatchResult> & results) const;
+
+  static BatchResult RunJob(const BatchJob & job);
+
+  private:
+  struct WorkQueue {
+    std::mutex lock;
+    std::deque<size_t> jobs;
+  };
+
+  void Worker(int id, const std::vector<BatchJob> & jobs, std::vector<BatchResult> & results);
+  bool NextJob(int id, size_t & job);
+
+  int threads;
+  std::vector<WorkQueue> queues;
+  BatchSummary summary;
+};
@@ -0,0 +1,122 @@
+/***************************************************************/
+/* BranchPredictor.h: LC-3b Branch Predictor Class Header File */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/*
+* One entry of the branch target buffer. Only control instructions
+* that were taken at least once are allocated.
+*/
+typedef struct BTB_Entry_Struct {
+  bool     valid,
+           conditional;
+  uint16_t tag,
+           target;
+} BTB_Entry;
+
+/*
+* One entry of the indirect target cache for JMP and JSRR.
+*/
+typedef struct ITC_Entry_Struct {
+  bool     valid;
+  uint16_t tag,
+           target;
+} ITC_Entry;
+
+/*
+* Return address stack state saved with every fetched instruction so
+* that a misprediction can undo the pushes and pops of the wrong path,
+* and the global history its prediction was made with so that it is
+* trained at the same gshare and indirect target cache entries.
+*/
+typedef struct RAS_Checkpoint_Struct {
+  uint16_t tos,
+           count,
+           top,
+           ghr;
+} RAS_Checkpoint;
+
+/*
+* Control instruction classes recognised from the fetched word.
+*/
+enum ControlKind {
+  CONTROL_OTHER,
+  CONTROL_CALL,           // JSR
+  CONTROL_INDIRECT_CALL,  // JSRR
+  CONTROL_RETURN,         // RET (JMP R7)
+  CONTROL_INDIRECT_JUMP   // JMP
+};
+
+class Simulator;
+class Statistics;
+class Checkpoint;
+class BranchPredictor
+{
+  public:
+  BranchPredictor(Simulator & instance);
+  ~BranchPredictor(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_predictor();
+  bool IsEnabled() const;
+  bits16 Predict(const bits16 & pc, const bits16 & ir, RAS_Checkpoint & checkpoint);
+  void Update(const bits16 & pc, const bits16 & ir, bool conditional, bool taken, const bits16 & target, bool mispredicted,
+              const RAS_Checkpoint & checkpoint);
+  void Recover(const RAS_Checkpoint & checkpoint, const bits16 & pc, const bits16 & ir);
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+  void Serialize(Checkpoint & cp);
+
+  private:
+  static ControlKind Classify(const bits16 & ir);
+  void PushReturnAddress(uint16_t address);
+  uint16_t PopReturnAddress();
+  uint16_t ItcIndex(uint16_t pc, uint16_t history) const;
+  bool PredictDirection(uint16_t pc, uint16_t target) const;
+  void UpdateCounter(uint8_t & counter, bool taken);
+  uint16_t BimodalIndex(uint16_t pc) const;
+  uint16_t GshareIndex(uint16_t pc, uint16_t history) const;
+
+  Simulator & _simulator;
+
+  /***************************************************************/
+  /* Prediction tables.                                          */
+  /***************************************************************/
+  std::vector<BTB_Entry> BTB;
+  std::vector<uint8_t> BIMODAL;
+  std::vector<uint8_t> GSHARE;
+  std::vector<uint8_t> CHOOSER;
+  uint16_t GHR;
+
+  std::vector<uint16_t> RAS;
+  uint16_t RAS_TOS,
+           RAS_COUNT;
+  std::vector<ITC_Entry> ITC;
+
+  /***************************************************************/
+  /* Statistics.                                                 */
+  /***************************************************************/
+  uint64_t lookups,
+           btb_hits,
+           conditional_branches,
+           unconditional_branches,
+           direction_mispredicts,
+           target_mispredicts,
+           ras_pushes,
+           ras_pops,
+           ras_overflows,
+           ras_underflows,
+           return_mispredicts,
+           itc_lookups,
+           itc_hits,
+           indirect_mispredicts;
+};
@@ -0,0 +1,93 @@
+/***************************************************************/
+/* Cache.h: LC-3b Cache Timing Model Class Header File         */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/*
+* Tag array of a set associative cache with LRU replacement. The data
+* always lives in MainMemory, the cache only decides when an access is
+* ready. A miss fetches its line in miss_latency cycles. Without MSHRs
+* the cache blocks and a single line is filled at a time, with them every
+* MSHR tracks the fill of one line and later misses to the same line are
+* merged into it. Every fill schedules a wake-up for the cycle its line
+* arrives. Models without timing Touch the cache instead, a miss fills
+* its line at once.
+*/
+class Statistics;
+class Checkpoint;
+class EventQueue;
+class Cache
+{
+  public:
+  Cache();
+  ~Cache(){}
+
+  void init_cache(int size_bytes, int line_bytes, int ways, int miss_latency, int mshrs = 0,
+                  EventQueue * events = nullptr);
+  bool IsEnabled() const { return !LINES.empty(); }
+  bool IsNonBlocking() const { return IsEnabled() && !MSHRS.empty(); }
+  bool Access(uint16_t address, int cycle);
+  int  Request(uint16_t address, int cycle);
+  bool Touch(uint16_t address);
+  void Cycle(int cycle);
+  void dump(FILE * console, FILE * dumpsim_file, const char * name);
+  void RegisterStats(Statistics & stats, const std::string & prefix);
+  void Serialize(Checkpoint & cp);
+
+  private:
+  struct Line {
+    bool valid;
+    uint16_t tag;
+    uint64_t last_use;
+    Line() : valid(false), tag(0), last_use(0) {}
+  };
+
+  /* miss status holding register, the addresses waiting on the line */
+  struct MSHR {
+    bool valid;
+    uint16_t line;
+    int fill_ready;
+    std::vector<uint16_t> targets;
+    MSHR() : valid(false), line(0), fill_ready(0) {}
+  };
+
+  bool Lookup(uint16_t line);
+  void Fill(uint16_t line);
+  void CompleteFills(int cycle);
+  int  Outstanding() const;
+
+  EventQueue * events;
+  std::vector<Line> LINES;
+  int sets;
+  int ways;
+  int line_bytes;
+  int miss_latency;
+  uint64_t use_count;
+
+  /* the line being fetched */
+  bool fill_pending;
+  uint16_t fill_line;
+  int fill_ready;
+
+  /* outstanding misses of the non-blocking cache */
+  std::vector<MSHR> MSHRS;
+
+  /* statistics */
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t miss_cycles;
+  uint64_t secondary_misses;
+  uint64_t hits_under_miss;
+  uint64_t misses_under_miss;
+  uint64_t mshr_full;
+  std::vector<uint64_t> outstanding;  // cycles with n misses outstanding
+};
@@ -0,0 +1,129 @@
+/***************************************************************/
+/* Checkpoint.h: LC-3b Checkpoint Class Header File            */
+/***************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/***************************************************************/
+/* File format identification. The version is bumped whenever  */
+/* the layout of a section changes.                            */
+/***************************************************************/
+#define CHECKPOINT_MAGIC    "LC3BCKPT"
+#define CHECKPOINT_VERSION  2
+
+/***************************************************************/
+/* Words in a memory page, pages of zeros are not written.     */
+/***************************************************************/
+#define CHECKPOINT_PAGE_WORDS 256
+#define CHECKPOINT_END_PAGES  0xffff
+
+/*
+* Saves and restores the whole simulator of the in-order pipeline so that
+* a restored run goes on cycle for cycle as the original would have.
+*
+* The file is the magic, the version, the options the checkpoint was
+* taken with and then one section per component: the simulator cycle,
+* the control store, State, main memory with its caches, the branch
+* predictor, the store buffer, the pipeline latches and queues, and the
+* table of the instructions in flight they refer to. Integers are little
+* endian of their native size; memory is written in pages, skipping those
+* that are all zeros.
+*
+* Every component walks its state once in Serialize, and the same walk
+* writes or reads depending on the direction, so the two never disagree
+* on the layout. Latches and queues refer to an instruction by its index
+* in the table, one instruction held by several latches stays shared.
+* Statistics and the timing diagram history restart at the restored
+* cycle.
+*/
+class Simulator;
+class Instruction;
+class Checkpoint
+{
+  public:
+  Checkpoint(Simulator & instance);
+  ~Checkpoint(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  bool Save(const char * filename);
+  bool Restore(const char * filename);
+  bool IsRestoring() const { return restoring; }
+
+  template<typename T> void Value(T & value);
+  template<size_t N> void Bits(bitfield<N> & bits);
+  template<typename T> void Size(T & container);
+  void String(std::string & value);
+  void Reference(std::shared_ptr<Instruction> & inst);
+  void Corrupt() { truncated = true; }
+  bool IsCorrupt() const { return truncated; }
+
+  private:
+  void Write(uint64_t value, int bytes);
+  uint64_t Read(int bytes);
+  std::vector<uint8_t> ConfigBytes();
+  void Sections();
+  void Instructions();
+
+  Simulator & _simulator;
+  bool restoring;
+  bool truncated;   // read past the end or found a value out of range
+  std::vector<uint8_t> data;
+  size_t position;
+
+  /* instructions in flight, a reference is an index plus one, 0 is none */
+  std::vector<std::shared_ptr<Instruction>> instructions;
+  std::unordered_map<const Instruction *, uint32_t> instruction_ids;
+  std::vector<std::pair<std::shared_ptr<Instruction> *, uint32_t>> fixups;
+};
+
+/*
+* An integer, bool or enum in sizeof(T) bytes
+*/
+template<typename T>
+void Checkpoint::Value(T & value)
+{
+  if(restoring)
+    value = (T)Read(sizeof(T));
+  else
+    Write((uint64_t)value, sizeof(T));
+}
+
+template<size_t N>
+void Checkpoint::Bits(bitfield<N> & bits)
+{
+  typename bitfield<N>::native_type value = bits.to_num();
+  Value(value);
+  if(restoring)
+    bits = value;
+}
+
+/*
+* The element count of a vector or deque, which is resized on restore.
+* Every element takes at least a byte, a larger count is corrupt.
+*/
+template<typename T>
+void Checkpoint::Size(T & container)
+{
+  uint32_t size = container.size();
+  Value(size);
+  if(restoring)
+  {
+    if(size > data.size() - position)
+    {
+      truncated = true;
+      size = 0;
+    }
+    container.resize(size);
+  }
+}
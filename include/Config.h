@@ -0,0 +1,133 @@
+/***************************************************************/
+/* Config.h: LC-3b Simulator Configuration Header File         */
+/***************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/***************************************************************/
+/* Direction predictors selectable from the command line.      */
+/***************************************************************/
+enum PredictorType {
+  PREDICT_NONE,       // stall the front end on every control instruction
+  PREDICT_STATIC,     // backward taken, forward not taken
+  PREDICT_BIMODAL,    // 2-bit counters indexed by PC
+  PREDICT_GSHARE,     // 2-bit counters indexed by PC xor global history
+  PREDICT_TOURNAMENT  // bimodal and gshare with a 2-bit chooser
+};
+
+/***************************************************************/
+/* Timing models selectable from the command line.             */
+/***************************************************************/
+enum CoreType {
+  CORE_IN_ORDER,      // the latch based pipeline
+  CORE_OUT_OF_ORDER,  // Tomasulo core with a reorder buffer
+  CORE_INTERVAL       // analytical model of the in-order pipeline, driven by the functional core
+};
+
+/***************************************************************/
+/* Formats of the results of a headless run.                   */
+/***************************************************************/
+enum OutputFormat {
+  OUTPUT_TEXT,        // the rdump, mdump and stats dump text
+  OUTPUT_JSON         // one JSON object
+};
+
+/***************************************************************/
+/* Largest number of cycles a split stage may take.            */
+/***************************************************************/
+#define MAX_STAGE_DEPTH 8
+
+/*
+* Simulator options. Every field has a default that reproduces the
+* original stall-on-branch 5-stage pipeline.
+*/
+class Checkpoint;
+class Config
+{
+  public:
+  Config();
+  ~Config(){}
+
+  int  parse(int argc, char *argv[]);
+  void usage(const char * program) const;
+  void Serialize(Checkpoint & cp);
+
+  /* branch prediction */
+  PredictorType predictor;
+  int btb_entries;
+  int bht_entries;
+  int history_bits;
+  int ras_entries;
+  int itc_entries;
+
+  /* pipeline depth, cycles spent in each splittable stage */
+  int fetch_stages;
+  int agex_stages;
+  int mem_stages;
+
+  /* instructions fetched, decoded and issued per cycle */
+  int issue_width;
+
+  /* stage that selects the next PC of control instructions other than TRAP */
+  Stages resolve_stage;
+
+  /* decode a flag setting ALU op and the branch behind it as one operation */
+  bool macro_fusion;
+
+  /* instructions buffered between fetch and decode, 0 couples the two */
+  int fetch_queue_entries;
+
+  /* caches, a size of 0 is an ideal single cycle memory */
+  int icache_size;
+  int dcache_size;
+  int line_size;
+  int cache_ways;
+  int miss_latency;
+  int mshr_entries;      // misses the data cache keeps in flight, 0 blocks
+
+  /* stores retired ahead of the data cache, 0 writes from the MEM stage */
+  int store_buffer_entries;
+
+  /* out-of-order core */
+  CoreType core;
+  int rob_entries;
+  int rs_entries;
+  int lsq_entries;
+
+  /* translate hot blocks of the functional core to host code */
+  bool jit;
+
+  /* check every write back of the pipeline against a reference model */
+  bool golden_check;
+
+  /* run the interval model beside the pipeline and report its error */
+  bool validate_interval;
+
+  /* SMARTS sampling: a window of the pipeline every sample_period instructions */
+  uint64_t sample_period;         // 0 simulates every instruction in detail
+  uint64_t sample_window;         // instructions measured per window
+  uint64_t sample_warmup;         // detailed instructions before each window
+  double sample_error;            // percent at 95% confidence to stop sampling at, 0 samples to HALT
+
+  /* jump over the cycles in which the pipeline waits on an event */
+  bool skip_idle;
+
+  /* headless run, without the command prompt */
+  bool headless;
+  int max_cycles;                 // stop before HALT after this many cycles, 0 has no limit
+  uint64_t max_instructions;      // or this many retired instructions
+  bool dump_registers;
+  std::vector<std::pair<int, int>> memory_dumps;  // byte address ranges
+  bool dump_statistics;
+  std::string output_file;        // empty writes to the console
+  OutputFormat output_format;
+};
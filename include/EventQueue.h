@@ -0,0 +1,53 @@
+/***************************************************************/
+/* EventQueue.h: LC-3b Event Queue Class Header File           */
+/***************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <limits.h>
+#include <queue>
+#include <vector>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/*
+* Cycles at which a component changes state without the pipeline moving:
+* a cache line arrives, a pending load writes back, the statistics take a
+* snapshot. Components schedule a wake-up whenever they start waiting on
+* one. A cycle in which the pipeline left every latch and queue as it
+* found them repeats itself until the next wake-up, so the simulator can
+* jump there. A wake-up that turns out not to be needed only ends a jump
+* early, one that is missing would make it wrong.
+*/
+class Simulator;
+class Statistics;
+class EventQueue
+{
+  public:
+  EventQueue(Simulator & instance);
+  ~EventQueue(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_events();
+  bool IsEnabled() const { return enabled; }
+  void Schedule(int cycle);
+  int  NextEvent(int cycle);
+  bool IsWaiting(int cycle) { return NextEvent(cycle) != INT_MAX; }
+  void Skipped(int cycles);
+  void RegisterStats(Statistics & stats);
+
+  private:
+  Simulator & _simulator;
+  bool enabled;
+
+  /* wake-ups, earliest first */
+  std::priority_queue<int, std::vector<int>, std::greater<int>> wakeups;
+
+  /* statistics */
+  uint64_t skips;
+  uint64_t skipped_cycles;
+};
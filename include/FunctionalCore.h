@@ -0,0 +1,170 @@
+/***************************************************************/
+/* FunctionalCore.h: LC-3b Functional Core Class Header File   */
+/***************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/***************************************************************/
+/* Run() without a PC to stop at.                              */
+/***************************************************************/
+#define NO_STOP_PC -1
+
+/***************************************************************/
+/* Most instructions decoded into one basic block.             */
+/***************************************************************/
+#define MAX_BLOCK_OPS 32
+
+/***************************************************************/
+/* Executions of a block before the JIT translates it.         */
+/***************************************************************/
+#define JIT_THRESHOLD 64
+
+class FunctionalCore;
+struct MicroOp;
+struct GuestContext;
+typedef uint16_t (*MicroOpHandler)(FunctionalCore & core, const MicroOp & op);
+typedef uint16_t (*NativeBlock)(GuestContext * context);
+
+/*
+* The kinds of instruction a handler is specialised for
+*/
+enum MicroOpKind {
+  OP_GENERIC,   // anything, through the whole datapath
+  OP_ALU,       // ADD, AND, XOR
+  OP_SHIFT,     // LSHF, RSHFL, RSHFA
+  OP_ADDRESS,   // LEA
+  OP_LOAD,      // LDW, LDB
+  OP_STORE,     // STW, STB
+  OP_BRANCH,    // BR
+  OP_JUMP       // JMP, JSR, JSRR
+};
+
+/*
+* Architectural state the functional core runs on. Translated blocks
+* address it through a pointer, so it is kept a plain struct.
+*/
+struct GuestContext {
+  uint16_t regs[8];
+  bool n, z, p;
+  uint32_t executed;        // instructions the last translated block ran
+  FunctionalCore * core;
+};
+
+/*
+* An instruction decoded once from its control store row, with its
+* registers, immediates and PC relative addresses resolved. The handler
+* executes it and returns the next PC.
+*/
+struct MicroOp {
+  MicroOpHandler handler;
+  uint16_t ir;
+  uint16_t npc;
+  uint16_t imm;      // ALU immediate or shift control
+  uint16_t offset;   // added to SR1 for a base register address
+  uint16_t target;   // address that does not depend on a register
+  uint8_t dr, sr1, sr2;
+  uint8_t nzp;       // conditions a branch is taken on
+  bool ld_cc;
+  uint8_t kind;      // MicroOpKind of the handler
+  uint8_t aluk;
+  bool use_imm;      // ALU source 2 is the immediate
+  bool base;         // address is SR1 plus offset
+  bool word;         // word rather than byte access
+  bool link;         // jump writes the return address
+};
+
+/*
+* The instructions from start up to the first control instruction. Each
+* static successor is chained to its block, the link is only followed
+* while no code was written since it was made.
+*/
+struct BasicBlock {
+  uint16_t start;
+  std::vector<MicroOp> ops;
+  uint16_t exit_pc[2];          // fall through and PC relative target
+  BasicBlock * exit_block[2];
+  uint64_t exit_epoch[2];
+  uint64_t runs;
+  NativeBlock native;           // translated code, if the block got hot
+};
+
+/*
+* Instruction set level interpreter. It executes instructions on the
+* registers, condition codes and PC in State and on the main memory,
+* driven by the same control store rows as the detailed cores but
+* without latches, caches, timing or history. Used to fast-forward to the
+* region of interest, the detailed core then goes on from the same state.
+*
+* Code is decoded once into basic blocks of micro-ops kept by start PC.
+* Writing a word blocks were decoded from drops those blocks, memory only
+* reports writes to pages that blocks were decoded from.
+* With -jit a block that ran JIT_THRESHOLD times is handed to the
+* JitCompiler and runs as host code from then on.
+*/
+class Simulator;
+class Statistics;
+class IntervalModel;
+class FunctionalCore
+{
+  public:
+  FunctionalCore(Simulator & instance);
+  ~FunctionalCore(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_functional();
+  void Step();
+  uint64_t Run(uint64_t count, int stop_pc, IntervalModel * model = nullptr);
+  bool InvalidateWord(int addr);
+  void RegisterStats(Statistics & stats);
+  uint64_t GetExecutedInstructions() const { return executed_instructions; }
+
+  private:
+  void LoadState();
+  void StoreState(uint16_t pc);
+  uint16_t ReadWord(uint16_t address);
+  MicroOp Decode(uint16_t pc);
+  BasicBlock * Lookup(uint16_t pc);
+  BasicBlock * Translate(uint16_t pc);
+  BasicBlock * NextBlock(BasicBlock * block, uint16_t pc);
+  void CompileBlock(BasicBlock * block);
+  void SetCC(uint16_t value);
+
+  /* micro-op handlers, one per kind of instruction */
+  static uint16_t Generic(FunctionalCore & core, const MicroOp & op);
+  template<int ALUK, bool IMM> static uint16_t AluOp(FunctionalCore & core, const MicroOp & op);
+  static uint16_t ShiftOp(FunctionalCore & core, const MicroOp & op);
+  template<bool BASE> static uint16_t AddressOp(FunctionalCore & core, const MicroOp & op);
+  template<bool WORD, bool BASE> static uint16_t LoadOp(FunctionalCore & core, const MicroOp & op);
+  template<bool WORD, bool BASE> static uint16_t StoreOp(FunctionalCore & core, const MicroOp & op);
+  static uint16_t BranchOp(FunctionalCore & core, const MicroOp & op);
+  template<bool BASE, bool LINK> static uint16_t JumpOp(FunctionalCore & core, const MicroOp & op);
+
+  Simulator & _simulator;
+
+  friend class JitCompiler;
+
+  /* architectural state, copied from State while running */
+  GuestContext context;
+
+  /* translation cache, a block dropped while it runs is freed after the run */
+  std::unordered_map<uint16_t, std::unique_ptr<BasicBlock>> blocks;
+  std::vector<std::unique_ptr<BasicBlock>> dropped_blocks;
+  uint64_t epoch;
+
+  /* statistics */
+  uint64_t executed_instructions;
+  uint64_t blocks_translated;
+  uint64_t blocks_invalidated;
+  uint64_t chained_exits;
+  uint64_t native_instructions;
+};
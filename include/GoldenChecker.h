@@ -0,0 +1,90 @@
+/***************************************************************/
+/* GoldenChecker.h: LC-3b Golden Model Checker Header File     */
+/***************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/*
+* What one instruction does to the architectural state: the register and
+* condition codes it writes and the memory it stores to
+*/
+struct GoldenEffect {
+  uint16_t pc;
+  uint16_t ir;
+  bool ld_reg;
+  int dr;
+  uint16_t value;
+  bool ld_cc;
+  int nzp;            // N, Z and P as bits 2, 1 and 0
+  bool store;
+  bool word;          // a store of both bytes, otherwise of one
+  uint16_t address;   // byte address of the store
+  uint16_t data;      // the word, or the byte in the low half
+};
+
+/*
+* Lockstep checker of the in-order pipeline. It keeps a reference
+* machine of its own, an interpreter of the ISA that decodes the
+* instruction bits rather than the control store, which it only asks
+* which instructions set the condition codes, and steps it once for
+* every instruction the pipeline writes back, in program order. The PC,
+* the instruction, the register and condition codes it writes and its
+* store must match what the reference did, the first difference stops
+* the simulation with a SimulatorError describing it. A load that left
+* MEM on a data cache miss is checked as it passes SR, with the data it
+* will write back. When the simulator halts the memory image is compared
+* as well.
+*
+* Sync copies the architectural state over whenever the pipeline was
+* not the one to get there: after loading the program, fast-forwarding
+* and restoring a checkpoint. The PC is then taken from the next
+* instruction to write back.
+*/
+class Simulator;
+class Instruction;
+class Statistics;
+class GoldenChecker
+{
+  public:
+  GoldenChecker(Simulator & instance);
+  ~GoldenChecker(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_checker();
+  bool IsEnabled() const { return enabled; }
+  void Sync(bool drained);
+  void Retire(const Instruction & inst, bool ld_reg, const bits3 & drid, const bits16 & value,
+              bool ld_cc, const bits3 & nzp);
+  void Finish();
+  void RegisterStats(Statistics & stats);
+
+  private:
+  GoldenEffect Step();
+  uint16_t Word(uint16_t address) const;
+  void Diverged(const Instruction & inst, const std::vector<std::string> & differences);
+
+  Simulator & _simulator;
+  bool enabled;
+
+  /* the reference machine */
+  uint16_t pc;
+  bool pc_known;          // false until the first write back after a Sync
+  uint16_t regs[8];
+  int nzp;
+  std::vector<uint8_t> memory;
+  uint64_t next_seq;      // a load waiting in SR is seen again, skip what was checked
+
+  /* statistics */
+  uint64_t checked;
+  uint64_t stores_checked;
+  uint64_t syncs;
+};
@@ -0,0 +1,80 @@
+/***************************************************************/
+/* InstructionMix.h: LC-3b Instruction Mix Class Header File   */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/***************************************************************/
+/* Histogram buckets, the last bucket of each also counts      */
+/* everything above it.                                        */
+/***************************************************************/
+#define MIX_OPCODES           16
+#define LATENCY_BUCKETS       16
+#define LATENCY_BUCKET_WIDTH  4
+#define STAGE_BUCKETS         16
+
+/*
+* The stages an instruction spends its cycles in, named after the first
+* letter of the stage in the timing diagram of either core
+*/
+enum MixStage {
+  MIX_FETCH,     // F, the extra fetch stages and the fetch queue
+  MIX_DECODE,    // D, decode or dispatch
+  MIX_EXECUTE,   // E, AGEX or execute
+  MIX_MEMORY,    // M, including a load waiting on a miss after it left MEM
+  MIX_RETIRE,    // W and S, write back and commit
+  NUM_MIX_STAGES
+};
+
+enum AddressingMode {
+  MODE_REGISTER,     // ALU ops with SR2, JMP and JSRR
+  MODE_IMMEDIATE,    // ALU ops with imm5, shifts
+  MODE_BASE_OFFSET,  // loads and stores
+  MODE_PC_RELATIVE,  // BR, JSR and LEA
+  MODE_TRAP_VECTOR,  // TRAP
+  MODE_NONE,         // RTI and the reserved opcodes
+  NUM_ADDRESSING_MODES
+};
+
+/*
+* Dynamic instruction mix and latencies. Both cores hand every instruction
+* that writes back or commits to Retire, which counts it by opcode and
+* addressing mode and adds its fetch to retire latency and the cycles of
+* each stage, read from its timing diagram row, to fixed size histograms.
+*/
+class Simulator;
+class Instruction;
+class Statistics;
+class InstructionMix
+{
+  public:
+  InstructionMix(Simulator & instance);
+  ~InstructionMix(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_mix();
+  void Retire(const Instruction & inst, int cycle);
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+
+  private:
+  static AddressingMode ModeOf(const bits16 & ir);
+  static bool IsReserved(int opcode) { return opcode == 10 || opcode == 11; }
+
+  Simulator & _simulator;
+  uint64_t retired;
+  uint64_t opcode_count[MIX_OPCODES];
+  uint64_t mode_count[NUM_ADDRESSING_MODES];
+  uint64_t latency_sum[MIX_OPCODES];
+  uint64_t latency[MIX_OPCODES][LATENCY_BUCKETS];
+  uint64_t stage_sum[MIX_OPCODES][NUM_MIX_STAGES];
+  uint64_t stage_cycles[MIX_OPCODES][NUM_MIX_STAGES][STAGE_BUCKETS];
+};
@@ -0,0 +1,154 @@
+/***************************************************************/
+/* IntervalModel.h: LC-3b Interval Model Class Header File     */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+    #include "../include/MicroSequencer.h"
+    #include "../include/Cache.h"
+    #include "../include/BranchPredictor.h"
+    #include "../include/PipeLine.h"
+#else
+    #include "LC3b.h"
+    #include "MicroSequencer.h"
+    #include "Cache.h"
+    #include "BranchPredictor.h"
+    #include "PipeLine.h"
+#endif
+
+/***************************************************************/
+/* Instructions the functional core runs between two looks at  */
+/* the limits of an interval run.                              */
+/***************************************************************/
+#define INTERVAL_CHUNK 4096
+
+/*
+* What the model needs to know of an instruction, from the control store
+* row it decodes to
+*/
+struct IntervalOp {
+  bool sr1_needed;
+  bool sr2_needed;
+  bool ld_reg;
+  bool ld_cc;
+  bool drmux;        // writes R7
+  bool alu_cc;       // sets the condition codes from the ALU, a fusion producer
+  bool memory;
+  bool store;
+  bool br_op;        // conditional branch
+  bool control;      // holds the front end until it resolves
+  bool trap;
+};
+
+/*
+* Analytical model of the in-order pipeline. Instead of moving latches
+* it is handed the instructions in program order and works out, for
+* each, the cycle it leaves decode: one issue slot after the instruction
+* in front of it, later if the fetch of its line missed, if the front end
+* waited on a control instruction, if a source marked by SR1.NEEDED or
+* SR2.NEEDED is written by an older instruction that has not written
+* back, or if the MEM stage is held by a data cache miss. The extra
+* cycles go to the CPI stack under the cause of the latest of these, so
+* the estimate has the stack of the detailed pipeline with its causes.
+* The model keeps no instructions in flight, only the cycle each
+* register and the condition codes are written back, and handles an
+* instruction in a few dozen host instructions.
+*
+* With -core interval the functional core drives it and its estimate is
+* the cycle count of the simulator, the caches and the predictor are
+* those of the simulator. With -validate the detailed pipeline runs as
+* usual and hands the model every instruction that leaves MEM, the model
+* then uses caches and a predictor of its own and reports its error.
+* With -sample it warms the caches and the predictor of the simulator
+* between the windows of the pipeline.
+*/
+class Simulator;
+class Statistics;
+class Instruction;
+class IntervalModel
+{
+  public:
+  IntervalModel(Simulator & instance);
+  ~IntervalModel(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_interval();
+  bool IsEnabled() const { return enabled; }
+  bool IsValidating() const { return validating; }
+  void Execute(uint16_t pc, uint16_t ir, uint16_t address);
+  void Observe(const Instruction & inst);
+  void Finish(uint16_t next_pc);
+  int  GetCycles() const { return (int)cycles; }
+  uint64_t GetRetiredInstructions() const { return retired; }
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+
+  private:
+  void Account(uint16_t next_pc);
+  void Charge(uint64_t issue, uint64_t bound, CpiCause cause, uint64_t & latest, CpiCause & latest_cause);
+  void ChargeControl(uint64_t wait, CpiCause resolved_cause);
+
+  Simulator & _simulator;
+  bool enabled;
+  bool validating;
+
+  /* decoded control store rows, by row */
+  IntervalOp ops[CONTROL_STORE_ROWS];
+
+  /* the machine being modelled */
+  int fetch_stages;
+  int agex_stages;
+  int mem_stages;
+  int issue_width;
+  int miss_latency;
+  Stages resolve_stage;
+  bool fusion;
+  bool store_buffer;
+  bool non_blocking;
+
+  /* the caches and predictor the model uses, with -validate its own */
+  Cache * icache;
+  Cache * dcache;
+  BranchPredictor * predictor;
+  Cache own_icache;
+  Cache own_dcache;
+  BranchPredictor own_predictor;
+
+  /* the instruction handed over last, accounted once its successor is known */
+  bool pending;
+  uint16_t pending_pc;
+  uint16_t pending_ir;
+  uint16_t pending_address;
+  uint64_t next_seq;            // with -validate, pipeline order of the next one
+
+  /* timeline of the instruction accounted last */
+  bool started;
+  uint64_t last_fetch;          // cycle its fetch completed
+  uint64_t last_decode;         // cycle it entered decode
+  uint64_t last_issue;          // cycle it entered AGEX
+  uint64_t last_mem_done;       // last cycle it spent in MEM
+  uint64_t next_fetch;          // earliest cycle of the next fetch
+  CpiCause next_fetch_cause;    // what held the next fetch back
+  int fetch_lane;
+  int issue_lane;
+  bool last_sets_alu_cc;        // fused with a conditional branch behind it
+  IntervalOp last_op;
+  uint16_t last_pc;
+  uint16_t last_dr;
+
+  /* cycle from which decode may issue an instruction reading each name */
+  uint64_t ready[SCOREBOARD_NAMES];
+
+  /* estimate */
+  uint64_t cycles;
+  uint64_t retired;
+  uint64_t cpi_stack[NUM_CPI_CAUSES];
+  uint64_t icache_misses;
+  uint64_t dcache_misses;
+  uint64_t mispredicts;
+  uint64_t dependency_stalls;
+};
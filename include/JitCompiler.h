@@ -0,0 +1,87 @@
+/***************************************************************/
+/* JitCompiler.h: LC-3b JIT Compiler Class Header File         */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <initializer_list>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+    #include "../include/FunctionalCore.h"
+#else
+    #include "LC3b.h"
+    #include "FunctionalCore.h"
+#endif
+
+/***************************************************************/
+/* Size of the executable buffer translations are placed in.   */
+/***************************************************************/
+#define JIT_BUFFER_BYTES (1 << 20)
+
+/*
+* Translates hot basic blocks of the functional core to x86-64 code in an
+* mmap'd buffer that is only writable while a translation is copied in and
+* only executable otherwise. A block is a function of the GuestContext that
+* keeps the guest registers and condition codes; it returns the next PC
+* and leaves the instructions it ran in the context. ALU, shift, LEA and
+* control instructions run inline, loads and stores call back into
+* MainMemory so that a write to code drops translations as it does for
+* the handlers. A block returns to the interpreter in front of the first
+* instruction it has no translation for, such as TRAP.
+*
+* Every translation is listed in /tmp/perf-<pid>.map for the perf
+* profiler, a flush rewrites the map without the translations it dropped.
+* On hosts other than x86-64 Linux the JIT stays disabled.
+*/
+class Simulator;
+class Statistics;
+class JitCompiler
+{
+  public:
+  JitCompiler(Simulator & instance);
+  ~JitCompiler();
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_jit();
+  bool IsEnabled() const { return buffer != nullptr; }
+  bool IsFull() const { return full; }
+  NativeBlock Compile(const BasicBlock & block);
+  void Flush();
+  void RegisterStats(Statistics & stats);
+
+  private:
+  void Release();
+  bool Protect(size_t offset, size_t bytes, bool writable);
+
+  /* x86-64 encoding */
+  void Emit(std::initializer_list<uint8_t> bytes);
+  void Emit32(uint32_t value);
+  void Emit64(uint64_t value);
+  void EmitLoadReg(int host_reg, int guest_reg);
+  void EmitStoreReg(int guest_reg);
+  void EmitSetCC();
+  void EmitCall(const void * helper);
+  void EmitExit(uint32_t executed);
+  bool EmitOp(const MicroOp & op, uint32_t index);
+
+  /* called from translated code */
+  static uint16_t LoadWord(GuestContext * context, uint16_t address);
+  static uint16_t LoadByte(GuestContext * context, uint16_t address);
+  static uint32_t StoreWord(GuestContext * context, uint16_t address, uint16_t value);
+  static uint32_t StoreByte(GuestContext * context, uint16_t address, uint16_t value);
+
+  Simulator & _simulator;
+  uint8_t * buffer;
+  size_t buffer_used;
+  bool full;
+  std::vector<uint8_t> code;
+  bool perf_map;
+
+  /* statistics */
+  uint64_t blocks_compiled;
+  uint64_t code_bytes;
+  uint64_t flushes;
+};
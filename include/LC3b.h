@@ -3,6 +3,11 @@
 /***************************************************************/
 #pragma once
 
+#include <cstdarg>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
 #ifdef __linux__ 
     #include "../include/BitField.h"
 #else
@@ -29,6 +34,30 @@
     inline void Exit() { system("pause"); exit(-1); }
 #endif
 
+/***************************************************************/
+/* Errors of the simulator are thrown so that one failing      */
+/* instance does not end the process; the front ends print     */
+/* them and Exit().                                            */
+/***************************************************************/
+class SimulatorError : public std::runtime_error
+{
+  public:
+  explicit SimulatorError(const std::string & message) : std::runtime_error(message) {}
+};
+
+/*
+* printf formatting into a string, for the message of a SimulatorError
+*/
+inline std::string Format(const char * format, ...)
+{
+  char text[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  return text;
+}
+
 /***************************************************************/
 /* Definition of bit order in control store word.              */
 /***************************************************************/
@@ -106,6 +135,11 @@ enum SR_CS_BITS {
   NUM_SR_CS_BITS
 };
 
+/***************************************************************/
+/* Most instructions a pipeline stage holds at once.           */
+/***************************************************************/
+#define MAX_ISSUE_WIDTH 2
+
 enum Stages {  
   DECODE,
   AGEX,
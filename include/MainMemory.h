@@ -6,8 +6,10 @@
 #include <vector>
 #ifdef __linux__
     #include "../include/LC3b.h"
+    #include "../include/Cache.h"
 #else
     #include "LC3b.h"
+    #include "Cache.h"
 #endif
 
 /***************************************************************/
@@ -15,7 +17,14 @@
 /***************************************************************/
 #define WORDS_IN_MEM    0x08000
 
+/***************************************************************/
+/* Words in a page the functional core tracks code writes by.  */
+/***************************************************************/
+#define CODE_PAGE_WORDS 64
+
 class Simulator;
+class Statistics;
+class Checkpoint;
 class MainMemory
 {
   public:
@@ -30,10 +39,21 @@ class MainMemory
   bits8 GetUpperByteAt(const bits16 & address) const;
   void SetUpperByteAt(const bits16 & address, bits8 val);
   void dcache_access(const bits16 & dcache_addr, bits16 & read_word, const bits16 & write_word, bool & dcache_r, bool mem_w0, bool mem_w1);
+  int  dcache_request(const bits16 & dcache_addr, bits16 & read_word);
+  bool IsDataCacheNonBlocking() const { return DCache.IsNonBlocking(); }
+  Cache & icache() { return ICache; }
+  Cache & dcache() { return DCache; }
   void icache_access(const bits16 & icache_addr, bits16 & read_word, bool & icache_r);
   void mdump(FILE * dumpsim_file, const bits16 & start, const bits16 & stop);
+  void Cycle();
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+  void Serialize(Checkpoint & cp);
+  void MarkCodePage(int page) { code_pages[page] = true; }
 
   private:
+  void CodeWritten(int addr);
+
   Simulator & _simulator;
   /***************************************************************/
   /* Main memory.                                                */
@@ -44,4 +64,11 @@ class MainMemory
    the least significant byte of a word. WE1 is used for the most significant
    byte of a word. */
   std::vector<std::vector<bits8>> MEMORY;
+
+  /* pages the functional core decoded blocks from */
+  std::vector<bool> code_pages;
+
+  /* timing of the caches in front of the memory */
+  Cache ICache;
+  Cache DCache;
 };
\ No newline at end of file
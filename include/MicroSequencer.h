@@ -16,19 +16,21 @@
 #define CONTROL_STORE_ROWS 64
 
 class Simulator;
+class Checkpoint;
 class MicroSequencer
 {
   public:
   MicroSequencer(Simulator & intance);
   ~MicroSequencer(){}
 
-  Simulator & simulator() { return _simulator; }
+  Simulator & simulator() const { return _simulator; }
 
   void Initialize();
   void init_control_store(char *ucode_filename);
   void SetMicroCodeBitsAt(uint8_t index, uint8_t bits, bool val);
   bool GetMicroCodeBitsAt(uint8_t index, uint8_t bits) const;
   cs_bits & GetMicroCodeAt(uint8_t row);
+  cs_bits & GetMicroCodeFor(const bits16 & ir);
 
   /***************************************************************/
   /* Functions to get at the control bits.                       */
@@ -37,6 +39,11 @@ class MicroSequencer
   bool Get_SR2_NEEDED(const cs_bits & x) const         { return (x[SR2_NEEDED]); }
   bool Get_DRMUX(const cs_bits & x) const              { return (x[DRMUX]);}
   bool Get_DE_BR_OP(const cs_bits & x) const           { return (x[BR_OP]); }
+  bool Get_DE_TRAP_OP(const cs_bits & x) const         { return (x[TRAP_OP]); }
+  bool Get_DE_DCACHE_EN(const cs_bits & x) const       { return (x[DCACHE_EN]); }
+  bool Get_DE_LD_REG(const cs_bits & x) const          { return (x[LD_REG]); }
+  bool Get_DE_LD_CC(const cs_bits & x) const           { return (x[LD_CC]); }
+  bits2 Get_DE_DR_VALUEMUX(const cs_bits & x) const    { return ((x[DR_VALUEMUX1] << 1) + x[DR_VALUEMUX0]); }
   bool Get_ADDR1MUX(const agex_cs_bits & x) const      { return (x[AGEX_ADDR1MUX]); }
   bits2 Get_ADDR2MUX(const agex_cs_bits & x) const     { return ((x[AGEX_ADDR2MUX1] << 1) + x[AGEX_ADDR2MUX0]); }
   bool Get_LSHF1(const agex_cs_bits & x) const         { return (x[AGEX_LSHF1]); }
@@ -63,6 +70,7 @@ class MicroSequencer
 
   void print_CS(const cs_bits & CS, int num) const;
   void cdump(FILE * dumpsim_file) const;
+  void Serialize(Checkpoint & cp);
 
   private:
   Simulator & _simulator;
@@ -11,12 +11,18 @@
     #include "LC3b.h"
 #endif
 
-class Latch;
+/*
+* Combinational datapath blocks of the execute stage. The control signals
+* come from the AGEX control bits carried by the instruction, so the
+* in-order pipeline and the out-of-order core compute the same values.
+*/
+class Instruction;
 class OperationUnit
 {
     public:
     virtual ~OperationUnit() = default;
-    static std::unique_ptr<OperationUnit> MakeUnit(Latch & latch);
+    virtual bits16 Output() const = 0;
+    static std::unique_ptr<OperationUnit> MakeUnit(const Instruction & inst);
 };
 
 class Shifter : public OperationUnit
@@ -24,6 +30,10 @@ class Shifter : public OperationUnit
     public:
     Shifter(bits16 source, bitfield<6> control);
     ~Shifter(){}
+    bits16 Output() const override { return result; }
+
+    private:
+    bits16 result;
 };
 
 class Alu : public OperationUnit
@@ -31,4 +41,22 @@ class Alu : public OperationUnit
     public:
     Alu(bits16 source1, bits16 source2, bits2 control);
     ~Alu(){}
+    bits16 Output() const override { return result; }
+
+    private:
+    bits16 result;
+};
+
+/*
+* Address adder: ADDR1MUX + (ADDR2MUX << LSHF1), or the trap vector
+*/
+class AddressUnit : public OperationUnit
+{
+    public:
+    AddressUnit(const Instruction & inst);
+    ~AddressUnit(){}
+    bits16 Output() const override { return result; }
+
+    private:
+    bits16 result;
 };
@@ -0,0 +1,157 @@
+/***************************************************************/
+/* OutOfOrderCore.h: LC-3b Out-of-Order Core Class Header File */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include <deque>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+    #include "../include/PipeLine.h"
+#else
+    #include "LC3b.h"
+    #include "PipeLine.h"
+#endif
+
+/***************************************************************/
+/* Fetched instructions buffered per fetch lane, unless -fq    */
+/* sets the queue size.                                        */
+/***************************************************************/
+#define FETCH_QUEUE_DEPTH 4
+
+/***************************************************************/
+/* Rename table: R0-R7 and the condition codes.                */
+/***************************************************************/
+#define RENAME_CC       8
+#define RENAME_ENTRIES  9
+#define NO_TAG         -1
+
+class Instruction;
+
+/*
+* Reorder buffer entry. An instruction owns one from dispatch to commit
+* and the index of the entry is the tag its result is renamed to.
+*/
+struct ROB_Entry {
+  std::shared_ptr<Instruction> instruction;
+  bool valid;
+  bool executing;      // issued, the result arrives at complete_cycle
+  bool done;           // result written back, ready to commit
+  int complete_cycle;
+  bool ld_reg;
+  bool ld_cc;
+  bool control;        // BR_STALL instruction, resolved on write back
+  bool taken;
+  int lsq;             // load/store queue entry or -1
+  bits16 value;        // destination register value
+  bits3 nzp;           // condition codes set by value
+  bits16 next_pc;      // resolved address of the next instruction
+  ROB_Entry() : valid(false), executing(false), done(false), complete_cycle(0),
+                ld_reg(false), ld_cc(false), control(false), taken(false), lsq(-1) {}
+};
+
+/*
+* Reservation station, holds an instruction until its operands are
+* captured from the register file, the reorder buffer or the result bus
+*/
+struct RS_Entry {
+  bool busy;
+  int rob;
+  int sr1_tag;
+  int sr2_tag;
+  int cc_tag;
+  RS_Entry() : busy(false), rob(NO_TAG), sr1_tag(NO_TAG), sr2_tag(NO_TAG), cc_tag(NO_TAG) {}
+};
+
+/*
+* Load/store queue entry, allocated in program order at dispatch.
+* Stores write memory when they commit.
+*/
+struct LSQ_Entry {
+  bool valid;
+  int rob;
+  bool store;
+  bool word;
+  bool address_ready;  // address and store data known from ready_cycle on
+  int ready_cycle;
+  bool accessed;       // load read memory or got its data forwarded
+  LSQ_Entry() : valid(false), rob(NO_TAG), store(false), word(false),
+                address_ready(false), ready_cycle(0), accessed(false) {}
+};
+
+class Simulator;
+class Statistics;
+class OutOfOrderCore
+{
+  public:
+  OutOfOrderCore(Simulator & instance);
+  ~OutOfOrderCore(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_core();
+  void Cycle();
+  void Flush();
+  void idump(FILE * dumpsim_file);
+  void DumpHistory();
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+  uint64_t GetRetiredInstructions() const { return retired_instructions; }
+
+  private:
+  void Commit();
+  void WriteBack();
+  void Issue();
+  void MemoryAccess();
+  void Dispatch();
+  void Fetch();
+  void UpdateHistory();
+
+  void Execute(RS_Entry & rs);
+  void Broadcast(int tag);
+  void ResolveControl(int tag);
+  void Squash(uint64_t seq);
+  void RebuildRenameTable();
+  void Retire(const std::shared_ptr<Instruction> & inst, const std::string & stage);
+  int  ReadOperand(int reg, bits16 & value);
+  bool IsYounger(int tag, uint64_t seq) const;
+  bits16 LoadData(const bits16 & address, bool word, const bits16 & mdr) const;
+  bits16 StoreData(const bits16 & address, bool word, const bits16 & data) const;
+
+  Simulator & _simulator;
+  int cycle;
+  int width;
+  int fetch_queue_depth;
+
+  /* front end */
+  bits16 fetch_pc;
+  bool fetch_blocked;    // waiting for a control instruction without a predictor
+  uint64_t fetch_seq;
+  std::deque<std::shared_ptr<Instruction>> fetch_queue;
+
+  /* renaming, the tag of the youngest in-flight producer of each name */
+  int rename_table[RENAME_ENTRIES];
+
+  /* circular reorder buffer and load/store queue */
+  std::vector<ROB_Entry> ROB;
+  int rob_head, rob_count;
+  std::vector<LSQ_Entry> LSQ;
+  int lsq_head, lsq_count;
+  std::vector<RS_Entry> RS;
+
+  /* statistics */
+  uint64_t retired_instructions;
+  uint64_t rob_occupancy;
+  uint64_t rob_full_stalls;
+  uint64_t rs_full_stalls;
+  uint64_t lsq_full_stalls;
+  uint64_t loads_forwarded;
+  uint64_t load_blocked_cycles;
+  uint64_t flushes;
+  uint64_t squashed_instructions;
+
+  // Traces of the instructions that left the core since the last idump
+  std::vector<InstructionTrace> instruction_history;
+};
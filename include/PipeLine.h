@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
+#include <functional>
 #ifdef __linux__ 
     #include "../include/LC3b.h"
 #else
@@ -19,17 +21,72 @@
 * as it moves through the pipeline.
 */
 struct InstructionTrace {
+    uint64_t seq;
     uint16_t pc;
     std::string disassembled;
     std::map<int, std::string> cycle_history;
     uint16_t mem_addr;
     bool mem_addr_valid;
-    InstructionTrace() : pc(0), mem_addr(0), mem_addr_valid(false) {}
+    InstructionTrace() : seq(0), pc(0), mem_addr(0), mem_addr_valid(false) {}
 };
 
+/***************************************************************/
+/* Scoreboard names: R0-R7 and the condition codes.            */
+/***************************************************************/
+#define SCOREBOARD_CC     8
+#define SCOREBOARD_NAMES  9
+
 class Latch;
+class Instruction;
+class Statistics;
+class Checkpoint;
 typedef std::vector<std::shared_ptr<Latch>> PipeState;
 
+/*
+* Reasons a younger instruction in decode cannot issue with the older one
+*/
+enum PairConflict {
+  PAIR_OK,
+  PAIR_RAW,          // reads the destination of the older instruction
+  PAIR_CC,           // branch on the condition codes the older one sets
+  PAIR_MEMORY_PORT,  // the data cache has a single port
+  PAIR_BRANCH,       // a single branch unit, no memory access behind a branch
+  NUM_PAIR_CONFLICTS
+};
+
+/*
+* The cause a cycle is charged to in the CPI stack. A cycle that writes
+* back an instruction is a base cycle, any other cycle goes to the first
+* cause in this order that held the pipeline. A cycle without any goes
+* to the stall that left the bubble in SR, or to an empty pipeline.
+*/
+enum CpiCause {
+  CPI_BASE,             // an instruction wrote back
+  CPI_ICACHE,           // fetch waits on an instruction cache miss
+  CPI_DEP_REGISTER,     // decode waits on a register an older instruction writes
+  CPI_DEP_CC,           // decode waits on the condition codes only
+  CPI_CONTROL_MEMORY,   // the front end waits on a control instruction in MEM
+  CPI_CONTROL_AGEX,     // ... in AGEX
+  CPI_CONTROL_SPLIT,    // ... in an extra cycle of a split stage
+  CPI_CONTROL_DECODE,   // ... in decode
+  CPI_DCACHE,           // MEM waits on the data cache or a full store buffer
+  CPI_EMPTY,            // nothing held the pipeline, it has no instruction to write back
+  NUM_CPI_CAUSES
+};
+
+/*
+* A load that missed in the non-blocking data cache. It left the MEM stage
+* with its data and writes back once its line has arrived.
+*/
+struct PendingLoad {
+  std::shared_ptr<Instruction> instruction;
+  int ready_cycle;   // cycle the load writes back
+  bits3 drid;        // captured, a bubble in the MEM latch still runs the stage logic
+  bits16 data;
+  bool ld_reg;       // cleared when a younger instruction writes the register first
+  bool ld_cc;
+};
+
 class Simulator;
 class PipeLine
 {
@@ -39,33 +96,67 @@ class PipeLine
 
   Simulator & simulator() { return _simulator; }
   Latch & latch(Stages stage, const PipeState & latch);
+  Latch & entry_latch(Stages stage, const PipeState & latch);
 
   void idump(FILE * dumpsim_file);
+  static void PrintTimingDiagram(FILE * console, FILE * dumpsim_file, std::vector<InstructionTrace> & instruction_history, int current_cycle);
 
   /***************************************************************/
   /* These are the functions you'll have to write.               */
   /***************************************************************/
   void init_pipeline();
   void SetStage(Stages stage) { current_stage = stage; }
+  void SetLane(int lane) { current_lane = lane; }
   void FETCH_stage();
   void DE_stage();
   void AGEX_stage();
   void MEM_stage();
   void SR_stage();
+  void SUB_stage(int index);
   void Cycle();
   void PropagatePipeLine();
   void MoveLatch(const PipeState & destination, const PipeState & source);
   bool IsStallDetected();
+  bool IsBackEndStallDetected();
   bool IsBranchTaken();
+  bool IsRedirectDetected();
+  bool IsRedirectDetected(int lane);
+  int BranchLane();
+  PairConflict CheckPairing();
+  void ResolveControl(std::shared_ptr<Instruction> inst);
+  void BranchLogic(std::shared_ptr<Instruction> inst);
+  Stages ResolveStage(const Instruction & inst);
   bool IsControlInstruction();
   bool IsOperateInstruction();
   bool IsMemoryMoveInstruction();
   void ProcessRegisterFile(const bits16 & de_instruction);
   bool CheckForDataDependencies();
+  void ScoreboardSet(Instruction & inst, uint16_t names);
+  void ScoreboardClear(Instruction & inst, uint16_t names = 0xffff);
+  int  FindFusionProducer(std::shared_ptr<Instruction> & producer);
+  void QueueFetchGroup(bool ld_de, bool redirect, const bool * lane_valid,
+                       const std::function<std::shared_ptr<Instruction>(int)> & fetched_instruction);
+  void CompletePendingLoads(bool all);
+  void Flush();
+  void AccountCycle(uint64_t retired_before);
   void UpdateHistory();
   void DumpHistory();
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+  void Serialize(Checkpoint & cp);
+  void CpiStack(FILE * dumpsim_file);
+  uint64_t GetRetiredInstructions() const { return retired_instructions; }
+  const std::deque<PendingLoad> & PendingLoads() const { return pending_loads; }
+  bool IsInStoreLatch(const Instruction & inst);
+  int ControlPenalty() const { return stage_latch[resolve_stage] + 1; }
+  bool IsIdle() const { return idle; }
+  void SkipIdle(int cycles);
 
   private:
+  void BuildLatches(int fetch_stages, int agex_stages, int mem_stages, int width);
+  void Signature(std::vector<uintptr_t> & signature);
+  int LatchIndex(int position) const { return position * issue_width + current_lane; }
+
   Simulator & _simulator;
 
   /* data structure for latch */
@@ -73,6 +164,75 @@ class PipeLine
   PipeState NEW_PS;
 
   Stages current_stage;
+  int current_lane;
+  int issue_width;
+
+  /* A stage split into n cycles owns n latch positions. The stage logic works on
+     the last one, the others only carry the instruction forward. The extra
+     fetch cycles sit in front of the decode latch. Every position holds
+     one latch per issue lane. */
+  std::vector<int> stage_latch;
+  std::vector<std::string> latch_name;
+  std::string fetch_name;
+
+  /* fetch order of the next instruction and retirement count */
+  uint64_t fetch_seq;
+  uint64_t retired_instructions;
+
+  /* register and condition code writes in flight: a name stays pending
+     while an issued instruction that writes it has not written back */
+  uint16_t scoreboard;
+  uint8_t scoreboard_writers[SCOREBOARD_NAMES];
+
+  /* superscalar issue statistics */
+  int issued_this_cycle;
+  uint64_t issue_cycles[MAX_ISSUE_WIDTH + 1];
+  uint64_t pair_conflicts[NUM_PAIR_CONFLICTS];
+
+  /* stage that selects the next PC, control instructions resolved in front of MEM */
+  Stages resolve_stage;
+  uint64_t early_resolved;
+  uint64_t resolve_cycles_saved;
+
+  /* macro-op fusion of a flag setting ALU op with the next branch */
+  bool fusion_enabled;
+  uint64_t branches_issued;
+  uint64_t fused_branches;
+  uint64_t fusion_cycles_saved;
+
+  /* a load read the data cache this cycle, the store buffer waits */
+  bool dcache_port_busy;
+
+  /* loads waiting on the non-blocking data cache, oldest first */
+  std::deque<PendingLoad> pending_loads;
+  std::map<uint64_t, std::string> pending_stage;  // "L" waiting or "S" written back this cycle
+  uint64_t loads_past_miss;      // loads that left the MEM stage on a miss
+  uint64_t pending_load_stalls;  // cycles decode waited only on a pending load
+
+  /* decoupled front end, fetched instructions wait here for decode */
+  int fetch_queue_depth;
+  std::deque<std::shared_ptr<Instruction>> fetch_queue;
+  bool fetch_queue_full;
+  bool fetch_queue_control;
+  std::map<uint64_t, std::string> queue_stage;  // "Q" waiting or "X" flushed this cycle
+  std::vector<uint64_t> queue_occupancy;
+  uint64_t hidden_fetch_stalls;     // fetch delivered nothing but decode was fed
+  uint64_t decoupled_fetch_cycles;  // fetch went on while decode was held
+
+  /* CPI stack, every cycle is charged to one cause */
+  bool dep_on_cc;         // the dependency stall of this cycle waits on the condition codes only
+  bool pair_dep_stall;    // the younger lane waits on a source, an older lane's included
+  bool pair_on_cc;        // ... on the condition codes only
+  Stages resolved_stage;  // stage whose branch logic resolved a control instruction this cycle
+  std::deque<CpiCause> owed_bubbles;  // causes of the bubbles still on their way to SR
+  uint64_t cpi_stack[NUM_CPI_CAUSES];
+
+  /* idle cycle detection, a cycle is idle when it ends with the latches and
+     queues it started with. A stalled fetch may still fetch a new bubble. */
+  std::vector<uintptr_t> signature;
+  std::vector<uintptr_t> last_signature;
+  bool idle;
+  uint64_t idle_fetches;   // bubbles fetched in the last cycle
 
   // A vector to store the history of every instruction fetched.
   std::vector<InstructionTrace> instruction_history;
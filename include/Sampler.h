@@ -0,0 +1,80 @@
+/***************************************************************/
+/* Sampler.h: LC-3b Sampled Simulation Class Header File       */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/***************************************************************/
+/* Normal quantile of the two-sided 95% confidence interval.   */
+/***************************************************************/
+#define SAMPLE_Z 1.96
+
+/***************************************************************/
+/* Fewest windows whose spread -error trusts to stop sampling. */
+/***************************************************************/
+#define SAMPLE_MIN_WINDOWS 10
+
+/*
+* SMARTS-style sampled simulation of the in-order pipeline. The program
+* is cut into units of -sample instructions. The most of each unit runs
+* on the functional core, which hands every instruction to the interval
+* model so the caches and the branch predictor see the whole program.
+* The end of the unit runs on the pipeline: -warmup instructions to fill
+* it and settle what functional warming cannot, then a window of -window
+* instructions whose CPI is one sample. The pipeline is flushed before
+* the functional core takes over again.
+*
+* The CPI of the program is estimated as the mean of the samples, with a
+* confidence interval from their spread, and the cycles as that CPI
+* times all instructions run. With -error sampling stops once the
+* interval is within the target, the rest of the program then runs on
+* the functional core alone.
+*/
+class Simulator;
+class Statistics;
+class Sampler
+{
+  public:
+  Sampler(Simulator & instance);
+  ~Sampler(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_sampler();
+  bool IsEnabled() const { return enabled; }
+  bool Run(uint64_t max_instructions);
+  double GetCpi() const;
+  double GetCpiError() const;
+  double GetCycles() const { return GetCpi() * GetInstructions(); }
+  uint64_t GetInstructions() const { return functional_instructions + detailed_instructions; }
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+
+  private:
+  bool Detailed(uint64_t count);
+  void Warm(uint64_t count);
+
+  Simulator & _simulator;
+  bool enabled;
+  uint64_t period;
+  uint64_t window;
+  uint64_t warmup;
+  double target;        // relative error to stop at, 0 samples to HALT
+  bool converged;       // the target was met, no more windows
+
+  /* CPI of each window */
+  std::vector<double> samples;
+
+  /* instructions run on each model */
+  uint64_t functional_instructions;
+  uint64_t detailed_instructions;
+  int detailed_cycles;
+};
@@ -6,14 +6,40 @@
 #include<memory>
 #ifdef __linux__ 
     #include "../include/LC3b.h"
+    #include "../include/Config.h"
 #else
     #include "LC3b.h"
+    #include "Config.h"
 #endif
 
+/***************************************************************/
+/* Exit status of a headless run.                              */
+/***************************************************************/
+#define HEADLESS_HALTED 0   // the program reached HALT
+#define HEADLESS_ERROR  1   // a file, option or the simulation failed
+#define HEADLESS_LIMIT  2   // stopped at -cycles or -insts before HALT
+
+/***************************************************************/
+/* Fewest idle cycles ahead worth measuring one and jumping.   */
+/***************************************************************/
+#define MIN_IDLE_SKIP   4
+
 class PipeLine;
 class MainMemory;
 class State;
 class MicroSequencer;
+class BranchPredictor;
+class OutOfOrderCore;
+class StoreBuffer;
+class Statistics;
+class InstructionMix;
+class FunctionalCore;
+class JitCompiler;
+class Checkpoint;
+class GoldenChecker;
+class EventQueue;
+class IntervalModel;
+class Sampler;
 
 class Simulator
 {
@@ -25,25 +51,71 @@ class Simulator
   MainMemory & memory() {return *CpuMemory; }
   State & state() {return *CpuState; }
   MicroSequencer & microsequencer() {return *CpuMicroSequencer; }
+  BranchPredictor & predictor() {return *CpuBranchPredictor; }
+  OutOfOrderCore & ooo() {return *CpuOutOfOrderCore; }
+  StoreBuffer & storebuffer() {return *CpuStoreBuffer; }
+  Statistics & statistics() {return *CpuStatistics; }
+  InstructionMix & mix() {return *CpuInstructionMix; }
+  FunctionalCore & functional() {return *CpuFunctionalCore; }
+  JitCompiler & jit() {return *CpuJitCompiler; }
+  GoldenChecker & checker() {return *CpuGoldenChecker; }
+  EventQueue & events() {return *CpuEventQueue; }
+  IntervalModel & interval() {return *CpuIntervalModel; }
+  Sampler & sampler() {return *CpuSampler; }
+  Config & config() {return CpuConfig; }
   
   void help();  
   void cycle();
+  void skip_idle(int stop_cycle);
   void run(int num_cycles);
   void go();
-  void get_command();  
+  bool simulate(int max_cycles, uint64_t max_instructions);
+  void fast_forward(uint64_t count, int stop_pc);
+  void halt();
+  bool get_command();  
+  int  headless();
+  void stats_command();
+  void checkpoint(const char * filename);
+  void restore(const char * filename);
+  void Serialize(Checkpoint & cp);
   void load_program(char *program_filename);
-  void initialize(char *ucode_filename, char *program_filename, uint16_t num_prog_files);
+  void initialize(char *ucode_filename, char *program_filenames[], uint16_t num_prog_files);
   int  GetCycles() const { return CYCLE_COUNT; }
   bool GetRunBit() const { return RUN_BIT; }
+  bool IsOutOfOrder() const { return CpuConfig.core == CORE_OUT_OF_ORDER; }
+  bool IsInterval() const { return CpuConfig.core == CORE_INTERVAL; }
+  uint64_t GetRetiredInstructions();
 
-  //HACK
-  FILE* dump_file;
+  /* where the simulator writes, each may be nullptr to stay silent */
+  void SetOutput(FILE * console, FILE * dump) { console_file = console; dump_file = dump; }
+  FILE * console() { return console_file; }
+  FILE * dumpfile() { return dump_file; }
+  void Print(const char * format, ...);
 
   private:
+  void write_text(FILE * results, bool halted);
+  void write_json(FILE * results, bool halted);
+  bool estimate(int max_cycles, uint64_t max_instructions);
+
+  FILE * console_file;
+  FILE * dump_file;
+
+  Config CpuConfig;
   std::shared_ptr<MainMemory> CpuMemory;
   std::shared_ptr<MicroSequencer> CpuMicroSequencer;
   std::shared_ptr<PipeLine> CpuPipeline;
   std::shared_ptr<State> CpuState;
+  std::shared_ptr<BranchPredictor> CpuBranchPredictor;
+  std::shared_ptr<OutOfOrderCore> CpuOutOfOrderCore;
+  std::shared_ptr<StoreBuffer> CpuStoreBuffer;
+  std::shared_ptr<Statistics> CpuStatistics;
+  std::shared_ptr<InstructionMix> CpuInstructionMix;
+  std::shared_ptr<FunctionalCore> CpuFunctionalCore;
+  std::shared_ptr<JitCompiler> CpuJitCompiler;
+  std::shared_ptr<GoldenChecker> CpuGoldenChecker;
+  std::shared_ptr<EventQueue> CpuEventQueue;
+  std::shared_ptr<IntervalModel> CpuIntervalModel;
+  std::shared_ptr<Sampler> CpuSampler;
 
 
   /* A cycle counter */
@@ -3,7 +3,6 @@
 /***************************************************************/
 #pragma once
 
-#include <vector>
 #ifdef __linux__
     #include <stdio.h>
     #include "../include/LC3b.h"
@@ -67,11 +66,15 @@ typedef struct PipeState_Hazards_Struct {
        v_de_br_stall,
        v_agex_br_stall,
        v_mem_br_stall,
+       v_sub_br_stall,
+       v_resolve_br_stall,
+       pair_stall,
        mem_stall,
        icache_r;
 } Stall_Entry;
 
 class Simulator;
+class Checkpoint;
 class State
 {
   public:
@@ -81,21 +84,24 @@ class State
   Simulator & simulator() { return _simulator; }
 
   void init_state();
+  void init_signals();
   void SetProgramCounter(const bits16 & val) { PC = val; }
   bits16 GetProgramCounter() const {return PC; }
   bool GetNBit() const { return N; };
   bool GetPBit() const { return P; };
   bool GetZBit() const { return Z; };
   bits3 GetNZP();
+  void SetNZP(const bits3 & nzp);
   void SetDataForRegister(const bits3 & reg, const bits16 & data);
   bits16 GetRegisterData(const bits3 & reg) const;
   void rdump(FILE * dumpsim_file);
+  void Serialize(Checkpoint & cp);
 
   Stall_Entry & Stall() { return stall_sigs; }
-  AGEX_Stage_Entry & AgexSignals() {return agex_sigs; }
-  DE_Stage_Entry & DecodeSignals() {return decode_sigs; }
-  MEMORY_stage_Entry & MemSignals() {return memory_sigs; }
-  STORE_stage_Entry & SrSignals() {return store_sigs; }
+  AGEX_Stage_Entry & AgexSignals(int lane = 0) {return agex_sigs[lane]; }
+  DE_Stage_Entry & DecodeSignals(int lane = 0) {return decode_sigs[lane]; }
+  MEMORY_stage_Entry & MemSignals(int lane = 0) {return memory_sigs[lane]; }
+  STORE_stage_Entry & SrSignals(int lane = 0) {return store_sigs[lane]; }
 
 
   private:
@@ -103,7 +109,7 @@ class State
   /**************************************************************/
   /* The LC3-b registers                                        */
   /**************************************************************/
-  std::vector<bits16> REGS;
+  bits16 REGS[LC3b_REGS];
 
   /***************************************************************/
   /* architectural state                                         */
@@ -113,9 +119,10 @@ class State
        Z,    /* z condition bit */
        P;	   /* p condition bit */
 
-  DE_Stage_Entry decode_sigs;
-  AGEX_Stage_Entry agex_sigs;
-  MEMORY_stage_Entry memory_sigs;
-  STORE_stage_Entry store_sigs;
+  /* one set of stage signals per issue lane, the stalls hold all lanes */
+  DE_Stage_Entry decode_sigs[MAX_ISSUE_WIDTH];
+  AGEX_Stage_Entry agex_sigs[MAX_ISSUE_WIDTH];
+  MEMORY_stage_Entry memory_sigs[MAX_ISSUE_WIDTH];
+  STORE_stage_Entry store_sigs[MAX_ISSUE_WIDTH];
   Stall_Entry stall_sigs;
 };
\ No newline at end of file
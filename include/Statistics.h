@@ -0,0 +1,81 @@
+/***************************************************************/
+/* Statistics.h: LC-3b Statistics Registry Class Header File   */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+/***************************************************************/
+/* Kinds of statistics a component can register.               */
+/***************************************************************/
+enum StatKind {
+  STAT_SCALAR,     // one counter
+  STAT_VECTOR,     // a fixed array of counters, one label each
+  STAT_HISTOGRAM,  // bucket i counts the cycles or events with value i
+  STAT_FORMULA     // computed from other counters when it is read
+};
+
+/*
+* A registered statistic. The counters stay plain integers owned and
+* incremented by the component, the registry only keeps their address,
+* so counting costs nothing more than it did before.
+*/
+struct StatEntry {
+  StatKind kind;
+  std::string name;                 // dotted path, e.g. dcache.misses
+  std::string description;
+  uint64_t * counters;              // scalar and vector
+  std::vector<std::string> labels;  // one per vector counter
+  std::vector<uint64_t> * buckets;  // histogram
+  std::function<double()> formula;
+};
+
+/*
+* The values of every statistic at the end of an interval
+*/
+struct StatSnapshot {
+  int cycle;
+  std::vector<double> values;
+};
+
+class Simulator;
+class Statistics
+{
+  public:
+  Statistics(Simulator & instance);
+  ~Statistics(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_statistics();
+  void AddScalar(const std::string & name, const std::string & description, uint64_t & counter);
+  void AddVector(const std::string & name, const std::string & description, uint64_t * counters,
+                 const std::vector<std::string> & labels);
+  void AddHistogram(const std::string & name, const std::string & description, std::vector<uint64_t> & buckets);
+  void AddFormula(const std::string & name, const std::string & description, const std::function<double()> & formula);
+
+  int  GetCycles() const;
+  void Reset();
+  void SetInterval(int cycles);
+  void Cycle();
+  void Capture(std::vector<uint64_t> & counters) const;
+  void Repeat(const std::vector<uint64_t> & before, const std::vector<uint64_t> & after, int times);
+  void dump(FILE * dumpsim_file);
+  bool WriteJSON(const char * filename);
+  void WriteJSON(FILE * file);
+  bool WriteCSV(const char * filename);
+
+  private:
+  void Flatten(std::vector<std::string> & names, std::vector<double> & values);
+  void ScheduleSnapshot();
+
+  Simulator & _simulator;
+  std::vector<StatEntry> stats;
+  int reset_cycle;    // the counters were zeroed at this cycle
+  int interval;       // cycles between snapshots, 0 takes none
+  std::vector<StatSnapshot> snapshots;
+};
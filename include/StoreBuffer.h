@@ -0,0 +1,69 @@
+/***************************************************************/
+/* StoreBuffer.h: LC-3b Store Buffer Class Header File         */
+/***************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <deque>
+#include <vector>
+#ifdef __linux__
+    #include "../include/LC3b.h"
+#else
+    #include "LC3b.h"
+#endif
+
+/*
+* A store waiting to be written to the data cache. The data is already
+* aligned to the word, we0 and we1 select the bytes the store writes.
+*/
+struct StoreBufferEntry {
+  bits16 address;
+  bits16 data;
+  bool we0;
+  bool we1;
+};
+
+/*
+* Stores leave the MEM stage by retiring into the buffer and are written
+* to the data cache in program order, one per cycle, whenever the MEM
+* stage leaves the cache port free. Loads read their bytes from the
+* youngest buffered store that writes them and the rest from the cache.
+*/
+class Simulator;
+class Statistics;
+class Checkpoint;
+class StoreBuffer
+{
+  public:
+  StoreBuffer(Simulator & instance);
+  ~StoreBuffer(){}
+
+  Simulator & simulator() { return _simulator; }
+
+  void init_store_buffer();
+  bool IsEnabled() const { return depth > 0; }
+  bool IsFull() const { return (int)entries.size() >= depth; }
+  const std::deque<StoreBufferEntry> & Entries() const { return entries; }
+  bool Insert(const bits16 & address, const bits16 & data, bool we0, bool we1);
+  bool Load(const bits16 & address, bits16 & read_word, bool need_low, bool need_high, int & ready_cycle);
+  void Drain(bool port_busy);
+  void Flush();
+  void dump(FILE * dumpsim_file);
+  void RegisterStats(Statistics & stats);
+  void Serialize(Checkpoint & cp);
+
+  private:
+  Simulator & _simulator;
+  int depth;
+  std::deque<StoreBufferEntry> entries;
+  bool full_this_cycle;   // a store found the buffer full and held the MEM stage
+
+  /* statistics */
+  uint64_t stores;
+  uint64_t full_stalls;
+  uint64_t hidden_miss_cycles;
+  uint64_t port_wait_cycles;
+  uint64_t loads_forwarded;
+  uint64_t loads_merged;
+  std::vector<uint64_t> occupancy;
+};
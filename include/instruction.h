@@ -10,13 +10,16 @@
 #ifdef __linux__ 
     #include "../include/LC3b.h"
     #include "../include/Simulator.h"
+    #include "../include/BranchPredictor.h"
 #else
     #include "LC3b.h"
     #include "Simulator.h"
+    #include "BranchPredictor.h"
 #endif
 
 
 class Latch;
+class Checkpoint;
 class Instruction
 {
   public:
@@ -46,6 +49,9 @@ class Instruction
   bits16 ADDRESS;
   bits3 DRID;
   bits3 CC;
+  bits16 PRED_PC;    // Next fetch address predicted by the fetch stage
+  RAS_Checkpoint ras_checkpoint; // Return address stack and global history before this instruction was fetched
+  std::shared_ptr<Instruction> FUSED_ALU; // ALU op a fused branch takes its condition codes from
 
   // Control signals
   agex_cs_bits AGEX_CS;
@@ -53,7 +59,10 @@ class Instruction
   sr_cs_bits SR_CS;
 
   // Pipeline stage tracking for timing diagram
+  uint64_t seq;                           // Fetch order, unique per instruction object
   int fetch_cycle;                        // Cycle when instruction was fetched
+  bool squashed;                          // Killed on a wrong path by a mispredicted branch
+  uint16_t scoreboard;                    // Registers and condition codes it holds on the scoreboard
   std::map<int, std::string> cycle_history; // Map of cycle -> stage symbol
   uint16_t mem_addr;                      // Memory address (for load/store)
   bool mem_addr_valid;                    // Whether this instruction accesses memory
@@ -65,6 +74,8 @@ class Instruction
   void setCurrentStage(const std::string& stage) { current_stage = stage; }
   std::string getCurrentStage() const { return current_stage; }
 
+  void Serialize(Checkpoint & cp);
+
   private:
   Instruction(Simulator & instance, const bits16 & instruction_bits);
   
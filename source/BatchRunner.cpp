@@ -0,0 +1,218 @@
+/***************************************************************/
+/* BatchRunner Implementaion                                   */
+/***************************************************************/
+
+#include <chrono>
+#include <thread>
+#include <exception>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/State.h"
+    #include "../include/BatchRunner.h"
+#else
+    #include "Simulator.h"
+    #include "State.h"
+    #include "BatchRunner.h"
+#endif
+
+/*
+* 0 threads is one per hardware thread
+*/
+BatchRunner::BatchRunner(int threads) :
+threads(threads),
+summary()
+{
+  if (this->threads <= 0)
+    this->threads = std::thread::hardware_concurrency();
+  if (this->threads <= 0)
+    this->threads = 1;
+}
+
+/*
+* Seconds since start
+*/
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RunJob                                          */
+/*                                                             */
+/* Purpose   : Run one simulation on a simulator of its own    */
+/*             that prints nothing, and report how it ended.   */
+/*                                                             */
+/***************************************************************/
+BatchResult BatchRunner::RunJob(const BatchJob & job)
+{
+  BatchResult result = {};
+  result.name = job.name;
+  auto start = std::chrono::steady_clock::now();
+
+  try
+  {
+    //Config::parse skips the program name like a command line
+    std::vector<std::string> arguments = job.arguments;
+    std::vector<char *> argv = { (char *)"lC3b" };
+    for (auto & argument : arguments)
+      argv.push_back(&argument[0]);
+    auto argc = (int)argv.size();
+
+    Simulator simulator;
+    simulator.SetOutput(nullptr, nullptr);
+    auto first_file = simulator.config().parse(argc, argv.data());
+    simulator.config().headless = true;
+    if (argc - first_file < 2)
+      throw SimulatorError("a job needs a micro-code file and at least one program file");
+
+    simulator.initialize(argv[first_file], &argv[first_file + 1], argc - first_file - 1);
+
+    //-cycles or -insts on the job line replace the limit of the batch
+    auto & config = simulator.config();
+    auto limited = config.max_cycles || config.max_instructions;
+    result.halted = simulator.simulate(limited ? config.max_cycles : job.max_cycles, config.max_instructions);
+
+    result.cycles = simulator.GetCycles();
+    result.instructions = simulator.GetRetiredInstructions();
+    result.pc = simulator.state().GetProgramCounter().to_num();
+    for (auto k = 0; k < 8; k++)
+      result.regs[k] = simulator.state().GetRegisterData(k).to_num();
+    result.ok = true;
+  }
+  catch (const SimulatorError & error)
+  {
+    result.error = error.what();
+  }
+  catch (const std::exception & error)
+  {
+    result.error = std::string("C++ error : ") + error.what();
+  }
+
+  result.seconds = SecondsSince(start);
+  return result;
+}
+
+/*
+* The next job of worker id: its own newest, or else the oldest of
+* another worker. False once every queue is empty.
+*/
+bool BatchRunner::NextJob(int id, size_t & job)
+{
+  {
+    std::lock_guard<std::mutex> guard(queues[id].lock);
+    if (!queues[id].jobs.empty())
+    {
+      job = queues[id].jobs.back();
+      queues[id].jobs.pop_back();
+      return true;
+    }
+  }
+
+  for (auto i = 1; i < threads; i++)
+  {
+    auto & victim = queues[(id + i) % threads];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.jobs.empty())
+    {
+      job = victim.jobs.front();
+      victim.jobs.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+* A worker runs jobs until there are none left to take or steal. No
+* jobs are added while the batch runs, so an empty pool stays empty.
+*/
+void BatchRunner::Worker(int id, const std::vector<BatchJob> & jobs, std::vector<BatchResult> & results)
+{
+  size_t job;
+  while (NextJob(id, job))
+    results[job] = RunJob(jobs[job]);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Run                                             */
+/*                                                             */
+/* Purpose   : Run the jobs on the pool and return the results */
+/*             in the order of the jobs.                       */
+/*                                                             */
+/***************************************************************/
+std::vector<BatchResult> BatchRunner::Run(const std::vector<BatchJob> & jobs)
+{
+  std::vector<BatchResult> results(jobs.size());
+  auto workers = std::min<size_t>(threads, std::max<size_t>(jobs.size(), 1));
+  auto start = std::chrono::steady_clock::now();
+
+  queues = std::vector<WorkQueue>(threads);
+  for (size_t i = 0; i < jobs.size(); i++)
+    queues[i % workers].jobs.push_back(i);
+
+  std::vector<std::thread> pool;
+  for (size_t id = 1; id < workers; id++)
+    pool.emplace_back(&BatchRunner::Worker, this, id, std::cref(jobs), std::ref(results));
+  Worker(0, jobs, results);
+  for (auto & thread : pool)
+    thread.join();
+
+  summary = BatchSummary();
+  summary.jobs = jobs.size();
+  summary.threads = workers;
+  summary.wall_seconds = SecondsSince(start);
+  for (auto & result : results)
+  {
+    summary.cpu_seconds += result.seconds;
+    if (!result.ok)
+    {
+      summary.failed++;
+      continue;
+    }
+    summary.halted += result.halted;
+    summary.cycles += result.cycles;
+    summary.instructions += result.instructions;
+  }
+  return results;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Print one line per job and the batch totals.    */
+/*                                                             */
+/***************************************************************/
+void BatchRunner::dump(FILE * file, const std::vector<BatchResult> & results) const
+{
+  for (auto & result : results)
+  {
+    if (!result.ok)
+    {
+      fprintf(file, "%-32s error  %s\n", result.name.c_str(), result.error.c_str());
+      continue;
+    }
+    fprintf(file, "%-32s %-6s cycles %-10d instructions %-10llu IPC %.3f PC 0x%04x R",
+            result.name.c_str(), result.halted ? "halted" : "limit", result.cycles,
+            (unsigned long long)result.instructions,
+            result.cycles ? (double)result.instructions / result.cycles : 0.0, result.pc);
+    for (auto k = 0; k < 8; k++)
+      fprintf(file, " %04x", result.regs[k]);
+    fprintf(file, "\n");
+  }
+
+  fprintf(file, "\nBatch :\n");
+  fprintf(file, "-------------------------------------\n");
+  fprintf(file, "Jobs                 : %d (%d halted, %d at a limit, %d failed)\n", summary.jobs,
+          summary.halted, summary.jobs - summary.halted - summary.failed, summary.failed);
+  fprintf(file, "Threads              : %d\n", summary.threads);
+  fprintf(file, "Cycles               : %llu\n", (unsigned long long)summary.cycles);
+  fprintf(file, "Instructions         : %llu\n", (unsigned long long)summary.instructions);
+  fprintf(file, "IPC                  : %.3f\n", summary.cycles ? (double)summary.instructions / summary.cycles : 0.0);
+  fprintf(file, "Host seconds         : %.3f wall, %.3f summed over jobs\n", summary.wall_seconds, summary.cpu_seconds);
+  fprintf(file, "Cycles per second    : %.0f\n", summary.wall_seconds > 0 ? summary.cycles / summary.wall_seconds : 0.0);
+  fprintf(file, "\n");
+  fflush(file);
+}
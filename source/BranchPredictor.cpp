@@ -0,0 +1,434 @@
+/***************************************************************/
+/* Branch Predictor Implementaion                              */
+/***************************************************************/
+
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/PipeLine.h"
+    #include "../include/BranchPredictor.h"
+    #include "../include/Statistics.h"
+    #include "../include/Checkpoint.h"
+#else
+    #include "Simulator.h"
+    #include "PipeLine.h"
+    #include "BranchPredictor.h"
+    #include "Statistics.h"
+    #include "Checkpoint.h"
+#endif
+
+/*
+* 2-bit saturating counters start weakly not taken
+*/
+#define COUNTER_INIT 1
+
+BranchPredictor::BranchPredictor(Simulator & instance) :
+_simulator(instance),
+GHR(0),
+RAS_TOS(0),
+RAS_COUNT(0)
+{
+
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_predictor                                  */
+/*                                                             */
+/* Purpose   : Size the tables from the configuration and      */
+/*             clear the history and statistics.               */
+/*                                                             */
+/***************************************************************/
+void BranchPredictor::init_predictor()
+{
+  auto & config = simulator().config();
+
+  BTB = std::vector<BTB_Entry>(config.btb_entries, BTB_Entry());
+  BIMODAL = std::vector<uint8_t>(config.bht_entries, COUNTER_INIT);
+  GSHARE = std::vector<uint8_t>(config.bht_entries, COUNTER_INIT);
+  CHOOSER = std::vector<uint8_t>(config.bht_entries, COUNTER_INIT);
+  GHR = 0;
+  RAS = std::vector<uint16_t>(config.ras_entries, 0);
+  RAS_TOS = 0;
+  RAS_COUNT = 0;
+  ITC = std::vector<ITC_Entry>(config.itc_entries, ITC_Entry());
+
+  lookups = 0;
+  btb_hits = 0;
+  conditional_branches = 0;
+  unconditional_branches = 0;
+  direction_mispredicts = 0;
+  target_mispredicts = 0;
+  ras_pushes = 0;
+  ras_pops = 0;
+  ras_overflows = 0;
+  ras_underflows = 0;
+  return_mispredicts = 0;
+  itc_lookups = 0;
+  itc_hits = 0;
+  indirect_mispredicts = 0;
+}
+
+/*
+* Speculative fetch is only used when a predictor was selected
+*/
+bool BranchPredictor::IsEnabled() const
+{
+  return _simulator.config().predictor != PREDICT_NONE;
+}
+
+uint16_t BranchPredictor::BimodalIndex(uint16_t pc) const
+{
+  return (pc >> 1) & (BIMODAL.size() - 1);
+}
+
+uint16_t BranchPredictor::GshareIndex(uint16_t pc, uint16_t history) const
+{
+  return ((pc >> 1) ^ history) & (GSHARE.size() - 1);
+}
+
+uint16_t BranchPredictor::ItcIndex(uint16_t pc, uint16_t history) const
+{
+  return ((pc >> 1) ^ history) & (ITC.size() - 1);
+}
+
+/*
+* Predecode the fetched word to find calls, returns and indirect jumps
+*/
+ControlKind BranchPredictor::Classify(const bits16 & ir)
+{
+  switch (ir.range<15,12>().to_num())
+  {
+    case 0b0100:
+      return ir[11] ? CONTROL_CALL : CONTROL_INDIRECT_CALL;
+    case 0b1100:
+      return (ir.range<8,6>().to_num() == 7) ? CONTROL_RETURN : CONTROL_INDIRECT_JUMP;
+    default:
+      return CONTROL_OTHER;
+  }
+}
+
+/*
+* The stack is circular, a push on a full stack overwrites the oldest entry
+*/
+void BranchPredictor::PushReturnAddress(uint16_t address)
+{
+  RAS_TOS = (RAS_TOS + 1) % RAS.size();
+  RAS[RAS_TOS] = address;
+  if (RAS_COUNT < RAS.size())
+    RAS_COUNT++;
+}
+
+uint16_t BranchPredictor::PopReturnAddress()
+{
+  auto address = RAS[RAS_TOS];
+  RAS_TOS = (RAS_TOS + RAS.size() - 1) % RAS.size();
+  RAS_COUNT--;
+  return address;
+}
+
+/*
+* Direction of a conditional branch that hit in the BTB
+*/
+bool BranchPredictor::PredictDirection(uint16_t pc, uint16_t target) const
+{
+  switch (_simulator.config().predictor)
+  {
+    case PREDICT_STATIC:
+      return target < pc;
+    case PREDICT_BIMODAL:
+      return BIMODAL[BimodalIndex(pc)] >= 2;
+    case PREDICT_GSHARE:
+      return GSHARE[GshareIndex(pc, GHR)] >= 2;
+    case PREDICT_TOURNAMENT:
+      if (CHOOSER[BimodalIndex(pc)] >= 2)
+        return GSHARE[GshareIndex(pc, GHR)] >= 2;
+      return BIMODAL[BimodalIndex(pc)] >= 2;
+    default:
+      return false;
+  }
+}
+
+void BranchPredictor::UpdateCounter(uint8_t & counter, bool taken)
+{
+  if (taken && counter < 3)
+    counter++;
+  else if (!taken && counter > 0)
+    counter--;
+}
+
+/*
+* Return the address to fetch after the instruction ir at pc. The state of
+* the return address stack before this instruction and the global history
+* the prediction used are saved in checkpoint.
+*/
+bits16 BranchPredictor::Predict(const bits16 & pc, const bits16 & ir, RAS_Checkpoint & checkpoint)
+{
+  auto pc_val = pc.to_num();
+  auto & entry = BTB[(pc_val >> 1) & (BTB.size() - 1)];
+  uint16_t next_pc = pc_val + 2;
+
+  checkpoint.tos = RAS_TOS;
+  checkpoint.count = RAS_COUNT;
+  checkpoint.top = RAS.empty() ? 0 : RAS[RAS_TOS];
+  checkpoint.ghr = GHR;
+
+  lookups++;
+  if (entry.valid && entry.tag == pc_val)
+  {
+    btb_hits++;
+    if (!entry.conditional || PredictDirection(pc_val, entry.target))
+      next_pc = entry.target;
+  }
+
+  auto kind = Classify(ir);
+  if (!RAS.empty())
+  {
+    if (kind == CONTROL_CALL || kind == CONTROL_INDIRECT_CALL)
+    {
+      ras_pushes++;
+      if (RAS_COUNT == RAS.size())
+        ras_overflows++;
+      PushReturnAddress(pc_val + 2);
+    }
+    else if (kind == CONTROL_RETURN)
+    {
+      ras_pops++;
+      if (RAS_COUNT > 0)
+        next_pc = PopReturnAddress();
+      else
+        ras_underflows++;
+    }
+  }
+
+  if (!ITC.empty() && (kind == CONTROL_INDIRECT_CALL || kind == CONTROL_INDIRECT_JUMP))
+  {
+    auto & itc_entry = ITC[ItcIndex(pc_val, GHR)];
+    itc_lookups++;
+    if (itc_entry.valid && itc_entry.tag == pc_val)
+    {
+      itc_hits++;
+      next_pc = itc_entry.target;
+    }
+  }
+
+  return next_pc;
+}
+
+/*
+* Restore the return address stack after a misprediction of the instruction
+* ir at pc, then redo the push or pop of that instruction itself.
+*/
+void BranchPredictor::Recover(const RAS_Checkpoint & checkpoint, const bits16 & pc, const bits16 & ir)
+{
+  if (RAS.empty())
+    return;
+
+  RAS_TOS = checkpoint.tos;
+  RAS_COUNT = checkpoint.count;
+  RAS[RAS_TOS] = checkpoint.top;
+
+  auto kind = Classify(ir);
+  if (kind == CONTROL_CALL || kind == CONTROL_INDIRECT_CALL)
+    PushReturnAddress(pc.to_num() + 2);
+  else if (kind == CONTROL_RETURN && RAS_COUNT > 0)
+    PopReturnAddress();
+}
+
+/*
+* Train the predictor with the resolved outcome of a control instruction.
+* The history is shifted at resolve, so the entries read at fetch are found
+* again with the history saved in the checkpoint of the instruction.
+*/
+void BranchPredictor::Update(const bits16 & pc, const bits16 & ir, bool conditional, bool taken, const bits16 & target, bool mispredicted,
+                             const RAS_Checkpoint & checkpoint)
+{
+  auto pc_val = pc.to_num();
+  auto target_val = target.to_num();
+  auto & entry = BTB[(pc_val >> 1) & (BTB.size() - 1)];
+  auto btb_hit = entry.valid && entry.tag == pc_val;
+  auto kind = Classify(ir);
+  auto indirect = (kind == CONTROL_INDIRECT_CALL || kind == CONTROL_INDIRECT_JUMP);
+
+  if (mispredicted)
+  {
+    if (!taken || (btb_hit && entry.target == target_val))
+      direction_mispredicts++;
+    else
+      target_mispredicts++;
+
+    if (kind == CONTROL_RETURN)
+      return_mispredicts++;
+    else if (indirect)
+      indirect_mispredicts++;
+  }
+
+  if (!ITC.empty() && indirect)
+  {
+    auto & itc_entry = ITC[ItcIndex(pc_val, checkpoint.ghr)];
+    itc_entry.valid = true;
+    itc_entry.tag = pc_val;
+    itc_entry.target = target_val;
+  }
+
+  if (conditional)
+  {
+    conditional_branches++;
+    auto bimodal_index = BimodalIndex(pc_val);
+    auto gshare_index = GshareIndex(pc_val, checkpoint.ghr);
+    bool bimodal_taken = BIMODAL[bimodal_index] >= 2;
+    bool gshare_taken = GSHARE[gshare_index] >= 2;
+
+    if (bimodal_taken != gshare_taken)
+      UpdateCounter(CHOOSER[bimodal_index], gshare_taken == taken);
+    UpdateCounter(BIMODAL[bimodal_index], taken);
+    UpdateCounter(GSHARE[gshare_index], taken);
+
+    auto history_mask = (1 << simulator().config().history_bits) - 1;
+    GHR = ((GHR << 1) | (taken ? 1 : 0)) & history_mask;
+  }
+  else
+    unconditional_branches++;
+
+  // PC x0000 is the halt vector, never redirect fetch there speculatively
+  if (taken && target_val != 0)
+  {
+    entry.valid = true;
+    entry.conditional = conditional;
+    entry.tag = pc_val;
+    entry.target = target_val;
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the predictor counters and the accuracy*/
+/*             and MPKI formulas.                              */
+/*                                                             */
+/***************************************************************/
+void BranchPredictor::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("bpred.btb.lookups", "BTB lookups", lookups);
+  stats.AddScalar("bpred.btb.hits", "BTB hits", btb_hits);
+  stats.AddScalar("bpred.conditional", "conditional branches resolved", conditional_branches);
+  stats.AddScalar("bpred.unconditional", "unconditional control instructions resolved", unconditional_branches);
+  stats.AddScalar("bpred.mispredicts.direction", "wrong direction", direction_mispredicts);
+  stats.AddScalar("bpred.mispredicts.target", "wrong target", target_mispredicts);
+  stats.AddFormula("bpred.accuracy", "correct predictions per control instruction", [this]() {
+    auto branches = conditional_branches + unconditional_branches;
+    auto mispredicts = direction_mispredicts + target_mispredicts;
+    return branches ? (double)(branches - mispredicts) / branches : 0.0;
+  });
+  stats.AddFormula("bpred.mpki", "mispredictions per thousand instructions", [this]() {
+    auto retired = simulator().GetRetiredInstructions();
+    return retired ? 1000.0 * (direction_mispredicts + target_mispredicts) / retired : 0.0;
+  });
+
+  if (!RAS.empty())
+  {
+    stats.AddScalar("bpred.ras.pushes", "return addresses pushed", ras_pushes);
+    stats.AddScalar("bpred.ras.pops", "return addresses popped", ras_pops);
+    stats.AddScalar("bpred.ras.overflows", "pushes on a full stack", ras_overflows);
+    stats.AddScalar("bpred.ras.underflows", "pops of an empty stack", ras_underflows);
+    stats.AddScalar("bpred.ras.mispredicts", "returns to the wrong address", return_mispredicts);
+  }
+  if (!ITC.empty())
+  {
+    stats.AddScalar("bpred.itc.lookups", "indirect target cache lookups", itc_lookups);
+    stats.AddScalar("bpred.itc.hits", "indirect target cache hits", itc_hits);
+    stats.AddScalar("bpred.itc.mispredicts", "indirect jumps to the wrong target", indirect_mispredicts);
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the predictor statistics to the output     */
+/*             file.                                           */
+/*                                                             */
+/***************************************************************/
+void BranchPredictor::dump(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  static const char * names[] = { "none", "static", "bimodal", "gshare", "tournament" };
+  auto & pipeline = simulator().pipeline();
+  auto branches = conditional_branches + unconditional_branches;
+  auto mispredicts = direction_mispredicts + target_mispredicts;
+  auto retired = simulator().GetRetiredInstructions();
+
+  PRINT_AND_DUMP("\nBranch predictor (%s) :\n", names[simulator().config().predictor]);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  PRINT_AND_DUMP("BTB lookups          : %llu (%llu hits)\n", (unsigned long long)lookups, (unsigned long long)btb_hits);
+  PRINT_AND_DUMP("Control instructions : %llu (%llu conditional)\n", (unsigned long long)branches, (unsigned long long)conditional_branches);
+  PRINT_AND_DUMP("Mispredictions       : %llu (%llu direction, %llu target)\n", (unsigned long long)mispredicts,
+                 (unsigned long long)direction_mispredicts, (unsigned long long)target_mispredicts);
+  PRINT_AND_DUMP("Accuracy             : %.2f%%\n", branches ? 100.0 * (branches - mispredicts) / branches : 0.0);
+  PRINT_AND_DUMP("MPKI                 : %.2f\n", retired ? 1000.0 * mispredicts / retired : 0.0);
+  if (!RAS.empty())
+  {
+    PRINT_AND_DUMP("RAS pushes / pops    : %llu / %llu (depth %d)\n", (unsigned long long)ras_pushes, (unsigned long long)ras_pops, (int)RAS.size());
+    PRINT_AND_DUMP("RAS over / underflow : %llu / %llu\n", (unsigned long long)ras_overflows, (unsigned long long)ras_underflows);
+    PRINT_AND_DUMP("Return mispredicts   : %llu\n", (unsigned long long)return_mispredicts);
+  }
+  if (!ITC.empty())
+  {
+    PRINT_AND_DUMP("ITC lookups          : %llu (%llu hits)\n", (unsigned long long)itc_lookups, (unsigned long long)itc_hits);
+    PRINT_AND_DUMP("Indirect mispredicts : %llu\n", (unsigned long long)indirect_mispredicts);
+  }
+  // an estimate, not a measurement: each correct prediction is credited the
+  // whole stall of fetch waiting for the resolve stage, although a stalled
+  // decode would have hidden part of it
+  if (!simulator().IsOutOfOrder())
+    PRINT_AND_DUMP("Est. saved cycles    : %llu\n", (unsigned long long)((branches - mispredicts) * pipeline.ControlPenalty()));
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
+
+/*
+* The tables, the global history and the return address stack
+*/
+void BranchPredictor::Serialize(Checkpoint & cp)
+{
+  cp.Size(BTB);
+  for (auto & entry : BTB)
+  {
+    cp.Value(entry.valid);
+    cp.Value(entry.conditional);
+    cp.Value(entry.tag);
+    cp.Value(entry.target);
+  }
+  cp.Size(BIMODAL);
+  for (auto & counter : BIMODAL)
+    cp.Value(counter);
+  cp.Size(GSHARE);
+  for (auto & counter : GSHARE)
+    cp.Value(counter);
+  cp.Size(CHOOSER);
+  for (auto & counter : CHOOSER)
+    cp.Value(counter);
+  cp.Value(GHR);
+
+  cp.Size(RAS);
+  for (auto & address : RAS)
+    cp.Value(address);
+  cp.Value(RAS_TOS);
+  cp.Value(RAS_COUNT);
+
+  cp.Size(ITC);
+  for (auto & entry : ITC)
+  {
+    cp.Value(entry.valid);
+    cp.Value(entry.tag);
+    cp.Value(entry.target);
+  }
+}
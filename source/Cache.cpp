@@ -0,0 +1,383 @@
+/***************************************************************/
+/* Cache Timing Model Implementaion                            */
+/***************************************************************/
+
+#include <algorithm>
+#ifdef __linux__
+    #include "../include/Cache.h"
+    #include "../include/Statistics.h"
+    #include "../include/Checkpoint.h"
+    #include "../include/EventQueue.h"
+#else
+    #include "Cache.h"
+    #include "Statistics.h"
+    #include "Checkpoint.h"
+    #include "EventQueue.h"
+#endif
+
+Cache::Cache() :
+events(nullptr),
+sets(0),
+ways(0),
+line_bytes(0),
+miss_latency(0),
+use_count(0),
+fill_pending(false),
+fill_line(0),
+fill_ready(0),
+hits(0),
+misses(0),
+miss_cycles(0),
+secondary_misses(0),
+hits_under_miss(0),
+misses_under_miss(0),
+mshr_full(0)
+{
+
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_cache                                      */
+/*                                                             */
+/* Purpose   : Invalidate every line. A size of 0 leaves the   */
+/*             cache disabled and every access hits, 0 MSHRs   */
+/*             make it a blocking cache.                       */
+/*                                                             */
+/***************************************************************/
+void Cache::init_cache(int size_bytes, int line_bytes, int ways, int miss_latency, int mshrs,
+                       EventQueue * events)
+{
+  this->events = events;
+  this->line_bytes = line_bytes;
+  this->ways = ways;
+  this->miss_latency = miss_latency;
+  sets = size_bytes ? size_bytes / (line_bytes * ways) : 0;
+  LINES = std::vector<Line>(sets * ways, Line());
+  use_count = 0;
+  fill_pending = false;
+  hits = 0;
+  misses = 0;
+  miss_cycles = 0;
+  MSHRS = std::vector<MSHR>(mshrs, MSHR());
+  secondary_misses = 0;
+  hits_under_miss = 0;
+  misses_under_miss = 0;
+  mshr_full = 0;
+  outstanding = std::vector<uint64_t>(mshrs + 1, 0);
+}
+
+/*
+* Look the line up and mark it most recently used
+*/
+bool Cache::Lookup(uint16_t line)
+{
+  auto set = line % sets;
+  for (auto way = 0; way < ways; way++)
+  {
+    auto & entry = LINES[set * ways + way];
+    if (entry.valid && entry.tag == line / sets)
+    {
+      entry.last_use = ++use_count;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+* Install a line over the least recently used way of its set
+*/
+void Cache::Fill(uint16_t line)
+{
+  auto set = line % sets;
+  auto victim = &LINES[set * ways];
+  for (auto way = 1; way < ways; way++)
+  {
+    auto & entry = LINES[set * ways + way];
+    if (!victim->valid)
+      break;
+    if (!entry.valid || entry.last_use < victim->last_use)
+      victim = &entry;
+  }
+  victim->valid = true;
+  victim->tag = line / sets;
+  victim->last_use = ++use_count;
+}
+
+/*
+* Return true if the word at address can be accessed this cycle. A miss
+* starts a line fill, the access is retried until the line arrives.
+*/
+bool Cache::Access(uint16_t address, int cycle)
+{
+  if (!IsEnabled())
+    return true;
+
+  uint16_t line = address / line_bytes;
+  if (fill_pending && cycle >= fill_ready)
+  {
+    Fill(fill_line);
+    fill_pending = false;
+  }
+
+  if (Lookup(line))
+  {
+    hits++;
+    return true;
+  }
+
+  if (!fill_pending)
+  {
+    fill_pending = true;
+    fill_line = line;
+    fill_ready = cycle + miss_latency;
+    misses++;
+    if (events)
+      events->Schedule(fill_ready);
+  }
+  miss_cycles++;
+  return false;
+}
+
+/*
+* Install the lines whose fill has arrived and free their MSHRs
+*/
+void Cache::CompleteFills(int cycle)
+{
+  for (auto & mshr : MSHRS)
+  {
+    if (mshr.valid && cycle >= mshr.fill_ready)
+    {
+      Fill(mshr.line);
+      mshr = MSHR();
+    }
+  }
+}
+
+/*
+* Number of lines being filled
+*/
+int Cache::Outstanding() const
+{
+  auto count = 0;
+  for (auto & mshr : MSHRS)
+    count += mshr.valid;
+  return count;
+}
+
+/*
+* Return the cycle the word at address is ready, or -1 when the access
+* has to be retried. A blocking cache is ready now or must be retried. A
+* non-blocking cache returns the fill cycle of a miss, the miss takes a
+* free MSHR or joins the one already fetching its line, and is only
+* retried when every MSHR is busy.
+*/
+int Cache::Request(uint16_t address, int cycle)
+{
+  if (!IsNonBlocking())
+    return Access(address, cycle) ? cycle : -1;
+
+  uint16_t line = address / line_bytes;
+  CompleteFills(cycle);
+  auto busy = Outstanding();
+
+  if (Lookup(line))
+  {
+    hits++;
+    if (busy)
+      hits_under_miss++;
+    return cycle;
+  }
+
+  for (auto & mshr : MSHRS)
+  {
+    if (mshr.valid && mshr.line == line)
+    {
+      //the same address asking again is a retry, not another miss
+      if (std::find(mshr.targets.begin(), mshr.targets.end(), address) == mshr.targets.end())
+      {
+        mshr.targets.push_back(address);
+        secondary_misses++;
+      }
+      return mshr.fill_ready;
+    }
+  }
+
+  for (auto & mshr : MSHRS)
+  {
+    if (!mshr.valid)
+    {
+      mshr.valid = true;
+      mshr.line = line;
+      mshr.fill_ready = cycle + miss_latency;
+      if (events)
+        events->Schedule(mshr.fill_ready);
+      mshr.targets.push_back(address);
+      misses++;
+      if (busy)
+        misses_under_miss++;
+      return mshr.fill_ready;
+    }
+  }
+
+  mshr_full++;
+  return -1;
+}
+
+/*
+* Look the line of address up and install it right away on a miss,
+* without a fill in flight. Return true on a hit.
+*/
+bool Cache::Touch(uint16_t address)
+{
+  if (!IsEnabled())
+    return true;
+
+  uint16_t line = address / line_bytes;
+  if (Lookup(line))
+  {
+    hits++;
+    return true;
+  }
+  Fill(line);
+  misses++;
+  return false;
+}
+
+/*
+* Called once a cycle, installs arrived lines and samples the number of
+* misses in flight for the memory level parallelism
+*/
+void Cache::Cycle(int cycle)
+{
+  if (!IsNonBlocking())
+    return;
+
+  CompleteFills(cycle);
+  auto busy = Outstanding();
+  outstanding[busy]++;
+  miss_cycles += busy ? 1 : 0;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the cache counters under prefix.       */
+/*                                                             */
+/***************************************************************/
+void Cache::RegisterStats(Statistics & stats, const std::string & prefix)
+{
+  stats.AddScalar(prefix + ".hits", "accesses that hit", hits);
+  stats.AddScalar(prefix + ".misses", "accesses that missed", misses);
+  stats.AddScalar(prefix + ".miss_cycles", "cycles spent waiting on misses", miss_cycles);
+  stats.AddFormula(prefix + ".miss_rate", "misses per access", [this]() {
+    auto accesses = hits + misses;
+    return accesses ? (double)misses / accesses : 0.0;
+  });
+
+  if (IsNonBlocking())
+  {
+    stats.AddScalar(prefix + ".mshr.secondary_misses", "misses merged into an MSHR", secondary_misses);
+    stats.AddScalar(prefix + ".mshr.hits_under_miss", "hits while a miss was outstanding", hits_under_miss);
+    stats.AddScalar(prefix + ".mshr.misses_under_miss", "misses while a miss was outstanding", misses_under_miss);
+    stats.AddScalar(prefix + ".mshr.full", "misses refused with every MSHR busy", mshr_full);
+    stats.AddHistogram(prefix + ".mshr.outstanding", "cycles with n misses outstanding", outstanding);
+    stats.AddFormula(prefix + ".mshr.mlp", "average misses outstanding while any is", [this]() {
+      uint64_t miss_sum = 0, busy_cycles = 0;
+      for (size_t i = 1; i < outstanding.size(); i++)
+      {
+        miss_sum += i * outstanding[i];
+        busy_cycles += outstanding[i];
+      }
+      return busy_cycles ? (double)miss_sum / busy_cycles : 0.0;
+    });
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the cache statistics to the output file.   */
+/*                                                             */
+/***************************************************************/
+void Cache::dump(FILE * console, FILE * dumpsim_file, const char * name)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          if (console) { fprintf(console, __VA_ARGS__); } \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  auto accesses = hits + misses;
+
+  PRINT_AND_DUMP("\n%s (%d bytes, %d-way, %d byte lines) :\n", name, sets * ways * line_bytes, ways, line_bytes);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  PRINT_AND_DUMP("Hits / misses        : %llu / %llu\n", (unsigned long long)hits, (unsigned long long)misses);
+  PRINT_AND_DUMP("Miss rate            : %.2f%%\n", accesses ? 100.0 * misses / accesses : 0.0);
+  PRINT_AND_DUMP("Miss cycles          : %llu\n", (unsigned long long)miss_cycles);
+  if (IsNonBlocking())
+  {
+    uint64_t miss_sum = 0, busy_cycles = 0;
+    for (size_t i = 1; i < outstanding.size(); i++)
+    {
+      miss_sum += i * outstanding[i];
+      busy_cycles += outstanding[i];
+    }
+    PRINT_AND_DUMP("MSHRs                : %zu\n", MSHRS.size());
+    PRINT_AND_DUMP("Secondary misses     : %llu\n", (unsigned long long)secondary_misses);
+    PRINT_AND_DUMP("Hits under miss      : %llu\n", (unsigned long long)hits_under_miss);
+    PRINT_AND_DUMP("Misses under miss    : %llu\n", (unsigned long long)misses_under_miss);
+    PRINT_AND_DUMP("MSHRs full           : %llu\n", (unsigned long long)mshr_full);
+    PRINT_AND_DUMP("MLP                  : %.2f\n", busy_cycles ? (double)miss_sum / busy_cycles : 0.0);
+    for (size_t i = 0; i < outstanding.size(); i++)
+      PRINT_AND_DUMP("Cycles with %-2zu misses : %llu\n", i, (unsigned long long)outstanding[i]);
+  }
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
+
+/*
+* Tags, LRU ages and the fills in flight. The geometry comes from the
+* options, which a restore checks are the same.
+*/
+void Cache::Serialize(Checkpoint & cp)
+{
+  cp.Size(LINES);
+  for (auto & line : LINES)
+  {
+    cp.Value(line.valid);
+    cp.Value(line.tag);
+    cp.Value(line.last_use);
+  }
+  cp.Value(use_count);
+  cp.Value(fill_pending);
+  cp.Value(fill_line);
+  cp.Value(fill_ready);
+
+  cp.Size(MSHRS);
+  for (auto & mshr : MSHRS)
+  {
+    cp.Value(mshr.valid);
+    cp.Value(mshr.line);
+    cp.Value(mshr.fill_ready);
+    cp.Size(mshr.targets);
+    for (auto & target : mshr.targets)
+      cp.Value(target);
+  }
+
+  //the restored fills wake the simulator up again
+  if (cp.IsRestoring() && events)
+  {
+    if (fill_pending)
+      events->Schedule(fill_ready);
+    for (auto & mshr : MSHRS)
+      if (mshr.valid)
+        events->Schedule(mshr.fill_ready);
+  }
+}
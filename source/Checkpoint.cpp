@@ -0,0 +1,285 @@
+/***************************************************************/
+/* Checkpoint Implementaion                                    */
+/***************************************************************/
+
+#include <cstring>
+#include <cstdio>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/MicroSequencer.h"
+    #include "../include/State.h"
+    #include "../include/MainMemory.h"
+    #include "../include/BranchPredictor.h"
+    #include "../include/StoreBuffer.h"
+    #include "../include/PipeLine.h"
+    #include "../include/instruction.h"
+    #include "../include/Checkpoint.h"
+#else
+    #include "Simulator.h"
+    #include "MicroSequencer.h"
+    #include "State.h"
+    #include "MainMemory.h"
+    #include "BranchPredictor.h"
+    #include "StoreBuffer.h"
+    #include "PipeLine.h"
+    #include "instruction.h"
+    #include "Checkpoint.h"
+#endif
+
+Checkpoint::Checkpoint(Simulator & instance) :
+_simulator(instance),
+restoring(false),
+truncated(false),
+position(0)
+{
+
+}
+
+void Checkpoint::Write(uint64_t value, int bytes)
+{
+  for(auto i = 0; i < bytes; i++)
+    data.push_back((value >> (8 * i)) & 0xff);
+}
+
+/*
+* Reading past the end gives zeros and marks the file truncated
+*/
+uint64_t Checkpoint::Read(int bytes)
+{
+  if(position + bytes > data.size())
+  {
+    truncated = true;
+    position = data.size();
+    return 0;
+  }
+  uint64_t value = 0;
+  for(auto i = 0; i < bytes; i++)
+    value |= (uint64_t)data[position++] << (8 * i);
+  return value;
+}
+
+void Checkpoint::String(std::string & value)
+{
+  Size(value);
+  for(auto & c : value)
+    Value(c);
+}
+
+/*
+* An instruction is written once to the table, every other place that
+* holds it writes its index
+*/
+void Checkpoint::Reference(std::shared_ptr<Instruction> & inst)
+{
+  uint32_t id = 0;
+  if(restoring)
+  {
+    Value(id);
+    inst = nullptr;
+    if(id)
+      fixups.push_back(std::make_pair(&inst, id));
+    return;
+  }
+
+  if(inst)
+  {
+    auto found = instruction_ids.find(inst.get());
+    if(found == instruction_ids.end())
+    {
+      instructions.push_back(inst);
+      id = instructions.size();
+      instruction_ids[inst.get()] = id;
+    }
+    else
+      id = found->second;
+  }
+  Value(id);
+}
+
+/*
+* The options as written to a checkpoint, a restore needs the same ones
+*/
+std::vector<uint8_t> Checkpoint::ConfigBytes()
+{
+  Checkpoint config_section(simulator());
+  simulator().config().Serialize(config_section);
+  return config_section.data;
+}
+
+/*
+* The table of the instructions referred to, each entry led by a 1 and
+* the table ended by a 0. An instruction may refer to one not yet in it.
+*/
+void Checkpoint::Instructions()
+{
+  if(restoring)
+  {
+    bool entry = false;
+    for(Value(entry); entry && !truncated; Value(entry))
+    {
+      uint16_t ir = 0;
+      Value(ir);
+      auto inst = Instruction::Create(simulator(), ir);
+      inst->Serialize(*this);
+      instructions.push_back(inst);
+    }
+    for(auto & fixup : fixups)
+    {
+      if(fixup.second > instructions.size())
+      {
+        truncated = true;
+        return;
+      }
+      *fixup.first = instructions[fixup.second - 1];
+    }
+    return;
+  }
+
+  for(size_t i = 0; i < instructions.size(); i++)
+  {
+    bool entry = true;
+    uint16_t ir = instructions[i]->IR.to_num();
+    Value(entry);
+    Value(ir);
+    instructions[i]->Serialize(*this);
+  }
+  bool end = false;
+  Value(end);
+}
+
+/*
+* The component sections, in file order
+*/
+void Checkpoint::Sections()
+{
+  simulator().Serialize(*this);
+  simulator().microsequencer().Serialize(*this);
+  simulator().state().Serialize(*this);
+  simulator().memory().Serialize(*this);
+  simulator().predictor().Serialize(*this);
+  simulator().storebuffer().Serialize(*this);
+  simulator().pipeline().Serialize(*this);
+  Instructions();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Save                                            */
+/*                                                             */
+/* Purpose   : Write the simulator to filename.                */
+/*                                                             */
+/***************************************************************/
+bool Checkpoint::Save(const char * filename)
+{
+  restoring = false;
+  data.clear();
+  instructions.clear();
+  instruction_ids.clear();
+
+  data.insert(data.end(), CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + strlen(CHECKPOINT_MAGIC));
+  uint32_t version = CHECKPOINT_VERSION;
+  Value(version);
+  auto config = ConfigBytes();
+  uint32_t config_size = config.size();
+  Value(config_size);
+  data.insert(data.end(), config.begin(), config.end());
+
+  //the sections are preceded by their size, so that a file cut short is
+  //found before anything is restored
+  auto body = data.size();
+  uint64_t body_size = 0;
+  Value(body_size);
+  Sections();
+  body_size = data.size() - body - sizeof(body_size);
+  for(size_t i = 0; i < sizeof(body_size); i++)
+    data[body + i] = (body_size >> (8 * i)) & 0xff;
+
+  auto file = fopen(filename, "wb");
+  if (file == NULL)
+  {
+    simulator().Print("Error: Can't open checkpoint file %s\n", filename);
+    return false;
+  }
+  auto written = fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+  if (written != data.size())
+  {
+    simulator().Print("Error: Can't write checkpoint file %s\n", filename);
+    return false;
+  }
+  return true;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Restore                                         */
+/*                                                             */
+/* Purpose   : Read the simulator back from filename. The file */
+/*             is checked before anything is changed.          */
+/*                                                             */
+/***************************************************************/
+bool Checkpoint::Restore(const char * filename)
+{
+  auto file = fopen(filename, "rb");
+  if (file == NULL)
+  {
+    simulator().Print("Error: Can't open checkpoint file %s\n", filename);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  auto size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  data.resize(size < 0 ? 0 : size);
+  auto read = fread(data.data(), 1, data.size(), file);
+  fclose(file);
+  if (read != data.size())
+  {
+    simulator().Print("Error: Can't read checkpoint file %s\n", filename);
+    return false;
+  }
+
+  restoring = true;
+  truncated = false;
+  position = 0;
+  instructions.clear();
+  fixups.clear();
+
+  auto magic_size = strlen(CHECKPOINT_MAGIC);
+  if (data.size() < magic_size || memcmp(data.data(), CHECKPOINT_MAGIC, magic_size))
+  {
+    simulator().Print("Error: %s is not a checkpoint file\n", filename);
+    return false;
+  }
+  position = magic_size;
+  uint32_t version = 0;
+  Value(version);
+  if (version != CHECKPOINT_VERSION)
+  {
+    simulator().Print("Error: Checkpoint file %s has version %u, expected %d\n", filename, version, CHECKPOINT_VERSION);
+    return false;
+  }
+  auto config = ConfigBytes();
+  uint32_t config_size = 0;
+  Value(config_size);
+  if (config_size != config.size() || position + config_size > data.size() ||
+      memcmp(data.data() + position, config.data(), config_size))
+  {
+    simulator().Print("Error: Checkpoint file %s was taken with other simulator options\n", filename);
+    return false;
+  }
+  position += config_size;
+  uint64_t body_size = 0;
+  Value(body_size);
+  if (truncated || position + body_size != data.size())
+  {
+    simulator().Print("Error: Checkpoint file %s is truncated\n", filename);
+    return false;
+  }
+
+  Sections();
+  if (truncated || position != data.size())
+  {
+    throw SimulatorError(Format("Checkpoint file %s is corrupt", filename));
+  }
+  return true;
+}
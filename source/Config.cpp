@@ -0,0 +1,500 @@
+/***************************************************************/
+/* Config Implementaion                                        */
+/***************************************************************/
+
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <climits>
+#ifdef __linux__
+    #include "../include/Config.h"
+    #include "../include/Checkpoint.h"
+#else
+    #include "Config.h"
+    #include "Checkpoint.h"
+#endif
+
+/*
+* Default configuration: the original pipeline
+*/
+Config::Config() :
+predictor(PREDICT_NONE),
+btb_entries(64),
+bht_entries(1024),
+history_bits(10),
+ras_entries(0),
+itc_entries(0),
+fetch_stages(1),
+agex_stages(1),
+mem_stages(1),
+issue_width(1),
+resolve_stage(MEMORY),
+macro_fusion(false),
+fetch_queue_entries(0),
+icache_size(0),
+dcache_size(0),
+line_size(16),
+cache_ways(1),
+miss_latency(10),
+mshr_entries(0),
+store_buffer_entries(0),
+core(CORE_IN_ORDER),
+rob_entries(32),
+rs_entries(16),
+lsq_entries(8),
+jit(false),
+golden_check(false),
+validate_interval(false),
+sample_period(0),
+sample_window(1000),
+sample_warmup(2000),
+sample_error(0),
+skip_idle(true),
+headless(false),
+max_cycles(0),
+max_instructions(0),
+dump_registers(false),
+dump_statistics(false),
+output_format(OUTPUT_TEXT)
+{
+
+}
+
+/*
+* Return true if n is a non-zero power of two
+*/
+static bool IsPowerOfTwo(int n)
+{
+  return (n > 0) && ((n & (n - 1)) == 0);
+}
+
+/*
+* The text following option argv[i]
+*/
+static const char * OptionString(int argc, char *argv[], int i)
+{
+  if (i + 1 >= argc)
+  {
+    throw SimulatorError(Format("option %s requires a value", argv[i]));
+  }
+  return argv[i + 1];
+}
+
+/*
+* Read the integer value following option argv[i]
+*/
+static int OptionValue(int argc, char *argv[], int i)
+{
+  auto text = OptionString(argc, argv, i);
+  char * end;
+  errno = 0;
+  auto value = strtol(text, &end, 0);
+  if (end == text || *end || errno == ERANGE || value < INT_MIN || value > INT_MAX)
+  {
+    throw SimulatorError(Format("option %s takes an integer, not %s", argv[i], text));
+  }
+  return (int)value;
+}
+
+/*
+* Read the count following option argv[i], strtoull would wrap a
+* negative one around
+*/
+static uint64_t OptionCount(int argc, char *argv[], int i)
+{
+  auto text = OptionString(argc, argv, i);
+  char * end;
+  errno = 0;
+  auto value = strtoull(text, &end, 0);
+  if (end == text || *end || errno == ERANGE || strchr(text, '-'))
+  {
+    throw SimulatorError(Format("option %s takes a count of 0 or more, not %s", argv[i], text));
+  }
+  return value;
+}
+
+/*
+* Read the number following option argv[i]
+*/
+static double OptionNumber(int argc, char *argv[], int i)
+{
+  auto text = OptionString(argc, argv, i);
+  char * end;
+  errno = 0;
+  auto value = strtod(text, &end);
+  if (end == text || *end || errno == ERANGE)
+  {
+    throw SimulatorError(Format("option %s takes a number, not %s", argv[i], text));
+  }
+  return value;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : usage                                           */
+/*                                                             */
+/* Purpose   : Print out the command line options.             */
+/*                                                             */
+/***************************************************************/
+void Config::usage(const char * program) const
+{
+  //the defaults, not the options parsed so far
+  const Config defaults;
+
+  printf("usage: %s [options] <micro_code_file> <program_file_1> <program_file_2> ...\n", program);
+  printf("options:\n");
+  printf("  -bpred <none|static|bimodal|gshare|tournament>  branch predictor (none)\n");
+  printf("  -btb <n>      branch target buffer entries, power of two (%d)\n", defaults.btb_entries);
+  printf("  -bht <n>      direction predictor counters, power of two (%d)\n", defaults.bht_entries);
+  printf("  -ghr <n>      global history bits for gshare/tournament (%d)\n", defaults.history_bits);
+  printf("  -ras <n>      return address stack depth, 0 disables (%d)\n", defaults.ras_entries);
+  printf("  -itc <n>      indirect target cache entries, power of two, 0 disables (%d)\n", defaults.itc_entries);
+  printf("  -fetch <n>    cycles in the fetch stage, 1 to %d (%d)\n", MAX_STAGE_DEPTH, defaults.fetch_stages);
+  printf("  -agex <n>     cycles in the address generation/execute stage, 1 to %d (%d)\n", MAX_STAGE_DEPTH, defaults.agex_stages);
+  printf("  -mem <n>      cycles in the memory stage, 1 to %d (%d)\n", MAX_STAGE_DEPTH, defaults.mem_stages);
+  printf("  -width <n>    issue width, 1 to %d (%d)\n", MAX_ISSUE_WIDTH, defaults.issue_width);
+  printf("  -resolve <de|agex|mem>  stage that resolves branches, jumps and calls (mem)\n");
+  printf("  -fuse         fuse ALU ops that set the condition codes with the next conditional branch\n");
+  printf("  -fq <n>       fetch queue entries between fetch and decode, 0 disables (%d)\n", defaults.fetch_queue_entries);
+  printf("  -icache <n>   instruction cache bytes, power of two, 0 is ideal memory (%d)\n", defaults.icache_size);
+  printf("  -dcache <n>   data cache bytes, power of two, 0 is ideal memory (%d)\n", defaults.dcache_size);
+  printf("  -line <n>     cache line bytes, power of two (%d)\n", defaults.line_size);
+  printf("  -assoc <n>    cache ways, power of two (%d)\n", defaults.cache_ways);
+  printf("  -miss <n>     cycles to fill a cache line (%d)\n", defaults.miss_latency);
+  printf("  -mshr <n>     outstanding data cache misses, 0 is a blocking cache (%d)\n", defaults.mshr_entries);
+  printf("  -sb <n>       store buffer entries of the in-order pipeline, 0 disables (%d)\n", defaults.store_buffer_entries);
+  printf("  -core <inorder|ooo|interval>  timing model (inorder)\n");
+  printf("  -rob <n>      reorder buffer entries of the ooo core (%d)\n", defaults.rob_entries);
+  printf("  -rs <n>       reservation stations of the ooo core (%d)\n", defaults.rs_entries);
+  printf("  -lsq <n>      load/store queue entries of the ooo core (%d)\n", defaults.lsq_entries);
+  printf("  -jit          fast-forward hot blocks as x86-64 host code\n");
+  printf("  -check        check every write back of the in-order pipeline against a golden model\n");
+  printf("  -validate     run the interval model beside the in-order pipeline and report its error\n");
+  printf("  -sample <n>   run a detailed window every n instructions, warm functionally in between\n");
+  printf("  -window <n>   instructions measured per window (%llu)\n", (unsigned long long)defaults.sample_window);
+  printf("  -warmup <n>   detailed instructions before each window (%llu)\n", (unsigned long long)defaults.sample_warmup);
+  printf("  -error <pct>  stop sampling once the CPI is known within pct at 95%% confidence\n");
+  printf("  -noskip       simulate idle cycles one by one instead of jumping to the next event\n");
+  printf("headless options, any of them runs without the command prompt:\n");
+  printf("  -headless     run until HALT, write the results and exit\n");
+  printf("  -cycles <n>   stop after n cycles, 0 has no limit (%d)\n", defaults.max_cycles);
+  printf("  -insts <n>    stop after n retired instructions, 0 has no limit (%llu)\n", (unsigned long long)defaults.max_instructions);
+  printf("  -rdump        write the architectural state\n");
+  printf("  -mdump <low:high>  write memory from byte address low to high, may repeat\n");
+  printf("  -stats        write every registered statistic\n");
+  printf("  -out <file>   write the results to file instead of the console\n");
+  printf("  -format <text|json>  format of the results (text)\n");
+  printf("exit status of a headless run: 0 halted, 1 error, 2 stopped at -cycles or -insts\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : parse                                           */
+/*                                                             */
+/* Purpose   : Consume the leading options of the command line */
+/*             and return the index of the first file name.    */
+/*                                                             */
+/***************************************************************/
+int Config::parse(int argc, char *argv[])
+{
+  auto i = 1;
+  for (; i < argc && argv[i][0] == '-'; i++)
+  {
+    if (!strcmp(argv[i], "-bpred"))
+    {
+      if (i + 1 >= argc)
+      {
+        throw SimulatorError(Format("option %s requires a value", argv[i]));
+      }
+      auto name = argv[++i];
+      if (!strcmp(name, "none"))            predictor = PREDICT_NONE;
+      else if (!strcmp(name, "static"))     predictor = PREDICT_STATIC;
+      else if (!strcmp(name, "bimodal"))    predictor = PREDICT_BIMODAL;
+      else if (!strcmp(name, "gshare"))     predictor = PREDICT_GSHARE;
+      else if (!strcmp(name, "tournament")) predictor = PREDICT_TOURNAMENT;
+      else
+      {
+        throw SimulatorError(Format("unknown branch predictor %s", name));
+      }
+    }
+    else if (!strcmp(argv[i], "-btb"))
+      btb_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-bht"))
+      bht_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-ghr"))
+      history_bits = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-ras"))
+      ras_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-itc"))
+      itc_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-fetch"))
+      fetch_stages = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-agex"))
+      agex_stages = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-mem"))
+      mem_stages = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-width"))
+      issue_width = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-resolve"))
+    {
+      if (i + 1 >= argc)
+      {
+        throw SimulatorError(Format("option %s requires a value", argv[i]));
+      }
+      auto name = argv[++i];
+      if (!strcmp(name, "de"))        resolve_stage = DECODE;
+      else if (!strcmp(name, "agex")) resolve_stage = AGEX;
+      else if (!strcmp(name, "mem"))  resolve_stage = MEMORY;
+      else
+      {
+        throw SimulatorError(Format("unknown resolve stage %s", name));
+      }
+    }
+    else if (!strcmp(argv[i], "-fuse"))
+      macro_fusion = true;
+    else if (!strcmp(argv[i], "-fq"))
+      fetch_queue_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-icache"))
+      icache_size = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-dcache"))
+      dcache_size = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-line"))
+      line_size = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-assoc"))
+      cache_ways = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-miss"))
+      miss_latency = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-mshr"))
+      mshr_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-sb"))
+      store_buffer_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-core"))
+    {
+      if (i + 1 >= argc)
+      {
+        throw SimulatorError(Format("option %s requires a value", argv[i]));
+      }
+      auto name = argv[++i];
+      if (!strcmp(name, "inorder"))  core = CORE_IN_ORDER;
+      else if (!strcmp(name, "ooo")) core = CORE_OUT_OF_ORDER;
+      else if (!strcmp(name, "interval")) core = CORE_INTERVAL;
+      else
+      {
+        throw SimulatorError(Format("unknown core %s", name));
+      }
+    }
+    else if (!strcmp(argv[i], "-rob"))
+      rob_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-rs"))
+      rs_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-lsq"))
+      lsq_entries = OptionValue(argc, argv, i++);
+    else if (!strcmp(argv[i], "-jit"))
+      jit = true;
+    else if (!strcmp(argv[i], "-check"))
+      golden_check = true;
+    else if (!strcmp(argv[i], "-validate"))
+      validate_interval = true;
+    else if (!strcmp(argv[i], "-sample"))
+      sample_period = OptionCount(argc, argv, i++);
+    else if (!strcmp(argv[i], "-window"))
+      sample_window = OptionCount(argc, argv, i++);
+    else if (!strcmp(argv[i], "-warmup"))
+      sample_warmup = OptionCount(argc, argv, i++);
+    else if (!strcmp(argv[i], "-error"))
+      sample_error = OptionNumber(argc, argv, i++);
+    else if (!strcmp(argv[i], "-noskip"))
+      skip_idle = false;
+    else if (!strcmp(argv[i], "-headless"))
+      headless = true;
+    else if (!strcmp(argv[i], "-cycles"))
+    {
+      max_cycles = OptionValue(argc, argv, i++);
+      headless = true;
+    }
+    else if (!strcmp(argv[i], "-insts"))
+    {
+      max_instructions = OptionCount(argc, argv, i++);
+      headless = true;
+    }
+    else if (!strcmp(argv[i], "-rdump"))
+      headless = dump_registers = true;
+    else if (!strcmp(argv[i], "-mdump"))
+    {
+      auto range = OptionString(argc, argv, i++);
+      char * end;
+      auto low = (int)strtol(range, &end, 0);
+      if (*end != ':')
+        throw SimulatorError(Format("-mdump takes low:high, not %s", range));
+      auto high = (int)strtol(end + 1, &end, 0);
+      if (*end || low < 0 || high < low || high > 0xffff)
+        throw SimulatorError(Format("-mdump range %s is not within 0x0000:0xffff", range));
+      memory_dumps.push_back(std::make_pair(low, high));
+      headless = true;
+    }
+    else if (!strcmp(argv[i], "-stats"))
+      headless = dump_statistics = true;
+    else if (!strcmp(argv[i], "-out"))
+    {
+      output_file = OptionString(argc, argv, i++);
+      headless = true;
+    }
+    else if (!strcmp(argv[i], "-format"))
+    {
+      auto name = OptionString(argc, argv, i++);
+      if (!strcmp(name, "text"))      output_format = OUTPUT_TEXT;
+      else if (!strcmp(name, "json")) output_format = OUTPUT_JSON;
+      else
+      {
+        throw SimulatorError(Format("unknown format %s", name));
+      }
+      headless = true;
+    }
+    else
+    {
+      throw SimulatorError(Format("unknown option %s", argv[i]));
+    }
+  }
+
+  if (!IsPowerOfTwo(btb_entries) || !IsPowerOfTwo(bht_entries))
+  {
+    throw SimulatorError("-btb and -bht must be powers of two");
+  }
+
+  if (ras_entries < 0 || (itc_entries != 0 && !IsPowerOfTwo(itc_entries)))
+  {
+    throw SimulatorError("-ras must not be negative and -itc must be 0 or a power of two");
+  }
+
+  if ((ras_entries || itc_entries) && predictor == PREDICT_NONE)
+  {
+    throw SimulatorError("-ras and -itc require a branch predictor (-bpred)");
+  }
+
+  if (history_bits < 1 || history_bits > 16)
+  {
+    throw SimulatorError("-ghr must be between 1 and 16");
+  }
+
+  if (fetch_stages < 1 || fetch_stages > MAX_STAGE_DEPTH ||
+      agex_stages < 1 || agex_stages > MAX_STAGE_DEPTH ||
+      mem_stages < 1 || mem_stages > MAX_STAGE_DEPTH)
+  {
+    throw SimulatorError(Format("-fetch, -agex and -mem must be between 1 and %d", MAX_STAGE_DEPTH));
+  }
+
+  if (issue_width < 1 || issue_width > MAX_ISSUE_WIDTH)
+  {
+    throw SimulatorError(Format("-width must be between 1 and %d", MAX_ISSUE_WIDTH));
+  }
+
+  if (fetch_queue_entries < 0 || (fetch_queue_entries && fetch_queue_entries < issue_width))
+  {
+    throw SimulatorError("-fq must be 0 or at least the issue width");
+  }
+
+  if (!IsPowerOfTwo(line_size) || line_size < 2 || !IsPowerOfTwo(cache_ways) || miss_latency < 1)
+  {
+    throw SimulatorError("-line and -assoc must be powers of two and -miss at least 1");
+  }
+
+  if ((icache_size != 0 && (!IsPowerOfTwo(icache_size) || icache_size < line_size * cache_ways)) ||
+      (dcache_size != 0 && (!IsPowerOfTwo(dcache_size) || dcache_size < line_size * cache_ways)))
+  {
+    throw SimulatorError("-icache and -dcache must be 0 or a power of two of at least -line times -assoc bytes");
+  }
+
+  if (mshr_entries < 0 || (mshr_entries && !dcache_size))
+  {
+    throw SimulatorError("-mshr must not be negative and requires a data cache (-dcache)");
+  }
+
+  if (resolve_stage != MEMORY && core == CORE_OUT_OF_ORDER)
+  {
+    throw SimulatorError("-resolve is only used by the in-order pipeline");
+  }
+
+  if (macro_fusion && core == CORE_OUT_OF_ORDER)
+  {
+    throw SimulatorError("-fuse is only used by the in-order pipeline");
+  }
+
+  if (store_buffer_entries < 0 || (store_buffer_entries && core == CORE_OUT_OF_ORDER))
+  {
+    throw SimulatorError("-sb must not be negative and is only used by the in-order pipeline");
+  }
+
+  if (golden_check && core != CORE_IN_ORDER)
+  {
+    throw SimulatorError("-check is only used by the in-order pipeline");
+  }
+
+  if (validate_interval && core != CORE_IN_ORDER)
+  {
+    throw SimulatorError("-validate runs the interval model beside the in-order pipeline");
+  }
+
+  if (sample_period && (core != CORE_IN_ORDER || validate_interval))
+  {
+    throw SimulatorError("-sample runs windows of the in-order pipeline, without -validate");
+  }
+
+  if (sample_period && (!sample_window || sample_period < sample_window + sample_warmup))
+  {
+    throw SimulatorError("-window must be at least 1 and -sample at least -window plus -warmup");
+  }
+
+  if (sample_error < 0 || (sample_error && !sample_period))
+  {
+    throw SimulatorError("-error must not be negative and requires -sample");
+  }
+
+  if (max_cycles < 0)
+  {
+    throw SimulatorError("-cycles must not be negative");
+  }
+
+  if (sample_period && max_cycles)
+  {
+    throw SimulatorError("-cycles does not limit a sampled run, use -insts");
+  }
+
+  if (rob_entries < 1 || rs_entries < 1 || lsq_entries < 1)
+  {
+    throw SimulatorError("-rob, -rs and -lsq must be at least 1");
+  }
+
+  return i;
+}
+
+/*
+* The options that shape the simulated machine, a checkpoint is only
+* restored with the same ones
+*/
+void Config::Serialize(Checkpoint & cp)
+{
+  cp.Value(predictor);
+  cp.Value(btb_entries);
+  cp.Value(bht_entries);
+  cp.Value(history_bits);
+  cp.Value(ras_entries);
+  cp.Value(itc_entries);
+  cp.Value(fetch_stages);
+  cp.Value(agex_stages);
+  cp.Value(mem_stages);
+  cp.Value(issue_width);
+  cp.Value(resolve_stage);
+  cp.Value(macro_fusion);
+  cp.Value(fetch_queue_entries);
+  cp.Value(icache_size);
+  cp.Value(dcache_size);
+  cp.Value(line_size);
+  cp.Value(cache_ways);
+  cp.Value(miss_latency);
+  cp.Value(mshr_entries);
+  cp.Value(store_buffer_entries);
+  cp.Value(core);
+  cp.Value(rob_entries);
+  cp.Value(rs_entries);
+  cp.Value(lsq_entries);
+}
@@ -11,20 +11,21 @@
 #endif
 
 
+// Using a map for trap vectors to make it cleaner. It is built before main
+// rather than on first use, so simulators on other threads only read it.
+static const std::map<int, std::string> trap_map = {
+    {0x20, "GETC"},
+    {0x21, "OUT"},
+    {0x22, "PUTS"},
+    {0x23, "IN"},
+    {0x24, "PUTSP"},
+    {0x25, "HALT"}
+};
+
 std::string Disassembler::disassemble(bits16 instruction) {
     std::stringstream ss;
     auto opcode = instruction.range<15, 12>();
 
-    // Using a map for trap vectors to make it cleaner
-    static const std::map<int, std::string> trap_map = {
-        {0x20, "GETC"},
-        {0x21, "OUT"},
-        {0x22, "PUTS"},
-        {0x23, "IN"},
-        {0x24, "PUTSP"},
-        {0x25, "HALT"}
-    };
-
     switch (opcode.to_num()) {
         case 0b0000: // BR
             return format_branch(instruction);
@@ -0,0 +1,82 @@
+/***************************************************************/
+/* Event Queue Implementaion                                   */
+/***************************************************************/
+
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/Statistics.h"
+    #include "../include/EventQueue.h"
+#else
+    #include "Simulator.h"
+    #include "Statistics.h"
+    #include "EventQueue.h"
+#endif
+
+EventQueue::EventQueue(Simulator & instance) :
+_simulator(instance),
+enabled(false),
+skips(0),
+skipped_cycles(0)
+{
+
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_events                                     */
+/*                                                             */
+/* Purpose   : Forget the wake-ups and clear the counters      */
+/*                                                             */
+/***************************************************************/
+void EventQueue::init_events()
+{
+  auto & config = simulator().config();
+  enabled = config.skip_idle && config.core == CORE_IN_ORDER;
+  wakeups = decltype(wakeups)();
+  skips = 0;
+  skipped_cycles = 0;
+}
+
+/*
+* Wake the simulator up at cycle, the first cycle that behaves differently
+*/
+void EventQueue::Schedule(int cycle)
+{
+  if (!enabled)
+    return;
+  NextEvent(simulator().GetCycles());
+  wakeups.push(cycle);
+}
+
+/*
+* The earliest wake-up at or after cycle, INT_MAX without one. Wake-ups
+* before cycle have passed and are dropped.
+*/
+int EventQueue::NextEvent(int cycle)
+{
+  while (!wakeups.empty() && wakeups.top() < cycle)
+    wakeups.pop();
+  return wakeups.empty() ? INT_MAX : wakeups.top();
+}
+
+/*
+* Count a jump over cycles idle cycles
+*/
+void EventQueue::Skipped(int cycles)
+{
+  skips++;
+  skipped_cycles += cycles;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the idle cycle counters.               */
+/*                                                             */
+/***************************************************************/
+void EventQueue::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("events.skips", "jumps over idle cycles to the next event", skips);
+  stats.AddScalar("events.skipped_cycles", "idle cycles not simulated one by one", skipped_cycles);
+}
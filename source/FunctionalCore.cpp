@@ -0,0 +1,636 @@
+/***************************************************************/
+/* Functional Core Implementaion                               */
+/***************************************************************/
+
+#include <algorithm>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/State.h"
+    #include "../include/MainMemory.h"
+    #include "../include/MicroSequencer.h"
+    #include "../include/OperationUnit.h"
+    #include "../include/Statistics.h"
+    #include "../include/FunctionalCore.h"
+    #include "../include/JitCompiler.h"
+    #include "../include/IntervalModel.h"
+#else
+    #include "Simulator.h"
+    #include "State.h"
+    #include "MainMemory.h"
+    #include "MicroSequencer.h"
+    #include "OperationUnit.h"
+    #include "Statistics.h"
+    #include "FunctionalCore.h"
+    #include "JitCompiler.h"
+    #include "IntervalModel.h"
+#endif
+
+FunctionalCore::FunctionalCore(Simulator & instance) :
+_simulator(instance),
+epoch(0),
+executed_instructions(0),
+blocks_translated(0),
+blocks_invalidated(0),
+chained_exits(0),
+native_instructions(0)
+{
+  context.core = this;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_functional                                 */
+/*                                                             */
+/* Purpose   : Drop the decoded blocks and clear the counters  */
+/*                                                             */
+/***************************************************************/
+void FunctionalCore::init_functional()
+{
+  blocks.clear();
+  dropped_blocks.clear();
+  epoch = 0;
+  executed_instructions = 0;
+  blocks_translated = 0;
+  blocks_invalidated = 0;
+  chained_exits = 0;
+  native_instructions = 0;
+}
+
+/*
+* Copy the registers and condition codes from State
+*/
+void FunctionalCore::LoadState()
+{
+  auto & cpu_state = simulator().state();
+  for(auto reg = 0; reg < LC3b_REGS; reg++)
+    context.regs[reg] = cpu_state.GetRegisterData(reg).to_num();
+  context.n = cpu_state.GetNBit();
+  context.z = cpu_state.GetZBit();
+  context.p = cpu_state.GetPBit();
+}
+
+/*
+* Copy the registers, condition codes and PC back to State
+*/
+void FunctionalCore::StoreState(uint16_t pc)
+{
+  auto & cpu_state = simulator().state();
+  for(auto reg = 0; reg < LC3b_REGS; reg++)
+    cpu_state.SetDataForRegister(reg, context.regs[reg]);
+  bits3 nzp;
+  nzp[2] = context.n;
+  nzp[1] = context.z;
+  nzp[0] = context.p;
+  cpu_state.SetNZP(nzp);
+  cpu_state.SetProgramCounter(pc);
+}
+
+/*
+* Word at a byte address, the low bit is ignored
+*/
+uint16_t FunctionalCore::ReadWord(uint16_t address)
+{
+  auto & memory = simulator().memory();
+  auto addr = address >> 1;
+  return (memory.GetUpperByteAt(addr).to_num() << 8) | memory.GetLowerByteAt(addr).to_num();
+}
+
+void FunctionalCore::SetCC(uint16_t value)
+{
+  context.n = value >> 15;
+  context.z = value == 0;
+  context.p = !context.n && !context.z;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Decode                                          */
+/*                                                             */
+/* Purpose   : Decode the instruction at pc into a micro-op.   */
+/*             The control store row selects the handler, an   */
+/*             instruction none of them covers exactly runs    */
+/*             through the whole datapath in Generic.          */
+/*                                                             */
+/***************************************************************/
+MicroOp FunctionalCore::Decode(uint16_t pc)
+{
+  auto & micro_seq = simulator().microsequencer();
+  bits16 ir = ReadWord(pc);
+  auto & ucode = micro_seq.GetMicroCodeFor(ir);
+
+  MicroOp op;
+  op.ir = ir.to_num();
+  op.npc = pc + 2;
+  op.sr1 = ir.range<8,6>().to_num();
+  op.sr2 = ir[13] ? ir.range<11,9>().to_num() : ir.range<2,0>().to_num();
+  op.dr = micro_seq.Get_DRMUX(ucode) ? 7 : ir.range<11,9>().to_num();
+  op.nzp = ir.range<11,9>().to_num();
+  op.ld_cc = micro_seq.Get_DE_LD_CC(ucode);
+  op.imm = ucode[ALU_RESULTMUX] ? ir.sign_ext(4).to_num() : ir.range<5,0>().to_num();
+
+  //address adder, with SR1 as base only the offset is known
+  bits16 offset;
+  switch((ucode[ADDR2MUX1] << 1) + ucode[ADDR2MUX0])
+  {
+    case 0: offset = 0; break;
+    case 1: offset = ir.sign_ext(5); break;
+    case 2: offset = ir.sign_ext(8); break;
+    case 3: offset = ir.sign_ext(10); break;
+  }
+  if(ucode[LSHF1])
+    offset = offset << 1;
+  op.offset = offset.to_num();
+  if(ucode[ADDRESSMUX])
+    op.target = op.npc + op.offset;
+  else
+    op.target = (ir.zero_ext(7) << 1).to_num();
+
+  bool base = ucode[ADDRESSMUX] && ucode[ADDR1MUX];
+  bool mem = micro_seq.Get_DE_DCACHE_EN(ucode);
+  bool word = ucode[DATA_SIZE];
+  bool imm = ucode[SR2MUX];
+  bool control = ucode[BR_OP] || ucode[UNCOND_OP] || ucode[TRAP_OP];
+  bool ld_reg = micro_seq.Get_DE_LD_REG(ucode);
+  auto value_mux = micro_seq.Get_DE_DR_VALUEMUX(ucode).to_num();
+  auto aluk = (ucode[ALUK1] << 1) + ucode[ALUK0];
+
+  static const MicroOpHandler alu_ops[4][2] = {
+    { &AluOp<0, false>, &AluOp<0, true> }, { &AluOp<1, false>, &AluOp<1, true> },
+    { &AluOp<2, false>, &AluOp<2, true> }, { &AluOp<3, false>, &AluOp<3, true> } };
+  static const MicroOpHandler load_ops[2][2] = {
+    { &LoadOp<false, false>, &LoadOp<false, true> }, { &LoadOp<true, false>, &LoadOp<true, true> } };
+  static const MicroOpHandler store_ops[2][2] = {
+    { &StoreOp<false, false>, &StoreOp<false, true> }, { &StoreOp<true, false>, &StoreOp<true, true> } };
+  static const MicroOpHandler jump_ops[2][2] = {
+    { &JumpOp<false, false>, &JumpOp<false, true> }, { &JumpOp<true, false>, &JumpOp<true, true> } };
+
+  op.aluk = aluk;
+  op.use_imm = imm;
+  op.base = base;
+  op.word = word;
+  op.link = ld_reg;
+
+  //a sequential successor at the halt vector and TRAP are left to Generic
+  op.kind = OP_GENERIC;
+  op.handler = &Generic;
+  if(op.npc == 0 || ucode[TRAP_OP])
+    return op;
+  if(!mem && !control && ld_reg && value_mux == 3)
+  {
+    op.kind = ucode[ALU_RESULTMUX] ? OP_ALU : OP_SHIFT;
+    op.handler = ucode[ALU_RESULTMUX] ? alu_ops[aluk][imm] : &ShiftOp;
+  }
+  else if(!mem && !control && ld_reg && value_mux == 0)
+  {
+    op.kind = OP_ADDRESS;
+    op.handler = base ? &AddressOp<true> : &AddressOp<false>;
+  }
+  else if(mem && !ucode[DCACHE_RW] && !control && ld_reg && value_mux == 1)
+  {
+    op.kind = OP_LOAD;
+    op.handler = load_ops[word][base];
+  }
+  else if(mem && ucode[DCACHE_RW] && !control && !ld_reg && !op.ld_cc &&
+          ucode[ALU_RESULTMUX] && aluk == 3 && !imm)
+  {
+    op.kind = OP_STORE;
+    op.handler = store_ops[word][base];
+  }
+  else if(ucode[BR_OP] && !mem && !ld_reg && !op.ld_cc && !base)
+  {
+    op.kind = OP_BRANCH;
+    op.handler = &BranchOp;
+  }
+  else if(ucode[UNCOND_OP] && !ucode[BR_OP] && !mem && !op.ld_cc && (!ld_reg || value_mux == 2))
+  {
+    op.kind = OP_JUMP;
+    op.handler = jump_ops[base][ld_reg];
+  }
+  return op;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Translate                                       */
+/*                                                             */
+/* Purpose   : Decode the basic block starting at pc and mark  */
+/*             the pages it was read from as code.             */
+/*                                                             */
+/***************************************************************/
+BasicBlock * FunctionalCore::Translate(uint16_t pc)
+{
+  auto & memory = simulator().memory();
+  auto & micro_seq = simulator().microsequencer();
+  std::unique_ptr<BasicBlock> block(new BasicBlock());
+  block->start = pc;
+
+  for(auto i = 0; i < MAX_BLOCK_OPS; i++)
+  {
+    auto op = Decode(pc);
+    memory.MarkCodePage((pc >> 1) / CODE_PAGE_WORDS);
+    block->ops.push_back(op);
+    auto & ucode = micro_seq.GetMicroCodeFor(op.ir);
+    if(ucode[BR_OP] || ucode[UNCOND_OP] || ucode[TRAP_OP] || op.npc == 0)
+      break;
+    pc = op.npc;
+  }
+
+  //the target of BR and JSR is known, that of JMP, JSRR and TRAP is not
+  auto & last = block->ops.back();
+  auto & ucode = micro_seq.GetMicroCodeFor(last.ir);
+  bool known_target = (ucode[BR_OP] || ucode[UNCOND_OP]) && !(ucode[ADDRESSMUX] && ucode[ADDR1MUX]);
+  block->exit_pc[0] = last.npc;
+  block->exit_pc[1] = known_target ? last.target : last.npc;
+  for(auto exit = 0; exit < 2; exit++)
+  {
+    block->exit_block[exit] = nullptr;
+    block->exit_epoch[exit] = 0;
+  }
+  block->runs = 0;
+  block->native = nullptr;
+
+  blocks_translated++;
+  auto translated = block.get();
+  auto start = block->start;
+  blocks[start] = std::move(block);
+  return translated;
+}
+
+BasicBlock * FunctionalCore::Lookup(uint16_t pc)
+{
+  auto found = blocks.find(pc);
+  if(found != blocks.end())
+    return found->second.get();
+  return Translate(pc);
+}
+
+/*
+* The block an exit of block to pc leads to, through its chained link
+* when one was made since code was last written
+*/
+BasicBlock * FunctionalCore::NextBlock(BasicBlock * block, uint16_t pc)
+{
+  for(auto exit = 0; exit < 2; exit++)
+  {
+    if(block->exit_pc[exit] == pc && block->exit_block[exit] && block->exit_epoch[exit] == epoch)
+    {
+      chained_exits++;
+      return block->exit_block[exit];
+    }
+  }
+
+  auto next = Lookup(pc);
+  for(auto exit = 0; exit < 2; exit++)
+  {
+    if(block->exit_pc[exit] == pc)
+    {
+      block->exit_block[exit] = next;
+      block->exit_epoch[exit] = epoch;
+    }
+  }
+  return next;
+}
+
+/*
+* Translate a hot block to host code. When the code buffer is full every
+* translation is dropped and the buffer starts over.
+*/
+void FunctionalCore::CompileBlock(BasicBlock * block)
+{
+  auto & jit = simulator().jit();
+  block->native = jit.Compile(*block);
+  if(!block->native && jit.IsFull())
+  {
+    for(auto & entry : blocks)
+      entry.second->native = nullptr;
+    jit.Flush();
+    block->native = jit.Compile(*block);
+  }
+}
+
+/*
+* Memory wrote the word at addr of a page blocks were decoded from. Drop
+* the blocks decoded from that word and, if there were any, every chained
+* link; a running block stops after the instruction that wrote. Return
+* whether blocks decoded from the page are left.
+*/
+bool FunctionalCore::InvalidateWord(int addr)
+{
+  auto first = addr / CODE_PAGE_WORDS * CODE_PAGE_WORDS, last = first + CODE_PAGE_WORDS - 1;
+  auto dropped = false, page_has_code = false;
+  for(auto it = blocks.begin(); it != blocks.end();)
+  {
+    int start = it->second->start >> 1;
+    int end = start + (int)it->second->ops.size() - 1;
+    if(start <= addr && end >= addr)
+    {
+      dropped_blocks.push_back(std::move(it->second));
+      it = blocks.erase(it);
+      blocks_invalidated++;
+      dropped = true;
+    }
+    else
+    {
+      page_has_code = page_has_code || (start <= last && end >= first);
+      ++it;
+    }
+  }
+  if(dropped)
+    epoch++;
+  return page_has_code;
+}
+
+/*
+* Execute the instruction at the PC
+*/
+void FunctionalCore::Step()
+{
+  Run(1, NO_STOP_PC);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Run                                             */
+/*                                                             */
+/* Purpose   : Execute up to count instructions, stopping      */
+/*             early when the PC reaches stop_pc or the        */
+/*             machine halts. Return the instructions          */
+/*             executed. With a model every instruction is     */
+/*             handed to it, and no block runs as host code.   */
+/*                                                             */
+/***************************************************************/
+uint64_t FunctionalCore::Run(uint64_t count, int stop_pc, IntervalModel * model)
+{
+  LoadState();
+  uint16_t pc = simulator().state().GetProgramCounter().to_num();
+  uint64_t executed = 0;
+  BasicBlock * block = nullptr;
+  auto use_jit = simulator().jit().IsEnabled();
+
+  while(executed < count && pc != 0)
+  {
+    if(!block)
+      block = Lookup(pc);
+
+    //a block that runs into stop_pc or past count ends early
+    auto size = block->ops.size();
+    auto ops = (size_t)std::min<uint64_t>(size, count - executed);
+    if(stop_pc > block->start && ((stop_pc - block->start) & 1) == 0)
+      ops = std::min<size_t>(ops, (stop_pc - block->start) / 2);
+
+    //a translated block runs whole, and returns early in front of an
+    //instruction it leaves to the handlers or after writing code
+    auto block_epoch = epoch;
+    size_t i = 0;
+    if(ops == size && block->native && !model)
+    {
+      pc = block->native(&context);
+      i = context.executed;
+      native_instructions += i;
+    }
+    else if(ops == size && use_jit && !model && ++block->runs == JIT_THRESHOLD)
+      CompileBlock(block);
+    while(i < ops && epoch == block_epoch)
+    {
+      auto & op = block->ops[i++];
+      if(model)
+        model->Execute(op.npc - 2, op.ir, op.base ? context.regs[op.sr1] + op.offset : op.target);
+      pc = op.handler(*this, op);
+    }
+    executed += i;
+    if(pc == stop_pc)
+      break;
+    block = (i == size && epoch == block_epoch) ? NextBlock(block, pc) : nullptr;
+  }
+
+  StoreState(pc);
+  dropped_blocks.clear();
+  executed_instructions += executed;
+  return executed;
+}
+
+/*
+* Any instruction: the control store row drives the datapath of the
+* pipeline stages in a single step, address and ALU in AGEX, memory
+* access and next PC in MEM, write back in SR
+*/
+uint16_t FunctionalCore::Generic(FunctionalCore & core, const MicroOp & op)
+{
+  auto & memory = core.simulator().memory();
+  auto & micro_seq = core.simulator().microsequencer();
+  bits16 ir = op.ir;
+  auto & ucode = micro_seq.GetMicroCodeFor(ir);
+  bits16 sr1_data = core.context.regs[op.sr1];
+  bits16 sr2_data = core.context.regs[op.sr2];
+
+  //address adder
+  bits16 address = op.target;
+  if(ucode[ADDRESSMUX] && ucode[ADDR1MUX])
+    address = sr1_data + bits16(op.offset);
+
+  //ALU or shifter
+  bits16 alu_result;
+  if(ucode[ALU_RESULTMUX])
+  {
+    bits16 source2 = ucode[SR2MUX] ? ir.sign_ext(4) : sr2_data;
+    bits2 aluk = (ucode[ALUK1] << 1) + ucode[ALUK0];
+    alu_result = Alu(sr1_data, source2, aluk).Output();
+  }
+  else
+    alu_result = Shifter(sr1_data, ir.range<5,0>()).Output();
+
+  //memory access, a byte goes to the half selected by the address
+  uint16_t data = 0;
+  if(micro_seq.Get_DE_DCACHE_EN(ucode))
+  {
+    auto word = ucode[DATA_SIZE];
+    auto addr = address >> 1;
+    if(ucode[DCACHE_RW])
+    {
+      if(word || !address[0])
+        memory.SetLowerByteAt(addr, alu_result.range<7,0>());
+      if(word)
+        memory.SetUpperByteAt(addr, alu_result.range<15,8>());
+      else if(address[0])
+        memory.SetUpperByteAt(addr, alu_result.range<7,0>());
+    }
+    else
+    {
+      data = core.ReadWord(address.to_num());
+      if(!word)
+      {
+        data = address[0] ? data >> 8 : data & 0xff;
+        if(data & 0x80)
+          data |= 0xff00;
+      }
+    }
+  }
+
+  //next PC from the branch logic
+  uint16_t next_pc = op.npc;
+  if(micro_seq.Get_DE_BR_OP(ucode))
+  {
+    if(((op.nzp & 4) && core.context.n) || ((op.nzp & 2) && core.context.z) || ((op.nzp & 1) && core.context.p))
+      next_pc = address.to_num();
+  }
+  else if(ucode[UNCOND_OP])
+    next_pc = address.to_num();
+  else if(micro_seq.Get_DE_TRAP_OP(ucode))
+    next_pc = data;
+
+  //as in the detailed cores, the machine stops when the PC reaches the
+  //halt vector, before the TRAP writes R7
+  if(next_pc == 0)
+    return next_pc;
+
+  //write back
+  uint16_t dr_value = 0;
+  switch(micro_seq.Get_DE_DR_VALUEMUX(ucode).to_num())
+  {
+    case 0: dr_value = address.to_num(); break;
+    case 1: dr_value = data; break;
+    case 2: dr_value = op.npc; break;
+    case 3: dr_value = alu_result.to_num(); break;
+  }
+  if(micro_seq.Get_DE_LD_REG(ucode))
+    core.context.regs[op.dr] = dr_value;
+  if(op.ld_cc)
+    core.SetCC(dr_value);
+  return next_pc;
+}
+
+/*
+* ADD, AND and XOR with SR2 or the immediate
+*/
+template<int ALUK, bool IMM>
+uint16_t FunctionalCore::AluOp(FunctionalCore & core, const MicroOp & op)
+{
+  uint16_t source1 = core.context.regs[op.sr1];
+  uint16_t source2 = IMM ? op.imm : core.context.regs[op.sr2];
+  uint16_t result;
+  switch(ALUK)
+  {
+    case 0:  result = source1 + source2; break;
+    case 1:  result = source1 & source2; break;
+    case 2:  result = source1 ^ source2; break;
+    default: result = source2; break;
+  }
+  core.context.regs[op.dr] = result;
+  if(op.ld_cc)
+    core.SetCC(result);
+  return op.npc;
+}
+
+/*
+* LSHF, RSHFL and RSHFA by the amount in the shift control
+*/
+uint16_t FunctionalCore::ShiftOp(FunctionalCore & core, const MicroOp & op)
+{
+  uint16_t source = core.context.regs[op.sr1];
+  auto amount = op.imm & 0xf;
+  uint16_t result;
+  switch((op.imm >> 4) & 3)
+  {
+    case 0:  result = source << amount; break;
+    case 1:  result = source >> amount; break;
+    case 3:  result = (int16_t)source >> amount; break;
+    default: result = 0; break;
+  }
+  core.context.regs[op.dr] = result;
+  if(op.ld_cc)
+    core.SetCC(result);
+  return op.npc;
+}
+
+/*
+* LEA, the address is written to the register
+*/
+template<bool BASE>
+uint16_t FunctionalCore::AddressOp(FunctionalCore & core, const MicroOp & op)
+{
+  uint16_t address = BASE ? core.context.regs[op.sr1] + op.offset : op.target;
+  core.context.regs[op.dr] = address;
+  if(op.ld_cc)
+    core.SetCC(address);
+  return op.npc;
+}
+
+/*
+* LDW and LDB, a byte is sign extended
+*/
+template<bool WORD, bool BASE>
+uint16_t FunctionalCore::LoadOp(FunctionalCore & core, const MicroOp & op)
+{
+  uint16_t address = BASE ? core.context.regs[op.sr1] + op.offset : op.target;
+  uint16_t data = core.ReadWord(address);
+  if(!WORD)
+  {
+    data = (address & 1) ? data >> 8 : data & 0xff;
+    if(data & 0x80)
+      data |= 0xff00;
+  }
+  core.context.regs[op.dr] = data;
+  if(op.ld_cc)
+    core.SetCC(data);
+  return op.npc;
+}
+
+/*
+* STW and STB, a byte goes to the half selected by the address
+*/
+template<bool WORD, bool BASE>
+uint16_t FunctionalCore::StoreOp(FunctionalCore & core, const MicroOp & op)
+{
+  auto & memory = core.simulator().memory();
+  uint16_t address = BASE ? core.context.regs[op.sr1] + op.offset : op.target;
+  uint16_t value = core.context.regs[op.sr2];
+  auto addr = address >> 1;
+  if(WORD)
+  {
+    memory.SetLowerByteAt(addr, value & 0xff);
+    memory.SetUpperByteAt(addr, value >> 8);
+  }
+  else if(address & 1)
+    memory.SetUpperByteAt(addr, value & 0xff);
+  else
+    memory.SetLowerByteAt(addr, value & 0xff);
+  return op.npc;
+}
+
+/*
+* BR on the condition codes
+*/
+uint16_t FunctionalCore::BranchOp(FunctionalCore & core, const MicroOp & op)
+{
+  if(((op.nzp & 4) && core.context.n) || ((op.nzp & 2) && core.context.z) || ((op.nzp & 1) && core.context.p))
+    return op.target;
+  return op.npc;
+}
+
+/*
+* JMP, JSR and JSRR, the return address is not written when the jump halts
+*/
+template<bool BASE, bool LINK>
+uint16_t FunctionalCore::JumpOp(FunctionalCore & core, const MicroOp & op)
+{
+  uint16_t target = BASE ? core.context.regs[op.sr1] + op.offset : op.target;
+  if(LINK && target != 0)
+    core.context.regs[op.dr] = op.npc;
+  return target;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the functional core counters.          */
+/*                                                             */
+/***************************************************************/
+void FunctionalCore::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("functional.instructions", "instructions fast-forwarded", executed_instructions);
+  stats.AddScalar("functional.blocks_translated", "basic blocks decoded", blocks_translated);
+  stats.AddScalar("functional.blocks_invalidated", "blocks dropped by a write to their code", blocks_invalidated);
+  stats.AddScalar("functional.chained_exits", "block exits that followed a chained link", chained_exits);
+  stats.AddScalar("functional.native_instructions", "instructions run as translated host code", native_instructions);
+}
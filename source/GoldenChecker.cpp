@@ -0,0 +1,377 @@
+/***************************************************************/
+/* Golden Model Checker Implementaion                          */
+/***************************************************************/
+
+#include <algorithm>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/instruction.h"
+    #include "../include/State.h"
+    #include "../include/MainMemory.h"
+    #include "../include/MicroSequencer.h"
+    #include "../include/PipeLine.h"
+    #include "../include/StoreBuffer.h"
+    #include "../include/Statistics.h"
+    #include "../include/Disassembler.h"
+    #include "../include/GoldenChecker.h"
+#else
+    #include "Simulator.h"
+    #include "instruction.h"
+    #include "State.h"
+    #include "MainMemory.h"
+    #include "MicroSequencer.h"
+    #include "PipeLine.h"
+    #include "StoreBuffer.h"
+    #include "Statistics.h"
+    #include "Disassembler.h"
+    #include "GoldenChecker.h"
+#endif
+
+GoldenChecker::GoldenChecker(Simulator & instance) :
+_simulator(instance),
+enabled(false),
+pc(0),
+pc_known(false),
+regs(),
+nzp(0),
+next_seq(0),
+checked(0),
+stores_checked(0),
+syncs(0)
+{
+
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_checker                                    */
+/*                                                             */
+/* Purpose   : Enable the checker if the options ask for it    */
+/*             and clear the reference machine.                */
+/*                                                             */
+/***************************************************************/
+void GoldenChecker::init_checker()
+{
+  enabled = simulator().config().golden_check;
+  pc = 0;
+  pc_known = false;
+  std::fill_n(regs, 8, 0);
+  nzp = 0;
+  memory.assign(enabled ? 2 * WORDS_IN_MEM : 0, 0);
+  next_seq = 0;
+  checked = 0;
+  stores_checked = 0;
+  syncs = 0;
+}
+
+/*
+* value sign extended from its low bits
+*/
+static uint16_t SignExtend(uint16_t value, int bits)
+{
+  uint16_t sign = 1 << (bits - 1);
+  value &= (1 << bits) - 1;
+  return (value ^ sign) - sign;
+}
+
+/*
+* The condition codes of a value written to a register
+*/
+static int ConditionCodes(uint16_t value)
+{
+  return (value & 0x8000) ? 4 : (value == 0) ? 2 : 1;
+}
+
+/*
+* The word at a byte address of the reference memory, bit 0 is ignored
+*/
+uint16_t GoldenChecker::Word(uint16_t address) const
+{
+  address &= 0xfffe;
+  return memory[address] | (memory[address + 1] << 8);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Sync                                            */
+/*                                                             */
+/* Purpose   : Copy the architectural state to the reference   */
+/*             machine. With drained the pipeline holds        */
+/*             nothing and the next instruction is at the PC   */
+/*             of State, otherwise the PC is taken from the    */
+/*             next instruction that writes back.              */
+/*                                                             */
+/***************************************************************/
+void GoldenChecker::Sync(bool drained)
+{
+  if (!enabled)
+    return;
+
+  auto & cpu_state = simulator().state();
+  auto & main_memory = simulator().memory();
+  for (auto r = 0; r < 8; r++)
+    regs[r] = cpu_state.GetRegisterData(r).to_num();
+  nzp = (cpu_state.GetNBit() << 2) | (cpu_state.GetZBit() << 1) | cpu_state.GetPBit();
+  pc = cpu_state.GetProgramCounter().to_num();
+  pc_known = drained;
+  next_seq = 0;
+
+  //memory as it is once the store buffer drained
+  for (auto word = 0; word < WORDS_IN_MEM; word++)
+  {
+    memory[2 * word] = main_memory.GetLowerByteAt(word).to_num();
+    memory[2 * word + 1] = main_memory.GetUpperByteAt(word).to_num();
+  }
+  for (auto & entry : simulator().storebuffer().Entries())
+  {
+    auto address = entry.address.to_num() & 0xfffe;
+    if (entry.we0)
+      memory[address] = entry.data.range<7,0>().to_num();
+    if (entry.we1)
+      memory[address + 1] = entry.data.range<15,8>().to_num();
+  }
+
+  //loads waiting on the data cache that already passed SR are written
+  //back in State later, the reference machine has them now
+  auto & pipeline = simulator().pipeline();
+  for (auto & load : pipeline.PendingLoads())
+  {
+    if (pipeline.IsInStoreLatch(*load.instruction))
+      continue;
+    if (load.ld_reg)
+      regs[load.drid.to_num()] = load.data.to_num();
+    if (load.ld_cc)
+      nzp = ConditionCodes(load.data.to_num());
+    next_seq = std::max(next_seq, load.instruction->seq + 1);
+  }
+  syncs++;
+}
+
+/*
+* Execute the instruction at the PC of the reference machine and return
+* what it did
+*/
+GoldenEffect GoldenChecker::Step()
+{
+  GoldenEffect effect = {};
+  uint16_t ir = Word(pc);
+  uint16_t npc = pc + 2;
+  effect.pc = pc;
+  effect.ir = ir;
+
+  auto dr = (ir >> 9) & 7;
+  auto sr1 = (ir >> 6) & 7;
+  uint16_t source2 = (ir & 0x20) ? SignExtend(ir, 5) : regs[ir & 7];
+  auto write = [&](int reg, uint16_t value) {
+    effect.ld_reg = true;
+    effect.dr = reg;
+    effect.value = value;
+  };
+
+  pc = npc;
+  switch (ir >> 12)
+  {
+    case 0:  // BR
+      if ((ir >> 9) & nzp & 7)
+        pc = npc + (SignExtend(ir, 9) << 1);
+      break;
+    case 1:  // ADD
+      write(dr, regs[sr1] + source2);
+      break;
+    case 5:  // AND
+      write(dr, regs[sr1] & source2);
+      break;
+    case 9:  // XOR
+      write(dr, regs[sr1] ^ source2);
+      break;
+    case 2:  // LDB
+    {
+      uint16_t address = regs[sr1] + SignExtend(ir, 6);
+      write(dr, SignExtend(memory[address], 8));
+      break;
+    }
+    case 6:  // LDW
+      write(dr, Word(regs[sr1] + (SignExtend(ir, 6) << 1)));
+      break;
+    case 3:  // STB
+    case 7:  // STW
+      effect.store = true;
+      effect.word = (ir >> 12) == 7;
+      effect.address = regs[sr1] + (effect.word ? SignExtend(ir, 6) << 1 : SignExtend(ir, 6));
+      effect.data = effect.word ? regs[dr] : regs[dr] & 0xff;
+      memory[effect.address & (effect.word ? 0xfffe : 0xffff)] = effect.data & 0xff;
+      if (effect.word)
+        memory[effect.address | 1] = effect.data >> 8;
+      break;
+    case 4:  // JSR, JSRR
+      pc = (ir & 0x0800) ? npc + (SignExtend(ir, 11) << 1) : regs[sr1];
+      write(7, npc);
+      break;
+    case 12: // JMP
+      pc = regs[sr1];
+      break;
+    case 13: // LSHF, RSHFL, RSHFA
+    {
+      auto amount = ir & 0xf;
+      uint16_t value = regs[sr1];
+      if (!(ir & 0x10))
+        value = value << amount;
+      else if (!(ir & 0x20))
+        value = value >> amount;
+      else
+        value = (uint16_t)((int16_t)value >> amount);
+      write(dr, value);
+      break;
+    }
+    case 14: // LEA
+      write(dr, npc + (SignExtend(ir, 9) << 1));
+      break;
+    case 15: // TRAP
+      pc = Word((ir & 0xff) << 1);
+      write(7, npc);
+      break;
+    default: // RTI and the reserved opcodes
+      throw SimulatorError(Format("golden model: %s at PC 0x%04x is not an instruction it executes",
+                                  Disassembler::disassemble(ir).c_str(), effect.pc));
+  }
+
+  //which instructions set the condition codes is up to the micro-code,
+  //the lab's sets them on LEA as well
+  auto & micro_seq = simulator().microsequencer();
+  effect.ld_cc = effect.ld_reg && micro_seq.Get_DE_LD_CC(micro_seq.GetMicroCodeFor(ir));
+  effect.nzp = effect.ld_cc ? ConditionCodes(effect.value) : 0;
+  if (effect.ld_reg)
+    regs[effect.dr] = effect.value;
+  if (effect.ld_cc)
+    nzp = effect.nzp;
+  return effect;
+}
+
+/*
+* Describe a register write back and the condition codes
+*/
+static std::string RegisterWrite(bool ld_reg, int dr, uint16_t value)
+{
+  return ld_reg ? Format("R%d = 0x%04x", dr, value) : std::string("no register written");
+}
+
+static std::string ConditionCodeWrite(bool ld_cc, int nzp)
+{
+  return ld_cc ? Format("NZP = %d%d%d", (nzp >> 2) & 1, (nzp >> 1) & 1, nzp & 1) : std::string("condition codes kept");
+}
+
+static std::string StoreWrite(bool store, bool word, uint16_t address, uint16_t data)
+{
+  if (!store)
+    return "no store";
+  return word ? Format("word 0x%04x stored to 0x%04x", data, address) : Format("byte 0x%02x stored to 0x%04x", data, address);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Retire                                          */
+/*                                                             */
+/* Purpose   : Step the reference machine for an instruction   */
+/*             the pipeline writes back and compare the two.   */
+/*                                                             */
+/***************************************************************/
+void GoldenChecker::Retire(const Instruction & inst, bool ld_reg, const bits3 & drid, const bits16 & value,
+                           bool ld_cc, const bits3 & cc)
+{
+  if (!enabled || inst.seq < next_seq)
+    return;
+  next_seq = inst.seq + 1;
+  if (!pc_known)
+    pc = inst.PC.to_num();
+  pc_known = true;
+
+  auto expected = Step();
+  std::vector<std::string> differences;
+  if (inst.PC.to_num() != expected.pc)
+    differences.push_back(Format("PC 0x%04x, expected 0x%04x", inst.PC.to_num(), expected.pc));
+  else if (inst.IR.to_num() != expected.ir)
+    differences.push_back(Format("IR 0x%04x, expected 0x%04x %s", inst.IR.to_num(), expected.ir,
+                                 Disassembler::disassemble(expected.ir).c_str()));
+  else
+  {
+    if (ld_reg != expected.ld_reg || (ld_reg && (drid.to_num() != expected.dr || value.to_num() != expected.value)))
+      differences.push_back(RegisterWrite(ld_reg, drid.to_num(), value.to_num()) + ", expected " +
+                            RegisterWrite(expected.ld_reg, expected.dr, expected.value));
+    if (ld_cc != expected.ld_cc || (ld_cc && cc.to_num() != expected.nzp))
+      differences.push_back(ConditionCodeWrite(ld_cc, cc.to_num()) + ", expected " +
+                            ConditionCodeWrite(expected.ld_cc, expected.nzp));
+
+    //the store as the MEM stage wrote it
+    auto & micro_seq = simulator().microsequencer();
+    auto store = micro_seq.Get_DCACHE_EN(inst.MEM_CS) && micro_seq.Get_DCACHE_RW(inst.MEM_CS);
+    auto word = micro_seq.Get_DATA_SIZE(inst.MEM_CS);
+    uint16_t address = inst.ADDRESS.to_num();
+    uint16_t data = word ? inst.ALU_RESULT.to_num() : inst.ALU_RESULT.to_num() & 0xff;
+    if (store != expected.store ||
+        (store && (word != expected.word || address != expected.address || data != expected.data)))
+      differences.push_back(StoreWrite(store, word, address, data) + ", expected " +
+                            StoreWrite(expected.store, expected.word, expected.address, expected.data));
+    stores_checked += store;
+  }
+
+  if (!differences.empty())
+    Diverged(inst, differences);
+  checked++;
+}
+
+/*
+* Stop the simulation with what the pipeline and the reference machine
+* did differently
+*/
+void GoldenChecker::Diverged(const Instruction & inst, const std::vector<std::string> & differences)
+{
+  auto report = Format("golden model check failed at cycle %d, instruction %llu checked since the last sync\n"
+                       "  PC 0x%04x  IR 0x%04x  %s", simulator().GetCycles(), (unsigned long long)checked + 1,
+                       inst.PC.to_num(), inst.IR.to_num(), inst.GetDisassembly().c_str());
+  for (auto & difference : differences)
+    report += "\n  " + difference;
+  throw SimulatorError(report);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Finish                                          */
+/*                                                             */
+/* Purpose   : Compare the memory of the halted simulator with */
+/*             the memory of the reference machine.            */
+/*                                                             */
+/***************************************************************/
+void GoldenChecker::Finish()
+{
+  if (!enabled)
+    return;
+
+  auto & main_memory = simulator().memory();
+  std::string report;
+  auto differences = 0;
+  for (auto word = 0; word < WORDS_IN_MEM; word++)
+  {
+    uint16_t got = main_memory.GetLowerByteAt(word).to_num() | (main_memory.GetUpperByteAt(word).to_num() << 8);
+    uint16_t expected = Word(2 * word);
+    if (got == expected)
+      continue;
+    if (differences++ < 8)
+      report += Format("\n  0x%04x = 0x%04x, expected 0x%04x", 2 * word, got, expected);
+  }
+  if (differences)
+    throw SimulatorError(Format("golden model check failed at halt, %d memory words differ", differences) + report);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the checker counters.                  */
+/*                                                             */
+/***************************************************************/
+void GoldenChecker::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("checker.instructions", "write backs checked against the golden model", checked);
+  stats.AddScalar("checker.stores", "stores checked against the golden model", stores_checked);
+  stats.AddScalar("checker.syncs", "times the golden model took over the architectural state", syncs);
+}
@@ -0,0 +1,256 @@
+/***************************************************************/
+/* Instruction Mix Implementaion                               */
+/***************************************************************/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/instruction.h"
+    #include "../include/Statistics.h"
+    #include "../include/InstructionMix.h"
+#else
+    #include "Simulator.h"
+    #include "instruction.h"
+    #include "Statistics.h"
+    #include "InstructionMix.h"
+#endif
+
+static const char * opcode_names[MIX_OPCODES] = { "BR", "ADD", "LDB", "STB", "JSR", "AND", "LDW", "STW",
+                                                  "RTI", "XOR", "1010", "1011", "JMP", "SHF", "LEA", "TRAP" };
+static const char * stage_names[NUM_MIX_STAGES] = { "fetch", "decode", "execute", "memory", "retire" };
+static const char * mode_names[NUM_ADDRESSING_MODES] = { "register", "immediate", "base_offset",
+                                                         "pc_relative", "trap_vector", "none" };
+
+InstructionMix::InstructionMix(Simulator & instance) :
+_simulator(instance)
+{
+  init_mix();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_mix                                        */
+/*                                                             */
+/* Purpose   : Clear the counters and histograms               */
+/*                                                             */
+/***************************************************************/
+void InstructionMix::init_mix()
+{
+  retired = 0;
+  std::fill_n(opcode_count, MIX_OPCODES, 0);
+  std::fill_n(mode_count, NUM_ADDRESSING_MODES, 0);
+  std::fill_n(latency_sum, MIX_OPCODES, 0);
+  std::fill_n(&latency[0][0], MIX_OPCODES * LATENCY_BUCKETS, 0);
+  std::fill_n(&stage_sum[0][0], MIX_OPCODES * NUM_MIX_STAGES, 0);
+  std::fill_n(&stage_cycles[0][0][0], MIX_OPCODES * NUM_MIX_STAGES * STAGE_BUCKETS, 0);
+}
+
+/*
+* The addressing mode of the operand the opcode does not take from a
+* fixed register
+*/
+AddressingMode InstructionMix::ModeOf(const bits16 & ir)
+{
+  switch (ir.to_num() >> 12)
+  {
+    case 1:  // ADD
+    case 5:  // AND
+    case 9:  // XOR
+      return ir[5] ? MODE_IMMEDIATE : MODE_REGISTER;
+    case 13: // SHF
+      return MODE_IMMEDIATE;
+    case 2:  // LDB
+    case 3:  // STB
+    case 6:  // LDW
+    case 7:  // STW
+      return MODE_BASE_OFFSET;
+    case 0:  // BR
+    case 14: // LEA
+      return MODE_PC_RELATIVE;
+    case 4:  // JSR, JSRR
+      return ir[11] ? MODE_PC_RELATIVE : MODE_REGISTER;
+    case 12: // JMP
+      return MODE_REGISTER;
+    case 15: // TRAP
+      return MODE_TRAP_VECTOR;
+    default:
+      return MODE_NONE;
+  }
+}
+
+/*
+* Count an instruction that wrote back or committed in cycle. The cycles
+* of each stage come from its timing diagram row. The cycles before the
+* first row entry are spent fetching, those after the last one waiting on
+* the data cache, a load that left MEM on a miss writes back later.
+*/
+void InstructionMix::Retire(const Instruction & inst, int cycle)
+{
+  auto opcode = inst.IR.to_num() >> 12;
+  retired++;
+  opcode_count[opcode]++;
+  mode_count[ModeOf(inst.IR)]++;
+  if (inst.fetch_cycle < 0 || inst.fetch_cycle > cycle)
+    return;
+
+  int cycles[NUM_MIX_STAGES] = {};
+  auto first = cycle + 1, last = inst.fetch_cycle - 1;
+  for (auto & entry : inst.cycle_history)
+  {
+    if (entry.first < inst.fetch_cycle || entry.first > cycle || entry.second.empty())
+      continue;
+    MixStage stage;
+    switch (entry.second[0])
+    {
+      case 'F': stage = MIX_FETCH; break;
+      case 'D': stage = MIX_DECODE; break;
+      case 'E': stage = MIX_EXECUTE; break;
+      case 'M': stage = MIX_MEMORY; break;
+      case 'W':
+      case 'S': stage = MIX_RETIRE; break;
+      default: continue;
+    }
+    cycles[stage]++;
+    first = std::min(first, entry.first);
+    last = std::max(last, entry.first);
+  }
+  if (first > cycle)
+  {
+    cycles[MIX_FETCH] += cycle - inst.fetch_cycle;
+    cycles[MIX_RETIRE]++;
+  }
+  else
+  {
+    cycles[MIX_FETCH] += first - inst.fetch_cycle;
+    if (last < cycle)
+    {
+      cycles[MIX_MEMORY] += cycle - 1 - last;
+      cycles[MIX_RETIRE]++;
+    }
+  }
+
+  auto total = cycle - inst.fetch_cycle + 1;
+  latency_sum[opcode] += total;
+  latency[opcode][std::min(total / LATENCY_BUCKET_WIDTH, LATENCY_BUCKETS - 1)]++;
+  for (auto stage = 0; stage < NUM_MIX_STAGES; stage++)
+  {
+    stage_sum[opcode][stage] += cycles[stage];
+    stage_cycles[opcode][stage][std::min(cycles[stage], STAGE_BUCKETS - 1)]++;
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the mix and the histograms of every    */
+/*             opcode.                                         */
+/*                                                             */
+/***************************************************************/
+void InstructionMix::RegisterStats(Statistics & stats)
+{
+  std::vector<std::string> opcodes, modes, stages, latency_labels, stage_labels;
+  for (auto opcode = 0; opcode < MIX_OPCODES; opcode++)
+    opcodes.push_back(opcode_names[opcode]);
+  for (auto mode = 0; mode < NUM_ADDRESSING_MODES; mode++)
+    modes.push_back(mode_names[mode]);
+  for (auto stage = 0; stage < NUM_MIX_STAGES; stage++)
+    stages.push_back(stage_names[stage]);
+  for (auto i = 0; i < LATENCY_BUCKETS; i++)
+    latency_labels.push_back(i == LATENCY_BUCKETS - 1 ? std::to_string(i * LATENCY_BUCKET_WIDTH) + "+" :
+                             std::to_string(i * LATENCY_BUCKET_WIDTH) + "-" + std::to_string((i + 1) * LATENCY_BUCKET_WIDTH - 1));
+  for (auto i = 0; i < STAGE_BUCKETS; i++)
+    stage_labels.push_back(std::to_string(i) + (i == STAGE_BUCKETS - 1 ? "+" : ""));
+
+  stats.AddVector("mix.opcode", "instructions retired by opcode", opcode_count, opcodes);
+  stats.AddVector("mix.mode", "instructions retired by addressing mode", mode_count, modes);
+  stats.AddVector("mix.latency_sum", "fetch to retire cycles by opcode", latency_sum, opcodes);
+  for (auto opcode = 0; opcode < MIX_OPCODES; opcode++)
+  {
+    if (IsReserved(opcode))
+      continue;
+    std::string name = opcode_names[opcode];
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    stats.AddVector("mix." + name + ".latency", "fetch to retire cycles", latency[opcode], latency_labels);
+    stats.AddVector("mix." + name + ".stage_sum", "cycles spent in each stage", stage_sum[opcode], stages);
+    for (auto stage = 0; stage < NUM_MIX_STAGES; stage++)
+      stats.AddVector("mix." + name + "." + stage_names[stage], "cycles spent in the stage",
+                      stage_cycles[opcode][stage], stage_labels);
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the mix, the average cycles of each stage  */
+/*             and the histograms of the opcodes retired.      */
+/*                                                             */
+/***************************************************************/
+void InstructionMix::dump(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  PRINT_AND_DUMP("\nInstruction mix (%llu instructions) :\n", (unsigned long long)retired);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  PRINT_AND_DUMP("Opcode    Count     Mix Latency   Fetch  Decode Execute  Memory  Retire\n");
+  for (auto opcode = 0; opcode < MIX_OPCODES; opcode++)
+  {
+    auto count = opcode_count[opcode];
+    if (!count)
+      continue;
+    PRINT_AND_DUMP("%-6s %8llu %6.1f%% %7.2f", opcode_names[opcode], (unsigned long long)count,
+                   100.0 * count / retired, (double)latency_sum[opcode] / count);
+    for (auto stage = 0; stage < NUM_MIX_STAGES; stage++)
+      PRINT_AND_DUMP(" %7.2f", (double)stage_sum[opcode][stage] / count);
+    PRINT_AND_DUMP("\n");
+  }
+  PRINT_AND_DUMP("\n");
+  for (auto mode = 0; mode < NUM_ADDRESSING_MODES; mode++)
+    PRINT_AND_DUMP("%-12s : %llu (%.1f%%)\n", mode_names[mode], (unsigned long long)mode_count[mode],
+                   retired ? 100.0 * mode_count[mode] / retired : 0.0);
+
+  PRINT_AND_DUMP("\nFetch to retire latency (%d cycles a bucket) :\n", LATENCY_BUCKET_WIDTH);
+  PRINT_AND_DUMP("Opcode");
+  for (auto i = 0; i < LATENCY_BUCKETS; i++)
+    PRINT_AND_DUMP(i == LATENCY_BUCKETS - 1 ? " %4d+" : " %5d", i * LATENCY_BUCKET_WIDTH);
+  PRINT_AND_DUMP("\n");
+  for (auto opcode = 0; opcode < MIX_OPCODES; opcode++)
+  {
+    if (!opcode_count[opcode])
+      continue;
+    PRINT_AND_DUMP("%-6s", opcode_names[opcode]);
+    for (auto i = 0; i < LATENCY_BUCKETS; i++)
+      PRINT_AND_DUMP(" %5llu", (unsigned long long)latency[opcode][i]);
+    PRINT_AND_DUMP("\n");
+  }
+
+  for (auto stage = 0; stage < NUM_MIX_STAGES; stage++)
+  {
+    PRINT_AND_DUMP("\nCycles in %s :\n", stage_names[stage]);
+    PRINT_AND_DUMP("Opcode");
+    for (auto i = 0; i < STAGE_BUCKETS; i++)
+      PRINT_AND_DUMP(i == STAGE_BUCKETS - 1 ? " %4d+" : " %5d", i);
+    PRINT_AND_DUMP("\n");
+    for (auto opcode = 0; opcode < MIX_OPCODES; opcode++)
+    {
+      if (!opcode_count[opcode])
+        continue;
+      PRINT_AND_DUMP("%-6s", opcode_names[opcode]);
+      for (auto i = 0; i < STAGE_BUCKETS; i++)
+        PRINT_AND_DUMP(" %5llu", (unsigned long long)stage_cycles[opcode][stage][i]);
+      PRINT_AND_DUMP("\n");
+    }
+  }
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
@@ -0,0 +1,446 @@
+/***************************************************************/
+/* Interval Model Implementaion                                */
+/***************************************************************/
+
+#include <algorithm>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/instruction.h"
+    #include "../include/MainMemory.h"
+    #include "../include/MicroSequencer.h"
+    #include "../include/Statistics.h"
+    #include "../include/IntervalModel.h"
+#else
+    #include "Simulator.h"
+    #include "instruction.h"
+    #include "MainMemory.h"
+    #include "MicroSequencer.h"
+    #include "Statistics.h"
+    #include "IntervalModel.h"
+#endif
+
+IntervalModel::IntervalModel(Simulator & instance) :
+_simulator(instance),
+enabled(false),
+validating(false),
+icache(nullptr),
+dcache(nullptr),
+predictor(nullptr),
+own_predictor(instance)
+{
+
+}
+
+/*
+* The control store row the instruction ir decodes to
+*/
+static int Row(uint16_t ir)
+{
+  return ((ir >> 11) << 1) | ((ir >> 5) & 1);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_interval                                   */
+/*                                                             */
+/* Purpose   : Enable the model for -core interval, -validate  */
+/*             or -sample, decode the control store rows and   */
+/*             start the timeline at cycle 0.                  */
+/*                                                             */
+/***************************************************************/
+void IntervalModel::init_interval()
+{
+  auto & config = simulator().config();
+  auto & micro_seq = simulator().microsequencer();
+  validating = config.validate_interval;
+  enabled = validating || config.core == CORE_INTERVAL || config.sample_period;
+
+  for (auto row = 0; row < CONTROL_STORE_ROWS; row++)
+  {
+    auto & ucode = micro_seq.GetMicroCodeAt(row);
+    auto & op = ops[row];
+    op.sr1_needed = micro_seq.Get_SR1_NEEDED(ucode);
+    op.sr2_needed = micro_seq.Get_SR2_NEEDED(ucode);
+    op.ld_reg = micro_seq.Get_DE_LD_REG(ucode);
+    op.ld_cc = micro_seq.Get_DE_LD_CC(ucode);
+    op.drmux = micro_seq.Get_DRMUX(ucode);
+    op.alu_cc = op.ld_cc && micro_seq.Get_DE_DR_VALUEMUX(ucode).to_num() == 3;
+    op.memory = micro_seq.Get_DE_DCACHE_EN(ucode);
+    op.store = op.memory && ucode[DCACHE_RW];
+    op.br_op = micro_seq.Get_DE_BR_OP(ucode);
+    op.control = micro_seq.Get_DE_BR_STALL(ucode);
+    op.trap = micro_seq.Get_DE_TRAP_OP(ucode);
+  }
+
+  fetch_stages = config.fetch_stages;
+  agex_stages = config.agex_stages;
+  mem_stages = config.mem_stages;
+  issue_width = config.issue_width;
+  miss_latency = config.miss_latency;
+  resolve_stage = config.resolve_stage;
+  fusion = config.macro_fusion;
+  store_buffer = config.store_buffer_entries > 0;
+  non_blocking = config.mshr_entries > 0 && config.dcache_size > 0;
+
+  //beside the pipeline the model must not touch what the pipeline uses
+  if (validating)
+  {
+    own_icache.init_cache(config.icache_size, config.line_size, config.cache_ways, config.miss_latency);
+    own_dcache.init_cache(config.dcache_size, config.line_size, config.cache_ways, config.miss_latency);
+    own_predictor.init_predictor();
+    icache = &own_icache;
+    dcache = &own_dcache;
+    predictor = &own_predictor;
+  }
+  else
+  {
+    icache = &simulator().memory().icache();
+    dcache = &simulator().memory().dcache();
+    predictor = &simulator().predictor();
+  }
+
+  pending = false;
+  started = false;
+  cycles = 0;
+  retired = 0;
+  std::fill_n(cpi_stack, NUM_CPI_CAUSES, 0);
+  icache_misses = 0;
+  dcache_misses = 0;
+  mispredicts = 0;
+  dependency_stalls = 0;
+  next_seq = 0;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Execute                                         */
+/*                                                             */
+/* Purpose   : Hand over the next instruction in program       */
+/*             order, ir at pc with the data address it        */
+/*             accesses, if any. The one handed over before    */
+/*             is accounted now that its successor is known.   */
+/*                                                             */
+/***************************************************************/
+void IntervalModel::Execute(uint16_t pc, uint16_t ir, uint16_t address)
+{
+  if (pending)
+    Account(pc);
+  pending = true;
+  pending_pc = pc;
+  pending_ir = ir;
+  pending_address = address;
+}
+
+/*
+* An instruction of the detailed pipeline left MEM. Lanes held by a
+* younger one stalled on the data cache run MEM again, they are seen once.
+*/
+void IntervalModel::Observe(const Instruction & inst)
+{
+  if (inst.seq < next_seq)
+    return;
+  next_seq = inst.seq + 1;
+  Execute(inst.PC.to_num(), inst.IR.to_num(), inst.ADDRESS.to_num());
+}
+
+/*
+* Account the last instruction handed over, next_pc is where the program
+* went on, 0 when it halted. The timeline ends here, the next instruction
+* starts with an empty pipeline, as after fast-forwarding.
+*/
+void IntervalModel::Finish(uint16_t next_pc)
+{
+  if (pending)
+    Account(next_pc);
+  pending = false;
+  started = false;
+}
+
+/*
+* Raise latest to bound if the issue cycle is held beyond it, and charge
+* the wait to cause. Called with the causes by rising priority, a later
+* cause wins a tie.
+*/
+void IntervalModel::Charge(uint64_t issue, uint64_t bound, CpiCause cause, uint64_t & latest, CpiCause & latest_cause)
+{
+  if (bound > issue && bound >= latest)
+  {
+    latest = bound;
+    latest_cause = cause;
+  }
+}
+
+/*
+* Charge the wait behind a control instruction without a predictor to the
+* stages it held the front end from, as the pipeline does: a cycle in
+* decode, one in AGEX, the extra cycles of split stages, and what is left
+* to the stage that resolved it, with the refill of the front end
+*/
+void IntervalModel::ChargeControl(uint64_t wait, CpiCause resolved_cause)
+{
+  auto stages_before = resolved_cause == CPI_CONTROL_MEMORY ? 2 : resolved_cause == CPI_CONTROL_AGEX ? 1 : 0;
+  uint64_t split = resolved_cause == CPI_CONTROL_MEMORY ? agex_stages - 1 + mem_stages - 1 :
+                   resolved_cause == CPI_CONTROL_AGEX ? agex_stages - 1 : 0;
+  static const CpiCause stages[] = { CPI_CONTROL_DECODE, CPI_CONTROL_AGEX };
+  for (auto i = 0; i < stages_before && wait; i++, wait--)
+    cpi_stack[stages[i]]++;
+  split = std::min(split, wait);
+  cpi_stack[CPI_CONTROL_SPLIT] += split;
+  cpi_stack[resolved_cause] += wait - split;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Account                                         */
+/*                                                             */
+/* Purpose   : Work out the fetch, issue, MEM and write back   */
+/*             cycles of the pending instruction, whose        */
+/*             successor is at next_pc, and charge the cycles  */
+/*             it added to the CPI stack.                      */
+/*                                                             */
+/***************************************************************/
+void IntervalModel::Account(uint16_t next_pc)
+{
+  auto & op = ops[Row(pending_ir)];
+  auto pc = pending_pc;
+  auto halts = next_pc == 0;
+  uint16_t sr1 = (pending_ir >> 6) & 7;
+  uint16_t sr2 = (pending_ir & 0x2000) ? (pending_ir >> 9) & 7 : pending_ir & 7;
+  uint16_t dr = op.drmux ? 7 : (pending_ir >> 9) & 7;
+  auto fused = fusion && op.br_op && started && last_sets_alu_cc && last_pc + 2 == pc;
+  auto predicted = predictor->IsEnabled();
+
+  //a fresh pipeline starts fetching at the cycle the last one ended
+  if (!started)
+  {
+    last_fetch = last_decode = last_issue = last_mem_done = cycles;
+    next_fetch = cycles;
+    next_fetch_cause = CPI_EMPTY;
+    fetch_lane = issue_lane = issue_width;
+    std::fill_n(ready, SCOREBOARD_NAMES, cycles);
+  }
+
+  //fetch, a wide front end fetches on down the sequential path in the same
+  //cycle, without a predictor only up to a control instruction
+  uint64_t fetch;
+  if (started && fetch_lane + 1 < issue_width && pc == last_pc + 2 && (predicted || !last_op.control) &&
+      next_fetch <= last_fetch + 1)
+  {
+    fetch = last_fetch;
+    fetch_lane++;
+  }
+  else
+  {
+    fetch = std::max(next_fetch, started ? last_fetch + 1 : cycles);
+    fetch_lane = 0;
+  }
+  auto front_end_cause = fetch > last_fetch + 1 ? next_fetch_cause : CPI_BASE;
+  if (!icache->Touch(pc))
+  {
+    fetch += miss_latency;
+    front_end_cause = CPI_ICACHE;
+    icache_misses++;
+    fetch_lane = issue_width;
+  }
+
+  //a younger lane issues with the instruction in front of it if both were
+  //in decode together and nothing holds it, as CheckPairing allows
+  uint64_t register_ready = std::max<uint64_t>(op.sr1_needed ? ready[sr1] : 0, op.sr2_needed ? ready[sr2] : 0);
+  uint64_t cc_ready = (op.br_op && !fused) ? ready[SCOREBOARD_CC] : 0;
+  uint64_t mem_free = started ? last_mem_done + 2 - std::min<uint64_t>(last_mem_done + 2, agex_stages + mem_stages) : 0;
+  auto pairs = started && issue_lane + 1 < issue_width && !op.trap &&
+               !(last_op.memory && op.memory) && !(last_op.control && (op.control || op.memory)) &&
+               !(last_op.ld_reg && ((op.sr1_needed && sr1 == last_dr) || (op.sr2_needed && sr2 == last_dr))) &&
+               !(op.br_op && last_op.ld_cc && !fused) &&
+               std::max(fetch + fetch_stages, last_decode) + 1 <= last_issue &&
+               std::max(register_ready, cc_ready) <= last_issue;
+
+  //otherwise decode takes it once the one in front left, and it issues
+  //when nothing holds it
+  uint64_t decode = pairs ? std::max(fetch + fetch_stages, last_decode) :
+                            std::max(fetch + fetch_stages, started ? last_issue : cycles);
+  uint64_t slot = pairs ? last_issue : started ? last_issue + 1 : cycles + 1;
+  uint64_t issue = slot;
+  auto cause = started ? CPI_BASE : CPI_EMPTY;
+  if (!pairs)
+    Charge(slot, mem_free, CPI_DCACHE, issue, cause);
+  Charge(slot, decode + 1, front_end_cause == CPI_BASE ? CPI_EMPTY : front_end_cause, issue, cause);
+  Charge(slot, cc_ready, CPI_DEP_CC, issue, cause);
+  Charge(slot, register_ready, CPI_DEP_REGISTER, issue, cause);
+  if (cause == CPI_DEP_REGISTER || cause == CPI_DEP_CC)
+    dependency_stalls++;
+  issue_lane = pairs ? issue_lane + 1 : 0;
+
+  //the CPI stack gets a base cycle for every cycle that issues, the rest
+  //of the wait goes to what held the instruction. Without a predictor the
+  //pipeline charges the last bubbles a control instruction left waiting on
+  //its sources to the stage that resolves it, they are in flight at the restart.
+  Stages resolve = (!op.control || op.trap) ? MEMORY : (fused && resolve_stage == DECODE) ? AGEX : resolve_stage;
+  auto resolved_cause = resolve == MEMORY ? CPI_CONTROL_MEMORY : resolve == AGEX ? CPI_CONTROL_AGEX : CPI_CONTROL_DECODE;
+  auto charged_before = started ? last_issue + 1 : cycles;
+  if (issue >= charged_before)
+  {
+    auto wait = issue - charged_before;
+    if (!predicted && cause >= CPI_CONTROL_MEMORY && cause <= CPI_CONTROL_DECODE)
+      ChargeControl(wait, cause);
+    else if (!predicted && op.control && (cause == CPI_DEP_REGISTER || cause == CPI_DEP_CC))
+    {
+      uint64_t in_flight = std::min<uint64_t>(wait, agex_stages + mem_stages);
+      cpi_stack[resolved_cause] += in_flight;
+      cpi_stack[cause] += wait - in_flight;
+    }
+    else
+      cpi_stack[cause] += wait;
+    cpi_stack[halts ? CPI_EMPTY : CPI_BASE]++;
+  }
+
+  //MEM, a blocking data cache holds the stage and everything behind it,
+  //lanes that issued together included, a load past a miss of the
+  //non-blocking cache only holds its readers
+  uint64_t mem = issue + agex_stages + mem_stages - 1;
+  uint64_t mem_done = pairs ? std::max(mem, last_mem_done) : mem;
+  uint64_t write_back = mem + 1;
+  if (op.memory && !dcache->Touch(pending_address))
+  {
+    dcache_misses++;
+    if (op.store && (store_buffer || non_blocking))
+      ;
+    else if (!op.store && non_blocking && !op.trap)
+      write_back = mem + miss_latency + 1;
+    else
+      mem_done += miss_latency;
+  }
+  write_back = std::max(write_back, mem_done + 1);
+  if (op.ld_reg)
+    ready[dr] = write_back + 2;
+  if (op.ld_cc)
+    ready[SCOREBOARD_CC] = write_back + 2;
+
+  //a control instruction holds fetch until it resolves, with a predictor
+  //only if it was mispredicted
+  uint64_t resolved = resolve == DECODE ? issue - 1 : resolve == AGEX ? issue + agex_stages - 1 : mem_done;
+  auto redirect = op.control && !predicted;
+  if (predicted)
+  {
+    RAS_Checkpoint checkpoint;
+    auto target = predictor->Predict(pc, pending_ir, checkpoint);
+    auto wrong = target.to_num() != next_pc;
+    if (op.control)
+      predictor->Update(pc, pending_ir, op.br_op, next_pc != (uint16_t)(pc + 2), next_pc, wrong, checkpoint);
+    if (wrong)
+    {
+      predictor->Recover(checkpoint, pc, pending_ir);
+      mispredicts++;
+      redirect = true;
+    }
+  }
+  next_fetch = fetch + 1;
+  next_fetch_cause = CPI_BASE;
+  if (redirect && resolved + 1 > next_fetch)
+  {
+    next_fetch = resolved + 1;
+    next_fetch_cause = resolved_cause;
+  }
+
+  //the simulation ends once the halting instruction resolved, or with the
+  //write back of the last instruction, the pipeline drain is empty
+  uint64_t tail_before = started ? cycles - (last_issue + 1) : 0;
+  if (halts)
+    cycles = std::max(resolved + 1, issue + 1);
+  else
+  {
+    cycles = std::max(cycles, write_back + 1);
+    retired++;
+  }
+  uint64_t tail = cycles - (issue + 1);
+  cpi_stack[CPI_EMPTY] = cpi_stack[CPI_EMPTY] + tail >= tail_before ? cpi_stack[CPI_EMPTY] + tail - tail_before : 0;
+
+  started = true;
+  last_fetch = fetch;
+  last_decode = decode;
+  last_issue = issue;
+  last_mem_done = mem_done;
+  last_op = op;
+  last_pc = pc;
+  last_dr = dr;
+  last_sets_alu_cc = op.alu_cc;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the estimated CPI stack, with -validate    */
+/*             against the cycles of the pipeline.             */
+/*                                                             */
+/***************************************************************/
+void IntervalModel::dump(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  static const char * causes[] = { "Base                 :", "I-cache miss         :", "Dependency, register :",
+                                   "Dependency, CC       :", "Control, MEM         :", "Control, AGEX        :",
+                                   "Control, split stage :", "Control, DE          :", "D-cache miss         :",
+                                   "Empty pipeline       :" };
+  uint64_t charged = 0;
+  for (auto count : cpi_stack)
+    charged += count;
+
+  PRINT_AND_DUMP("\nInterval model (%llu cycles, %llu instructions) :\n", (unsigned long long)cycles,
+                 (unsigned long long)retired);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  for (auto i = 0; i < NUM_CPI_CAUSES; i++)
+    PRINT_AND_DUMP("%s %llu (CPI %.3f, %.1f%%)\n", causes[i], (unsigned long long)cpi_stack[i],
+                   retired ? (double)cpi_stack[i] / retired : 0.0, charged ? 100.0 * cpi_stack[i] / charged : 0.0);
+  PRINT_AND_DUMP("CPI                  : %.3f\n", retired ? (double)cycles / retired : 0.0);
+  PRINT_AND_DUMP("I-cache / D-cache misses : %llu / %llu\n", (unsigned long long)icache_misses,
+                 (unsigned long long)dcache_misses);
+  PRINT_AND_DUMP("Mispredictions       : %llu\n", (unsigned long long)mispredicts);
+  PRINT_AND_DUMP("Dependency stalls    : %llu\n", (unsigned long long)dependency_stalls);
+  if (validating)
+  {
+    auto detailed = simulator().GetCycles();
+    PRINT_AND_DUMP("Pipeline cycles      : %d\n", detailed);
+    PRINT_AND_DUMP("Error                : %+.2f%%\n", detailed ? 100.0 * ((double)cycles - detailed) / detailed : 0.0);
+  }
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the estimate, its CPI stack and with   */
+/*             -validate its error.                            */
+/*                                                             */
+/***************************************************************/
+void IntervalModel::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("interval.retired", "instructions the model accounted", retired);
+  stats.AddVector("interval.cpi_stack", "estimated cycles charged to each cause", cpi_stack,
+                  {"base", "icache", "dep_register", "dep_cc", "control_memory", "control_agex",
+                   "control_split", "control_decode", "dcache", "empty"});
+  stats.AddScalar("interval.icache_misses", "instruction fetches that missed", icache_misses);
+  stats.AddScalar("interval.dcache_misses", "data accesses that missed", dcache_misses);
+  stats.AddScalar("interval.mispredicts", "control instructions that redirected fetch", mispredicts);
+  stats.AddScalar("interval.dependency_stalls", "instructions held by a source not written back", dependency_stalls);
+
+  if (validating)
+  {
+    stats.AddFormula("interval.cycles", "cycles the model estimates since the start", [this]() {
+      return (double)cycles;
+    });
+    stats.AddFormula("interval.error", "estimated minus pipeline cycles, per pipeline cycle", [this]() {
+      auto detailed = simulator().GetCycles();
+      return detailed ? ((double)cycles - detailed) / detailed : 0.0;
+    });
+  }
+}
@@ -0,0 +1,531 @@
+/***************************************************************/
+/* JIT Compiler Implementaion                                  */
+/***************************************************************/
+
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#if defined(__linux__) && defined(__x86_64__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define JIT_SUPPORTED
+#endif
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/MainMemory.h"
+    #include "../include/Statistics.h"
+    #include "../include/JitCompiler.h"
+#else
+    #include "Simulator.h"
+    #include "MainMemory.h"
+    #include "Statistics.h"
+    #include "JitCompiler.h"
+#endif
+
+/*
+* Host registers, as numbered in ModRM
+*/
+enum HostRegister {
+  RAX = 0,
+  RCX = 1,
+  RDX = 2,
+  RBX = 3,   // the GuestContext, callee saved across helper calls
+  RSI = 6,
+  RDI = 7
+};
+
+/*
+* Displacements from RBX of the context fields
+*/
+static const uint32_t REGS_OFFSET = offsetof(GuestContext, regs);
+static const uint32_t N_OFFSET = offsetof(GuestContext, n);
+static const uint32_t Z_OFFSET = offsetof(GuestContext, z);
+static const uint32_t P_OFFSET = offsetof(GuestContext, p);
+static const uint32_t EXECUTED_OFFSET = offsetof(GuestContext, executed);
+
+/*
+* The perf map is one file per process, shared by every simulator of the
+* batch runner. The lines of the live translations of each compiler are
+* kept so that a flush can rewrite the map without the dropped ones; those
+* of a released compiler are kept under nullptr for the profiler to read
+* after the run.
+*/
+static std::mutex perf_map_lock;
+static std::map<const JitCompiler *, std::string> perf_map_lines;
+
+/*
+* Append text to the perf map, or replace the map with it. Return whether
+* the map could be written.
+*/
+static bool WritePerfMap(const std::string & text, bool replace)
+{
+#ifdef JIT_SUPPORTED
+  char name[64];
+  snprintf(name, sizeof(name), "/tmp/perf-%d.map", (int)getpid());
+  auto file = fopen(name, replace ? "w" : "a");
+  if (!file)
+    return false;
+  fwrite(text.data(), 1, text.size(), file);
+  fclose(file);
+  return true;
+#else
+  return false;
+#endif
+}
+
+JitCompiler::JitCompiler(Simulator & instance) :
+_simulator(instance),
+buffer(nullptr),
+buffer_used(0),
+full(false),
+perf_map(false),
+blocks_compiled(0),
+code_bytes(0),
+flushes(0)
+{
+
+}
+
+JitCompiler::~JitCompiler()
+{
+  Release();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_jit                                        */
+/*                                                             */
+/* Purpose   : Map the code buffer and open the perf map when  */
+/*             -jit is given                                   */
+/*                                                             */
+/***************************************************************/
+void JitCompiler::init_jit()
+{
+  Release();
+  buffer_used = 0;
+  full = false;
+  blocks_compiled = 0;
+  code_bytes = 0;
+  flushes = 0;
+  if (!simulator().config().jit)
+    return;
+
+#ifdef JIT_SUPPORTED
+  auto mapped = mmap(nullptr, JIT_BUFFER_BYTES, PROT_READ | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED)
+  {
+    simulator().Print("Warning: can't map an executable buffer, the JIT is disabled\n");
+    return;
+  }
+  buffer = (uint8_t *)mapped;
+
+  std::lock_guard<std::mutex> guard(perf_map_lock);
+  perf_map = WritePerfMap("", false);
+  if (perf_map)
+    perf_map_lines[this].clear();
+#else
+  simulator().Print("Warning: the JIT needs an x86-64 Linux host, the functional core interprets\n");
+#endif
+}
+
+/*
+* Unmap the code buffer, its lines stay in the perf map
+*/
+void JitCompiler::Release()
+{
+#ifdef JIT_SUPPORTED
+  if (buffer)
+    munmap(buffer, JIT_BUFFER_BYTES);
+#endif
+  buffer = nullptr;
+  if (perf_map)
+  {
+    std::lock_guard<std::mutex> guard(perf_map_lock);
+    perf_map_lines[nullptr] += perf_map_lines[this];
+    perf_map_lines.erase(this);
+  }
+  perf_map = false;
+}
+
+/*
+* Start over at the beginning of the buffer, the functional core has
+* dropped every translation. The perf map is rewritten without them.
+*/
+void JitCompiler::Flush()
+{
+  buffer_used = 0;
+  full = false;
+  flushes++;
+  if (perf_map)
+  {
+    std::lock_guard<std::mutex> guard(perf_map_lock);
+    perf_map_lines[this].clear();
+    std::string text;
+    for (auto & lines : perf_map_lines)
+      text += lines.second;
+    WritePerfMap(text, true);
+  }
+}
+
+/*
+* Make the pages of the buffer from offset on that hold bytes writable
+* and not executable, or executable and not writable
+*/
+bool JitCompiler::Protect(size_t offset, size_t bytes, bool writable)
+{
+#ifdef JIT_SUPPORTED
+  static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  auto first = offset / page * page;
+  auto last = (offset + bytes + page - 1) / page * page;
+  return mprotect(buffer + first, last - first, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#else
+  return false;
+#endif
+}
+
+void JitCompiler::Emit(std::initializer_list<uint8_t> bytes)
+{
+  code.insert(code.end(), bytes);
+}
+
+void JitCompiler::Emit32(uint32_t value)
+{
+  for (auto i = 0; i < 4; i++)
+    code.push_back((value >> (8 * i)) & 0xff);
+}
+
+void JitCompiler::Emit64(uint64_t value)
+{
+  Emit32((uint32_t)value);
+  Emit32((uint32_t)(value >> 32));
+}
+
+/*
+* movzx host_reg, word [rbx + guest_reg]
+*/
+void JitCompiler::EmitLoadReg(int host_reg, int guest_reg)
+{
+  Emit({ 0x0F, 0xB7, (uint8_t)(0x83 | (host_reg << 3)) });
+  Emit32(REGS_OFFSET + 2 * guest_reg);
+}
+
+/*
+* mov word [rbx + guest_reg], ax
+*/
+void JitCompiler::EmitStoreReg(int guest_reg)
+{
+  Emit({ 0x66, 0x89, 0x83 });
+  Emit32(REGS_OFFSET + 2 * guest_reg);
+}
+
+/*
+* Condition codes from ax: test ax, ax then sets, sete and setg
+*/
+void JitCompiler::EmitSetCC()
+{
+  Emit({ 0x66, 0x85, 0xC0 });
+  Emit({ 0x0F, 0x98, 0x83 });
+  Emit32(N_OFFSET);
+  Emit({ 0x0F, 0x94, 0x83 });
+  Emit32(Z_OFFSET);
+  Emit({ 0x0F, 0x9F, 0x83 });
+  Emit32(P_OFFSET);
+}
+
+/*
+* Call a helper with the context as its first argument, the others
+* already in esi and edx
+*/
+void JitCompiler::EmitCall(const void * helper)
+{
+  Emit({ 0x48, 0x89, 0xDF });        // mov rdi, rbx
+  Emit({ 0x48, 0xB8 });              // mov rax, helper
+  Emit64((uint64_t)helper);
+  Emit({ 0xFF, 0xD0 });              // call rax
+}
+
+/*
+* Return the PC in ax, recording the instructions the block ran
+*/
+void JitCompiler::EmitExit(uint32_t executed)
+{
+  Emit({ 0xC7, 0x83 });              // mov dword [rbx + executed], imm32
+  Emit32(EXECUTED_OFFSET);
+  Emit32(executed);
+  Emit({ 0x0F, 0xB7, 0xC0 });        // movzx eax, ax
+  Emit({ 0x5B, 0xC3 });              // pop rbx, ret
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : EmitOp                                          */
+/*                                                             */
+/* Purpose   : Emit the code of the micro-op at index of its   */
+/*             block. Return false when it is left to its      */
+/*             handler.                                        */
+/*                                                             */
+/***************************************************************/
+bool JitCompiler::EmitOp(const MicroOp & op, uint32_t index)
+{
+  //address of a LEA, load, store or jump into eax
+  auto emit_address = [&]() {
+    if (op.base)
+    {
+      EmitLoadReg(RAX, op.sr1);
+      Emit({ 0x05 });                // add eax, offset
+      Emit32(op.offset);
+    }
+    else
+    {
+      Emit({ 0xB8 });                // mov eax, target
+      Emit32(op.target);
+    }
+  };
+
+  switch (op.kind)
+  {
+    case OP_ALU:
+    {
+      static const uint8_t imm_ops[4] = { 0x05, 0x25, 0x35, 0xB8 };  // add, and, xor, mov eax, imm32
+      static const uint8_t reg_ops[4] = { 0x01, 0x21, 0x31, 0x89 };  // add, and, xor, mov eax, ecx
+      EmitLoadReg(RAX, op.sr1);
+      if (op.use_imm)
+      {
+        Emit({ imm_ops[op.aluk] });
+        Emit32((uint32_t)(int16_t)op.imm);
+      }
+      else
+      {
+        EmitLoadReg(RCX, op.sr2);
+        Emit({ reg_ops[op.aluk], 0xC8 });
+      }
+      EmitStoreReg(op.dr);
+      if (op.ld_cc)
+        EmitSetCC();
+      return true;
+    }
+
+    case OP_SHIFT:
+    {
+      uint8_t amount = op.imm & 0xf;
+      EmitLoadReg(RAX, op.sr1);
+      switch ((op.imm >> 4) & 3)
+      {
+        case 0:  Emit({ 0x66, 0xC1, 0xE0, amount }); break;   // shl ax, amount
+        case 1:  Emit({ 0x66, 0xC1, 0xE8, amount }); break;   // shr ax, amount
+        case 3:  Emit({ 0x66, 0xC1, 0xF8, amount }); break;   // sar ax, amount
+        default: Emit({ 0x31, 0xC0 }); break;                 // xor eax, eax
+      }
+      EmitStoreReg(op.dr);
+      if (op.ld_cc)
+        EmitSetCC();
+      return true;
+    }
+
+    case OP_ADDRESS:
+      emit_address();
+      EmitStoreReg(op.dr);
+      if (op.ld_cc)
+        EmitSetCC();
+      return true;
+
+    case OP_LOAD:
+      emit_address();
+      Emit({ 0x0F, 0xB7, 0xF0 });    // movzx esi, ax
+      EmitCall(op.word ? (const void *)&LoadWord : (const void *)&LoadByte);
+      EmitStoreReg(op.dr);
+      if (op.ld_cc)
+        EmitSetCC();
+      return true;
+
+    case OP_STORE:
+    {
+      emit_address();
+      Emit({ 0x0F, 0xB7, 0xF0 });    // movzx esi, ax
+      EmitLoadReg(RDX, op.sr2);
+      EmitCall(op.word ? (const void *)&StoreWord : (const void *)&StoreByte);
+
+      //the store wrote code, the rest of the block may be stale
+      Emit({ 0x85, 0xC0, 0x74, 0x00 });  // test eax, eax; jz skip
+      auto skip = code.size();
+      Emit({ 0xB8 });
+      Emit32(op.npc);
+      EmitExit(index + 1);
+      code[skip - 1] = (uint8_t)(code.size() - skip);
+      return true;
+    }
+
+    case OP_BRANCH:
+    {
+      //jump to taken on any condition code the branch tests
+      const uint32_t offsets[3] = { N_OFFSET, Z_OFFSET, P_OFFSET };
+      std::vector<size_t> taken_jumps;
+      for (auto i = 0; i < 3; i++)
+      {
+        if (!(op.nzp & (4 >> i)))
+          continue;
+        Emit({ 0x80, 0xBB });        // cmp byte [rbx + cc], 0
+        Emit32(offsets[i]);
+        Emit({ 0x00, 0x0F, 0x85 });  // jne taken
+        Emit32(0);
+        taken_jumps.push_back(code.size());
+      }
+      Emit({ 0xB8 });                // mov eax, npc
+      Emit32(op.npc);
+      Emit({ 0xEB, 0x05 });          // jmp over the taken path
+      for (auto jump : taken_jumps)
+      {
+        auto rel = (uint32_t)(code.size() - jump);
+        memcpy(&code[jump - 4], &rel, 4);
+      }
+      Emit({ 0xB8 });                // mov eax, target
+      Emit32(op.target);
+      EmitExit(index + 1);
+      return true;
+    }
+
+    case OP_JUMP:
+      emit_address();
+      if (op.link)
+      {
+        //no return address when the jump halts
+        Emit({ 0x66, 0x85, 0xC0, 0x74, 0x09 });   // test ax, ax; jz over the link
+        Emit({ 0x66, 0xC7, 0x83 });               // mov word [rbx + dr], npc
+        Emit32(REGS_OFFSET + 2 * op.dr);
+        Emit({ (uint8_t)(op.npc & 0xff), (uint8_t)(op.npc >> 8) });
+      }
+      EmitExit(index + 1);
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Compile                                         */
+/*                                                             */
+/* Purpose   : Translate block into the code buffer. Return    */
+/*             nullptr when its first instruction has no       */
+/*             translation or the buffer is full.              */
+/*                                                             */
+/***************************************************************/
+NativeBlock JitCompiler::Compile(const BasicBlock & block)
+{
+  if (!buffer)
+    return nullptr;
+
+  code.clear();
+  Emit({ 0x53 });                    // push rbx
+  Emit({ 0x48, 0x89, 0xFB });        // mov rbx, rdi
+
+  uint32_t index = 0;
+  auto exited = false;
+  for (auto & op : block.ops)
+  {
+    if (!EmitOp(op, index))
+      break;
+    index++;
+    if (op.kind == OP_BRANCH || op.kind == OP_JUMP)
+    {
+      exited = true;
+      break;
+    }
+  }
+  if (index == 0)
+    return nullptr;
+
+  //fall out in front of the first instruction left to the handlers
+  if (!exited)
+  {
+    uint16_t pc = index < block.ops.size() ? block.ops[index].npc - 2 : block.ops[index - 1].npc;
+    Emit({ 0xB8 });
+    Emit32(pc);
+    EmitExit(index);
+  }
+
+  if (buffer_used + code.size() > JIT_BUFFER_BYTES)
+  {
+    full = true;
+    return nullptr;
+  }
+  auto native = buffer + buffer_used;
+  if (!Protect(buffer_used, code.size(), true))
+    return nullptr;
+  memcpy(native, code.data(), code.size());
+  if (!Protect(buffer_used, code.size(), false))
+    return nullptr;
+  buffer_used += code.size();
+  blocks_compiled++;
+  code_bytes += code.size();
+
+  if (perf_map)
+  {
+    char line[64];
+    snprintf(line, sizeof(line), "%lx %zx lc3b_block_0x%.4x\n", (unsigned long)native, code.size(), block.start);
+    std::lock_guard<std::mutex> guard(perf_map_lock);
+    perf_map_lines[this] += line;
+    WritePerfMap(line, false);
+  }
+  return (NativeBlock)native;
+}
+
+/*
+* Loads and stores of translated code go through main memory
+*/
+uint16_t JitCompiler::LoadWord(GuestContext * context, uint16_t address)
+{
+  return context->core->ReadWord(address);
+}
+
+uint16_t JitCompiler::LoadByte(GuestContext * context, uint16_t address)
+{
+  uint16_t data = context->core->ReadWord(address);
+  data = (address & 1) ? data >> 8 : data & 0xff;
+  if (data & 0x80)
+    data |= 0xff00;
+  return data;
+}
+
+/*
+* Return non-zero when the store wrote to code
+*/
+uint32_t JitCompiler::StoreWord(GuestContext * context, uint16_t address, uint16_t value)
+{
+  auto & core = *context->core;
+  auto & memory = core.simulator().memory();
+  auto epoch = core.epoch;
+  memory.SetLowerByteAt(address >> 1, value & 0xff);
+  memory.SetUpperByteAt(address >> 1, value >> 8);
+  return core.epoch != epoch;
+}
+
+uint32_t JitCompiler::StoreByte(GuestContext * context, uint16_t address, uint16_t value)
+{
+  auto & core = *context->core;
+  auto & memory = core.simulator().memory();
+  auto epoch = core.epoch;
+  if (address & 1)
+    memory.SetUpperByteAt(address >> 1, value & 0xff);
+  else
+    memory.SetLowerByteAt(address >> 1, value & 0xff);
+  return core.epoch != epoch;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the translation counters.              */
+/*                                                             */
+/***************************************************************/
+void JitCompiler::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("jit.blocks_compiled", "basic blocks translated to host code", blocks_compiled);
+  stats.AddScalar("jit.code_bytes", "bytes of host code emitted", code_bytes);
+  stats.AddScalar("jit.flushes", "times the full code buffer was dropped", flushes);
+}
@@ -28,25 +28,62 @@ int main(int argc, char *argv[])
   Simulator Simulator;
 
   /* Error Checking */
-  if (argc < 3) 
+  int first_file = 0;
+  try
   {
-	  printf("Error: usage: %s <micro_code_file> <program_file_1> <program_file_2> ...\n", argv[0]);
-	  exit(1);
+    first_file = Simulator.config().parse(argc, argv);
+  }
+  catch (const SimulatorError & error)
+  {
+    fprintf(stderr, "Error: %s\n", error.what());
+    Simulator.config().usage(argv[0]);
+    return HEADLESS_ERROR;
+  }
+  if (argc - first_file < 2) 
+  {
+	  fprintf(stderr, "Error: a micro-code file and a program file are needed\n");
+	  Simulator.config().usage(argv[0]);
+	  return HEADLESS_ERROR;
   }
 
-  printf("LC-3b Simulator\n\n");
-  Simulator.initialize(argv[1], argv[2], argc - 2);
-
-  if ( (Simulator.dump_file = fopen( "dumpsim.txt", "w" )) == NULL ) 
+  if (Simulator.config().headless)
   {
-	  printf("Error: Can't open dumpsim file\n");
-	  Exit();
+    //no banner, prompt or dumpsim file, only the results asked for
+    try
+    {
+      Simulator.SetOutput(nullptr, nullptr);
+      Simulator.initialize(argv[first_file], &argv[first_file + 1], argc - first_file - 1);
+      return Simulator.headless();
+    }
+    catch (const SimulatorError & error)
+    {
+      fprintf(stderr, "Error: %s\n", error.what());
+      return HEADLESS_ERROR;
+    }
   }
 
-  while (1)
+  try
   {
-	  Simulator.get_command();
+    printf("LC-3b Simulator\n\n");
+    Simulator.initialize(argv[first_file], &argv[first_file + 1], argc - first_file - 1);
+
+    if ( (dumpsim_file = fopen( "dumpsim.txt", "w" )) == NULL ) 
+    {
+      printf("Error: Can't open dumpsim file\n");
+      Exit();
+    }
+    Simulator.SetOutput(stdout, dumpsim_file);
+
+    while (Simulator.get_command());
   }
+  catch (const SimulatorError & error)
+  {
+    printf("Error: %s\n", error.what());
+    Exit();
+  }
+
+  fclose(dumpsim_file);
+  return 0;
 }
 
 void test_bitfield()
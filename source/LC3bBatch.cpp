@@ -0,0 +1,115 @@
+/***************************************************************/
+/*                                                             */
+/* Files:  jobfile      One simulation per line: the options,  */
+/*                      micro-code file and program files of   */
+/*                      the simulator's command line           */
+/*                                                             */
+/***************************************************************/
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+    #include "../include/BatchRunner.h"
+#else
+    #include "BatchRunner.h"
+#endif
+
+static void usage(const char * program)
+{
+  fprintf(stderr, "usage: %s [-j threads] [-cycles n] <jobfile>\n", program);
+  fprintf(stderr, "  -j <n>        worker threads, 0 is one per hardware thread (0)\n");
+  fprintf(stderr, "  -cycles <n>   stop each job after n cycles, 0 runs it until HALT (0)\n");
+  fprintf(stderr, "jobfile: one job per line, [options] <micro_code_file> <program_file_1> ...\n");
+  fprintf(stderr, "         empty lines and text after # are skipped\n");
+}
+
+/*
+* A job per line of the job file, named after its line and last file
+*/
+static std::vector<BatchJob> ReadJobs(const char * filename, int max_cycles)
+{
+  std::ifstream file(filename);
+  if (!file)
+    throw SimulatorError(Format("Can't open job file %s", filename));
+
+  std::vector<BatchJob> jobs;
+  std::string line;
+  for (auto number = 1; std::getline(file, line); number++)
+  {
+    auto comment = line.find('#');
+    if (comment != std::string::npos)
+      line.erase(comment);
+
+    BatchJob job;
+    job.max_cycles = max_cycles;
+    std::istringstream words(line);
+    for (std::string word; words >> word; )
+      job.arguments.push_back(word);
+    if (job.arguments.empty())
+      continue;
+
+    auto program = job.arguments.back();
+    auto slash = program.find_last_of("/\\");
+    job.name = std::to_string(number) + ":" + (slash == std::string::npos ? program : program.substr(slash + 1));
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : main                                            */
+/*                                                             */
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  auto threads = 0, max_cycles = 0;
+  auto i = 1;
+  char * end = nullptr;
+  for (; i < argc && argv[i][0] == '-'; i++)
+  {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      threads = (int)strtol(argv[++i], &end, 0);
+    else if (!strcmp(argv[i], "-cycles") && i + 1 < argc)
+      max_cycles = (int)strtol(argv[++i], &end, 0);
+    else
+    {
+      fprintf(stderr, "Error: unknown option %s\n", argv[i]);
+      usage(argv[0]);
+      return 1;
+    }
+    if (end == argv[i] || *end)
+    {
+      fprintf(stderr, "Error: option %s takes an integer, not %s\n", argv[i - 1], argv[i]);
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (argc - i != 1)
+  {
+    fprintf(stderr, "Error: a job file is needed\n");
+    usage(argv[0]);
+    return 1;
+  }
+  if (threads < 0 || max_cycles < 0)
+  {
+    fprintf(stderr, "Error: -j and -cycles must not be negative\n");
+    usage(argv[0]);
+    return 1;
+  }
+
+  try
+  {
+    auto jobs = ReadJobs(argv[i], max_cycles);
+    BatchRunner runner(threads);
+    auto results = runner.Run(jobs);
+    runner.dump(stdout, results);
+    return runner.Summary().failed ? 1 : 0;
+  }
+  catch (const SimulatorError & error)
+  {
+    fprintf(stderr, "Error: %s\n", error.what());
+    return 1;
+  }
+}
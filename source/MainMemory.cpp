@@ -5,9 +5,15 @@
 #ifdef __linux__
     #include "../include/Simulator.h"
     #include "../include/MainMemory.h"
+    #include "../include/FunctionalCore.h"
+    #include "../include/Checkpoint.h"
+    #include "../include/EventQueue.h"
 #else
     #include "Simulator.h"
     #include "MainMemory.h"
+    #include "FunctionalCore.h"
+    #include "Checkpoint.h"
+    #include "EventQueue.h"
 #endif
 
 /*
@@ -16,22 +22,31 @@
 MainMemory::MainMemory(Simulator & instance) : _simulator(instance)
 {
   MEMORY = std::vector<std::vector<bits8>>(WORDS_IN_MEM,std::vector<bits8>(2));
+  code_pages = std::vector<bool>(WORDS_IN_MEM / CODE_PAGE_WORDS);
 }
 
 /***************************************************************/
 /*                                                             */
 /* Procedure : init_memory                                     */
 /*                                                             */
-/* Purpose   : Zero out the memory array                       */
+/* Purpose   : Zero out the memory array and empty the caches  */
 /*                                                             */
 /***************************************************************/
 void MainMemory::init_memory()
 {
+  auto & config = simulator().config();
+
   for (auto i=0; i < WORDS_IN_MEM; i++)
   {
     MEMORY[i][0] = 0;
     MEMORY[i][1] = 0;
   }
+  std::fill(code_pages.begin(), code_pages.end(), false);
+
+  auto & events = simulator().events();
+  ICache.init_cache(config.icache_size, config.line_size, config.cache_ways, config.miss_latency, 0, &events);
+  DCache.init_cache(config.dcache_size, config.line_size, config.cache_ways, config.miss_latency, config.mshr_entries,
+                    &events);
 }
 
 /*
@@ -45,10 +60,7 @@ bits8 MainMemory::GetLowerByteAt(const bits16 & address) const
   }
   catch (const std::out_of_range& oor)
   {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: Low byte read to invalid memory location: addr=0x%04hX\n",address.to_num());
-    printf("C++ error code : %s\n",oor.what());
-	  Exit();
+    throw SimulatorError(Format("Low byte read to invalid memory location: addr=0x%04hX", address.to_num()));
   }
 }
 
@@ -63,11 +75,9 @@ void MainMemory::SetLowerByteAt(const bits16 & address, bits8 val)
   }
   catch (const std::out_of_range& oor)
   {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: Low byte write to invalid memory location: addr=0x%04hX\n",address.to_num());
-    printf("C++ error code : %s\n",oor.what());
-	  Exit();
+    throw SimulatorError(Format("Low byte write to invalid memory location: addr=0x%04hX", address.to_num()));
   }
+  CodeWritten(address.to_num());
 }
 
 /*
@@ -81,10 +91,7 @@ bits8 MainMemory::GetUpperByteAt(const bits16 & address) const
   }
   catch (const std::out_of_range& oor)
   {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: High byte read to invalid memory location: addr=0x%04hX\n",address.to_num());
-    printf("C++ error code : %s\n",oor.what());
-	  Exit();
+    throw SimulatorError(Format("High byte read to invalid memory location: addr=0x%04hX", address.to_num()));
   }
 }
 
@@ -99,11 +106,22 @@ void MainMemory::SetUpperByteAt(const bits16 & address, bits8 val)
   }
   catch (const std::out_of_range& oor)
   {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: High byte write to invalid memory location: addr=0x%04hX\n",address.to_num());
-    printf("C++ error code : %s\n",oor.what());
-	  Exit();
+    throw SimulatorError(Format("High byte write to invalid memory location: addr=0x%04hX", address.to_num()));
   }
+  CodeWritten(address.to_num());
+}
+
+/*
+* A write to a page the functional core decoded code from drops the
+* blocks decoded from the word written. The page stays marked while
+* blocks decoded from it are left.
+*/
+void MainMemory::CodeWritten(int addr)
+{
+  auto page = addr / CODE_PAGE_WORDS;
+  if(!code_pages[page])
+    return;
+  code_pages[page] = simulator().functional().InvalidateWord(addr);
 }
 
 /***************************************************************/
@@ -114,9 +132,12 @@ void MainMemory::SetUpperByteAt(const bits16 & address, bits8 val)
 void MainMemory::dcache_access(const bits16 & dcache_addr, bits16 & read_word, const bits16 & write_word, bool  & dcache_r, bool mem_w0, bool mem_w1)
 {
   auto addr = dcache_addr >> 1;
-  int random = 0; //simulator().GetCycles() % 9;
+  auto cycle = simulator().GetCycles();
+  auto ready_cycle = DCache.Request(dcache_addr.to_num(), cycle);
 
-  if (random)
+  //a write miss of the non-blocking cache leaves its data in the MSHR,
+  //a read waits for the line
+  if (ready_cycle == -1 || (!mem_w0 && !mem_w1 && ready_cycle > cycle))
   {
     dcache_r = false;
     read_word = 0xfeed ;
@@ -132,6 +153,34 @@ void MainMemory::dcache_access(const bits16 & dcache_addr, bits16 & read_word, c
       SetUpperByteAt(addr,write_word.range<15,8>());
   }
 }
+
+/*
+* Read the word at dcache_addr without waiting for a miss. Return the
+* cycle the data is ready, or -1 when the read has to be retried. The
+* data is read from memory right away, a miss only delays its use.
+*/
+int MainMemory::dcache_request(const bits16 & dcache_addr, bits16 & read_word)
+{
+  auto addr = dcache_addr >> 1;
+  auto ready_cycle = DCache.Request(dcache_addr.to_num(), simulator().GetCycles());
+  if (ready_cycle == -1)
+    read_word = 0xfeed;
+  else
+  {
+    read_word.range<15,8>() = GetUpperByteAt(addr).range<7,0>();
+    read_word.range<7,0>() = GetLowerByteAt(addr).range<7,0>();
+  }
+  return ready_cycle;
+}
+
+/*
+* Advance the caches by a cycle
+*/
+void MainMemory::Cycle()
+{
+  DCache.Cycle(simulator().GetCycles());
+}
+
 /***************************************************************/
 /*                                                             */
 /* icache_access                                               */
@@ -140,9 +189,9 @@ void MainMemory::dcache_access(const bits16 & dcache_addr, bits16 & read_word, c
 void MainMemory::icache_access(const bits16 & icache_addr, bits16 & read_word, bool & icache_r)
 {
   auto addr = icache_addr >> 1;
-  int random = 0; //simulator().GetCycles() % 13;
+  auto miss = !ICache.Access(icache_addr.to_num(), simulator().GetCycles());
 
-  if (random)
+  if (miss)
   {
     icache_r = false;
     read_word = 0xfeed;
@@ -168,14 +217,14 @@ void MainMemory::mdump(FILE * dumpsim_file, const bits16  & start, const bits16
   auto start_val = start.to_num();
   auto stop_val = stop.to_num();
 
-  printf("\nMemory content [0x%04x..0x%04x] :\n", start_val, stop_val);
-  printf("-------------------------------------\n");
+  simulator().Print("\nMemory content [0x%04x..0x%04x] :\n", start_val, stop_val);
+  simulator().Print("-------------------------------------\n");
   for (address = (start_val >> 1); address <= (stop_val >> 1); address++)
   {
-    printf("  0x%04x (%d) : 0x%02x%02x\n", address << 1, address << 1, GetUpperByteAt(address).to_num(), GetLowerByteAt(address).to_num());
+    simulator().Print("  0x%04x (%d) : 0x%02x%02x\n", address << 1, address << 1, GetUpperByteAt(address).to_num(), GetLowerByteAt(address).to_num());
   }
 
-  printf("\n");
+  simulator().Print("\n");
 
   /* dump the memory contents into the dumpsim file */
   fprintf(dumpsim_file, "\nMemory content [0x%04x..0x%04x] :\n", start_val, stop_val);
@@ -188,3 +237,89 @@ void MainMemory::mdump(FILE * dumpsim_file, const bits16  & start, const bits16
   fprintf(dumpsim_file, "\n");
   fflush(dumpsim_file);
 }
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the counters of the enabled caches.    */
+/*                                                             */
+/***************************************************************/
+void MainMemory::RegisterStats(Statistics & stats)
+{
+  if (ICache.IsEnabled())
+    ICache.RegisterStats(stats, "icache");
+  if (DCache.IsEnabled())
+    DCache.RegisterStats(stats, "dcache");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the statistics of the enabled caches.      */
+/*                                                             */
+/***************************************************************/
+void MainMemory::dump(FILE * dumpsim_file)
+{
+  if (ICache.IsEnabled())
+    ICache.dump(simulator().console(), dumpsim_file, "Instruction cache");
+  if (DCache.IsEnabled())
+    DCache.dump(simulator().console(), dumpsim_file, "Data cache");
+}
+
+/*
+* Memory in pages of CHECKPOINT_PAGE_WORDS words, each led by its index,
+* leaving out the pages of zeros. Then the caches in front of it.
+*/
+void MainMemory::Serialize(Checkpoint & cp)
+{
+  const int pages = WORDS_IN_MEM / CHECKPOINT_PAGE_WORDS;
+  if (cp.IsRestoring())
+  {
+    for (auto i=0; i < WORDS_IN_MEM; i++)
+    {
+      MEMORY[i][0] = 0;
+      MEMORY[i][1] = 0;
+    }
+    std::fill(code_pages.begin(), code_pages.end(), false);
+
+    uint16_t index = 0;
+    for (cp.Value(index); index != CHECKPOINT_END_PAGES && !cp.IsCorrupt(); cp.Value(index))
+    {
+      if (index >= pages)
+      {
+        cp.Corrupt();
+        break;
+      }
+      for (auto i = 0; i < CHECKPOINT_PAGE_WORDS; i++)
+      {
+        cp.Bits(MEMORY[index * CHECKPOINT_PAGE_WORDS + i][0]);
+        cp.Bits(MEMORY[index * CHECKPOINT_PAGE_WORDS + i][1]);
+      }
+    }
+  }
+  else
+  {
+    for (uint16_t index = 0; index < pages; index++)
+    {
+      auto base = index * CHECKPOINT_PAGE_WORDS;
+      auto used = false;
+      for (auto i = 0; i < CHECKPOINT_PAGE_WORDS && !used; i++)
+        used = MEMORY[base + i][0].to_num() || MEMORY[base + i][1].to_num();
+      if (!used)
+        continue;
+      cp.Value(index);
+      for (auto i = 0; i < CHECKPOINT_PAGE_WORDS; i++)
+      {
+        cp.Bits(MEMORY[base + i][0]);
+        cp.Bits(MEMORY[base + i][1]);
+      }
+    }
+    uint16_t end = CHECKPOINT_END_PAGES;
+    cp.Value(end);
+  }
+
+  ICache.Serialize(cp);
+  DCache.Serialize(cp);
+}
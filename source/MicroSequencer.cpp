@@ -4,9 +4,13 @@
 
 #include <cstring>
 #ifdef __linux__
+    #include "../include/Simulator.h"
     #include "../include/MicroSequencer.h"
+    #include "../include/Checkpoint.h"
 #else
+    #include "Simulator.h"
     #include "MicroSequencer.h"
+    #include "Checkpoint.h"
 #endif
 
 /*
@@ -29,13 +33,12 @@ void MicroSequencer::init_control_store(char *ucode_filename)
   FILE *ucode;
   char line[200];
 
-  printf("Loading Control Store from file: %s\n", ucode_filename);
+  simulator().Print("Loading Control Store from file: %s\n", ucode_filename);
 
   /* Open the micro-code file. */
   if ((ucode = fopen(ucode_filename, "r")) == NULL)
   {
-    printf("Error: Can't open micro-code file %s\n", ucode_filename);
-    Exit();
+    throw SimulatorError(Format("Can't open micro-code file %s", ucode_filename));
   }
 
   /* Read a line for each row in the control store. */
@@ -44,8 +47,8 @@ void MicroSequencer::init_control_store(char *ucode_filename)
   {
     if (fscanf(ucode, "%[^\n]\n", line) == EOF)
     {
-      printf("Error: Too few lines (%d) in micro-code file: %s. Expected %d lines.\n", ucode_row, ucode_filename, CONTROL_STORE_ROWS);
-      Exit();
+      fclose(ucode);
+      throw SimulatorError(Format("Too few lines (%d) in micro-code file: %s. Expected %d lines.", ucode_row, ucode_filename, CONTROL_STORE_ROWS));
     }
 
     /* Find the '#' character and terminate the string there to ignore comments */
@@ -81,28 +84,29 @@ void MicroSequencer::init_control_store(char *ucode_filename)
       }
       else if (!isspace(line[j]))
       {
-        printf("Error: Unknown value '%c' in micro-code file: %s\nLine: %d\n", line[j], ucode_filename, ucode_row);
-        Exit();
+        fclose(ucode);
+        throw SimulatorError(Format("Unknown value '%c' in micro-code file: %s\nLine: %d", line[j], ucode_filename, ucode_row));
       }
     }
 
     if (bit_count < NUM_CONTROL_STORE_BITS)
     {
-      printf("Error: Too few control bits in micro-code file: %s\nLine: %d (found %d, expected %d)\n", ucode_filename, ucode_row, bit_count, NUM_CONTROL_STORE_BITS);
-      Exit();
+      fclose(ucode);
+      throw SimulatorError(Format("Too few control bits in micro-code file: %s\nLine: %d (found %d, expected %d)", ucode_filename, ucode_row, bit_count, NUM_CONTROL_STORE_BITS));
     }
 
     /* Warn about extra bits in line. */
     for (int j = 0; line[j] != '\0'; j++)
     {
         if (!isspace(line[j]) && line[j] != '0' && line[j] != '1') {
-             printf("Warning: Extra character(s) '%c' in control store file %s. Line: %d\n", line[j], ucode_filename, ucode_row);
+             simulator().Print("Warning: Extra character(s) '%c' in control store file %s. Line: %d\n", line[j], ucode_filename, ucode_row);
         }
     }
 
     ucode_row++; // Increment only when a valid line is processed
   }
-  printf("\n");
+  fclose(ucode);
+  simulator().Print("\n");
 }
 
 /*
@@ -116,13 +120,21 @@ cs_bits & MicroSequencer::GetMicroCodeAt(uint8_t row)
   }
   catch (const std::out_of_range& oor)
   {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: trying to get Invalid micro-code location: Index=%d\n",row);
-    printf("C++ error code : ' %s '\n",oor.what());
-	  Exit();
+    throw SimulatorError(Format("trying to get Invalid micro-code location: Index=%d", row));
   }
 }
 
+/*
+* Control store row of an instruction, addressed by IR[15:11] and IR[5]
+*/
+cs_bits & MicroSequencer::GetMicroCodeFor(const bits16 & ir)
+{
+  bitfield<6> CONTROL_STORE_ADDRESS;
+  CONTROL_STORE_ADDRESS.range<5,1>() = ir.range<15,11>();
+  CONTROL_STORE_ADDRESS[0] = ir[5];
+  return GetMicroCodeAt(CONTROL_STORE_ADDRESS.to_num());
+}
+
 /*
 * //TODO
 */
@@ -134,10 +146,7 @@ bool MicroSequencer::GetMicroCodeBitsAt(uint8_t index, uint8_t bits) const
   }
   catch (const std::out_of_range& oor)
   {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: trying to get Invalid micro-code: Index=%d, Bit=%d\n",index,bits);
-    printf("C++ error code : ' %s '\n",oor.what());
-	  Exit();
+    throw SimulatorError(Format("trying to get Invalid micro-code: Index=%d, Bit=%d", index,bits));
   }
 }
 
@@ -152,10 +161,7 @@ void MicroSequencer::SetMicroCodeBitsAt(uint8_t index, uint8_t bit, bool val)
   }
   catch (const std::out_of_range& oor)
   {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: trying to set Invalid micro-code: row=%d, Bit=%d\n",index, bit);
-    printf("C++ error code : ' %s '\n",oor.what());
-	  Exit();
+    throw SimulatorError(Format("trying to set Invalid micro-code: row=%d, Bit=%d", index, bit));
   }
 }
 
@@ -164,25 +170,25 @@ void MicroSequencer::SetMicroCodeBitsAt(uint8_t index, uint8_t bit, bool val)
 */
 void MicroSequencer::print_CS(const cs_bits &CS, int num) const
 {
-  printf("CS :");
+  simulator().Print("CS :");
   for ( auto ii = 0 ; ii < num; ii++) {
-    printf("%d",CS[ii]);
+    simulator().Print("%d",CS[ii]);
   }
-  printf("\n");
+  simulator().Print("\n");
 }
 
 void MicroSequencer::cdump(FILE * dumpsim_file) const
 {
-  printf("\nControl store content \n");
-  printf("------------------------\n");
+  simulator().Print("\nControl store content \n");
+  simulator().Print("------------------------\n");
 
   for (auto row = 0 ; row < CONTROL_STORE_ROWS; row++)
   {
-    printf("Row %d :",row);
+    simulator().Print("Row %d :",row);
     for ( auto ii = 0 ; ii < NUM_CONTROL_STORE_BITS; ii++) {
-      printf("%d",CONTROL_STORE[row][ii]);
+      simulator().Print("%d",CONTROL_STORE[row][ii]);
     }
-    printf("\n");
+    simulator().Print("\n");
   }
 
   fprintf(dumpsim_file, "\nControl store content \n");
@@ -200,3 +206,14 @@ void MicroSequencer::cdump(FILE * dumpsim_file) const
   fprintf(dumpsim_file, "\n");
   fflush(dumpsim_file);
 }
+
+/*
+* The control store is part of the checkpoint since it may have been
+* loaded from another ucode file than the one given on restore
+*/
+void MicroSequencer::Serialize(Checkpoint & cp)
+{
+  cp.Size(CONTROL_STORE);
+  for (auto & row : CONTROL_STORE)
+    cp.Bits(row);
+}
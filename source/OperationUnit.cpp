@@ -3,44 +3,119 @@
 /***************************************************************/
 
 #ifdef __linux__    
-    #include "../include/Latch.h"
+    #include "../include/instruction.h"
     #include "../include/OperationUnit.h"
 #else
-    #include "Latch.h"
+    #include "instruction.h"
     #include "OperationUnit.h"
 #endif
 
-// factory methods to generate the desired logic unit
-// TODO: add some way to identify which latch is being passed. Currently assume its always AGEX
-std::unique_ptr<OperationUnit> OperationUnit::MakeUnit(Latch & latch)
+// factory method to generate the logic unit selected by ALU.RESULTMUX
+std::unique_ptr<OperationUnit> OperationUnit::MakeUnit(const Instruction & inst)
 {   
-    auto inst = latch.instruction;
-    if (!inst) return nullptr;
-    
-    auto alu_result_mux = latch.AGEX_CS[AGEX_ALU_RESULTMUX];
+    auto alu_result_mux = inst.AGEX_CS[AGEX_ALU_RESULTMUX];
     if(alu_result_mux) 
     {
         bits16 input2;
-        auto sr2_mux = latch.AGEX_CS[AGEX_SR2MUX];
+        auto sr2_mux = inst.AGEX_CS[AGEX_SR2MUX];
         if(sr2_mux)
-            input2 = inst->IR.range<4,0>().sign_ext();
+            input2 = inst.IR.sign_ext(4);
         else
-            input2 = inst->SR2;
+            input2 = inst.SR2;
 
-        auto aluk = (latch.AGEX_CS[AGEX_ALUK1] << 1) + latch.AGEX_CS[AGEX_ALUK0];
-        return std::make_unique<Alu>(inst->SR1,input2,aluk);
+        bits2 aluk = (inst.AGEX_CS[AGEX_ALUK1] << 1) + inst.AGEX_CS[AGEX_ALUK0];
+        return std::make_unique<Alu>(inst.SR1,input2,aluk);
     }
     else
-        return std::make_unique<Shifter>(inst->SR1,inst->IR.range<5,0>());
+        return std::make_unique<Shifter>(inst.SR1,inst.IR.range<5,0>());
     
 }
 
+//shif instruction
+//       [15       12|11     9|8      6| 5| 4| 3  2  1  0]
+//  LSHF [ 1, 1, 0, 1|   DR   |   SR   | 0| 0|   amount  ]
+//  RSHF [ 1, 1, 0, 1|   DR   |   SR   | 0| 1|   amount  ]
+// RSHFA [ 1, 1, 0, 1|   DR   |   SR   | 1| 1|   amount  ]
+//
 Shifter::Shifter(bits16 source, bitfield<6> control)
 {
-
+    auto shift_amount = control.range<3,0>().to_num();
+    switch(control.range<5,4>().to_num())
+    {
+      case 0: //LSHF
+        result = source << shift_amount;
+        break;
+      case 1: //RSHF
+        result = source >> shift_amount;
+        break;
+      case 3: //RSHFA
+      {
+        //arithmetic right shift, will preserve the MSB when shifting
+        auto sr_15 = source[15];
+        result = source >> shift_amount;
+        for(auto i = 0; i < shift_amount; ++i)
+          result[15-i] = sr_15;
+        break;
+      }
+      default:
+        result = 0;
+    }
 }
 
 Alu::Alu(bits16 source1, bits16 source2, bits2 control)
 {
+    switch(control.to_num())
+    {
+      case 0:
+        result = source1 + source2;
+        break;
+      case 1:
+        result = source1 & source2;
+        break;
+      case 2:
+        result = source1 ^ source2;
+        break;
+      case 3:
+        result = source2;
+        break;
+    }
+}
 
+AddressUnit::AddressUnit(const Instruction & inst)
+{
+    // First program counter mux
+    bits16 next_pc_1;
+    if(inst.AGEX_CS[AGEX_ADDR1MUX])
+      next_pc_1 = inst.SR1;
+    else
+      next_pc_1 = inst.NPC;
+
+    // second program counter mux
+    bits16 next_pc_2;
+    bits2 addr2mux = (inst.AGEX_CS[AGEX_ADDR2MUX1] << 1) + inst.AGEX_CS[AGEX_ADDR2MUX0];
+    switch (addr2mux.to_num())
+    {
+    case 0:
+      next_pc_2 = 0;
+      break;
+    case 1:
+      next_pc_2 = inst.IR.sign_ext(5);
+      break;
+    case 2:
+      next_pc_2 = inst.IR.sign_ext(8);
+      break;
+    case 3:
+      next_pc_2 = inst.IR.sign_ext(10);
+      break;
+    }
+
+    //check if lshf1 signal is 1
+    if(inst.AGEX_CS[AGEX_LSHF1])
+      next_pc_2 = next_pc_2 << 1;
+
+    //generate next instruction address
+    if(inst.AGEX_CS[AGEX_ADDRESSMUX])
+      result = next_pc_1 + next_pc_2;
+    else
+      result = inst.IR.zero_ext(7) << 1;
 }
@@ -0,0 +1,879 @@
+/***************************************************************/
+/* Out-of-Order Core Implementaion                             */
+/***************************************************************/
+
+#include <algorithm>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/State.h"
+    #include "../include/MicroSequencer.h"
+    #include "../include/MainMemory.h"
+    #include "../include/BranchPredictor.h"
+    #include "../include/OperationUnit.h"
+    #include "../include/instruction.h"
+    #include "../include/OutOfOrderCore.h"
+    #include "../include/Statistics.h"
+    #include "../include/InstructionMix.h"
+#else
+    #include "Simulator.h"
+    #include "State.h"
+    #include "MicroSequencer.h"
+    #include "MainMemory.h"
+    #include "BranchPredictor.h"
+    #include "OperationUnit.h"
+    #include "instruction.h"
+    #include "OutOfOrderCore.h"
+    #include "Statistics.h"
+    #include "InstructionMix.h"
+#endif
+
+OutOfOrderCore::OutOfOrderCore(Simulator & instance) :
+_simulator(instance),
+cycle(0),
+width(1),
+fetch_queue_depth(0),
+fetch_pc(0),
+fetch_blocked(false),
+fetch_seq(0),
+rob_head(0),
+rob_count(0),
+lsq_head(0),
+lsq_count(0)
+{
+
+}
+
+/*
+* Timing diagram row of an instruction
+*/
+static InstructionTrace TraceOf(const Instruction & inst)
+{
+  InstructionTrace trace;
+  trace.seq = inst.seq;
+  trace.pc = inst.PC.to_num();
+  trace.disassembled = inst.GetDisassembly();
+  trace.cycle_history = inst.cycle_history;
+  trace.mem_addr = inst.mem_addr;
+  trace.mem_addr_valid = inst.mem_addr_valid;
+  return trace;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_core                                       */
+/*                                                             */
+/* Purpose   : Size the queues from the configuration and      */
+/*             start fetching at the architectural PC.         */
+/*                                                             */
+/***************************************************************/
+void OutOfOrderCore::init_core()
+{
+  auto & config = simulator().config();
+
+  width = config.issue_width;
+  fetch_queue_depth = config.fetch_queue_entries ? config.fetch_queue_entries : FETCH_QUEUE_DEPTH * width;
+  ROB = std::vector<ROB_Entry>(config.rob_entries, ROB_Entry());
+  RS = std::vector<RS_Entry>(config.rs_entries, RS_Entry());
+  LSQ = std::vector<LSQ_Entry>(config.lsq_entries, LSQ_Entry());
+  rob_head = rob_count = 0;
+  lsq_head = lsq_count = 0;
+  for (auto & tag : rename_table)
+    tag = NO_TAG;
+
+  fetch_pc = simulator().state().GetProgramCounter();
+  fetch_blocked = false;
+  fetch_seq = 0;
+  fetch_queue.clear();
+  instruction_history.clear();
+
+  retired_instructions = 0;
+  rob_occupancy = 0;
+  rob_full_stalls = 0;
+  rs_full_stalls = 0;
+  lsq_full_stalls = 0;
+  loads_forwarded = 0;
+  load_blocked_cycles = 0;
+  flushes = 0;
+  squashed_instructions = 0;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Cycle                                           */
+/*                                                             */
+/* Purpose   : Execute one cycle of the core. The steps run    */
+/*             from commit back to fetch so that every         */
+/*             instruction spends at least a cycle in each.    */
+/*                                                             */
+/***************************************************************/
+void OutOfOrderCore::Cycle()
+{
+  cycle = simulator().GetCycles();
+  Commit();
+  WriteBack();
+  Issue();
+  MemoryAccess();
+  Dispatch();
+  Fetch();
+  UpdateHistory();
+  rob_occupancy += rob_count;
+}
+
+/*
+* Word read from memory to the value of a load, bytes are sign extended
+*/
+bits16 OutOfOrderCore::LoadData(const bits16 & address, bool word, const bits16 & mdr) const
+{
+  if (word)
+    return mdr;
+
+  bits8 data_byte;
+  if (address[0])
+    data_byte = mdr.range<15,8>();
+  else
+    data_byte = mdr.range<7,0>();
+
+  bits16 data;
+  data.range<7,0>() = data_byte.range<7,0>();
+  if (data[7])
+    data = data.sign_ext(7);
+  return data;
+}
+
+/*
+* Word written to memory by a store, a byte goes to its half of the word
+*/
+bits16 OutOfOrderCore::StoreData(const bits16 & address, bool word, const bits16 & data) const
+{
+  if (word)
+    return data;
+
+  bits16 mdr;
+  bits8 data_byte = data.range<7,0>();
+  if (address[0])
+    mdr.range<15,8>() = data_byte.range<7,0>();
+  else
+    mdr.range<7,0>() = data_byte.range<7,0>();
+  return mdr;
+}
+
+/*
+* Record the last stage of an instruction leaving the core
+*/
+void OutOfOrderCore::Retire(const std::shared_ptr<Instruction> & inst, const std::string & stage)
+{
+  inst->current_stage = stage;
+  inst->cycle_history[cycle] = stage;
+  if (!simulator().config().headless)
+    instruction_history.push_back(TraceOf(*inst));
+}
+
+bool OutOfOrderCore::IsYounger(int tag, uint64_t seq) const
+{
+  return ROB[tag].valid && ROB[tag].instruction->seq > seq;
+}
+
+/************************* Commit() *************************/
+/*
+* Retire finished instructions from the head of the reorder buffer in
+* program order. Registers, condition codes and the PC are only written
+* here, and stores write the data cache.
+*/
+void OutOfOrderCore::Commit()
+{
+  auto & cpu_state = simulator().state();
+  auto & memory = simulator().memory();
+
+  for (auto n = 0; n < width && rob_count > 0; n++)
+  {
+    auto & entry = ROB[rob_head];
+    if (!entry.done)
+      break;
+    auto inst = entry.instruction;
+
+    if (entry.lsq != -1)
+    {
+      auto & lsq = LSQ[entry.lsq];
+      if (lsq.store)
+      {
+        bits16 MDR_OUT;
+        bool data_cache_r = false;
+        auto MDR_IN = StoreData(inst->ADDRESS, lsq.word, inst->ALU_RESULT);
+        auto we_high = lsq.word || inst->ADDRESS[0];
+        auto we_low = lsq.word || !inst->ADDRESS[0];
+        memory.dcache_access(inst->ADDRESS, MDR_OUT, MDR_IN, data_cache_r, we_low, we_high);
+        if (!data_cache_r)
+          break;
+        inst->mem_addr = inst->ADDRESS.to_num();
+        inst->mem_addr_valid = true;
+      }
+      lsq = LSQ_Entry();
+      lsq_head = (lsq_head + 1) % LSQ.size();
+      lsq_count--;
+    }
+
+    //as in the pipeline, the machine stops when the PC reaches the halt
+    //vector, before the TRAP writes R7
+    auto halted = entry.next_pc.to_num() == 0;
+    if (entry.ld_reg && !halted)
+    {
+      cpu_state.SetDataForRegister(inst->DRID, entry.value);
+      if (rename_table[inst->DRID.to_num()] == rob_head)
+        rename_table[inst->DRID.to_num()] = NO_TAG;
+    }
+    if (entry.ld_cc && !halted)
+    {
+      cpu_state.SetNZP(entry.nzp);
+      if (rename_table[RENAME_CC] == rob_head)
+        rename_table[RENAME_CC] = NO_TAG;
+    }
+    cpu_state.SetProgramCounter(entry.next_pc);
+
+    //nothing behind a HALT commits, and like in the pipeline the halting
+    //TRAP itself does not retire
+    if (halted)
+      break;
+    retired_instructions++;
+    Retire(inst, "S");
+    simulator().mix().Retire(*inst, cycle);
+
+    entry = ROB_Entry();
+    rob_head = (rob_head + 1) % ROB.size();
+    rob_count--;
+  }
+}
+
+/************************* WriteBack() *************************/
+/*
+* Instructions whose result arrives this cycle select their register
+* value like the SR stage, broadcast it on the result bus and, for
+* control instructions, resolve the next PC.
+*/
+void OutOfOrderCore::WriteBack()
+{
+  auto & micro_seq = simulator().microsequencer();
+
+  for (auto i = 0; i < rob_count; i++)
+  {
+    auto tag = (rob_head + i) % ROB.size();
+    auto & entry = ROB[tag];
+    if (!entry.executing || entry.done || entry.complete_cycle > cycle)
+      continue;
+    auto inst = entry.instruction;
+
+    switch (micro_seq.Get_DR_VALUEMUX(inst->SR_CS).to_num())
+    {
+    case 0:
+      entry.value = inst->ADDRESS;
+      break;
+    case 1:
+      entry.value = inst->DATA;
+      break;
+    case 2:
+      entry.value = inst->NPC;
+      break;
+    case 3:
+      entry.value = inst->ALU_RESULT;
+      break;
+    }
+
+    /* CC LOGIC  */
+    entry.nzp[2] = entry.value[15];
+    entry.nzp[1] = (entry.value.to_num() == 0);
+    entry.nzp[0] = (!entry.nzp[2] && !entry.nzp[1]);
+
+    //Branch Logic
+    entry.next_pc = inst->NPC;
+    entry.taken = false;
+    if (micro_seq.Get_BR_OP(inst->MEM_CS))
+    {
+      bits3 br_intr_nzp = inst->IR.range<11,9>();
+      entry.taken = (br_intr_nzp & inst->CC).to_num() != 0;
+      if (entry.taken)
+        entry.next_pc = inst->ADDRESS;
+    }
+    else if (micro_seq.Get_UNCOND_OP(inst->MEM_CS))
+    {
+      entry.taken = true;
+      entry.next_pc = inst->ADDRESS;
+    }
+    else if (micro_seq.Get_TRAP_OP(inst->MEM_CS))
+    {
+      entry.taken = true;
+      entry.next_pc = inst->DATA;
+    }
+
+    entry.done = true;
+    inst->current_stage = "W";
+    Broadcast(tag);
+    if (entry.control)
+      ResolveControl(tag);
+  }
+}
+
+/*
+* Result bus: every reservation station waiting on tag captures the value
+*/
+void OutOfOrderCore::Broadcast(int tag)
+{
+  auto & entry = ROB[tag];
+  for (auto & rs : RS)
+  {
+    if (!rs.busy)
+      continue;
+    auto inst = ROB[rs.rob].instruction;
+    if (rs.sr1_tag == tag)
+    {
+      inst->SR1 = entry.value;
+      rs.sr1_tag = NO_TAG;
+    }
+    if (rs.sr2_tag == tag)
+    {
+      inst->SR2 = entry.value;
+      rs.sr2_tag = NO_TAG;
+    }
+    if (rs.cc_tag == tag)
+    {
+      inst->CC = entry.nzp;
+      rs.cc_tag = NO_TAG;
+    }
+  }
+}
+
+/*
+* Without a predictor the front end waits for every control instruction.
+* With speculative fetch, a misprediction flushes everything younger.
+*/
+void OutOfOrderCore::ResolveControl(int tag)
+{
+  auto & entry = ROB[tag];
+  auto inst = entry.instruction;
+  auto & predictor = simulator().predictor();
+  auto & micro_seq = simulator().microsequencer();
+
+  if (!predictor.IsEnabled())
+  {
+    fetch_pc = entry.next_pc;
+    fetch_blocked = false;
+    return;
+  }
+
+  auto mispredicted = entry.next_pc.to_num() != inst->PRED_PC.to_num();
+  predictor.Update(inst->PC, inst->IR, micro_seq.Get_BR_OP(inst->MEM_CS), entry.taken, entry.next_pc, mispredicted,
+                   inst->ras_checkpoint);
+  if (mispredicted)
+  {
+    predictor.Recover(inst->ras_checkpoint, inst->PC, inst->IR);
+    Squash(inst->seq);
+    fetch_pc = entry.next_pc;
+    flushes++;
+  }
+}
+
+/*
+* Remove every instruction younger than seq from the core and rebuild
+* the rename table from the instructions that remain
+*/
+void OutOfOrderCore::Squash(uint64_t seq)
+{
+  for (auto & inst : fetch_queue)
+  {
+    inst->squashed = true;
+    Retire(inst, "X");
+    squashed_instructions++;
+  }
+  fetch_queue.clear();
+
+  for (auto & rs : RS)
+  {
+    if (rs.busy && IsYounger(rs.rob, seq))
+      rs = RS_Entry();
+  }
+
+  while (rob_count > 0)
+  {
+    auto tail = (rob_head + rob_count - 1) % ROB.size();
+    auto & entry = ROB[tail];
+    if (!IsYounger(tail, seq))
+      break;
+    entry.instruction->squashed = true;
+    Retire(entry.instruction, "X");
+    squashed_instructions++;
+    //the load/store queue is in program order, younger entries are at its tail
+    if (entry.lsq != -1)
+    {
+      LSQ[entry.lsq] = LSQ_Entry();
+      lsq_count--;
+    }
+    entry = ROB_Entry();
+    rob_count--;
+  }
+
+  RebuildRenameTable();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Flush                                           */
+/*                                                             */
+/* Purpose   : Drop every instruction that has not committed   */
+/*             and fetch again from the PC in State. Nothing   */
+/*             uncommitted has written the registers or        */
+/*             memory, so State holds the whole architectural  */
+/*             state.                                          */
+/*                                                             */
+/***************************************************************/
+void OutOfOrderCore::Flush()
+{
+  cycle = simulator().GetCycles();
+  for (auto & inst : fetch_queue)
+  {
+    inst->squashed = true;
+    Retire(inst, "X");
+  }
+  fetch_queue.clear();
+  for (auto i = 0; i < rob_count; i++)
+  {
+    auto & inst = ROB[(rob_head + i) % ROB.size()].instruction;
+    inst->squashed = true;
+    Retire(inst, "X");
+  }
+
+  ROB = std::vector<ROB_Entry>(ROB.size(), ROB_Entry());
+  RS = std::vector<RS_Entry>(RS.size(), RS_Entry());
+  LSQ = std::vector<LSQ_Entry>(LSQ.size(), LSQ_Entry());
+  rob_head = rob_count = 0;
+  lsq_head = lsq_count = 0;
+  for (auto & tag : rename_table)
+    tag = NO_TAG;
+
+  fetch_pc = simulator().state().GetProgramCounter();
+  fetch_blocked = false;
+}
+
+void OutOfOrderCore::RebuildRenameTable()
+{
+  for (auto & tag : rename_table)
+    tag = NO_TAG;
+
+  for (auto i = 0; i < rob_count; i++)
+  {
+    auto tag = (rob_head + i) % ROB.size();
+    auto & entry = ROB[tag];
+    if (entry.ld_reg)
+      rename_table[entry.instruction->DRID.to_num()] = tag;
+    if (entry.ld_cc)
+      rename_table[RENAME_CC] = tag;
+  }
+}
+
+/************************* Issue() *************************/
+/*
+* Send the oldest reservation stations with all operands captured to
+* the execution units, one per issue lane
+*/
+void OutOfOrderCore::Issue()
+{
+  for (auto issued = 0; issued < width; issued++)
+  {
+    RS_Entry * oldest = nullptr;
+    for (auto & rs : RS)
+    {
+      if (!rs.busy || rs.sr1_tag != NO_TAG || rs.sr2_tag != NO_TAG || rs.cc_tag != NO_TAG)
+        continue;
+      if (!oldest || ROB[rs.rob].instruction->seq < ROB[oldest->rob].instruction->seq)
+        oldest = &rs;
+    }
+    if (!oldest)
+      break;
+
+    Execute(*oldest);
+    *oldest = RS_Entry();
+  }
+}
+
+/*
+* The execute stage datapath, shared with the AGEX stage of the pipeline.
+* Loads and stores only generate their address here.
+*/
+void OutOfOrderCore::Execute(RS_Entry & rs)
+{
+  auto & entry = ROB[rs.rob];
+  auto inst = entry.instruction;
+  auto latency = simulator().config().agex_stages;
+
+  inst->ADDRESS = AddressUnit(*inst).Output();
+  inst->ALU_RESULT = OperationUnit::MakeUnit(*inst)->Output();
+  inst->current_stage = "E";
+
+  if (entry.lsq != -1)
+  {
+    auto & lsq = LSQ[entry.lsq];
+    lsq.address_ready = true;
+    lsq.ready_cycle = cycle + latency;
+    //a load finishes once its data arrives
+    if (!lsq.store)
+      return;
+  }
+  entry.executing = true;
+  entry.complete_cycle = cycle + latency;
+}
+
+/************************* MemoryAccess() *************************/
+/*
+* Loads whose address is known read the data cache through its single
+* port, or take the data of an older store to the same address. A load
+* waits while an older store has no address yet or only partly overlaps.
+*/
+void OutOfOrderCore::MemoryAccess()
+{
+  auto & memory = simulator().memory();
+  auto port_busy = false;
+
+  for (auto i = 0; i < lsq_count; i++)
+  {
+    auto & load = LSQ[(lsq_head + i) % LSQ.size()];
+    if (load.store || load.accessed || !load.address_ready || load.ready_cycle > cycle)
+      continue;
+    auto & entry = ROB[load.rob];
+    auto inst = entry.instruction;
+    auto address = inst->ADDRESS.to_num();
+
+    //the youngest older store to the same word decides
+    auto blocked = false, forwarded = false;
+    for (auto j = i - 1; j >= 0; j--)
+    {
+      auto & older = LSQ[(lsq_head + j) % LSQ.size()];
+      if (!older.store)
+        continue;
+      if (!older.address_ready || older.ready_cycle > cycle)
+      {
+        blocked = true;
+        break;
+      }
+      auto store_inst = ROB[older.rob].instruction;
+      auto store_address = store_inst->ADDRESS.to_num();
+      if ((store_address >> 1) != (address >> 1))
+        continue;
+      if (older.word == load.word && store_address == address)
+      {
+        forwarded = true;
+        inst->DATA = LoadData(inst->ADDRESS, load.word, StoreData(store_inst->ADDRESS, older.word, store_inst->ALU_RESULT));
+      }
+      else
+        blocked = true;
+      break;
+    }
+
+    if (blocked)
+    {
+      load_blocked_cycles++;
+      continue;
+    }
+
+    auto latency = 1;
+    if (forwarded)
+      loads_forwarded++;
+    else
+    {
+      if (port_busy)
+        continue;
+      port_busy = true;
+
+      bits16 MDR_OUT;
+      bool data_cache_r = false;
+      memory.dcache_access(inst->ADDRESS, MDR_OUT, 0, data_cache_r, 0, 0);
+      if (!data_cache_r)
+        continue;
+      inst->DATA = LoadData(inst->ADDRESS, load.word, MDR_OUT);
+      latency = simulator().config().mem_stages;
+    }
+
+    load.accessed = true;
+    entry.executing = true;
+    entry.complete_cycle = cycle + latency;
+    inst->current_stage = "M";
+    inst->mem_addr = address;
+    inst->mem_addr_valid = true;
+  }
+}
+
+/*
+* Rename a source: the value comes from the register file when nothing
+* in flight writes it, from the reorder buffer when the producer is done,
+* otherwise the reservation station waits for the returned tag.
+*/
+int OutOfOrderCore::ReadOperand(int reg, bits16 & value)
+{
+  auto & cpu_state = simulator().state();
+  auto tag = rename_table[reg];
+
+  if (tag == NO_TAG)
+  {
+    if (reg == RENAME_CC)
+      value = cpu_state.GetNZP().to_num();
+    else
+      value = cpu_state.GetRegisterData(reg);
+    return NO_TAG;
+  }
+
+  if (ROB[tag].done)
+  {
+    value = (reg == RENAME_CC) ? ROB[tag].nzp.to_num() : ROB[tag].value.to_num();
+    return NO_TAG;
+  }
+  return tag;
+}
+
+/************************* Dispatch() *************************/
+/*
+* Decode and rename instructions from the fetch queue in program order
+* into the reorder buffer, a reservation station and, for memory
+* instructions, the load/store queue
+*/
+void OutOfOrderCore::Dispatch()
+{
+  auto & micro_seq = simulator().microsequencer();
+  auto fetch_stages = simulator().config().fetch_stages;
+
+  for (auto n = 0; n < width && !fetch_queue.empty(); n++)
+  {
+    auto inst = fetch_queue.front();
+    if (cycle - inst->fetch_cycle < fetch_stages)
+      break;
+
+    auto & ucode = micro_seq.GetMicroCodeFor(inst->IR);
+    auto memory_op = micro_seq.Get_DE_DCACHE_EN(ucode);
+
+    if (rob_count == (int)ROB.size())
+    {
+      rob_full_stalls++;
+      break;
+    }
+    auto rs = std::find_if(RS.begin(), RS.end(), [](const RS_Entry & e) { return !e.busy; });
+    if (rs == RS.end())
+    {
+      rs_full_stalls++;
+      break;
+    }
+    if (memory_op && lsq_count == (int)LSQ.size())
+    {
+      lsq_full_stalls++;
+      break;
+    }
+    fetch_queue.pop_front();
+
+    // Propagate control signals to instruction
+    inst->AGEX_CS.range<19,0>() = ucode.range<22,3>();
+    inst->MEM_CS.range<10,0>() = inst->AGEX_CS.range<19,9>();
+    inst->SR_CS = inst->MEM_CS.range<10,7>();
+    if (micro_seq.Get_DRMUX(ucode))
+      inst->DRID = 0x7;
+    else
+      inst->DRID = inst->IR.range<11,9>();
+
+    //sources are renamed before the destination
+    bits3 sr1 = inst->IR.range<8,6>();
+    bits3 sr2;
+    if (inst->IR[13])
+      sr2 = inst->IR.range<11,9>();
+    else
+      sr2 = inst->IR.range<2,0>();
+
+    if (micro_seq.Get_SR1_NEEDED(ucode))
+      rs->sr1_tag = ReadOperand(sr1.to_num(), inst->SR1);
+    if (micro_seq.Get_SR2_NEEDED(ucode))
+      rs->sr2_tag = ReadOperand(sr2.to_num(), inst->SR2);
+    if (micro_seq.Get_DE_BR_OP(ucode))
+    {
+      bits16 cc;
+      rs->cc_tag = ReadOperand(RENAME_CC, cc);
+      inst->CC = cc.to_num();
+    }
+
+    auto tag = (rob_head + rob_count) % ROB.size();
+    auto & entry = ROB[tag];
+    entry = ROB_Entry();
+    entry.instruction = inst;
+    entry.valid = true;
+    entry.ld_reg = micro_seq.Get_DE_LD_REG(ucode);
+    entry.ld_cc = micro_seq.Get_DE_LD_CC(ucode);
+    entry.control = micro_seq.Get_DE_BR_STALL(ucode);
+    if (entry.ld_reg)
+      rename_table[inst->DRID.to_num()] = tag;
+    if (entry.ld_cc)
+      rename_table[RENAME_CC] = tag;
+    rob_count++;
+
+    if (memory_op)
+    {
+      auto index = (lsq_head + lsq_count) % LSQ.size();
+      LSQ[index] = LSQ_Entry();
+      LSQ[index].valid = true;
+      LSQ[index].rob = tag;
+      LSQ[index].store = micro_seq.Get_DCACHE_RW(inst->MEM_CS);
+      LSQ[index].word = micro_seq.Get_DATA_SIZE(inst->MEM_CS);
+      entry.lsq = index;
+      lsq_count++;
+    }
+
+    rs->busy = true;
+    rs->rob = tag;
+    inst->current_stage = "D";
+  }
+}
+
+/************************* Fetch() *************************/
+/*
+* Fetch up to one instruction per lane into the fetch queue. A fetch
+* group ends at a predicted taken control instruction, and without a
+* predictor the front end stops at every control instruction.
+*/
+void OutOfOrderCore::Fetch()
+{
+  auto & memory = simulator().memory();
+  auto & predictor = simulator().predictor();
+  auto & micro_seq = simulator().microsequencer();
+
+  //PC x0000 is the halt vector
+  if (fetch_blocked || fetch_pc.to_num() == 0)
+    return;
+
+  for (auto lane = 0; lane < width; lane++)
+  {
+    if ((int)fetch_queue.size() >= fetch_queue_depth)
+      break;
+
+    bits16 instruction;
+    bool icache_r = false;
+    memory.icache_access(fetch_pc, instruction, icache_r);
+    if (!icache_r)
+      break;
+
+    auto inst = Instruction::Create(simulator(), instruction);
+    inst->PC = fetch_pc;
+    inst->NPC = fetch_pc + 2;
+    inst->seq = fetch_seq++;
+    inst->fetch_cycle = cycle;
+    inst->current_stage = "F";
+    if (predictor.IsEnabled())
+      inst->PRED_PC = predictor.Predict(inst->PC, inst->IR, inst->ras_checkpoint);
+    else
+      inst->PRED_PC = inst->NPC;
+    fetch_queue.push_back(inst);
+
+    fetch_pc = inst->PRED_PC;
+    if (!predictor.IsEnabled() && micro_seq.Get_DE_BR_STALL(micro_seq.GetMicroCodeFor(instruction)))
+    {
+      fetch_blocked = true;
+      break;
+    }
+    if (fetch_pc.to_num() != inst->NPC.to_num())
+      break;
+  }
+}
+
+/*
+* Record the stage of every instruction in flight, a "*" marks a
+* cycle spent waiting in the same stage
+*/
+void OutOfOrderCore::UpdateHistory()
+{
+  auto record = [&](const std::shared_ptr<Instruction> & inst) {
+    auto stage = inst->current_stage;
+    auto previous = inst->cycle_history.find(cycle - 1);
+    if (previous != inst->cycle_history.end() && previous->second.compare(0, stage.size(), stage) == 0)
+      stage += "*";
+    inst->cycle_history[cycle] = stage;
+  };
+
+  for (auto & inst : fetch_queue)
+    record(inst);
+  for (auto i = 0; i < rob_count; i++)
+    record(ROB[(rob_head + i) % ROB.size()].instruction);
+}
+
+/*
+* Timing diagram of the instructions that left the core since the last
+* dump, followed by those still in flight
+*/
+void OutOfOrderCore::idump(FILE * dumpsim_file)
+{
+  auto traces = instruction_history;
+  for (auto i = 0; i < rob_count; i++)
+    traces.push_back(TraceOf(*ROB[(rob_head + i) % ROB.size()].instruction));
+  for (auto & inst : fetch_queue)
+    traces.push_back(TraceOf(*inst));
+  std::sort(traces.begin(), traces.end(),
+            [](const InstructionTrace & a, const InstructionTrace & b) { return a.seq < b.seq; });
+
+  PipeLine::PrintTimingDiagram(simulator().console(), dumpsim_file, traces, simulator().GetCycles());
+  instruction_history.clear();
+}
+
+void OutOfOrderCore::DumpHistory()
+{
+  // This function is called ONCE at the end of the simulation
+  if (simulator().dumpfile() != nullptr)
+    idump(simulator().dumpfile());
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the core counters.                     */
+/*                                                             */
+/***************************************************************/
+void OutOfOrderCore::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("ooo.retired", "instructions committed", retired_instructions);
+  stats.AddScalar("ooo.rob.occupancy", "sum of the ROB entries in use each cycle", rob_occupancy);
+  stats.AddFormula("ooo.rob.average_occupancy", "ROB entries in use per cycle", [this, &stats]() {
+    auto cycles = stats.GetCycles();
+    return cycles ? (double)rob_occupancy / cycles : 0.0;
+  });
+  stats.AddScalar("ooo.dispatch_stalls.rob_full", "dispatch held by a full ROB", rob_full_stalls);
+  stats.AddScalar("ooo.dispatch_stalls.rs_full", "dispatch held by full reservation stations", rs_full_stalls);
+  stats.AddScalar("ooo.dispatch_stalls.lsq_full", "dispatch held by a full LSQ", lsq_full_stalls);
+  stats.AddScalar("ooo.lsq.loads_forwarded", "loads forwarded from an older store", loads_forwarded);
+  stats.AddScalar("ooo.lsq.load_blocked_cycles", "cycles a ready load waited on an older store", load_blocked_cycles);
+  stats.AddScalar("ooo.flushes", "mispredictions recovered", flushes);
+  stats.AddScalar("ooo.squashed", "instructions squashed", squashed_instructions);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the core statistics to the output file.    */
+/*                                                             */
+/***************************************************************/
+void OutOfOrderCore::dump(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  auto cycles = simulator().GetCycles();
+
+  PRINT_AND_DUMP("\nOut-of-order core (width %d) :\n", width);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  PRINT_AND_DUMP("Retired instructions : %llu\n", (unsigned long long)retired_instructions);
+  PRINT_AND_DUMP("IPC                  : %.3f\n", cycles ? (double)retired_instructions / cycles : 0.0);
+  PRINT_AND_DUMP("ROB / RS / LSQ       : %d / %d / %d entries\n", (int)ROB.size(), (int)RS.size(), (int)LSQ.size());
+  PRINT_AND_DUMP("Average ROB occupancy: %.2f\n", cycles ? (double)rob_occupancy / cycles : 0.0);
+  PRINT_AND_DUMP("Dispatch stalls      : %llu ROB full, %llu RS full, %llu LSQ full\n", (unsigned long long)rob_full_stalls,
+                 (unsigned long long)rs_full_stalls, (unsigned long long)lsq_full_stalls);
+  PRINT_AND_DUMP("Loads forwarded      : %llu\n", (unsigned long long)loads_forwarded);
+  PRINT_AND_DUMP("Load blocked cycles  : %llu\n", (unsigned long long)load_blocked_cycles);
+  PRINT_AND_DUMP("Flushes              : %llu (%llu instructions squashed)\n", (unsigned long long)flushes,
+                 (unsigned long long)squashed_instructions);
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
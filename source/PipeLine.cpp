@@ -3,43 +3,109 @@
 /***************************************************************/
 
 #include <cstring>
+#include <algorithm>
 #include <assert.h>
 #ifdef __linux__
     #include "../include/Simulator.h"
     #include "../include/State.h"
     #include "../include/MicroSequencer.h"
     #include "../include/MainMemory.h"
+    #include "../include/BranchPredictor.h"
+    #include "../include/StoreBuffer.h"
     #include "../include/Latch.h"
     #include "../include/OperationUnit.h"
     #include "../include/PipeLine.h"
     //#include "../include/instruction.h"
     #include "../include/Disassembler.h"
+    #include "../include/Statistics.h"
+    #include "../include/InstructionMix.h"
+    #include "../include/Checkpoint.h"
+    #include "../include/GoldenChecker.h"
+    #include "../include/EventQueue.h"
+    #include "../include/IntervalModel.h"
 #else
     #include "Simulator.h"
     #include "State.h"
     #include "MicroSequencer.h"
     #include "MainMemory.h"
+    #include "BranchPredictor.h"
+    #include "StoreBuffer.h"
     #include "Latch.h"
     #include "OperationUnit.h"
     #include "PipeLine.h"
     //#include "instruction.h"
     #include "Disassembler.h"
+    #include "Statistics.h"
+    #include "InstructionMix.h"
+    #include "Checkpoint.h"
+    #include "GoldenChecker.h"
+    #include "EventQueue.h"
+    #include "IntervalModel.h"
 #endif
 
 /*
 * //TODO
 */
-PipeLine::PipeLine(Simulator & instance) : _simulator(instance)
+PipeLine::PipeLine(Simulator & instance) :
+_simulator(instance),
+fetch_seq(0),
+retired_instructions(0),
+resolve_stage(MEMORY),
+early_resolved(0),
+resolve_cycles_saved(0),
+fusion_enabled(false),
+branches_issued(0),
+fused_branches(0),
+fusion_cycles_saved(0),
+dcache_port_busy(false),
+loads_past_miss(0),
+pending_load_stalls(0),
+fetch_queue_depth(0),
+fetch_queue_full(false),
+fetch_queue_control(false)
 {
-  PS = PipeState(NUM_OF_LATCHES);
-  NEW_PS = PipeState(NUM_OF_LATCHES);
+  current_lane = 0;
+  BuildLatches(1, 1, 1, 1);
+  instruction_history.reserve(100); // Pre-allocate space for performance
+}
+
+/*
+* Lay out the latches for the configured depth of each stage:
+* [F2..Fn] DE [E1..En] [M1..Mn] SR, width latches per position
+*/
+void PipeLine::BuildLatches(int fetch_stages, int agex_stages, int mem_stages, int width)
+{
+  static const char * stage_names[] = { "D", "E", "M", "S" };
+  int depth[NUM_OF_LATCHES] = { fetch_stages, agex_stages, mem_stages, 1 };
+
+  stage_latch = std::vector<int>(NUM_OF_LATCHES);
+  latch_name.clear();
+  fetch_name = (fetch_stages > 1) ? "F1" : "F";
+  for(auto i = 2; i <= fetch_stages; i++)
+    latch_name.push_back("F" + std::to_string(i));
+
+  for(auto stage = 0; stage < NUM_OF_LATCHES; stage++)
+  {
+    // the extra fetch cycles were laid out in front of decode
+    auto sub_stages = (stage == DECODE) ? 1 : depth[stage];
+    for(auto i = 1; i <= sub_stages; i++)
+    {
+      std::string name = stage_names[stage];
+      if(sub_stages > 1)
+        name += std::to_string(i);
+      latch_name.push_back(name);
+    }
+    stage_latch[stage] = latch_name.size() - 1;
+  }
 
-  for(auto i = 0; i < NUM_OF_LATCHES; i++)
+  issue_width = width;
+  PS = PipeState(latch_name.size() * width);
+  NEW_PS = PipeState(latch_name.size() * width);
+  for(size_t i = 0; i < PS.size(); i++)
   {
     PS.at(i) = std::make_shared<Latch>();
     NEW_PS.at(i) = std::make_shared<Latch>();
   }
-  instruction_history.reserve(100); // Pre-allocate space for performance
 }
 
 /***************************************************************/
@@ -51,8 +117,58 @@ PipeLine::PipeLine(Simulator & instance) : _simulator(instance)
 /***************************************************************/
 void PipeLine::init_pipeline()
 {
+  auto & config = simulator().config();
+
   SetStage(UNDEFINED);
+  SetLane(0);
+  BuildLatches(config.fetch_stages, config.agex_stages, config.mem_stages, config.issue_width);
   instruction_history.clear();
+  fetch_seq = 0;
+  retired_instructions = 0;
+  issued_this_cycle = 0;
+  for(auto i = 0; i <= MAX_ISSUE_WIDTH; i++)
+    issue_cycles[i] = 0;
+  for(auto i = 0; i < NUM_PAIR_CONFLICTS; i++)
+    pair_conflicts[i] = 0;
+  dep_on_cc = false;
+  pair_dep_stall = false;
+  pair_on_cc = false;
+  resolved_stage = UNDEFINED;
+  owed_bubbles.clear();
+  for(auto i = 0; i < NUM_CPI_CAUSES; i++)
+    cpi_stack[i] = 0;
+
+  scoreboard = 0;
+  for(auto name = 0; name < SCOREBOARD_NAMES; name++)
+    scoreboard_writers[name] = 0;
+
+  resolve_stage = config.resolve_stage;
+  early_resolved = 0;
+  resolve_cycles_saved = 0;
+
+  fusion_enabled = config.macro_fusion;
+  branches_issued = 0;
+  fused_branches = 0;
+  fusion_cycles_saved = 0;
+
+  pending_loads.clear();
+  pending_stage.clear();
+  loads_past_miss = 0;
+  pending_load_stalls = 0;
+
+  fetch_queue_depth = config.fetch_queue_entries;
+  fetch_queue.clear();
+  fetch_queue_full = false;
+  fetch_queue_control = false;
+  queue_stage.clear();
+  queue_occupancy = std::vector<uint64_t>(fetch_queue_depth + 1, 0);
+  hidden_fetch_stalls = 0;
+  decoupled_fetch_cycles = 0;
+
+  signature.clear();
+  last_signature.clear();
+  idle = false;
+  idle_fetches = 0;
 }
 
 /***************************************************************/
@@ -63,11 +179,20 @@ void PipeLine::init_pipeline()
 /*                                                             */
 /***************************************************************/
 void PipeLine::idump(FILE * dumpsim_file)
+{
+  PrintTimingDiagram(simulator().console(), dumpsim_file, instruction_history, simulator().GetCycles());
+}
+
+/*
+* Print one row per instruction with the stage it occupied in each cycle.
+* Rows of retired or squashed instructions are removed once printed.
+*/
+void PipeLine::PrintTimingDiagram(FILE * console, FILE * dumpsim_file, std::vector<InstructionTrace> & instruction_history, int current_cycle)
 {
   // Helper macro to print to both terminal and file, removing redundancy.
   #define PRINT_AND_DUMP(...) \
       do { \
-          printf(__VA_ARGS__); \
+          if (console) { fprintf(console, __VA_ARGS__); } \
           if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
       } while (0)
 
@@ -75,7 +200,6 @@ void PipeLine::idump(FILE * dumpsim_file)
   const int INST_COL_WIDTH = 30;
   const int MEM_ADDR_COL_WIDTH = 10;
   const int CYCLE_COL_WIDTH = 5;
-  int current_cycle = simulator().GetCycles();
 
   // Header
   PRINT_AND_DUMP("\n%-*s| %-*s| %-*s", PC_COL_WIDTH, "PC", INST_COL_WIDTH, "Instruction", MEM_ADDR_COL_WIDTH, "Mem Addr");
@@ -116,8 +240,9 @@ void PipeLine::idump(FILE * dumpsim_file)
               auto it = inst_trace.cycle_history.find(i);
               if (it != inst_trace.cycle_history.end()) {
                   stage_char = it->second;
-                  // If the instruction just completed the Store stage, mark it as retired for the *next* cycle.
-                  if (it->second == "S") {
+                  // If the instruction just completed the Store stage or was squashed,
+                  // mark it as retired for the *next* cycle.
+                  if (it->second == "S" || it->second == "X") {
                     retired = true;
                   }
               }
@@ -149,38 +274,143 @@ void PipeLine::idump(FILE * dumpsim_file)
 /***************************************************************/
 void PipeLine::Cycle()
 {
+  auto fetch_seq_before = fetch_seq;
   // 1. Simulate all stages to determine the state of NEW_PS
   PropagatePipeLine();
   // 2. Record what happened in this cycle based on PS and NEW_PS
   UpdateHistory();
   // 3. Advance the pipeline by committing the new state
   MoveLatch(PS, NEW_PS);
+  // 4. A cycle that ends as it started repeats until the next event,
+  //    without one waiting nothing would end the repetition
+  if (simulator().events().IsWaiting(simulator().GetCycles() + 1))
+  {
+    Signature(signature);
+    idle = signature == last_signature;
+    last_signature.swap(signature);
+    idle_fetches = fetch_seq - fetch_seq_before;
+  }
+  else if (idle || !last_signature.empty())
+  {
+    last_signature.clear();
+    idle = false;
+  }
+}
+
+/*
+* What the next cycle depends on apart from the cycle count: the latches,
+* the queues, the scoreboard and the PC. A valid latch is known by its
+* instruction, a bubble by the instruction bits it carries, as a stalled
+* fetch makes a new bubble every cycle.
+*/
+void PipeLine::Signature(std::vector<uintptr_t> & signature)
+{
+  auto & cpu_state = simulator().state();
+
+  signature.clear();
+  for (auto & entry : PS)
+  {
+    auto inst = entry->instruction.get();
+    signature.push_back(entry->V);
+    if (entry->V || !inst)
+      signature.push_back((uintptr_t)inst);
+    else
+      signature.push_back((inst->PC.to_num() << 17) | (inst->IR.to_num() << 1) | inst->squashed);
+  }
+  for (auto & queued : fetch_queue)
+    signature.push_back((uintptr_t)queued.get());
+  signature.push_back(fetch_queue.size());
+  signature.push_back(fetch_queue_full);
+  signature.push_back(pending_loads.size());
+  if (!pending_loads.empty())
+    signature.push_back(pending_loads.front().ld_reg << 1 | pending_loads.front().ld_cc);
+  signature.push_back(simulator().storebuffer().Entries().size());
+  signature.push_back(owed_bubbles.size());
+  if (!owed_bubbles.empty())
+    signature.push_back(owed_bubbles.front());
+  signature.push_back(scoreboard);
+  signature.push_back(retired_instructions);
+  signature.push_back(cpu_state.GetProgramCounter().to_num());
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : SkipIdle                                        */
+/*                                                             */
+/* Purpose   : Record cycles more cycles like the idle one     */
+/*             just simulated: every row of the timing diagram */
+/*             repeats its last stage, and the stalled fetch   */
+/*             numbers the bubbles it would have made.         */
+/*                                                             */
+/***************************************************************/
+void PipeLine::SkipIdle(int cycles)
+{
+  auto last = simulator().GetCycles() - 1;
+
+  for (auto & inst_trace : instruction_history)
+  {
+    auto entry = inst_trace.cycle_history.find(last);
+    if (entry == inst_trace.cycle_history.end() || entry->second == " ")
+      continue;
+    for (auto cycle = last + 1; cycle <= last + cycles; cycle++)
+      inst_trace.cycle_history[cycle] = entry->second;
+  }
+
+  for (auto & entry : PS)
+  {
+    auto & inst = entry->instruction;
+    if (!inst || !entry->V)
+      continue;
+    auto stage = inst->cycle_history.find(last);
+    if (stage == inst->cycle_history.end())
+      continue;
+    for (auto cycle = last + 1; cycle <= last + cycles; cycle++)
+      inst->cycle_history[cycle] = stage->second;
+  }
+
+  fetch_seq += idle_fetches * cycles;
 }
 
 void PipeLine::MoveLatch(const PipeState & destination, const PipeState & source)
 {
-  for(auto i = 0; i < NUM_OF_LATCHES; i++)
+  for(size_t i = 0; i < destination.size(); i++)
   {
     *destination.at(i) = *source.at(i);
   }
 }
 
+/*
+* The latch the logic of the stage works on, in the current lane
+*/
 Latch & PipeLine::latch(Stages stage, const PipeState & latch)
 {
   switch (stage)
   {
   case DECODE:
-    return *latch.at(0);
-    break;
   case AGEX:
-    return *latch.at(1);
-    break;
   case MEMORY:
-    return *latch.at(2);
-    break;
   case STORE:
-    return *latch.at(3);
+    return *latch.at(LatchIndex(stage_latch[stage]));
+  default:
+    throw std::runtime_error("Invalid stage for latch access"); // Should not happen
     break;
+  }
+}
+
+/*
+* The first latch of the stage, loaded by the stage in front of it,
+* in the current lane
+*/
+Latch & PipeLine::entry_latch(Stages stage, const PipeState & latch)
+{
+  switch (stage)
+  {
+  case DECODE:
+    return *latch.at(LatchIndex(0));
+  case AGEX:
+  case MEMORY:
+  case STORE:
+    return *latch.at(LatchIndex(stage_latch[stage - 1] + 1));
   default:
     throw std::runtime_error("Invalid stage for latch access"); // Should not happen
     break;
@@ -211,10 +441,146 @@ bool PipeLine::IsMemoryMoveInstruction()
 bool PipeLine::IsBranchTaken()
 {
   //TODO: finish the implementation of the branch logic
-  auto & memory_sig = simulator().state().MemSignals();
+  auto & memory_sig = simulator().state().MemSignals(BranchLane());
   return (memory_sig.mem_pc_mux.to_num() != 0);
 }
 
+/*
+* The lane of the MEM stage that writes the PC, lane 0 if none does
+*/
+int PipeLine::BranchLane()
+{
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    if(simulator().state().MemSignals(lane).mem_pc_mux.to_num() != 0)
+      return lane;
+  }
+  return 0;
+}
+
+/*
+* With speculative fetch, a non-zero PC mux out of the MEM stage means the
+* instruction there was mispredicted and the younger stages hold a wrong path.
+*/
+bool PipeLine::IsRedirectDetected()
+{
+  return simulator().predictor().IsEnabled() && IsBranchTaken();
+}
+
+bool PipeLine::IsRedirectDetected(int lane)
+{
+  return simulator().predictor().IsEnabled() &&
+         simulator().state().MemSignals(lane).mem_pc_mux.to_num() != 0;
+}
+
+/*
+* Compare the resolved next PC of the instruction in the MEM stage with the
+* address the fetch stage predicted for it and train the predictor. Only a
+* misprediction leaves a redirect on the memory signals.
+*/
+void PipeLine::ResolveControl(std::shared_ptr<Instruction> inst)
+{
+  auto & memory_sig = simulator().state().MemSignals(current_lane);
+  auto & micro_seq = simulator().microsequencer();
+  auto & predictor = simulator().predictor();
+
+  bits16 actual_pc;
+  switch (memory_sig.mem_pc_mux.to_num())
+  {
+    case 1:
+      actual_pc = memory_sig.target_pc;
+      break;
+    case 2:
+      actual_pc = memory_sig.trap_pc;
+      break;
+    default:
+      actual_pc = inst->NPC;
+      break;
+  }
+
+  auto mispredicted = actual_pc.to_num() != inst->PRED_PC.to_num();
+  if (micro_seq.Get_MEM_BR_STALL(inst->MEM_CS))
+  {
+    auto taken = memory_sig.mem_pc_mux.to_num() != 0;
+    predictor.Update(inst->PC, inst->IR, micro_seq.Get_BR_OP(inst->MEM_CS), taken, actual_pc, mispredicted, inst->ras_checkpoint);
+  }
+
+  if (mispredicted)
+  {
+    predictor.Recover(inst->ras_checkpoint, inst->PC, inst->IR);
+    memory_sig.target_pc = actual_pc;
+    memory_sig.mem_pc_mux = 1;
+  }
+  else
+    memory_sig.mem_pc_mux = 0;
+}
+
+/*
+* Branch logic of the stage that resolves the instruction inst. Drive the
+* PC mux of its lane from the condition codes and the control signals,
+* with speculative fetch only a misprediction is left on the PC mux.
+*/
+void PipeLine::BranchLogic(std::shared_ptr<Instruction> inst)
+{
+  auto & memory_sig = simulator().state().MemSignals(current_lane);
+  auto & micro_seq = simulator().microsequencer();
+
+  memory_sig.target_pc = inst->ADDRESS;
+  memory_sig.mem_pc_mux = 0; //branch not taken
+  if(micro_seq.Get_BR_OP(inst->MEM_CS))
+  {
+    bits3 br_intr_nzp = inst->IR.range<11,9>();
+    bits3 cpu_nzp = inst->CC;
+    if(((br_intr_nzp[2] & cpu_nzp[2]) == 1) || // N
+       ((br_intr_nzp[1] & cpu_nzp[1]) == 1) || // Z
+       ((br_intr_nzp[0] & cpu_nzp[0]) == 1))   // P
+       {
+         memory_sig.mem_pc_mux = 1; //branch taken, jump to target PC
+       }
+  }
+  else if (micro_seq.Get_UNCOND_OP(inst->MEM_CS))
+    memory_sig.mem_pc_mux = 1; //JMP, JSR and JSRR always jump to target PC
+  else if (micro_seq.Get_TRAP_OP(inst->MEM_CS))
+    memory_sig.mem_pc_mux = 2; //trap was triggered
+
+  //the CPI stack charges the refill of the front end to this stage
+  if(micro_seq.Get_DE_BR_STALL(micro_seq.GetMicroCodeFor(inst->IR)))
+    resolved_stage = current_stage;
+
+  //with speculative fetch, check the prediction made for this instruction
+  if(simulator().predictor().IsEnabled())
+    ResolveControl(inst);
+}
+
+/*
+* The stage whose branch logic selects the next PC after inst. TRAP waits
+* for the vector read in MEM, and a fused branch only has its condition
+* codes once the ALU op in front of it went through AGEX.
+*/
+Stages PipeLine::ResolveStage(const Instruction & inst)
+{
+  auto & micro_seq = simulator().microsequencer();
+  auto & ucode = micro_seq.GetMicroCodeFor(inst.IR);
+  if(!micro_seq.Get_DE_BR_STALL(ucode) || micro_seq.Get_DE_TRAP_OP(ucode))
+    return MEMORY;
+  if(inst.FUSED_ALU && resolve_stage == DECODE)
+    return AGEX;
+  return resolve_stage;
+}
+
+/*
+* Decode cannot take new instructions. With a fetch queue, fetch only
+* stops once the queue has no room for another fetch group.
+*/
+bool PipeLine::IsBackEndStallDetected()
+{
+  auto & stall = simulator().state().Stall();
+
+  if (fetch_queue_depth)
+    return fetch_queue_full;
+  return stall.dep_stall || stall.pair_stall || stall.mem_stall;
+}
+
 /*
 * Logic to detect if any stall in the pipline
 */
@@ -222,18 +588,29 @@ bool PipeLine::IsStallDetected()
 {
   auto & stall = simulator().state().Stall();
 
+  // With speculative fetch, control instructions do not hold the front end.
+  // A redirect from the MEM stage overrides any stall caused by the wrong path.
+  if (simulator().predictor().IsEnabled())
+  {
+    if (IsRedirectDetected())
+      return false;
+    return !stall.icache_r || IsBackEndStallDetected();
+  }
+
   // Any stall signals asserted or instruction cache is not ready.
   // For control instructions, pipeline needs to wait until the
   // branch logic unit completes the calculation of the next PC.
 
   if (stall.icache_r &&
-      !stall.dep_stall &&
-      !stall.mem_stall &&
+      !IsBackEndStallDetected() &&
+      !fetch_queue_control &&
       !stall.v_agex_br_stall &&
       !stall.v_de_br_stall &&
-      !stall.v_mem_br_stall)
+      !stall.v_mem_br_stall &&
+      !stall.v_sub_br_stall &&
+      !stall.v_resolve_br_stall)
     return false;
-  else if(stall.v_mem_br_stall && IsBranchTaken())
+  else if(stall.v_resolve_br_stall && IsBranchTaken())
     return false;
   else
     return true;
@@ -245,8 +622,7 @@ bool PipeLine::IsStallDetected()
 void PipeLine::ProcessRegisterFile(const bits16 & de_instruction)
 {
   auto & cpu_state = simulator().state();
-  auto & decode_sigs = cpu_state.DecodeSignals();
-  auto & store_signals = cpu_state.SrSignals();
+  auto & decode_sigs = cpu_state.DecodeSignals(current_lane);
 
   // select the sr2 register based on the type
   // of access: register or immediate
@@ -263,10 +639,15 @@ void PipeLine::ProcessRegisterFile(const bits16 & de_instruction)
   decode_sigs.de_sr2_data = cpu_state.GetRegisterData(decode_sigs.de_sr2);
 
   // load processed data into destinaion
-  // register baed on ucode bit
-  if(store_signals.v_sr_ld_reg)
+  // register baed on ucode bit, one write port per lane
+  // and the youngest lane is written last
+  for(auto lane = 0; lane < issue_width; lane++)
   {
-    cpu_state.SetDataForRegister(store_signals.sr_drid, store_signals.sr_reg_data);
+    auto & store_signals = cpu_state.SrSignals(lane);
+    if(store_signals.v_sr_ld_reg)
+    {
+      cpu_state.SetDataForRegister(store_signals.sr_drid, store_signals.sr_reg_data);
+    }
   }
 }
 
@@ -288,49 +669,160 @@ bool PipeLine::CheckForDataDependencies()
   auto inst_de = de_latch.instruction;
   if(inst_de && de_latch.V)
   {
-    auto & de_sig = cpu_state.DecodeSignals();
-    auto & agex_sig = cpu_state.AgexSignals();
-    auto & mem_sig = cpu_state.MemSignals();
-    auto & sr_sig = cpu_state.SrSignals();
-
-    // Get SR1/SR2 needed bits from the control store ucode
-    auto sr1_needed = ucode.Get_SR1_NEEDED(de_sig.de_ucode);
-    auto sr2_needed = ucode.Get_SR2_NEEDED(de_sig.de_ucode);
-    auto branch_op = ucode.Get_DE_BR_OP(de_sig.de_ucode);
-
-    // To determine if a dependency exists, the Dependency Check Logic compares the
-    // destination register number of the instructions in the agex_sigs, memory_sigs, and store_signals stages
-    // to the source register numbers of the instruction in the decode_sigs stage. If a match
-    // is found and the instruction in the decode_sigs stage actually needs the source register
-    // (as indicated by the SR1.NEEDED or SR2.NEEDED control signal) and an instruction
-    // in a later stage actually writes to the same register (as indicated by the
-    // V.agex_sigs.LD.REG, V.memory_sigs.LD.REG, or V.store_signals.LD.REG signals), DEP.STALL should be set to 1
-    if(sr1_needed)
+    auto & de_sig = cpu_state.DecodeSignals(current_lane);
+
+    // Every issued instruction marks the register and the condition codes it
+    // writes on the scoreboard until it writes them back, in SR or as a load
+    // completing under a miss. Instead of comparing the sources with every
+    // stage, DEP.STALL is set when a source the instruction actually needs
+    // (SR1.NEEDED, SR2.NEEDED) is pending. A conditional branch (BR.OP) needs
+    // the condition codes, unless it is fused with the ALU op in front of it.
+    uint16_t needed = 0;
+    if(ucode.Get_SR1_NEEDED(de_sig.de_ucode))
+      needed |= 1 << de_sig.de_sr1.to_num();
+    if(ucode.Get_SR2_NEEDED(de_sig.de_ucode))
+      needed |= 1 << de_sig.de_sr2.to_num();
+    if(ucode.Get_DE_BR_OP(de_sig.de_ucode) && !inst_de->FUSED_ALU)
+      needed |= 1 << SCOREBOARD_CC;
+
+    auto pending = needed & scoreboard;
+    if(!pending)
+      return false;
+    if(current_lane == 0)
+      dep_on_cc = pending == (1 << SCOREBOARD_CC);
+    else
+      pair_on_cc = pending == (1 << SCOREBOARD_CC);
+
+    // count the cycles decode only waits on loads that left the MEM stage
+    // on a data cache miss, one leaving it this cycle is still in MEM
+    if(current_lane == 0 && !pending_loads.empty())
     {
-      if((agex_sig.v_agex_ld_reg && (de_sig.de_sr1.to_num() == agex_sig.agex_drid.to_num())) ||
-         (mem_sig.v_mem_ld_reg &&  (de_sig.de_sr1.to_num() == mem_sig.mem_drid.to_num())) ||
-         (sr_sig.v_sr_ld_reg && (de_sig.de_sr1.to_num() == sr_sig.sr_drid.to_num())))
-          return true;
+      uint8_t load_writers[SCOREBOARD_NAMES] = {};
+      for(auto & load : pending_loads)
+      {
+        auto in_mem = false;
+        for(auto lane = 0; lane < issue_width; lane++)
+        {
+          auto & memory_latch = *PS.at(stage_latch[MEMORY] * issue_width + lane);
+          in_mem = in_mem || (memory_latch.V && memory_latch.instruction == load.instruction);
+        }
+        for(auto name = 0; name < SCOREBOARD_NAMES && !in_mem; name++)
+          if(load.instruction->scoreboard & (1 << name))
+            load_writers[name]++;
+      }
+
+      auto loads_only = true;
+      for(auto name = 0; name < SCOREBOARD_NAMES; name++)
+        if((pending & (1 << name)) && load_writers[name] != scoreboard_writers[name])
+          loads_only = false;
+      if(loads_only)
+        pending_load_stalls++;
     }
+    return true;
+  }
+  return false;
+}
+
+/*
+* Mark names, a mask of registers and the condition codes, as
+* written by the issued instruction inst
+*/
+void PipeLine::ScoreboardSet(Instruction & inst, uint16_t names)
+{
+  inst.scoreboard |= names;
+  for(auto name = 0; name < SCOREBOARD_NAMES; name++)
+  {
+    if((names & (1 << name)) && scoreboard_writers[name]++ == 0)
+      scoreboard |= 1 << name;
+  }
+}
+
+/*
+* Release the names inst holds, once it wrote them back, was
+* squashed, or a younger instruction wrote them first
+*/
+void PipeLine::ScoreboardClear(Instruction & inst, uint16_t names)
+{
+  names &= inst.scoreboard;
+  inst.scoreboard &= ~names;
+  for(auto name = 0; name < SCOREBOARD_NAMES; name++)
+  {
+    if((names & (1 << name)) && --scoreboard_writers[name] == 0)
+      scoreboard &= ~(1 << name);
+  }
+}
 
-    if(sr2_needed)
+/*
+* Find the ALU op the conditional branch in decode can be fused with: the
+* instruction right in front of it in program order, if it sets the
+* condition codes from its ALU result and has not written them back yet.
+* Return the latch position of that op, or -1.
+*/
+int PipeLine::FindFusionProducer(std::shared_ptr<Instruction> & producer)
+{
+  auto & ucode = simulator().microsequencer();
+  auto inst = latch(DECODE,PS).instruction;
+  for(auto position = stage_latch[DECODE]; position <= stage_latch[STORE]; position++)
+  {
+    // in decode only an older lane is in front of the branch
+    auto lanes = (position == stage_latch[DECODE]) ? current_lane : issue_width;
+    for(auto lane = 0; lane < lanes; lane++)
     {
-      if((agex_sig.v_agex_ld_reg && (de_sig.de_sr2.to_num() == agex_sig.agex_drid.to_num())) ||
-         (mem_sig.v_mem_ld_reg &&  (de_sig.de_sr2.to_num() == mem_sig.mem_drid.to_num())) ||
-         (sr_sig.v_sr_ld_reg && (de_sig.de_sr2.to_num() == sr_sig.sr_drid.to_num())))
-          return true;
+      auto & older_latch = *PS.at(position * issue_width + lane);
+      auto older = older_latch.instruction;
+      if(!older || !older_latch.V || older->squashed || older->seq + 1 != inst->seq)
+        continue;
+
+      auto & older_ucode = ucode.GetMicroCodeFor(older->IR);
+      if(!ucode.Get_DE_LD_CC(older_ucode) || ucode.Get_DE_DR_VALUEMUX(older_ucode).to_num() != 3)
+        return -1;
+      producer = older;
+      return position;
     }
-
-    // If the instruction in the decode_sigs stage is a conditional branch instruction
-    // (as indicated by the BR.OP control signal), and if any of the instructions
-    // in the agex_sigs, memory_sigs, or store_signals stages is writing to the condition codes, then DEP.STALL
-    if(branch_op &&
-        (agex_sig.v_agex_ld_cc ||
-         mem_sig.v_mem_ld_cc ||
-         sr_sig.v_sr_ld_cc))
-         return true;
   }
-  return false;
+  return -1;
+}
+
+/*
+* Check whether the instruction in decode lane 1 can issue together with
+* the older one in lane 0. Lane 0 has already been decoded in this cycle.
+*/
+PairConflict PipeLine::CheckPairing()
+{
+  auto & cpu_state = simulator().state();
+  auto & ucode = simulator().microsequencer();
+  auto & older_latch = *PS.at(stage_latch[DECODE] * issue_width);
+  auto & younger_latch = *PS.at(stage_latch[DECODE] * issue_width + 1);
+  if(!older_latch.instruction || !older_latch.V || !younger_latch.V)
+    return PAIR_OK;
+
+  auto & older = cpu_state.DecodeSignals(0);
+  auto & younger = cpu_state.DecodeSignals(1);
+  auto older_dr = ucode.Get_DRMUX(older.de_ucode) ? 7 : older_latch.instruction->IR.range<11,9>().to_num();
+
+  if(ucode.Get_DE_LD_REG(older.de_ucode) &&
+     ((ucode.Get_SR1_NEEDED(younger.de_ucode) && younger.de_sr1.to_num() == older_dr) ||
+      (ucode.Get_SR2_NEEDED(younger.de_ucode) && younger.de_sr2.to_num() == older_dr)))
+    return PAIR_RAW;
+
+  if(ucode.Get_DE_BR_OP(younger.de_ucode) && ucode.Get_DE_LD_CC(older.de_ucode) && !younger_latch.instruction->FUSED_ALU)
+    return PAIR_CC;
+
+  if(ucode.Get_DE_DCACHE_EN(older.de_ucode) && ucode.Get_DE_DCACHE_EN(younger.de_ucode))
+    return PAIR_MEMORY_PORT;
+
+  // a memory stall of the younger lane would hold a branch that already
+  // resolved in the older lane, so only operate instructions pair behind one
+  if(ucode.Get_DE_BR_STALL(older.de_ucode) &&
+     (ucode.Get_DE_BR_STALL(younger.de_ucode) || ucode.Get_DE_DCACHE_EN(younger.de_ucode)))
+    return PAIR_BRANCH;
+
+  // a TRAP issues alone, the halt vector stops the simulation as soon as
+  // it reaches the PC and an older lane would not have written back yet
+  if(ucode.Get_DE_TRAP_OP(younger.de_ucode))
+    return PAIR_BRANCH;
+
+  return PAIR_OK;
 }
 
 /*
@@ -340,11 +832,300 @@ void PipeLine::PropagatePipeLine()
 {
   // This function just simulates the logic of each stage for one cycle.
   // It calculates the state of NEW_PS based on the state of PS.
-  SR_stage();
-  MEM_stage();
-  AGEX_stage();
-  DE_stage();
+  // Every stage runs once per lane, the older lane first.
+  auto & stall = simulator().state().Stall();
+  stall.v_de_br_stall = false;
+  stall.v_agex_br_stall = false;
+  stall.v_mem_br_stall = false;
+  stall.v_sub_br_stall = false;
+  stall.v_resolve_br_stall = false;
+  stall.pair_stall = false;
+  stall.mem_stall = false;
+  pair_dep_stall = false;
+  issued_this_cycle = 0;
+  dcache_port_busy = false;
+  resolved_stage = UNDEFINED;
+  auto retired_before = retired_instructions;
+
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    SR_stage();
+  }
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    MEM_stage();
+  }
+  //lanes move through MEM together, an older lane that already went
+  //on to SR waits for a younger one stalled on the data cache
+  for(auto lane = 0; lane < issue_width && stall.mem_stall; lane++)
+  {
+    SetLane(lane);
+    latch(STORE, NEW_PS).V = false;
+  }
+  //the store buffer writes to the data cache when no load used the port
+  if(simulator().storebuffer().IsEnabled())
+    simulator().storebuffer().Drain(dcache_port_busy);
+  //a control instruction resolved in AGEX squashes the younger lanes
+  //and everything behind it, so AGEX runs for all lanes in between
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    for(auto i = stage_latch[MEMORY] - 1; i > stage_latch[AGEX]; i--)
+      SUB_stage(i);
+  }
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    AGEX_stage();
+  }
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    for(auto i = stage_latch[AGEX] - 1; i > stage_latch[DECODE]; i--)
+      SUB_stage(i);
+  }
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    DE_stage();
+  }
+  //decode reads what SR wrote back from the next cycle on, and what the
+  //instructions squashed in this cycle would have written
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    auto & store_latch = latch(STORE, PS);
+    if(store_latch.instruction && store_latch.V)
+      ScoreboardClear(*store_latch.instruction);
+  }
+  for(auto & next_latch : NEW_PS)
+  {
+    if(next_latch->instruction && next_latch->instruction->squashed)
+      ScoreboardClear(*next_latch->instruction);
+  }
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    for(auto i = stage_latch[DECODE] - 1; i >= 0; i--)
+      SUB_stage(i);
+  }
+  SetLane(0);
   FETCH_stage();
+
+  //when only the older lane issued, decode keeps the younger instruction
+  //and a bubble takes the place of the older one
+  if(stall.pair_stall && !stall.mem_stall && !IsRedirectDetected())
+    latch(DECODE, NEW_PS).V = false;
+  issue_cycles[issued_this_cycle]++;
+
+  CompletePendingLoads(false);
+  AccountCycle(retired_before);
+}
+
+/*
+* Charge the cycle to the CPI stack. A cycle that wrote back an
+* instruction is a base cycle, any other goes to the first cause that
+* held the pipeline: an instruction cache miss, a dependency, also one
+* a younger lane waits on in decode, a control instruction from the
+* oldest stage on, a data cache miss, and the pipeline is empty when
+* nothing held it. With a predictor control
+* instructions do not hold fetch, only a misprediction costs cycles, and
+* the stalls of the wrong path it squashes do not count.
+*
+* A stall while older instructions still write back leaves a bubble that
+* reaches SR later, when nothing holds the pipeline anymore. Such a cycle
+* is charged to the stall that left the bubble, and the cycles the front
+* end needs to refill after a control instruction restarted it to that
+* control instruction.
+*/
+void PipeLine::AccountCycle(uint64_t retired_before)
+{
+  auto & stall = simulator().state().Stall();
+  auto predicted = simulator().predictor().IsEnabled();
+  auto restarted = resolved_stage != UNDEFINED && (!predicted || IsRedirectDetected());
+  auto wrong_path = predicted && restarted;
+  auto resolved_cause = resolved_stage == MEMORY ? CPI_CONTROL_MEMORY :
+                        resolved_stage == AGEX ? CPI_CONTROL_AGEX : CPI_CONTROL_DECODE;
+  CpiCause cause;
+
+  if(!stall.icache_r && !wrong_path)
+    cause = CPI_ICACHE;
+  else if(stall.dep_stall && !wrong_path)
+    cause = dep_on_cc ? CPI_DEP_CC : CPI_DEP_REGISTER;
+  else if(pair_dep_stall && !wrong_path)
+    cause = pair_on_cc ? CPI_DEP_CC : CPI_DEP_REGISTER;
+  else if(!predicted && stall.v_mem_br_stall)
+    cause = CPI_CONTROL_MEMORY;
+  else if(!predicted && stall.v_agex_br_stall)
+    cause = CPI_CONTROL_AGEX;
+  else if(!predicted && stall.v_sub_br_stall)
+    cause = CPI_CONTROL_SPLIT;
+  else if(!predicted && stall.v_de_br_stall)
+    cause = CPI_CONTROL_DECODE;
+  else if(restarted)
+    cause = resolved_cause;
+  else if(stall.mem_stall)
+    cause = CPI_DCACHE;
+  else
+    cause = CPI_EMPTY;
+
+  //a bubble takes at most the depth of the pipeline to reach SR
+  size_t depth = stage_latch[STORE] + 1;
+  if(retired_instructions != retired_before)
+  {
+    if(cause != CPI_EMPTY)
+      owed_bubbles.push_back(cause);
+    cause = CPI_BASE;
+  }
+  else if(cause == CPI_EMPTY && !owed_bubbles.empty())
+  {
+    cause = owed_bubbles.front();
+    owed_bubbles.pop_front();
+  }
+  cpi_stack[cause]++;
+
+  //the squash removes the bubbles in flight, the instruction fetched
+  //from the next PC reaches SR once the pipeline has filled again
+  if(restarted)
+    owed_bubbles.assign(depth, resolved_cause);
+  while(owed_bubbles.size() > depth)
+    owed_bubbles.pop_front();
+}
+
+/*
+* Return true if inst is in the SR latch of a lane, to write back in the
+* next cycle
+*/
+bool PipeLine::IsInStoreLatch(const Instruction & inst)
+{
+  for(auto lane = 0; lane < issue_width; lane++)
+    if(PS.at(stage_latch[STORE] * issue_width + lane)->instruction.get() == &inst)
+      return true;
+  return false;
+}
+
+/*
+* Write back the oldest load waiting on the data cache once its line has
+* arrived, one load a cycle and in program order. With all set, write
+* back every pending load at once, used when the simulator halts.
+*/
+void PipeLine::CompletePendingLoads(bool all)
+{
+  auto & cpu_state = simulator().state();
+  auto cycle = simulator().GetCycles();
+
+  pending_stage.clear();
+  for(auto & pending : pending_loads)
+    pending_stage[pending.instruction->seq] = "L";
+
+  while(!pending_loads.empty() && (all || pending_loads.front().ready_cycle <= cycle))
+  {
+    auto & pending = pending_loads.front();
+    auto data = pending.data;
+    if(pending.ld_reg)
+      cpu_state.SetDataForRegister(pending.drid, data);
+    if(pending.ld_cc)
+    {
+      bits3 nzp;
+      nzp[2] = data[15];
+      nzp[1] = data.to_num() == 0;
+      nzp[0] = !data[15] && data.to_num() != 0;
+      cpu_state.SetNZP(nzp);
+    }
+    pending_stage[pending.instruction->seq] = "S";
+    ScoreboardClear(*pending.instruction);
+    retired_instructions++;
+    simulator().mix().Retire(*pending.instruction, cycle);
+    pending_loads.pop_front();
+    if(!all)
+      break;
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Flush                                           */
+/*                                                             */
+/* Purpose   : Empty the pipeline and leave the architectural  */
+/*             state of the instructions that passed MEM in    */
+/*             State, so another core can go on from there.    */
+/*                                                             */
+/***************************************************************/
+void PipeLine::Flush()
+{
+  auto & cpu_state = simulator().state();
+
+  //the instructions in SR write back as they would in the next cycle,
+  //then the loads and stores that already left the MEM stage
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    SR_stage();
+  }
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    auto & store_signals = cpu_state.SrSignals(lane);
+    if(store_signals.v_sr_ld_reg)
+      cpu_state.SetDataForRegister(store_signals.sr_drid, store_signals.sr_reg_data);
+  }
+  cpu_state.GetNZP();
+  CompletePendingLoads(true);
+  simulator().storebuffer().Flush();
+
+  //everything in front of SR is dropped, the oldest of those restarts
+  //fetch. Without one the PC already holds the next instruction.
+  std::shared_ptr<Instruction> oldest;
+  auto consider = [&](const std::shared_ptr<Instruction> & inst) {
+    if(inst && !inst->squashed && (!oldest || inst->seq < oldest->seq))
+      oldest = inst;
+  };
+  for(auto position = 0; position < stage_latch[STORE]; position++)
+  {
+    for(auto lane = 0; lane < issue_width; lane++)
+    {
+      auto & flushed = *PS.at(position * issue_width + lane);
+      if(flushed.V)
+        consider(flushed.instruction);
+    }
+  }
+  for(auto & queued : fetch_queue)
+    consider(queued);
+  if(oldest)
+    cpu_state.SetProgramCounter(oldest->PC);
+
+  for(auto position = 0; position < stage_latch[STORE]; position++)
+  {
+    for(auto lane = 0; lane < issue_width; lane++)
+    {
+      auto & flushed = *PS.at(position * issue_width + lane);
+      if(flushed.instruction && flushed.V)
+        flushed.instruction->squashed = true;
+    }
+  }
+  for(auto & queued : fetch_queue)
+    queued->squashed = true;
+
+  for(size_t i = 0; i < PS.size(); i++)
+  {
+    *PS.at(i) = Latch();
+    *NEW_PS.at(i) = Latch();
+  }
+  cpu_state.init_signals();
+  fetch_queue.clear();
+  fetch_queue_full = false;
+  fetch_queue_control = false;
+  queue_stage.clear();
+  pending_stage.clear();
+  scoreboard = 0;
+  for(auto name = 0; name < SCOREBOARD_NAMES; name++)
+    scoreboard_writers[name] = 0;
+  owed_bubbles.clear();
+  last_signature.clear();
+  idle = false;
+  SetStage(UNDEFINED);
+  SetLane(0);
 }
 
 void PipeLine::UpdateHistory()
@@ -355,24 +1136,29 @@ void PipeLine::UpdateHistory()
   // A new instruction has been successfully fetched if it's valid in the next
   // DECODE latch, AND it's different from what was in the current DECODE latch
   // (or the current latch was invalid). This prevents creating duplicate rows for stalls.
-  auto & de_new_latch = latch(DECODE, NEW_PS);
-  auto de_new_inst = de_new_latch.instruction;
-  if (de_new_inst && de_new_latch.V) {
-      bool is_new_instruction = false;
-      // A simple check to see if this PC is already the last one in our history.
-      if (instruction_history.empty() || instruction_history.back().pc != (de_new_inst->NPC.to_num() - 2)) {
-          is_new_instruction = true;
-      }
-      auto & de_curr_latch = latch(DECODE, PS);
-      auto de_curr_inst = de_curr_latch.instruction;
-      if (!de_curr_inst || !de_curr_latch.V || (de_curr_inst->NPC.to_num() != de_new_inst->NPC.to_num())) {
-          is_new_instruction = true;
+  for (int lane = 0; lane < issue_width; lane++) {
+      auto & de_new_latch = *NEW_PS.at(lane);
+      auto de_new_inst = de_new_latch.instruction;
+      if (de_new_inst && de_new_latch.V) {
+          // Every fetch creates a new instruction object, so a stalled instruction
+          // keeps its sequence number and does not create a duplicate row.
+          if (instruction_history.empty() || instruction_history.back().seq < de_new_inst->seq) {
+              InstructionTrace new_trace;
+              new_trace.seq = de_new_inst->seq;
+              new_trace.pc = de_new_inst->NPC.to_num() - 2;
+              new_trace.disassembled = disassembler.disassemble(de_new_inst->IR);
+              instruction_history.push_back(new_trace);
+          }
       }
+  }
 
-      if (is_new_instruction) {
+  // Instructions that wait in the fetch queue get their row when fetched
+  for (auto & queued : fetch_queue) {
+      if (instruction_history.empty() || instruction_history.back().seq < queued->seq) {
           InstructionTrace new_trace;
-          new_trace.pc = de_new_inst->NPC.to_num() - 2;
-          new_trace.disassembled = disassembler.disassemble(de_new_inst->IR);
+          new_trace.seq = queued->seq;
+          new_trace.pc = queued->PC.to_num();
+          new_trace.disassembled = disassembler.disassemble(queued->IR);
           instruction_history.push_back(new_trace);
       }
   }
@@ -383,79 +1169,59 @@ void PipeLine::UpdateHistory()
   for (auto& inst_trace : instruction_history) {
       std::string stage_char = " "; // Default to blank
       std::shared_ptr<Instruction> current_inst = nullptr;
-      
-      // Check each pipeline stage for this instruction
-      auto & sr_latch = latch(STORE, PS);
-      auto & mem_latch_hist = latch(MEMORY, PS);
-      auto & agex_latch_hist = latch(AGEX, PS);
-      auto & de_latch_hist = latch(DECODE, PS);
-      
-      auto sr_inst = sr_latch.instruction;
-      auto mem_inst = mem_latch_hist.instruction;
-      auto agex_inst = agex_latch_hist.instruction;
-      auto de_inst = de_latch_hist.instruction;
-      
-      // Find which stage contains this instruction by matching PC
-      if (sr_inst && sr_latch.V && (sr_inst->NPC.to_num() - 2 == inst_trace.pc)) {
-          current_inst = sr_inst;
-          stage_char = current_inst->current_stage;
-          current_inst->recordStage(current_cycle, stage_char);
+      int current_latch = -1;
+
+      // Find which latch contains this instruction by matching its sequence number
+      for (int i = PS.size() - 1; i >= 0; i--) {
+          auto & latch_hist = *PS.at(i);
+          if (latch_hist.instruction && latch_hist.V && (latch_hist.instruction->seq == inst_trace.seq)) {
+              current_inst = latch_hist.instruction;
+              current_latch = i;
+              break;
+          }
       }
-      else if (mem_inst && mem_latch_hist.V && (mem_inst->NPC.to_num() - 2 == inst_trace.pc)) {
-          current_inst = mem_inst;
-          stage_char = current_inst->current_stage;
+
+      if (current_inst) {
+          stage_char = current_inst->squashed ? "X" : latch_name[current_latch / issue_width];
           // Check if this instruction is performing a memory access in this cycle
-          if (micro_sequencer.Get_DCACHE_EN(mem_inst->MEM_CS)) {
-              inst_trace.mem_addr = mem_inst->ADDRESS.to_num();
+          if (current_latch / issue_width == stage_latch[MEMORY] && micro_sequencer.Get_DCACHE_EN(current_inst->MEM_CS)) {
+              inst_trace.mem_addr = current_inst->ADDRESS.to_num();
               inst_trace.mem_addr_valid = true;
-              mem_inst->mem_addr = inst_trace.mem_addr;
-              mem_inst->mem_addr_valid = true;
+              current_inst->mem_addr = inst_trace.mem_addr;
+              current_inst->mem_addr_valid = true;
           }
           current_inst->recordStage(current_cycle, stage_char);
-      }
-      else if (agex_inst && agex_latch_hist.V && (agex_inst->NPC.to_num() - 2 == inst_trace.pc)) {
-          current_inst = agex_inst;
-          stage_char = current_inst->current_stage;
-          current_inst->recordStage(current_cycle, stage_char);
-      }
-      else if (de_inst && de_latch_hist.V && (de_inst->NPC.to_num() - 2 == inst_trace.pc)) {
-          current_inst = de_inst;
-          stage_char = current_inst->current_stage;
-          current_inst->recordStage(current_cycle, stage_char);
-      }
-      else if (inst_trace.cycle_history.empty()) {
-          stage_char = "F";
-      }
 
-      // Check for stalls by seeing if the instruction is still in the same stage in the *next* cycle
-      auto & de_new_latch_check = latch(DECODE, NEW_PS);
-      auto de_new_inst_check = de_new_latch_check.instruction;
-      auto & agex_new_latch = latch(AGEX, NEW_PS);
-      auto agex_new_inst = agex_new_latch.instruction;
-      auto & mem_new_latch = latch(MEMORY, NEW_PS);
-      auto mem_new_inst = mem_new_latch.instruction;
-      
-      if (stage_char == "D" && de_new_inst_check && de_new_latch_check.V && (de_new_inst_check->NPC.to_num() - 2 == inst_trace.pc)) {
-          stage_char = "D*";
-          if (de_inst) {
-              de_inst->recordStall(current_cycle, "D");
+          // Check for stalls by seeing if the instruction is still in the same latch in the *next* cycle
+          auto & new_latch = *NEW_PS.at(current_latch);
+          if (!current_inst->squashed && new_latch.instruction && new_latch.V &&
+              (new_latch.instruction->seq == inst_trace.seq)) {
+              current_inst->recordStall(current_cycle, stage_char);
+              stage_char += "*";
           }
       }
-      if (stage_char == "E" && agex_new_inst && agex_new_latch.V && (agex_new_inst->NPC.to_num() - 2 == inst_trace.pc)) {
-          stage_char = "E*";
-          if (agex_inst) {
-              agex_inst->recordStall(current_cycle, "E");
-          }
+      else if (inst_trace.cycle_history.empty()) {
+          stage_char = fetch_name;
       }
-      if (stage_char == "M" && mem_new_inst && mem_new_latch.V && (mem_new_inst->NPC.to_num() - 2 == inst_trace.pc)) {
-          stage_char = "M*";
-          if (mem_inst) {
-              mem_inst->recordStall(current_cycle, "M");
-          }
+      else if (queue_stage.count(inst_trace.seq)) {
+          stage_char = queue_stage[inst_trace.seq];
+      }
+      else if (pending_stage.count(inst_trace.seq)) {
+          stage_char = pending_stage[inst_trace.seq];
       }
 
       inst_trace.cycle_history[current_cycle] = stage_char;
   }
+
+  // Nobody prints the diagram of a headless run, so the rows of instructions
+  // that left the pipeline are dropped instead of growing every cycle
+  if (simulator().config().headless) {
+      instruction_history.erase(std::remove_if(instruction_history.begin(), instruction_history.end(),
+          [current_cycle](const InstructionTrace & inst_trace) {
+              auto & stage_char = inst_trace.cycle_history.at(current_cycle);
+              return stage_char == "S" || stage_char == "X" || stage_char == " ";
+          }), instruction_history.end());
+  }
 }
 
 /************************* SR_stage() *************************/
@@ -463,7 +1229,7 @@ void PipeLine::SR_stage()
 {
   SetStage(STORE);
   auto & micro_sequencer =  simulator().microsequencer();
-  auto & sr_sig = simulator().state().SrSignals();
+  auto & sr_sig = simulator().state().SrSignals(current_lane);
   auto & store_latch = latch(STORE,PS);
   auto inst = store_latch.instruction;
   
@@ -492,11 +1258,94 @@ void PipeLine::SR_stage()
     sr_sig.v_sr_ld_reg = micro_sequencer.Get_SR_LD_REG(inst->SR_CS) & store_latch.V;
     sr_sig.v_sr_ld_cc = micro_sequencer.Get_SR_LD_CC(inst->SR_CS) & store_latch.V;
 
+    //an older load still waiting on the data cache must not overwrite
+    //what this instruction writes back
+    for(auto & pending : pending_loads)
+    {
+      if(pending.instruction->seq > inst->seq)
+        continue;
+      if(sr_sig.v_sr_ld_reg && pending.drid.to_num() == sr_sig.sr_drid.to_num())
+      {
+        pending.ld_reg = false;
+        ScoreboardClear(*pending.instruction, 1 << pending.drid.to_num());
+      }
+      if(sr_sig.v_sr_ld_cc)
+      {
+        pending.ld_cc = false;
+        ScoreboardClear(*pending.instruction, 1 << SCOREBOARD_CC);
+      }
+    }
+
     /* CC LOGIC  */
     sr_sig.sr_n = sr_sig.sr_reg_data[15];
     sr_sig.sr_z = ((sr_sig.sr_reg_data.to_num() == 0) ? 1 : 0);
     sr_sig.sr_p = ((!sr_sig.sr_n) && (!sr_sig.sr_z));
+
+    if (store_latch.V)
+    {
+      retired_instructions++;
+      simulator().mix().Retire(*inst, simulator().GetCycles());
+    }
+
+    //a load that left MEM on a miss passes SR without writing back,
+    //the checker takes its data now to stay in program order
+    auto & checker = simulator().checker();
+    if (checker.IsEnabled() &&
+        (store_latch.V || std::any_of(pending_loads.begin(), pending_loads.end(),
+                                      [&inst](const PendingLoad & load) { return load.instruction == inst; })))
+    {
+      bits3 nzp;
+      nzp[2] = sr_sig.sr_n;
+      nzp[1] = sr_sig.sr_z;
+      nzp[0] = sr_sig.sr_p;
+      checker.Retire(*inst, micro_sequencer.Get_SR_LD_REG(inst->SR_CS), sr_sig.sr_drid, sr_sig.sr_reg_data,
+                     micro_sequencer.Get_SR_LD_CC(inst->SR_CS), nzp);
+    }
+  }
+}
+
+/************************* SUB_stage() *************************/
+/*
+* An extra cycle of a split stage. The instruction in latch index moves
+* on to the next latch, held by the same stalls as the stage it belongs
+* to and squashed by a redirect from the MEM stage.
+*/
+void PipeLine::SUB_stage(int index)
+{
+  auto & stall = simulator().state().Stall();
+  auto & micro_seq = simulator().microsequencer();
+  auto & sub_latch = *PS.at(LatchIndex(index));
+  auto & next_latch = *NEW_PS.at(LatchIndex(index + 1));
+  auto inst = sub_latch.instruction;
+  auto front_end = index < stage_latch[DECODE];
+
+  //a control instruction that has not reached the MEM stage holds the fetch
+  //stage, the extra fetch cycles predecode the instruction to find out
+  if(inst && sub_latch.V)
+  {
+    if(front_end)
+    {
+      if(micro_seq.Get_DE_BR_STALL(micro_seq.GetMicroCodeFor(inst->IR)))
+        stall.v_sub_br_stall = true;
+    }
+    else if(micro_seq.Get_AGEX_BR_STALL(inst->AGEX_CS) && index < stage_latch[ResolveStage(*inst)])
+      stall.v_sub_br_stall = true;
+  }
+
+  //the front end waits on dependency and memory stalls, the back end
+  //only on memory stalls, a redirect overrides both
+  auto redirect = IsRedirectDetected();
+  auto hold = stall.mem_stall || (front_end && (stall.dep_stall || stall.pair_stall));
+  if(hold && !redirect)
+  {
+    next_latch = *PS.at(LatchIndex(index + 1));
+    return;
   }
+
+  if(redirect && inst && sub_latch.V)
+    inst->squashed = true;
+  next_latch.instruction = inst;
+  next_latch.V = sub_latch.V && !redirect;
 }
 
 /************************* MEM_stage() *************************/
@@ -507,12 +1356,15 @@ void PipeLine::MEM_stage()
   auto & memory_latch = latch(MEMORY,PS);
   auto inst = memory_latch.instruction;
   auto & main_memory = simulator().memory();
-  auto & memory_sig = simulator().state().MemSignals();
+  auto & memory_sig = simulator().state().MemSignals(current_lane);
   auto & stall_sig = simulator().state().Stall();
   auto & micro_seq = simulator().microsequencer();
 
   if (!inst) {
-    // No instruction in MEMORY - this shouldn't happen, but handle gracefully
+    // No instruction in MEMORY while the pipeline fills, after reset or a
+    // flush. A branch resolved early drives the PC mux of this lane, which
+    // has to be cleared for the next cycle like the stage logic does.
+    memory_sig.mem_pc_mux = 0;
     return;
   }
   
@@ -540,7 +1392,7 @@ void PipeLine::MEM_stage()
     MDR_IN = inst->ALU_RESULT;
 
   //read/write enable logic
-  auto read_write_en = micro_seq.Get_DCACHE_RW(memory_latch.MEM_CS);
+  auto read_write_en = micro_seq.Get_DCACHE_RW(inst->MEM_CS);
   auto we_high = 0, we_low = 0;
   if(read_write_en)
   {
@@ -559,12 +1411,46 @@ void PipeLine::MEM_stage()
     }
   }
 
-  //data cache access
+  //a mispredicted branch in an older lane squashes this one
+  //before it touches the data cache
+  auto squash = false;
+  for(auto lane = 0; lane < current_lane; lane++)
+    squash = squash || IsRedirectDetected(lane);
+  if(squash && memory_latch.V)
+    inst->squashed = true;
+
+  //data cache access, with a store buffer a store retires into the buffer
+  //and only stalls when it is full, a load reads through the buffer
   bits16 MDR_OUT;
   bool data_cache_r = false;
   auto & memory_latch_ps = latch(MEMORY, PS);
-  auto cache_en = micro_seq.Get_DCACHE_EN(inst->MEM_CS) && memory_latch_ps.V;
-  if(cache_en)
+  auto & store_buffer = simulator().storebuffer();
+  auto cache_en = micro_seq.Get_DCACHE_EN(inst->MEM_CS) && memory_latch_ps.V && !squash;
+  auto miss_pending = false;
+  auto pending_ready_cycle = 0;
+  if(cache_en && !read_write_en)
+  {
+    auto ready_cycle = -1;
+    auto cycle = simulator().GetCycles();
+    if(store_buffer.IsEnabled())
+    {
+      auto need_high = data_size || alignment_needed;
+      auto need_low = data_size || !alignment_needed;
+      dcache_port_busy = store_buffer.Load(inst->ADDRESS, MDR_OUT, need_low, need_high, ready_cycle) || dcache_port_busy;
+    }
+    else
+      ready_cycle = main_memory.dcache_request(inst->ADDRESS, MDR_OUT);
+
+    //a load that missed in the non-blocking cache leaves the MEM stage and
+    //writes back when its line arrives, a TRAP needs its vector right away
+    miss_pending = ready_cycle > cycle && main_memory.IsDataCacheNonBlocking() && !micro_seq.Get_TRAP_OP(inst->MEM_CS);
+    data_cache_r = ready_cycle != -1 && (ready_cycle <= cycle || miss_pending);
+    if(miss_pending)
+      pending_ready_cycle = ready_cycle + 1;
+  }
+  else if(cache_en && store_buffer.IsEnabled())
+    data_cache_r = store_buffer.Insert(inst->ADDRESS, MDR_IN, we_low, we_high);
+  else if(cache_en)
     main_memory.dcache_access(inst->ADDRESS, MDR_OUT, MDR_IN, data_cache_r, we_low, we_high);
   else
     data_cache_r = true; //no stall since memory was not even accessed
@@ -572,32 +1458,7 @@ void PipeLine::MEM_stage()
   //memory signals for fetch stage
   memory_sig.target_pc = inst->ADDRESS;
   memory_sig.mem_drid = inst->DRID;
-  stall_sig.mem_stall = cache_en && (!data_cache_r);
-
-  //Branch Logic
-  auto memory_v = memory_latch_ps.V;
-  if(memory_v)
-  {
-    auto is_branch_op = micro_seq.Get_BR_OP(inst->MEM_CS);
-    auto is_trap_op = micro_seq.Get_TRAP_OP(inst->MEM_CS);
-    if(is_branch_op)
-    {
-      bits3 br_intr_nzp = inst->IR.range<11,9>();
-      bits3 cpu_nzp = inst->CC;
-      if(((br_intr_nzp[2] & cpu_nzp[2]) == 1) || // N
-         ((br_intr_nzp[1] & cpu_nzp[1]) == 1) || // Z
-         ((br_intr_nzp[0] & cpu_nzp[0]) == 1))   // P
-         {
-           memory_sig.mem_pc_mux = 1; //branch taken, jump to target PC
-         }
-    }
-    else if (is_trap_op)
-      memory_sig.mem_pc_mux = 2; //trap was triggered
-    else
-      memory_sig.mem_pc_mux = 0; //branch not taken, continue next instruction
-  }
-  else
-    memory_sig.mem_pc_mux = 0; //memory not valid
+  stall_sig.mem_stall = stall_sig.mem_stall || (cache_en && (!data_cache_r));
 
   //process trap
   memory_sig.trap_pc = 0;
@@ -619,10 +1480,22 @@ void PipeLine::MEM_stage()
     }
   }
 
+  //Branch Logic
+  //the PC can only be redirected once the stage is not waiting on the d-cache,
+  //a TRAP needs the vector read to complete first. A control instruction
+  //resolved in an earlier stage leaves the PC alone.
+  auto memory_v = memory_latch_ps.V && !squash;
+  auto resolve_here = ResolveStage(*inst) == MEMORY;
+  memory_sig.mem_pc_mux = 0; //branch not taken or memory not valid
+  if(memory_v && !stall_sig.mem_stall && resolve_here)
+    BranchLogic(inst);
+
   //check for dependencies
   memory_sig.v_mem_ld_cc = memory_v && micro_seq.Get_MEM_LD_CC(inst->MEM_CS);
   memory_sig.v_mem_ld_reg = memory_v && micro_seq.Get_MEM_LD_REG(inst->MEM_CS);
-  stall_sig.v_mem_br_stall = memory_v && micro_seq.Get_MEM_BR_STALL(inst->MEM_CS);
+  auto br_stall = memory_v && resolve_here && micro_seq.Get_MEM_BR_STALL(inst->MEM_CS);
+  stall_sig.v_mem_br_stall = stall_sig.v_mem_br_stall || br_stall;
+  stall_sig.v_resolve_br_stall = stall_sig.v_resolve_br_stall || br_stall;
 
   //load SR latch - only control signals
   /* The code below propagates the control signals from memory_sigs.CS latch
@@ -632,18 +1505,29 @@ void PipeLine::MEM_stage()
   // Propagate instruction object and update its data fields
   bool store_valid = memory_v && (!stall_sig.mem_stall);
   store_latch.instruction = inst;
-  store_latch.V = store_valid;
+  store_latch.V = store_valid && !miss_pending;
   inst->DATA = memory_sig.trap_pc;
+  if(store_valid && simulator().interval().IsValidating())
+    simulator().interval().Observe(*inst);
+
+  //a load past a miss writes back from the pending loads instead of SR
+  if(store_valid && miss_pending)
+  {
+    pending_loads.push_back({inst, pending_ready_cycle, inst->DRID, inst->DATA,
+                             (bool)micro_seq.Get_SR_LD_REG(inst->SR_CS), (bool)micro_seq.Get_SR_LD_CC(inst->SR_CS)});
+    loads_past_miss++;
+    simulator().events().Schedule(pending_ready_cycle);
+  }
 }
 
 /************************* AGEX_stage() *************************/
 void PipeLine::AGEX_stage()
 {
   SetStage(AGEX);
-  auto & memory_latch = latch(MEMORY,NEW_PS);
+  auto & memory_latch = entry_latch(MEMORY,NEW_PS);
   auto & agex_latch = latch(AGEX,PS);
   auto inst = agex_latch.instruction;
-  auto & agex_sig = simulator().state().AgexSignals();
+  auto & agex_sig = simulator().state().AgexSignals(current_lane);
   auto & stall_sig = simulator().state().Stall();
   auto & micro_seq = simulator().microsequencer();
 
@@ -655,114 +1539,19 @@ void PipeLine::AGEX_stage()
   inst->current_stage = "E";
   
   /* your code for agex_sigs stage goes here */
-  // First program counter mux
-  bits16 next_pc_1;
-  if(micro_seq.Get_ADDR1MUX(inst->AGEX_CS))
-    next_pc_1 = inst->SR1;
-  else
-    next_pc_1 = inst->NPC;
-
-  // second program counter mux
-  // TODO: this might be broken because of the bit access to non_const overload
-  bits16 next_pc_2;
-  auto agex_addr2mux = micro_seq.Get_ADDR2MUX(inst->AGEX_CS);
-  switch (agex_addr2mux.to_num())
-  {
-  case 0:
-    next_pc_2 = 0;
-    break;
-  case 1:
-    next_pc_2 = inst->IR.sign_ext(5);
-    break;
-  case 2:
-    next_pc_2 = inst->IR.sign_ext(8);
-    break;
-  case 3:
-    next_pc_2 = inst->IR.sign_ext(10);
-    break;
-  default:
-    assert(true); //TODO: should not happen. add an exception?
-  }
-
-  //check if lshf1 signal is 1
-  if(micro_seq.Get_LSHF1(inst->AGEX_CS))
-    next_pc_2 = next_pc_2 << 1;
-
-  //generate next instruction address
-  bits16 mem_address;
-  if(micro_seq.Get_ADDRESSMUX(inst->AGEX_CS))
-    mem_address = next_pc_1 + next_pc_2;
-  else
-    mem_address = inst->IR.zero_ext(7) << 1;
+  //generate the memory or next instruction address
+  auto mem_address = AddressUnit(*inst).Output();
 
   //Shifter or ALU generation
-  bits16 alu_shifter_output;
-  if(micro_seq.Get_ALU_RESULTMUX(inst->AGEX_CS)) //ALU operation
-  {
-    //determine the second input to the ALU
-    bits16 input2;
-    if(micro_seq.Get_SR2MUX(inst->AGEX_CS))
-        input2 = inst->IR.sign_ext(4);
-    else
-        input2 = inst->SR2;
-
-    //perfom the operation based on the micro code of the current instruction
-    auto aluk = micro_seq.Get_ALUK(inst->AGEX_CS);
-    switch(aluk.to_num())
-    {
-      case 0:
-        alu_shifter_output = inst->SR1 + input2;
-        break;
-      case 1:
-        alu_shifter_output = inst->SR1 & input2;
-        break;
-      case 2:
-        alu_shifter_output = inst->SR1 ^ input2;
-        break;
-      case 3:
-        alu_shifter_output = input2;
-        break;
-      default:
-        assert(true);
-    }
-  }
-  else //Shift Operation
-  {
-    //shif instruction
-    //       [15       12|11     9|8      6| 5| 4| 3  2  1  0]
-    //  LSHF [ 1, 1, 0, 1|   DR   |   SR   | 0| 0|   amount  ]
-    //  RSHF [ 1, 1, 0, 1|   DR   |   SR   | 0| 1|   amount  ]
-    // RSHFA [ 1, 1, 0, 1|   DR   |   SR   | 1| 1|   amount  ]
-    //
-    auto shif_mux = inst->IR.range<5,4>();
-    auto shift_amount = inst->IR.range<3,0>();
-    switch(shif_mux.to_num())
-    {
-      case 0: //LSHF
-        alu_shifter_output = inst->SR1 << shift_amount.to_num();
-        break;
-      case 1: //RSHF
-        alu_shifter_output = inst->SR1 >> shift_amount.to_num();
-        break;
-      case 3: //RSHFA
-      {
-        //arithmetic right shift, will preserve the MSB when shifting
-        auto sr_15 = inst->SR1[15];
-        alu_shifter_output = inst->SR1 >> shift_amount.to_num();
-        for(auto i = 0; i < shift_amount.to_num(); ++i)
-          alu_shifter_output[15-i] = sr_15;
-        break;
-      }
-      default:
-        assert(true);
-    }
-  }
+  auto alu_shifter_output = OperationUnit::MakeUnit(*inst)->Output();
 
   //set signals needed for previous stage
   agex_sig.agex_drid = inst->DRID;
   agex_sig.v_agex_ld_cc = agex_latch.V && micro_seq.Get_AGEX_LD_CC(inst->AGEX_CS);
   agex_sig.v_agex_ld_reg = agex_latch.V && micro_seq.Get_AGEX_LD_REG(inst->AGEX_CS);
-  stall_sig.v_agex_br_stall = agex_latch.V && micro_seq.Get_AGEX_BR_STALL(inst->AGEX_CS);
+  //a control instruction holds the front end until it is resolved
+  auto resolve = ResolveStage(*inst);
+  auto br_stall = agex_latch.V && micro_seq.Get_AGEX_BR_STALL(inst->AGEX_CS) && resolve != DECODE;
 
   //Stall check
   auto LD_MEM = (stall_sig.mem_stall) ? 0 : 1;
@@ -772,18 +1561,44 @@ void PipeLine::AGEX_stage()
     /* Propagate control signals from agex_sigs.CS latch to memory_sigs.CS latch. */
     inst->MEM_CS.range<10,0>() = inst->AGEX_CS.range<19,9>();
     
-    // Propagate instruction object and V bit
+    // Propagate instruction object and V bit, a mispredicted branch
+    // in the MEM stage squashes the wrong-path instruction
+    auto squash = IsRedirectDetected();
+    if (squash && agex_latch.V)
+      inst->squashed = true;
     memory_latch.instruction = inst;
-    memory_latch.V = agex_latch.V;
+    memory_latch.V = agex_latch.V && !squash;
     inst->ADDRESS = mem_address;
     inst->ALU_RESULT = alu_shifter_output;
+
+    //a fused branch evaluates its condition on the result of the ALU op,
+    //which went through AGEX in an older lane or an earlier cycle
+    if(inst->FUSED_ALU)
+    {
+      auto result = inst->FUSED_ALU->ALU_RESULT;
+      inst->CC[2] = result[15];
+      inst->CC[1] = result.to_num() == 0;
+      inst->CC[0] = !result[15] && result.to_num() != 0;
+    }
+
+    //with early branch resolution the target and the condition codes are
+    //known here, the control instruction writes the PC on its way to MEM
+    if(memory_latch.V && resolve == AGEX)
+    {
+      BranchLogic(inst);
+      br_stall = false;
+      stall_sig.v_resolve_br_stall = true;
+      early_resolved++;
+      resolve_cycles_saved += stage_latch[MEMORY] - stage_latch[AGEX];
+    }
   } else {
     // mem_stall: Keep instruction in MEM by writing current MEM instruction to NEW_PS MEM latch
-    auto & current_mem_latch = latch(MEMORY, PS);
+    auto & current_mem_latch = entry_latch(MEMORY, PS);
     memory_latch.instruction = current_mem_latch.instruction;
     memory_latch.MEM_CS = current_mem_latch.MEM_CS;
     memory_latch.V = current_mem_latch.V;
   }
+  stall_sig.v_agex_br_stall = stall_sig.v_agex_br_stall || br_stall;
 }
 
 /************************* DE_stage() *************************/
@@ -791,12 +1606,12 @@ void PipeLine::DE_stage()
 {
   SetStage(DECODE);
   auto & cpu_state = simulator().state();
-  auto & de_sig = cpu_state.DecodeSignals();
+  auto & de_sig = cpu_state.DecodeSignals(current_lane);
   auto & stall = cpu_state.Stall();
   auto & micro_sequencer = simulator().microsequencer();
   auto & decode_latch = latch(DECODE,PS);
   auto inst = decode_latch.instruction;
-  auto & agex_latch = latch(AGEX,NEW_PS);
+  auto & agex_latch = entry_latch(AGEX,NEW_PS);
   bitfield<6> CONTROL_STORE_ADDRESS;
 
   if (!inst) {
@@ -826,13 +1641,37 @@ void PipeLine::DE_stage()
   //obtained are latched regardless of whether an instruction needs these values.
   de_sig.de_cc = cpu_state.GetNZP();
 
+  //a conditional branch right behind a flag setting ALU op is fused with it
+  //and does not wait for the condition codes
+  auto fused_position = -1;
+  if(fusion_enabled && decode_latch.V)
+  {
+    inst->FUSED_ALU = nullptr;
+    if(micro_sequencer.Get_DE_BR_OP(de_sig.de_ucode))
+      fused_position = FindFusionProducer(inst->FUSED_ALU);
+  }
+
   //Dependency check logic indicates whether or not the instruction in the decode_sigs stage should
   //be propagated forward. If DEP.STALL is asserted, the state of the decode_sigs latches should
   //not be changed, and a bubble needs to be inserted into the agex_sigs stage. This is accomplished
   //by setting the valid bit for the agex_sigs stage (agex_sigs.V) to 0. Other actions need to be taken
   //to preserve the correct value of the PC. Therefore, the DEP.STALL signal is also used
   //by the structures physically located in the F stage
-  stall.dep_stall = CheckForDataDependencies();
+  //A younger lane only issues together with the older ones. If it cannot,
+  //PAIR.STALL lets the older lane go on and holds the younger instruction.
+  if(current_lane == 0)
+    stall.dep_stall = CheckForDataDependencies();
+  else if(!stall.dep_stall && decode_latch.V)
+  {
+    auto conflict = CheckPairing();
+    if(conflict != PAIR_OK && !stall.mem_stall)
+      pair_conflicts[conflict]++;
+    auto dependent = CheckForDataDependencies();
+    stall.pair_stall = dependent || conflict != PAIR_OK;
+    pair_dep_stall = dependent || conflict == PAIR_RAW || conflict == PAIR_CC;
+    if(!dependent)
+      pair_on_cc = conflict == PAIR_CC;
+  }
 
   //The BR.STALL signal from the control store indicates that the instruction being processed
   //is a control instruction, and hence the frontend of the pipeline should be stalled until
@@ -840,7 +1679,7 @@ void PipeLine::DE_stage()
   //is 1, then the decode_sigs.BR.STALL signal should be asserted. This indicates that the instruction
   //in the decode_sigs stage is a valid control instruction. The decode_sigs.BR.STALL signal is used to insert
   //bubbles into the pipeline in the F stage
-  stall.v_de_br_stall = decode_latch.V && micro_sequencer.Get_DE_BR_STALL(de_sig.de_ucode);
+  auto br_stall = decode_latch.V && micro_sequencer.Get_DE_BR_STALL(de_sig.de_ucode);
   
   //if mem stage is already stalled dont change the state of mem latch
   auto LD_AGEX = (stall.mem_stall) ? 0 : 1;
@@ -849,26 +1688,72 @@ void PipeLine::DE_stage()
     // Propagate control signals to instruction
     inst->AGEX_CS.range<19,0>() = de_sig.de_ucode.range<22,3>();
 
-    /*agex_sigs Valid: valid if no stall or bubbles were detected*/
-    bool agex_valid = (!stall.dep_stall) && (decode_latch.V);
+    /*agex_sigs Valid: valid if no stall or bubbles were detected and
+      the instruction is not on a mispredicted path*/
+    auto squash = IsRedirectDetected();
+    if (squash && decode_latch.V)
+      inst->squashed = true;
+    bool agex_valid = (!stall.dep_stall) && (current_lane == 0 || !stall.pair_stall) && (decode_latch.V) && !squash;
+    if(agex_valid)
+      issued_this_cycle++;
+
+    //without fusion the branch waits until the ALU op leaves SR
+    if(agex_valid && micro_sequencer.Get_DE_BR_OP(de_sig.de_ucode))
+    {
+      branches_issued++;
+      if(inst->FUSED_ALU)
+      {
+        fused_branches++;
+        fusion_cycles_saved += stage_latch[STORE] - fused_position + 1;
+      }
+    }
     
     // Always propagate instruction object and V bit
     agex_latch.instruction = inst;
     agex_latch.V = agex_valid;
     inst->SR1 = de_sig.de_sr1_data;
     inst->SR2 = de_sig.de_sr2_data;
-    inst->CC = de_sig.de_cc;
+    //a fused branch gets its condition codes in AGEX, also keep them when
+    //a bubble left behind in decode still points to it
+    if(!inst->FUSED_ALU)
+      inst->CC = de_sig.de_cc;
     
     if(micro_sequencer.Get_DRMUX(de_sig.de_ucode))
       inst->DRID = 0x7;
     else
       inst->DRID = inst->IR.range<11,9>();
+
+    //the destination register and the condition codes stay pending on the
+    //scoreboard until the instruction writes them back
+    if(agex_valid)
+    {
+      uint16_t names = 0;
+      if(micro_sequencer.Get_DE_LD_REG(de_sig.de_ucode))
+        names |= 1 << inst->DRID.to_num();
+      if(micro_sequencer.Get_DE_LD_CC(de_sig.de_ucode))
+        names |= 1 << SCOREBOARD_CC;
+      ScoreboardSet(*inst, names);
+    }
+
+    //resolving in decode, the target is computed from the PC and the register
+    //just read and the branch uses the condition codes read with them
+    if(agex_valid && ResolveStage(*inst) == DECODE)
+    {
+      inst->MEM_CS.range<10,0>() = inst->AGEX_CS.range<19,9>();
+      inst->ADDRESS = AddressUnit(*inst).Output();
+      BranchLogic(inst);
+      br_stall = false;
+      stall.v_resolve_br_stall = true;
+      early_resolved++;
+      resolve_cycles_saved += stage_latch[MEMORY] - stage_latch[DECODE];
+    }
   } else {
     // mem_stall: Keep instruction in AGEX by writing current AGEX instruction to NEW_PS
-    auto & current_agex_latch = latch(AGEX, PS);
+    auto & current_agex_latch = entry_latch(AGEX, PS);
     agex_latch.instruction = current_agex_latch.instruction;
     agex_latch.V = current_agex_latch.V;
   }
+  stall.v_de_br_stall = stall.v_de_br_stall || br_stall;
 }
 
 /************************* FETCH_stage() *************************/
@@ -876,17 +1761,84 @@ void PipeLine::FETCH_stage()
 {
   SetStage(FETCH);
   auto & cpu_state = simulator().state();
-  auto & memory_sig = simulator().state().MemSignals();
+  auto & memory_sig = simulator().state().MemSignals(BranchLane());
   auto & stall = simulator().state().Stall();
   auto & memory = simulator().memory();
-  auto & decode_latch = latch(DECODE,NEW_PS);
+  auto & predictor = simulator().predictor();
+  auto & micro_sequencer = simulator().microsequencer();
   bits16 new_pc, instruction;
 
   //get the instruction from the instruction cache and the ready bit
-  memory.icache_access(cpu_state.GetProgramCounter(),instruction,stall.icache_r);
+  auto fetch_pc = cpu_state.GetProgramCounter();
+  memory.icache_access(fetch_pc,instruction,stall.icache_r);
+
+  //do not latch the decode_sigs in case there is a data stall or dependency stall,
+  //unless the instruction held in decode is on a mispredicted path
+  auto ld_de = (IsRedirectDetected() || !(stall.dep_stall || stall.pair_stall || stall.mem_stall)) ? 1 : 0;
+
+  //the fetch queue is full when the instructions decode leaves in it and
+  //a new fetch group would not fit. Without a predictor, a queued control
+  //instruction holds fetch like one in decode.
+  if(fetch_queue_depth)
+  {
+    size_t dequeued = ld_de ? std::min<size_t>(issue_width, fetch_queue.size()) : 0;
+    fetch_queue_full = !IsRedirectDetected() && fetch_queue.size() - dequeued + issue_width > (size_t)fetch_queue_depth;
+    fetch_queue_control = false;
+    for(auto & queued : fetch_queue)
+      fetch_queue_control = fetch_queue_control || (!predictor.IsEnabled() &&
+                            micro_sequencer.Get_DE_BR_STALL(micro_sequencer.GetMicroCodeFor(queued->IR)));
+  }
+
+  //if there are no stalls or control instructions in the pipeline,
+  //the PC should be incremented by 2.
+  auto load_pc = !IsStallDetected();
+
+  //with speculative fetch, the predictor supplies the next PC and the
+  //memory_sigs stage only writes the PC to recover from a misprediction.
+  //The predictor is only consulted for an instruction that enters decode.
+  auto speculate = predictor.IsEnabled();
+  auto redirect = IsRedirectDetected();
+
+  //decode_sigs.valid is 0 if stall was detected or a branch
+  //was not taken. Ohterwise, stage is good to go
+  bool decode_valid;
+  if(speculate)
+    decode_valid = load_pc && !redirect;
+  else
+    decode_valid = (!load_pc || stall.v_resolve_br_stall) ? 0 : 1;
+
+  //A wider front end fetches the next instructions in the same cycle as
+  //long as the older ones stay on the sequential path. Without a predictor
+  //a control instruction ends the group, found by predecoding it.
+  bits16 lane_pc[MAX_ISSUE_WIDTH], lane_ir[MAX_ISSUE_WIDTH], lane_pred_pc[MAX_ISSUE_WIDTH];
+  RAS_Checkpoint lane_checkpoint[MAX_ISSUE_WIDTH] = {};
+  bool lane_valid[MAX_ISSUE_WIDTH];
+  auto predicted_pc = fetch_pc;
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    lane_valid[lane] = decode_valid;
+    if(lane == 0)
+    {
+      lane_pc[lane] = fetch_pc;
+      lane_ir[lane] = instruction;
+    }
+    else
+    {
+      bool icache_r = false;
+      lane_pc[lane] = lane_pc[lane - 1] + 2;
+      memory.icache_access(lane_pc[lane], lane_ir[lane], icache_r);
+      lane_valid[lane] = lane_valid[lane - 1] && icache_r &&
+                         lane_pred_pc[lane - 1].to_num() == lane_pc[lane].to_num() &&
+                         (speculate || !micro_sequencer.Get_DE_BR_STALL(micro_sequencer.GetMicroCodeFor(lane_ir[lane - 1])));
+    }
 
-  //the de npc latch will be the address of the next instruction
-  auto de_npc = cpu_state.GetProgramCounter() + 2;
+    //the de npc latch will be the address of the next instruction
+    lane_pred_pc[lane] = lane_pc[lane] + 2;
+    if(speculate && load_pc && !redirect && (lane == 0 || lane_valid[lane]))
+      lane_pred_pc[lane] = predictor.Predict(lane_pc[lane], lane_ir[lane], lane_checkpoint[lane]);
+    if(lane == 0 || lane_valid[lane])
+      predicted_pc = lane_pred_pc[lane];
+  }
 
   //If a control instruction other than TRAP is supposed to write
   //into the PC, the TARGET.PC value coming from the memory_sigs stage should be latched into
@@ -898,7 +1850,7 @@ void PipeLine::FETCH_stage()
   switch(memory_sig.mem_pc_mux.to_num())
   {
     case 0:
-      new_pc = de_npc;
+      new_pc = predicted_pc;
       break;
     case 1:
       new_pc = memory_sig.target_pc;
@@ -911,42 +1863,352 @@ void PipeLine::FETCH_stage()
       break;
   }
 
-  //if there are no stalls or control instructions in the pipeline,
-  //the PC should be incremented by 2.
-  auto load_pc = !IsStallDetected();
   if(load_pc)
   {
     cpu_state.SetProgramCounter(new_pc);
   }
 
-  //do not latch the decode_sigs in case there is a data stall or dependency stall
-  auto ld_de = (stall.dep_stall || stall.mem_stall) ? 0 : 1;
-  if(ld_de)
-  {
-    //decode_sigs.valid is 0 if stall was detected or a branch
-    //was not taken. Ohterwise, stage is good to go
-    bool decode_valid = (!load_pc || stall.v_mem_br_stall) ? 0 : 1;
-    
-    // Always create instruction object - latch V bit indicates if it's valid or a bubble
-    auto new_instr = Instruction::Create(simulator(), instruction);
-    new_instr->PC = cpu_state.GetProgramCounter();
-    new_instr->IR = instruction;
-    new_instr->NPC = de_npc;
+  auto fetched_instruction = [&](int lane) {
+    auto new_instr = Instruction::Create(simulator(), lane_ir[lane]);
+    new_instr->PC = lane_pc[lane];
+    new_instr->IR = lane_ir[lane];
+    new_instr->NPC = lane_pc[lane] + 2;
+    new_instr->PRED_PC = lane_pred_pc[lane];
+    new_instr->ras_checkpoint = lane_checkpoint[lane];
+    new_instr->seq = fetch_seq++;
     new_instr->fetch_cycle = simulator().GetCycles();
     new_instr->current_stage = "F";
-    decode_latch.instruction = new_instr;
-    decode_latch.V = decode_valid;
-  } else {
-    // dep_stall or mem_stall: Keep instruction in DECODE by copying from PS
-    auto & current_decode_latch = latch(DECODE, PS);
-    decode_latch.instruction = current_decode_latch.instruction;
-    decode_latch.V = current_decode_latch.V;
+    return new_instr;
+  };
+
+  if(fetch_queue_depth)
+  {
+    QueueFetchGroup(ld_de, redirect, lane_valid, fetched_instruction);
+    return;
+  }
+
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    auto & decode_latch = entry_latch(DECODE,NEW_PS);
+    if(ld_de)
+    {
+      // Always create instruction object - latch V bit indicates if it's valid or a bubble
+      decode_latch.instruction = fetched_instruction(lane);
+      decode_latch.V = lane_valid[lane];
+    } else {
+      // dep_stall or mem_stall: Keep instruction in DECODE by copying from PS
+      auto & current_decode_latch = entry_latch(DECODE, PS);
+      decode_latch.instruction = current_decode_latch.instruction;
+      decode_latch.V = current_decode_latch.V;
+    }
+  }
+  SetLane(0);
+}
+
+/*
+* Fetch queue between FETCH and decode. The valid instructions of the fetch
+* group join the tail, decode takes one per lane from the head, so an empty
+* queue passes the group straight to decode. A redirect flushes the queue.
+*/
+void PipeLine::QueueFetchGroup(bool ld_de, bool redirect, const bool * lane_valid,
+                               const std::function<std::shared_ptr<Instruction>(int)> & fetched_instruction)
+{
+  queue_stage.clear();
+  for(auto & queued : fetch_queue)
+    queue_stage[queued->seq] = "Q";
+  if(redirect)
+  {
+    for(auto & queued : fetch_queue)
+    {
+      queued->squashed = true;
+      queue_stage[queued->seq] = "X";
+    }
+    fetch_queue.clear();
+  }
+
+  auto fetched = 0;
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    if(lane_valid[lane])
+    {
+      fetch_queue.push_back(fetched_instruction(lane));
+      fetched++;
+    }
+  }
+
+  auto delivered = 0;
+  for(auto lane = 0; lane < issue_width; lane++)
+  {
+    SetLane(lane);
+    auto & decode_latch = entry_latch(DECODE,NEW_PS);
+    if(ld_de)
+    {
+      if(!fetch_queue.empty())
+      {
+        decode_latch.instruction = fetch_queue.front();
+        decode_latch.V = true;
+        fetch_queue.pop_front();
+        delivered++;
+      }
+      else
+      {
+        decode_latch.instruction = Instruction::Create(simulator(), 0);
+        decode_latch.V = false;
+      }
+    } else {
+      // dep_stall or mem_stall: Keep instruction in DECODE by copying from PS
+      auto & current_decode_latch = entry_latch(DECODE, PS);
+      decode_latch.instruction = current_decode_latch.instruction;
+      decode_latch.V = current_decode_latch.V;
+    }
   }
+  SetLane(0);
+
+  queue_occupancy[fetch_queue.size()]++;
+  if(delivered && !fetched && !redirect)
+    hidden_fetch_stalls++;
+  if(!ld_de && fetched)
+    decoupled_fetch_cycles++;
 }
 
 void PipeLine::DumpHistory()
 {
   // This function is called ONCE at the end of the simulation
-  if (simulator().dump_file != nullptr)
-    idump(simulator().dump_file);
+  if (simulator().dumpfile() != nullptr)
+    idump(simulator().dumpfile());
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the pipeline counters of the options in*/
+/*             use with the statistics registry.               */
+/*                                                             */
+/***************************************************************/
+void PipeLine::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("pipeline.retired", "instructions written back", retired_instructions);
+
+  if (issue_width > 1)
+  {
+    std::vector<std::string> issued;
+    for(auto i = 0; i <= issue_width; i++)
+      issued.push_back(std::to_string(i));
+    stats.AddVector("pipeline.issue.cycles", "cycles issuing n instructions", issue_cycles, issued);
+    stats.AddVector("pipeline.issue.pair_conflicts", "younger instruction held in decode",
+                    pair_conflicts, {"none", "raw", "cc", "memory_port", "branch"});
+  }
+
+  if (fetch_queue_depth)
+  {
+    stats.AddHistogram("pipeline.fetch_queue.occupancy", "cycles holding n instructions", queue_occupancy);
+    stats.AddScalar("pipeline.fetch_queue.hidden_fetch_stalls", "fetch stalled but decode was fed", hidden_fetch_stalls);
+    stats.AddScalar("pipeline.fetch_queue.decoupled_cycles", "fetch went on while decode was held", decoupled_fetch_cycles);
+  }
+
+  if (resolve_stage != MEMORY)
+  {
+    stats.AddScalar("pipeline.resolve.early", "control instructions resolved before MEM", early_resolved);
+    stats.AddScalar("pipeline.resolve.cycles_saved", "front end cycles saved by early resolution", resolve_cycles_saved);
+  }
+
+  if (fusion_enabled)
+  {
+    stats.AddScalar("pipeline.fusion.branches", "conditional branches issued", branches_issued);
+    stats.AddScalar("pipeline.fusion.fused", "branches fused with an ALU op", fused_branches);
+    stats.AddScalar("pipeline.fusion.cycles_saved", "decode stall cycles saved by fusion", fusion_cycles_saved);
+  }
+
+  stats.AddVector("pipeline.cpi_stack", "cycles charged to each cause", cpi_stack,
+                  {"base", "icache", "dep_register", "dep_cc", "control_memory", "control_agex",
+                   "control_split", "control_decode", "dcache", "empty"});
+
+  if (simulator().memory().IsDataCacheNonBlocking())
+  {
+    stats.AddScalar("pipeline.pending_loads.loads", "loads that left MEM on a miss", loads_past_miss);
+    stats.AddScalar("pipeline.pending_loads.decode_stalls", "decode cycles waiting only on a pending load", pending_load_stalls);
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the issue and fetch queue statistics to    */
+/*             the output file.                                */
+/*                                                             */
+/***************************************************************/
+void PipeLine::dump(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  auto cycles = simulator().GetCycles();
+
+  if (issue_width > 1)
+  {
+    PRINT_AND_DUMP("\nIssue (width %d) :\n", issue_width);
+    PRINT_AND_DUMP("-------------------------------------\n");
+    PRINT_AND_DUMP("Retired instructions : %llu\n", (unsigned long long)retired_instructions);
+    PRINT_AND_DUMP("IPC                  : %.3f\n", cycles ? (double)retired_instructions / cycles : 0.0);
+    for(auto i = 0; i <= issue_width; i++)
+      PRINT_AND_DUMP("Cycles issuing %d     : %llu\n", i, (unsigned long long)issue_cycles[i]);
+    PRINT_AND_DUMP("Pair conflicts       : %llu RAW, %llu CC, %llu memory port, %llu branch\n",
+                   (unsigned long long)pair_conflicts[PAIR_RAW], (unsigned long long)pair_conflicts[PAIR_CC],
+                   (unsigned long long)pair_conflicts[PAIR_MEMORY_PORT], (unsigned long long)pair_conflicts[PAIR_BRANCH]);
+    PRINT_AND_DUMP("\n");
+  }
+
+  if (fetch_queue_depth)
+  {
+    PRINT_AND_DUMP("\nFetch queue (%d entries) :\n", fetch_queue_depth);
+    PRINT_AND_DUMP("-------------------------------------\n");
+    for(auto i = 0; i <= fetch_queue_depth; i++)
+      PRINT_AND_DUMP("Cycles holding %-2d    : %llu (%.1f%%)\n", i, (unsigned long long)queue_occupancy[i],
+                     cycles ? 100.0 * queue_occupancy[i] / cycles : 0.0);
+    PRINT_AND_DUMP("Fetch stalls hidden  : %llu\n", (unsigned long long)hidden_fetch_stalls);
+    PRINT_AND_DUMP("Fetch past decode    : %llu\n", (unsigned long long)decoupled_fetch_cycles);
+    PRINT_AND_DUMP("\n");
+  }
+
+  if (resolve_stage != MEMORY)
+  {
+    PRINT_AND_DUMP("\nBranch resolution (%s) :\n", resolve_stage == DECODE ? "DE" : "AGEX");
+    PRINT_AND_DUMP("-------------------------------------\n");
+    PRINT_AND_DUMP("Resolved before MEM  : %llu\n", (unsigned long long)early_resolved);
+    PRINT_AND_DUMP("Cycles saved         : %llu\n", (unsigned long long)resolve_cycles_saved);
+    PRINT_AND_DUMP("\n");
+  }
+
+  if (fusion_enabled)
+  {
+    PRINT_AND_DUMP("\nMacro-op fusion :\n");
+    PRINT_AND_DUMP("-------------------------------------\n");
+    PRINT_AND_DUMP("Branches issued      : %llu\n", (unsigned long long)branches_issued);
+    PRINT_AND_DUMP("Fused with ALU op    : %llu (%.1f%%)\n", (unsigned long long)fused_branches,
+                   branches_issued ? 100.0 * fused_branches / branches_issued : 0.0);
+    PRINT_AND_DUMP("Stall cycles saved   : %llu\n", (unsigned long long)fusion_cycles_saved);
+    PRINT_AND_DUMP("\n");
+  }
+
+  if (simulator().memory().IsDataCacheNonBlocking())
+  {
+    PRINT_AND_DUMP("\nLoads under miss :\n");
+    PRINT_AND_DUMP("-------------------------------------\n");
+    PRINT_AND_DUMP("Loads past a miss    : %llu\n", (unsigned long long)loads_past_miss);
+    PRINT_AND_DUMP("Decode waiting       : %llu\n", (unsigned long long)pending_load_stalls);
+    PRINT_AND_DUMP("\n");
+  }
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : CpiStack                                        */
+/*                                                             */
+/* Purpose   : Dump the cycles charged to each cause and their */
+/*             share of the CPI to the output file.            */
+/*                                                             */
+/***************************************************************/
+void PipeLine::CpiStack(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  static const char * causes[] = { "Base                 :", "I-cache miss         :", "Dependency, register :",
+                                   "Dependency, CC       :", "Control, MEM         :", "Control, AGEX        :",
+                                   "Control, split stage :", "Control, DE          :", "D-cache miss         :",
+                                   "Empty pipeline       :" };
+  uint64_t cycles = 0;
+  for (auto count : cpi_stack)
+    cycles += count;
+
+  PRINT_AND_DUMP("\nCPI stack (%llu cycles, %llu instructions) :\n", (unsigned long long)cycles,
+                 (unsigned long long)retired_instructions);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  for (auto i = 0; i < NUM_CPI_CAUSES; i++)
+    PRINT_AND_DUMP("%s %llu (CPI %.3f, %.1f%%)\n", causes[i], (unsigned long long)cpi_stack[i],
+                   retired_instructions ? (double)cpi_stack[i] / retired_instructions : 0.0,
+                   cycles ? 100.0 * cpi_stack[i] / cycles : 0.0);
+  PRINT_AND_DUMP("CPI                  : %.3f\n", retired_instructions ? (double)cycles / retired_instructions : 0.0);
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Serialize                                       */
+/*                                                             */
+/* Purpose   : Write or read the latches, the scoreboard and   */
+/*             the queues. The instructions they hold go to    */
+/*             the table of the checkpoint.                    */
+/*                                                             */
+/***************************************************************/
+void PipeLine::Serialize(Checkpoint & cp)
+{
+  for (auto state : { &PS, &NEW_PS })
+  {
+    for (auto & entry : *state)
+    {
+      cp.Value(entry->V);
+      cp.Bits(entry->AGEX_CS);
+      cp.Bits(entry->MEM_CS);
+      cp.Bits(entry->SR_CS);
+      cp.Reference(entry->instruction);
+    }
+  }
+
+  cp.Value(fetch_seq);
+  cp.Value(retired_instructions);
+  cp.Value(scoreboard);
+  for (auto i = 0; i < SCOREBOARD_NAMES; i++)
+    cp.Value(scoreboard_writers[i]);
+
+  cp.Size(fetch_queue);
+  for (auto & inst : fetch_queue)
+    cp.Reference(inst);
+  cp.Value(fetch_queue_full);
+  cp.Value(fetch_queue_control);
+
+  cp.Size(pending_loads);
+  for (auto & load : pending_loads)
+  {
+    cp.Reference(load.instruction);
+    cp.Value(load.ready_cycle);
+    cp.Bits(load.drid);
+    cp.Bits(load.data);
+    cp.Value(load.ld_reg);
+    cp.Value(load.ld_cc);
+  }
+
+  cp.Size(owed_bubbles);
+  for (auto & cause : owed_bubbles)
+    cp.Value(cause);
+
+  //the timing diagram starts over at the restored cycle, the pending
+  //loads wake the simulator up again
+  if (cp.IsRestoring())
+  {
+    instruction_history.clear();
+    pending_stage.clear();
+    queue_stage.clear();
+    last_signature.clear();
+    idle = false;
+    for (auto & load : pending_loads)
+      simulator().events().Schedule(load.ready_cycle);
+  }
 }
\ No newline at end of file
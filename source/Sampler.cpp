@@ -0,0 +1,241 @@
+/***************************************************************/
+/* Sampler Implementaion                                       */
+/***************************************************************/
+
+#include <math.h>
+#include <algorithm>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/State.h"
+    #include "../include/PipeLine.h"
+    #include "../include/FunctionalCore.h"
+    #include "../include/GoldenChecker.h"
+    #include "../include/IntervalModel.h"
+    #include "../include/Statistics.h"
+    #include "../include/Sampler.h"
+#else
+    #include "Simulator.h"
+    #include "State.h"
+    #include "PipeLine.h"
+    #include "FunctionalCore.h"
+    #include "GoldenChecker.h"
+    #include "IntervalModel.h"
+    #include "Statistics.h"
+    #include "Sampler.h"
+#endif
+
+Sampler::Sampler(Simulator & instance) :
+_simulator(instance),
+enabled(false)
+{
+
+}
+
+/*
+* Take the unit, window and warm-up lengths and the target error from
+* the configuration
+*/
+void Sampler::init_sampler()
+{
+  auto & config = simulator().config();
+  enabled = config.sample_period > 0;
+  period = config.sample_period;
+  window = config.sample_window;
+  warmup = config.sample_warmup;
+  target = config.sample_error / 100.0;
+  converged = false;
+  samples.clear();
+  functional_instructions = 0;
+  detailed_instructions = 0;
+  detailed_cycles = 0;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : Run                                             */
+/*                                                             */
+/* Purpose   : Sample the program until HALT, or until         */
+/*             max_instructions ran if it is not 0. Return     */
+/*             true if the program halted.                     */
+/*                                                             */
+/***************************************************************/
+bool Sampler::Run(uint64_t max_instructions)
+{
+  auto & state = simulator().state();
+  auto running = [&]() { return state.GetProgramCounter().to_num() != 0x0000; };
+
+  while (running())
+  {
+    if (max_instructions && GetInstructions() >= max_instructions)
+      return false;
+    auto budget = max_instructions ? max_instructions - GetInstructions() : UINT64_MAX;
+
+    //once the target is met the functional core runs the rest cold
+    if (converged)
+    {
+      Warm(budget);
+      continue;
+    }
+
+    //a window that the program or the limit cuts short is no sample
+    Warm(std::min(budget, period - warmup - window));
+    budget = max_instructions ? max_instructions - GetInstructions() : UINT64_MAX;
+    if (!running() || !Detailed(std::min(budget, warmup)) || budget <= warmup)
+      continue;
+    auto cycles = detailed_cycles;
+    auto instructions = detailed_instructions;
+    if (!Detailed(std::min(budget - warmup, window)) || budget - warmup < window)
+      continue;
+    samples.push_back((double)(detailed_cycles - cycles) / (detailed_instructions - instructions));
+
+    if (target && samples.size() >= SAMPLE_MIN_WINDOWS && GetCpiError() <= target)
+      converged = true;
+  }
+
+  simulator().halt();
+  return true;
+}
+
+/*
+* Run the pipeline until count more instructions retired, return false
+* if the program halted first
+*/
+bool Sampler::Detailed(uint64_t count)
+{
+  auto & pipeline = simulator().pipeline();
+  auto retired = pipeline.GetRetiredInstructions();
+  auto cycles = simulator().GetCycles();
+
+  while (simulator().state().GetProgramCounter().to_num() != 0x0000 &&
+         pipeline.GetRetiredInstructions() - retired < count)
+  {
+    simulator().cycle();
+    simulator().skip_idle(0);
+  }
+
+  detailed_instructions += pipeline.GetRetiredInstructions() - retired;
+  detailed_cycles += simulator().GetCycles() - cycles;
+  return simulator().state().GetProgramCounter().to_num() != 0x0000;
+}
+
+/*
+* Flush the pipeline and run count instructions on the functional core,
+* handing them to the interval model to warm the caches and predictor
+* unless sampling is over
+*/
+void Sampler::Warm(uint64_t count)
+{
+  auto & pipeline = simulator().pipeline();
+  auto & state = simulator().state();
+  auto retired = pipeline.GetRetiredInstructions();
+  pipeline.Flush();
+  detailed_instructions += pipeline.GetRetiredInstructions() - retired;
+
+  auto model = converged ? nullptr : &simulator().interval();
+  auto executed = simulator().functional().Run(count, NO_STOP_PC, model);
+  if (model)
+    model->Finish(state.GetProgramCounter().to_num());
+  simulator().checker().Sync(true);
+
+  //the halting TRAP does not retire on the pipeline either
+  if (executed && state.GetProgramCounter().to_num() == 0x0000)
+    executed--;
+  functional_instructions += executed;
+}
+
+/*
+* Mean CPI of the windows
+*/
+double Sampler::GetCpi() const
+{
+  double sum = 0;
+  for (auto cpi : samples)
+    sum += cpi;
+  return samples.empty() ? 0.0 : sum / samples.size();
+}
+
+/*
+* Half the 95% confidence interval of the CPI, relative to it. Unknown,
+* 0, with fewer than two windows.
+*/
+double Sampler::GetCpiError() const
+{
+  auto mean = GetCpi();
+  if (samples.size() < 2 || mean == 0)
+    return 0.0;
+  double squares = 0;
+  for (auto cpi : samples)
+    squares += (cpi - mean) * (cpi - mean);
+  auto deviation = sqrt(squares / (samples.size() - 1));
+  return SAMPLE_Z * deviation / sqrt((double)samples.size()) / mean;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the CPI and cycle estimates with their     */
+/*             confidence interval.                            */
+/*                                                             */
+/***************************************************************/
+void Sampler::dump(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  auto cpi = GetCpi();
+  auto error = GetCpiError();
+  PRINT_AND_DUMP("\nSampling (%zu windows of %llu instructions, one every %llu) :\n", samples.size(),
+                 (unsigned long long)window, (unsigned long long)period);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  PRINT_AND_DUMP("CPI                  : %.3f +- %.3f (%.2f%%, 95%% confidence)\n", cpi, cpi * error, 100.0 * error);
+  PRINT_AND_DUMP("Estimated cycles     : %.0f +- %.0f\n", GetCycles(), GetCycles() * error);
+  PRINT_AND_DUMP("Instructions         : %llu (%llu functional, %llu detailed)\n",
+                 (unsigned long long)GetInstructions(), (unsigned long long)functional_instructions,
+                 (unsigned long long)detailed_instructions);
+  PRINT_AND_DUMP("Detailed cycles      : %d\n", detailed_cycles);
+  if (target && converged)
+    PRINT_AND_DUMP("Target error         : %.2f%%, met after %zu windows\n", 100.0 * target, samples.size());
+  else if (target && samples.size() >= 2)
+  {
+    //the windows needed shrink with the square of the error
+    auto needed = (uint64_t)ceil(samples.size() * (error / target) * (error / target));
+    needed = std::max<uint64_t>(needed, SAMPLE_MIN_WINDOWS);
+    PRINT_AND_DUMP("Target error         : %.2f%%, not met, about %llu windows needed (-sample %llu)\n",
+                   100.0 * target, (unsigned long long)needed,
+                   (unsigned long long)std::max<uint64_t>(window + warmup, GetInstructions() / needed));
+  }
+  else if (target)
+    PRINT_AND_DUMP("Target error         : %.2f%%, not met, too few windows\n", 100.0 * target);
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the estimates. They are formulas, a    */
+/*             stats reset does not drop the windows taken.    */
+/*                                                             */
+/***************************************************************/
+void Sampler::RegisterStats(Statistics & stats)
+{
+  stats.AddFormula("sample.windows", "windows measured", [this]() { return (double)samples.size(); });
+  stats.AddFormula("sample.cpi", "mean CPI of the windows", [this]() { return GetCpi(); });
+  stats.AddFormula("sample.cpi_error", "half the 95% confidence interval of the CPI, relative to it",
+                   [this]() { return GetCpiError(); });
+  stats.AddFormula("sample.cycles", "estimated cycles of all instructions run", [this]() { return GetCycles(); });
+  stats.AddFormula("sample.instructions", "instructions run", [this]() { return (double)GetInstructions(); });
+  stats.AddFormula("sample.functional_instructions", "instructions run on the functional core",
+                   [this]() { return (double)functional_instructions; });
+  stats.AddFormula("sample.detailed_instructions", "instructions retired by the pipeline",
+                   [this]() { return (double)detailed_instructions; });
+  stats.AddFormula("sample.detailed_cycles", "cycles the pipeline ran", [this]() { return (double)detailed_cycles; });
+}
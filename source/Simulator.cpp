@@ -2,17 +2,44 @@
 /* Simulator Implementaion                                     */
 /***************************************************************/
 
+#include <limits.h>
+#include <algorithm>
+#include <vector>
 #ifdef __linux__
     #include "../include/PipeLine.h"
     #include "../include/MainMemory.h"
     #include "../include/State.h"
     #include "../include/MicroSequencer.h"
+    #include "../include/BranchPredictor.h"
+    #include "../include/OutOfOrderCore.h"
+    #include "../include/StoreBuffer.h"
+    #include "../include/Statistics.h"
+    #include "../include/InstructionMix.h"
+    #include "../include/FunctionalCore.h"
+    #include "../include/JitCompiler.h"
+    #include "../include/Checkpoint.h"
+    #include "../include/GoldenChecker.h"
+    #include "../include/EventQueue.h"
+    #include "../include/IntervalModel.h"
+    #include "../include/Sampler.h"
     #include "../include/Simulator.h"
 #else
     #include "PipeLine.h"
     #include "MainMemory.h"
     #include "State.h"
     #include "MicroSequencer.h"
+    #include "BranchPredictor.h"
+    #include "OutOfOrderCore.h"
+    #include "StoreBuffer.h"
+    #include "Statistics.h"
+    #include "InstructionMix.h"
+    #include "FunctionalCore.h"
+    #include "JitCompiler.h"
+    #include "Checkpoint.h"
+    #include "GoldenChecker.h"
+    #include "EventQueue.h"
+    #include "IntervalModel.h"
+    #include "Sampler.h"
     #include "Simulator.h"
 #endif
 
@@ -20,14 +47,51 @@
 * Simulator constructor
 */
 Simulator::Simulator() :
+console_file(stdout),
+dump_file(nullptr),
 CYCLE_COUNT(0),
-RUN_BIT(0),
-dump_file(nullptr)
+RUN_BIT(0)
 {
   CpuPipeline = std::make_shared<PipeLine>(*this);
   CpuMemory = std::make_shared<MainMemory>(*this);
   CpuState = std::make_shared<State>(*this);
   CpuMicroSequencer = std::make_shared<MicroSequencer>(*this);
+  CpuBranchPredictor = std::make_shared<BranchPredictor>(*this);
+  CpuOutOfOrderCore = std::make_shared<OutOfOrderCore>(*this);
+  CpuStoreBuffer = std::make_shared<StoreBuffer>(*this);
+  CpuStatistics = std::make_shared<Statistics>(*this);
+  CpuInstructionMix = std::make_shared<InstructionMix>(*this);
+  CpuFunctionalCore = std::make_shared<FunctionalCore>(*this);
+  CpuJitCompiler = std::make_shared<JitCompiler>(*this);
+  CpuGoldenChecker = std::make_shared<GoldenChecker>(*this);
+  CpuEventQueue = std::make_shared<EventQueue>(*this);
+  CpuIntervalModel = std::make_shared<IntervalModel>(*this);
+  CpuSampler = std::make_shared<Sampler>(*this);
+}
+
+/*
+* printf to the console, if the simulator has one
+*/
+void Simulator::Print(const char * format, ...)
+{
+  if (console_file == nullptr)
+    return;
+  va_list args;
+  va_start(args, format);
+  vfprintf(console_file, format, args);
+  va_end(args);
+}
+
+/*
+* Instructions retired by the selected core
+*/
+uint64_t Simulator::GetRetiredInstructions()
+{
+  if (IsOutOfOrder())
+    return ooo().GetRetiredInstructions();
+  if (IsInterval())
+    return interval().GetRetiredInstructions();
+  return pipeline().GetRetiredInstructions();
 }
 
 /***************************************************************/
@@ -39,15 +103,30 @@ dump_file(nullptr)
 /***************************************************************/
 void Simulator::help()
 {
-    printf("----------------LC-3bSIM Help-----------------------\n");
-    printf("go               -  run program to completion       \n");
-    printf("run n            -  execute program for n cycles    \n");
-    printf("mdump low high   -  dump memory from low to high    \n");
-    printf("rdump            -  dump the architectural state    \n");
-    printf("idump            -  dump the internal state         \n");
-    printf("cdump            -  dump the control store state    \n");
-    printf("?                -  display this help menu          \n");
-    printf("quit             -  exit the program                \n\n");
+    Print("----------------LC-3bSIM Help-----------------------\n");
+    Print("go               -  run program to completion       \n");
+    Print("run n            -  execute program for n cycles    \n");
+    Print("ff n             -  fast-forward n instructions     \n");
+    Print("                    without timing                  \n");
+    Print("ffpc addr        -  fast-forward until the PC is    \n");
+    Print("                    addr                            \n");
+    Print("mdump low high   -  dump memory from low to high    \n");
+    Print("mix              -  dump the instruction mix and    \n");
+    Print("                    latencies                       \n");
+    Print("rdump            -  dump the architectural state    \n");
+    Print("idump            -  dump the internal state         \n");
+    Print("cdump            -  dump the control store state    \n");
+    Print("cpi              -  dump the CPI stack              \n");
+    Print("stats dump       -  dump the statistics             \n");
+    Print("stats reset      -  zero the statistics             \n");
+    Print("stats interval n -  snapshot the statistics every n \n");
+    Print("                    cycles, 0 stops                 \n");
+    Print("stats json file  -  write the statistics as JSON    \n");
+    Print("stats csv file   -  write the statistics as CSV     \n");
+    Print("checkpoint file  -  save the simulator to file      \n");
+    Print("restore file     -  resume the simulator from file  \n");
+    Print("?                -  display this help menu          \n");
+    Print("quit             -  exit the program                \n\n");
 }
 
 
@@ -60,8 +139,49 @@ void Simulator::help()
 /***************************************************************/
 void Simulator::cycle()
 {
-  pipeline().Cycle();
+  if (IsOutOfOrder())
+    ooo().Cycle();
+  else
+    pipeline().Cycle();
+  memory().Cycle();
   CYCLE_COUNT++;
+  statistics().Cycle();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : skip_idle                                       */
+/*                                                             */
+/* Purpose   : After an idle cycle, simulate one more to learn */
+/*             what an idle cycle counts and jump to the next  */
+/*             event, or to stop_cycle if it is not 0 and      */
+/*             comes first.                                    */
+/*                                                             */
+/***************************************************************/
+void Simulator::skip_idle(int stop_cycle)
+{
+  if (!events().IsEnabled() || !pipeline().IsIdle())
+    return;
+
+  //without an event the pipeline is stuck, simulate it as it is
+  auto next = events().NextEvent(CYCLE_COUNT);
+  if (stop_cycle)
+    next = std::min(next, stop_cycle);
+  if (next == INT_MAX || next - CYCLE_COUNT < MIN_IDLE_SKIP)
+    return;
+
+  std::vector<uint64_t> before, after;
+  statistics().Capture(before);
+  cycle();
+  statistics().Capture(after);
+  if (!pipeline().IsIdle() || before.size() != after.size())
+    return;
+
+  auto cycles = next - CYCLE_COUNT;
+  statistics().Repeat(before, after, cycles);
+  pipeline().SkipIdle(cycles);
+  CYCLE_COUNT += cycles;
+  events().Skipped(cycles);
 }
 
 /***************************************************************/
@@ -75,21 +195,29 @@ void Simulator::run(int num_cycles)
 {
   if (RUN_BIT == FALSE)
   {
-    printf("Can't simulate, Simulator is halted\n\n");
+    Print("Can't simulate, Simulator is halted\n\n");
   return;
   }
 
-  printf("Simulating for %d cycles...\n\n", num_cycles);
-  for (auto i = 0; i < num_cycles; i++)
+  Print("Simulating for %d cycles...\n\n", num_cycles);
+  auto stop_cycle = CYCLE_COUNT + num_cycles;
+  if (IsInterval())
+  {
+    if (estimate(stop_cycle, 0))
+      Print("Simulator halted\n\n");
+    return;
+  }
+  while (CYCLE_COUNT < stop_cycle)
   {
     if (state().GetProgramCounter().to_num() == 0x0000)
     {
       cycle();
-      RUN_BIT = FALSE;
-      printf("Simulator halted\n\n");
+      halt();
+      Print("Simulator halted\n\n");
       break;
     }
     cycle();
+    skip_idle(stop_cycle);
   }
 }
 
@@ -104,37 +232,232 @@ void Simulator::go()
 {
   if ((RUN_BIT == FALSE) || (state().GetProgramCounter().to_num() == 0x0000))
   {
-	  printf("Can't simulate, Simulator is halted\n\n");
+	  Print("Can't simulate, Simulator is halted\n\n");
 	  return;
   }
 
-  printf("Simulating...\n\n");
-  /* initialization */
+  Print("Simulating...\n\n");
+  simulate(0, 0);
+  if (IsOutOfOrder())
+    ooo().DumpHistory();
+  else if (!IsInterval())
+    pipeline().DumpHistory();
+  if (predictor().IsEnabled())
+    predictor().dump(dump_file);
+  if (IsOutOfOrder())
+    ooo().dump(dump_file);
+  else if (IsInterval())
+    interval().dump(dump_file);
+  else if (config().issue_width > 1 || config().fetch_queue_entries || config().mshr_entries ||
+           config().macro_fusion || config().resolve_stage != MEMORY)
+    pipeline().dump(dump_file);
+  if (!IsOutOfOrder() && !IsInterval())
+    pipeline().CpiStack(dump_file);
+  if (interval().IsValidating())
+    interval().dump(dump_file);
+  if (sampler().IsEnabled())
+    sampler().dump(dump_file);
+  if (storebuffer().IsEnabled())
+    storebuffer().dump(dump_file);
+  memory().dump(dump_file);
+  Print("\nSimulator halted\n\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : simulate                                        */
+/*                                                             */
+/* Purpose   : Cycle without printing until HALT, or until the */
+/*             limits that are not 0: max_cycles cycles or     */
+/*             max_instructions retired. Return true if the    */
+/*             program halted.                                 */
+/*                                                             */
+/***************************************************************/
+bool Simulator::simulate(int max_cycles, uint64_t max_instructions)
+{
+  if (IsInterval())
+    return estimate(max_cycles, max_instructions);
+  if (sampler().IsEnabled())
+    return sampler().Run(max_instructions);
+
   while (state().GetProgramCounter().to_num() != 0x0000)
   {
+    if (max_cycles && CYCLE_COUNT >= max_cycles)
+      return false;
+    if (max_instructions && GetRetiredInstructions() >= max_instructions)
+      return false;
     cycle();
+    skip_idle(max_cycles);
   }
 
+  halt();
+  return true;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : estimate                                        */
+/*                                                             */
+/* Purpose   : simulate with -core interval. The functional    */
+/*             core runs the program in chunks and hands each  */
+/*             instruction to the interval model, whose        */
+/*             estimate is the cycle count.                    */
+/*                                                             */
+/***************************************************************/
+bool Simulator::estimate(int max_cycles, uint64_t max_instructions)
+{
+  while (state().GetProgramCounter().to_num() != 0x0000)
+  {
+    if (max_cycles && CYCLE_COUNT >= max_cycles)
+      return false;
+    if (max_instructions && GetRetiredInstructions() >= max_instructions)
+      return false;
+
+    //before a cycle limit, half of what the CPI so far lets retire, one
+    //instruction to learn it
+    uint64_t chunk = INTERVAL_CHUNK;
+    auto retired = GetRetiredInstructions();
+    if (max_cycles && retired)
+      chunk = std::min<uint64_t>(chunk, std::max(1.0, (max_cycles - CYCLE_COUNT) * retired / (2.0 * CYCLE_COUNT)));
+    else if (max_cycles)
+      chunk = 1;
+    if (max_instructions)
+      chunk = std::min<uint64_t>(chunk, std::max<uint64_t>(1, max_instructions - retired));
+    functional().Run(chunk, NO_STOP_PC, &interval());
+    CYCLE_COUNT = interval().GetCycles();
+  }
+
+  interval().Finish(0x0000);
+  CYCLE_COUNT = interval().GetCycles();
+  halt();
+  return true;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : fast_forward                                    */
+/*                                                             */
+/* Purpose   : Execute up to count instructions on the         */
+/*             functional core, or until the PC is stop_pc.    */
+/*             The detailed core hands its architectural state */
+/*             over first and fetches from the PC the          */
+/*             functional core stopped at afterwards.          */
+/*                                                             */
+/***************************************************************/
+void Simulator::fast_forward(uint64_t count, int stop_pc)
+{
+  if ((RUN_BIT == FALSE) || (state().GetProgramCounter().to_num() == 0x0000))
+  {
+    Print("Can't simulate, Simulator is halted\n\n");
+    return;
+  }
+
+  if (IsOutOfOrder())
+    ooo().Flush();
+  else
+    pipeline().Flush();
+  interval().Finish(state().GetProgramCounter().to_num());
+
+  auto executed = functional().Run(count, stop_pc);
+
+  if (IsOutOfOrder())
+    ooo().Flush();
+  checker().Sync(true);
+  Print("Fast-forwarded %llu instructions, PC = 0x%.4x\n\n", (unsigned long long)executed,
+         state().GetProgramCounter().to_num());
+  if (state().GetProgramCounter().to_num() == 0x0000)
+  {
+    halt();
+    Print("Simulator halted\n\n");
+  }
+}
+
+/*
+* Stop the simulation. Loads still waiting on the data cache write back
+* and stores still in the store buffer are written to memory, so the
+* final state can be dumped.
+*/
+void Simulator::halt()
+{
   RUN_BIT = FALSE;
-  pipeline().DumpHistory();
-  printf("\nSimulator halted\n\n");
+  pipeline().CompletePendingLoads(true);
+  storebuffer().Flush();
+  checker().Finish();
+  interval().Finish(0x0000);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : checkpoint                                      */
+/*                                                             */
+/* Purpose   : Save everything the simulator needs to go on    */
+/*             from this cycle to filename.                    */
+/*                                                             */
+/***************************************************************/
+void Simulator::checkpoint(const char * filename)
+{
+  if (config().core != CORE_IN_ORDER)
+  {
+    Print("Checkpoints are taken of the in-order pipeline only\n\n");
+    return;
+  }
+  if (Checkpoint(*this).Save(filename))
+    Print("Checkpoint of cycle %d written to %s\n\n", CYCLE_COUNT, filename);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : restore                                         */
+/*                                                             */
+/* Purpose   : Resume from the checkpoint in filename. Decoded */
+/*             blocks are dropped and the statistics restart.  */
+/*                                                             */
+/***************************************************************/
+void Simulator::restore(const char * filename)
+{
+  if (config().core != CORE_IN_ORDER)
+  {
+    Print("Checkpoints are taken of the in-order pipeline only\n\n");
+    return;
+  }
+  if (!Checkpoint(*this).Restore(filename))
+    return;
+  functional().init_functional();
+  checker().Sync(false);
+  interval().Finish(state().GetProgramCounter().to_num());
+  statistics().Reset();
+  Print("Restored cycle %d from %s\n\n", CYCLE_COUNT, filename);
+}
+
+/*
+* The cycle count and run bit
+*/
+void Simulator::Serialize(Checkpoint & cp)
+{
+  cp.Value(CYCLE_COUNT);
+  cp.Value(RUN_BIT);
 }
 
 /***************************************************************/
 /*                                                             */
 /* Procedure : get_command                                     */
 /*                                                             */
-/* Purpose   : Read a command from standard input.             */
+/* Purpose   : Read a command from standard input, return      */
+/*             false on quit or at the end of the input.       */
 /*                                                             */
 /***************************************************************/
-void Simulator::get_command()
+bool Simulator::get_command()
 {
   char buffer[20];
   uint16_t start, stop, cycles;
 
-  printf("LC-3b-SIM> ");
-  scanf("%s", buffer);
-  printf("\n");
+  Print("LC-3b-SIM> ");
+  if (scanf("%19s", buffer) != 1)
+  {
+    Print("\nBye.\n");
+    return false;
+  }
+  Print("\n");
 
   switch(buffer[0])
   {
@@ -143,23 +466,51 @@ void Simulator::get_command()
       go();
       break;
     case 'M':
-    case 'm':
-      scanf("%i %i", &start, &stop);
-      memory().mdump(dump_file, start, stop);
+    case 'm': // Distinguish 'mdump' from 'mix'
+      if (buffer[1] == 'i' || buffer[1] == 'I')
+      {
+        mix().dump(dump_file);
+      }
+      else
+      {
+        scanf("%i %i", &start, &stop);
+        memory().mdump(dump_file, start, stop);
+      }
+      break;
+    case 'F':
+    case 'f': // Distinguish 'ff' from 'ffpc'
+      if (buffer[2] == 'p' || buffer[2] == 'P')
+      {
+        int stop_pc;
+        scanf("%i", &stop_pc);
+        fast_forward(UINT64_MAX, stop_pc);
+      }
+      else
+      {
+        unsigned long long count;
+        scanf("%llu", &count);
+        fast_forward(count, NO_STOP_PC);
+      }
       break;
     case '?':
       help();
       break;
     case 'Q':
     case 'q': // Allow 'quit'
-      printf("Bye.\n");
-      exit(0);
+      Print("Bye.\n");
+      return false;
     case 'R':
-    case 'r': // Distinguish 'rdump' from 'run'
+    case 'r': // Distinguish 'rdump' from 'run' and 'restore'
       if (buffer[1] == 'd' || buffer[1] == 'D')
       {
         state().rdump(dump_file);
       }
+      else if (buffer[1] == 'e' || buffer[1] == 'E')
+      {
+        char filename[256];
+        scanf("%255s", filename);
+        restore(filename);
+      }
       else
       {
         scanf("%d", &cycles);
@@ -168,14 +519,187 @@ void Simulator::get_command()
       break;
     case 'I':
     case 'i': // Allow 'idump'
-      pipeline().idump(dump_file);
+      if (IsOutOfOrder())
+        ooo().idump(dump_file);
+      else if (IsInterval())
+        Print("The interval model keeps no pipeline state\n\n");
+      else
+        pipeline().idump(dump_file);
       break;
     case 'C':
-    case 'c': // Allow 'cdump'
-      microsequencer().cdump(dump_file);
+    case 'c': // Distinguish 'cdump' from 'cpi' and 'checkpoint'
+      if (buffer[1] == 'h' || buffer[1] == 'H')
+      {
+        char filename[256];
+        scanf("%255s", filename);
+        checkpoint(filename);
+      }
+      else if (buffer[1] == 'p' || buffer[1] == 'P')
+      {
+        if (IsOutOfOrder())
+          Print("The CPI stack is kept by the in-order pipeline only\n\n");
+        else if (IsInterval())
+          interval().dump(dump_file);
+        else
+          pipeline().CpiStack(dump_file);
+      }
+      else
+      {
+        microsequencer().cdump(dump_file);
+      }
+      break;
+    case 'S':
+    case 's': // Allow 'stats'
+      stats_command();
       break;
     default:
-      printf("Invalid Command\n");
+      Print("Invalid Command\n");
+      break;
+  }
+  return true;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : headless                                        */
+/*                                                             */
+/* Purpose   : Run without the command prompt until HALT or    */
+/*             the -cycles/-insts limit, write the results     */
+/*             asked for and return the exit status.           */
+/*                                                             */
+/***************************************************************/
+int Simulator::headless()
+{
+  FILE * results = stdout;
+  if (!config().output_file.empty() && (results = fopen(config().output_file.c_str(), "w")) == NULL)
+    throw SimulatorError(Format("Can't open output file %s", config().output_file.c_str()));
+
+  auto halted = simulate(config().max_cycles, config().max_instructions);
+  if (config().output_format == OUTPUT_JSON)
+    write_json(results, halted);
+  else
+    write_text(results, halted);
+
+  if (results != stdout)
+    fclose(results);
+  else
+    fflush(results);
+  return halted ? HEADLESS_HALTED : HEADLESS_LIMIT;
+}
+
+/*
+* The results of a headless run in the formats of rdump, mdump and
+* stats dump, after a line saying how the run ended
+*/
+void Simulator::write_text(FILE * results, bool halted)
+{
+  fprintf(results, "Simulator %s at cycle %d after %llu instructions\n", halted ? "halted" : "stopped",
+          GetCycles(), (unsigned long long)GetRetiredInstructions());
+  if (sampler().IsEnabled())
+    fprintf(results, "Sampled CPI %.4f +- %.2f%%, estimated %.0f cycles for %llu instructions\n",
+            sampler().GetCpi(), 100.0 * sampler().GetCpiError(), sampler().GetCycles(),
+            (unsigned long long)sampler().GetInstructions());
+
+  //the console stays silent, the dumps go to results only
+  auto console = console_file;
+  console_file = nullptr;
+  if (config().dump_registers)
+    state().rdump(results);
+  for (auto & range : config().memory_dumps)
+    memory().mdump(results, range.first, range.second);
+  if (config().dump_statistics)
+    statistics().dump(results);
+  console_file = console;
+}
+
+/*
+* The results of a headless run as one JSON object
+*/
+void Simulator::write_json(FILE * results, bool halted)
+{
+  fprintf(results, "{\n  \"halted\": %s,\n  \"cycles\": %d,\n  \"instructions\": %llu",
+          halted ? "true" : "false", GetCycles(), (unsigned long long)GetRetiredInstructions());
+  if (sampler().IsEnabled())
+    fprintf(results, ",\n  \"sampled_cpi\": %.6f,\n  \"sampled_cpi_error\": %.6f,\n  \"estimated_cycles\": %.0f,"
+            "\n  \"sampled_instructions\": %llu", sampler().GetCpi(), sampler().GetCpiError(), sampler().GetCycles(),
+            (unsigned long long)sampler().GetInstructions());
+
+  if (config().dump_registers)
+  {
+    fprintf(results, ",\n  \"pc\": %d,\n  \"n\": %d,\n  \"z\": %d,\n  \"p\": %d,\n  \"registers\": [",
+            state().GetProgramCounter().to_num(), state().GetNBit(), state().GetZBit(), state().GetPBit());
+    for (auto k = 0; k < LC3b_REGS; k++)
+      fprintf(results, "%s%d", k ? ", " : "", state().GetRegisterData(k).to_num());
+    fprintf(results, "]");
+  }
+
+  if (!config().memory_dumps.empty())
+  {
+    fprintf(results, ",\n  \"memory\": [");
+    for (size_t r = 0; r < config().memory_dumps.size(); r++)
+    {
+      auto & range = config().memory_dumps[r];
+      fprintf(results, "%s\n    {\"low\": %d, \"high\": %d, \"words\": [", r ? "," : "", range.first, range.second);
+      for (auto address = range.first >> 1; address <= range.second >> 1; address++)
+      {
+        auto word = (memory().GetUpperByteAt(address).to_num() << 8) | memory().GetLowerByteAt(address).to_num();
+        fprintf(results, "%s%d", address == range.first >> 1 ? "" : ", ", word);
+      }
+      fprintf(results, "]}");
+    }
+    fprintf(results, "\n  ]");
+  }
+
+  if (config().dump_statistics)
+  {
+    fprintf(results, ",\n  \"statistics\": ");
+    statistics().WriteJSON(results);
+  }
+  else
+    fprintf(results, "\n");
+  fprintf(results, "}\n");
+}
+
+/*
+* Read the subcommand of stats: dump, reset, interval n, json file
+* or csv file
+*/
+void Simulator::stats_command()
+{
+  char action[20], filename[256];
+  int cycles;
+
+  scanf("%19s", action);
+  switch(action[0])
+  {
+    case 'D':
+    case 'd':
+      statistics().dump(dump_file);
+      break;
+    case 'R':
+    case 'r':
+      statistics().Reset();
+      Print("Statistics reset at cycle %d\n\n", GetCycles());
+      break;
+    case 'I':
+    case 'i':
+      scanf("%d", &cycles);
+      statistics().SetInterval(cycles < 0 ? 0 : cycles);
+      break;
+    case 'J':
+    case 'j':
+      scanf("%255s", filename);
+      if (statistics().WriteJSON(filename))
+        Print("Statistics written to %s\n\n", filename);
+      break;
+    case 'C':
+    case 'c':
+      scanf("%255s", filename);
+      if (statistics().WriteCSV(filename))
+        Print("Statistics written to %s\n\n", filename);
+      break;
+    default:
+      Print("Invalid Command\n");
       break;
   }
 }
@@ -195,8 +719,7 @@ void Simulator::load_program(char *program_filename)
   auto prog = fopen(program_filename, "r");
   if (prog == NULL)
   {
-    printf("Error: Can't open program file %s\n", program_filename);
-    Exit();
+    throw SimulatorError(Format("Can't open program file %s", program_filename));
   }
 
   /* Read in the program. */
@@ -206,8 +729,8 @@ void Simulator::load_program(char *program_filename)
   }
   else
   {
-    printf("Error: Program file is empty\n");
-    Exit();
+    fclose(prog);
+    throw SimulatorError("Program file is empty");
   }
 
   auto ii = 0;
@@ -217,8 +740,8 @@ void Simulator::load_program(char *program_filename)
     auto program_memory = program_base + ii;
     if (program_memory >= WORDS_IN_MEM)
     {
-      printf("Error: Program file %s is too long to fit in memory. %x\n", program_filename, ii);
-      Exit();
+      fclose(prog);
+      throw SimulatorError(Format("Program file %s is too long to fit in memory. %x", program_filename, ii));
     }
 
     bits16 instruction = word;
@@ -227,13 +750,14 @@ void Simulator::load_program(char *program_filename)
     memory().SetUpperByteAt(program_base + ii, instruction.range<15,8>());
     ii++;
   }
+  fclose(prog);
 
   if (state().GetProgramCounter().to_num() == 0)
   {
     state().SetProgramCounter(program_base << 1);
   }
 
-  printf("Read %d words from program into memory.\n\n", ii);
+  Print("Read %d words from program into memory.\n\n", ii);
 }
 
 /***************************************************************/
@@ -244,18 +768,66 @@ void Simulator::load_program(char *program_filename)
 /*             and set up initial state of the machine.        */
 /*                                                             */
 /***************************************************************/
-void Simulator::initialize(char *ucode_filename, char *program_filename, uint16_t num_prog_files)
+void Simulator::initialize(char *ucode_filename, char *program_filenames[], uint16_t num_prog_files)
 {
+  events().init_events();
   microsequencer().init_control_store(ucode_filename);
   memory().init_memory();
   state().init_state();
   pipeline().init_pipeline();
+  predictor().init_predictor();
+  storebuffer().init_store_buffer();
+  mix().init_mix();
+  functional().init_functional();
+  jit().init_jit();
+  checker().init_checker();
+  interval().init_interval();
+  sampler().init_sampler();
 
   for (auto i = 0; i < num_prog_files; i++ )
   {
-	  load_program(program_filename);
-	  while(*program_filename++ != '\0');
+	  load_program(program_filenames[i]);
   }
+  checker().Sync(true);
+
+  // the out-of-order core starts fetching at the PC of the first program
+  ooo().init_core();
+
+  // every component registers the counters of the options in use
+  statistics().init_statistics();
+  statistics().AddFormula("sim.cycles", "cycles since the statistics were reset",
+                          [this]() { return (double)statistics().GetCycles(); });
+  statistics().AddFormula("sim.instructions", "instructions retired",
+                          [this]() { return (double)GetRetiredInstructions(); });
+  statistics().AddFormula("sim.ipc", "instructions per cycle", [this]() {
+    auto cycles = statistics().GetCycles();
+    return cycles ? (double)GetRetiredInstructions() / cycles : 0.0;
+  });
+  statistics().AddFormula("sim.cpi", "cycles per instruction", [this]() {
+    auto retired = GetRetiredInstructions();
+    return retired ? (double)statistics().GetCycles() / retired : 0.0;
+  });
+  if (IsOutOfOrder())
+    ooo().RegisterStats(statistics());
+  else if (!IsInterval())
+    pipeline().RegisterStats(statistics());
+  if (interval().IsEnabled())
+    interval().RegisterStats(statistics());
+  if (sampler().IsEnabled())
+    sampler().RegisterStats(statistics());
+  if (predictor().IsEnabled())
+    predictor().RegisterStats(statistics());
+  if (storebuffer().IsEnabled())
+    storebuffer().RegisterStats(statistics());
+  memory().RegisterStats(statistics());
+  mix().RegisterStats(statistics());
+  functional().RegisterStats(statistics());
+  if (jit().IsEnabled())
+    jit().RegisterStats(statistics());
+  if (checker().IsEnabled())
+    checker().RegisterStats(statistics());
+  if (events().IsEnabled())
+    events().RegisterStats(statistics());
 
   RUN_BIT = TRUE;
 }
@@ -6,9 +6,11 @@
 #ifdef __linux__
     #include "../include/Simulator.h"
     #include "../include/State.h"
+    #include "../include/Checkpoint.h"
 #else
     #include "Simulator.h"
     #include "State.h"
+    #include "Checkpoint.h"
 #endif
 
 /***************************************************************/
@@ -23,12 +25,22 @@ void State::init_state()
   PC = 0;
   N = P = 0;
   Z = 1;
-  REGS = std::vector<bits16>(LC3b_REGS);
+  for (auto & reg : REGS)
+    reg = 0;
 
-  std::memset(&decode_sigs, 0, sizeof(PipeState_DE_stage_Struct));
-  std::memset(&agex_sigs, 0, sizeof(PipeState_AGEX_stage_Struct));
-  std::memset(&memory_sigs, 0, sizeof(PipeState_MEMORY_stage_Struct));
-  std::memset(&store_sigs, 0,sizeof(PipeState_STORE_stage_Struct));
+  init_signals();
+}
+
+/*
+* Zero the signals between the pipeline stages, as when the pipeline
+* holds no instruction
+*/
+void State::init_signals()
+{
+  std::memset(decode_sigs, 0, sizeof(decode_sigs));
+  std::memset(agex_sigs, 0, sizeof(agex_sigs));
+  std::memset(memory_sigs, 0, sizeof(memory_sigs));
+  std::memset(store_sigs, 0, sizeof(store_sigs));
   std::memset(&stall_sigs, 0, sizeof(PipeState_Hazards_Struct));
 }
 
@@ -37,40 +49,43 @@ void State::init_state()
 */
 bits3 State::GetNZP()
 {
-  auto & store_sigs = SrSignals();
   auto nzp = bits3(0);
   nzp[2] = GetNBit();
   nzp[1] = GetZBit();
   nzp[0] = GetPBit();
 
   //load new nzp bits into cpu
-  //nzp from the store stage
-  if(store_sigs.v_sr_ld_cc)
+  //nzp from the store stage, the youngest lane is loaded last
+  for(auto lane = 0; lane < MAX_ISSUE_WIDTH; lane++)
   {
-    N = store_sigs.sr_n;
-    Z = store_sigs.sr_z;
-    P = store_sigs.sr_p;
+    auto & store_sigs = SrSignals(lane);
+    if(store_sigs.v_sr_ld_cc)
+    {
+      N = store_sigs.sr_n;
+      Z = store_sigs.sr_z;
+      P = store_sigs.sr_p;
+    }
   }
 
   return nzp;
 }
 
+/*
+* Load the N Z P bits directly, used by cores that write back at commit
+*/
+void State::SetNZP(const bits3 & nzp)
+{
+  N = nzp[2];
+  Z = nzp[1];
+  P = nzp[0];
+}
+
 /*
 * Move the data into the requested register
 */
 void State::SetDataForRegister(const bits3 & reg, const bits16 & data)
 {
-  try
-  {
-    REGS.at(reg.to_num()) = data;
-  }
-  catch (const std::out_of_range& oor)
-  {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: Invalid Register: reg=%d\n",reg.to_num());
-    printf("C++ error code : %s\n",oor.what());
-    Exit();
-  }
+  REGS[reg.to_num()] = data;
 }
 
 /*
@@ -78,17 +93,7 @@ void State::SetDataForRegister(const bits3 & reg, const bits16 & data)
 */
 bits16 State::GetRegisterData(const bits3 & reg) const
 {
-  try
-  {
-    return REGS.at(reg.to_num());
-  }
-  catch (const std::out_of_range& oor)
-  {
-    printf("\n********* C++ exception *********\n");
-    printf("Error: Invalid Register: reg=%d\n",reg.to_num());
-    printf("C++ error code : %s\n",oor.what());
-    Exit();
-  }
+  return REGS[reg.to_num()];
 }
 
 /***************************************************************/
@@ -101,18 +106,18 @@ bits16 State::GetRegisterData(const bits3 & reg) const
 /***************************************************************/
 void State::rdump(FILE * dumpsim_file)
 {
-  printf("\nCurrent architectural state :\n");
-  printf("-------------------------------------\n");
-  printf("Cycle Count : %d\n", simulator().GetCycles());
-  printf("CpuState.GetProgramCounter()          : 0x%04x\n", GetProgramCounter().to_num());
-  printf("CCs: N = %d  Z = %d  P = %d\n", GetNBit(), GetZBit(), GetPBit());
-  printf("Registers:\n");
+  simulator().Print("\nCurrent architectural state :\n");
+  simulator().Print("-------------------------------------\n");
+  simulator().Print("Cycle Count : %d\n", simulator().GetCycles());
+  simulator().Print("CpuState.GetProgramCounter()          : 0x%04x\n", GetProgramCounter().to_num());
+  simulator().Print("CCs: N = %d  Z = %d  P = %d\n", GetNBit(), GetZBit(), GetPBit());
+  simulator().Print("Registers:\n");
   for (auto k = 0; k < LC3b_REGS; k++)
   {
-	  printf("%d: 0x%04x\n", k, GetRegisterData(k).to_num());
+	  simulator().Print("%d: 0x%04x\n", k, GetRegisterData(k).to_num());
   }
 
-  printf("\n");
+  simulator().Print("\n");
 
   /* dump the state information into the dumpsim file */
   fprintf(dumpsim_file, "\nCurrent architectural state :\n");
@@ -128,4 +133,61 @@ void State::rdump(FILE * dumpsim_file)
 
   fprintf(dumpsim_file, "\n");
   fflush(dumpsim_file);
-}
\ No newline at end of file
+}
+
+/*
+* The registers, condition codes and the signals the stages hand back
+* to earlier ones
+*/
+void State::Serialize(Checkpoint & cp)
+{
+  for (auto k = 0; k < LC3b_REGS; k++)
+    cp.Bits(REGS[k]);
+  cp.Bits(PC);
+  cp.Value(N);
+  cp.Value(Z);
+  cp.Value(P);
+
+  for (auto lane = 0; lane < MAX_ISSUE_WIDTH; lane++)
+  {
+    auto & de = decode_sigs[lane];
+    cp.Bits(de.de_ucode);
+    cp.Bits(de.de_sr1_data);
+    cp.Bits(de.de_sr2_data);
+    cp.Bits(de.de_sr1);
+    cp.Bits(de.de_sr2);
+    cp.Bits(de.de_cc);
+
+    auto & agex = agex_sigs[lane];
+    cp.Value(agex.v_agex_ld_reg);
+    cp.Value(agex.v_agex_ld_cc);
+    cp.Bits(agex.agex_drid);
+
+    auto & mem = memory_sigs[lane];
+    cp.Bits(mem.target_pc);
+    cp.Bits(mem.trap_pc);
+    cp.Bits(mem.mem_pc_mux);
+    cp.Value(mem.v_mem_ld_cc);
+    cp.Value(mem.v_mem_ld_reg);
+    cp.Bits(mem.mem_drid);
+
+    auto & sr = store_sigs[lane];
+    cp.Value(sr.sr_n);
+    cp.Value(sr.sr_z);
+    cp.Value(sr.sr_p);
+    cp.Value(sr.v_sr_ld_cc);
+    cp.Value(sr.v_sr_ld_reg);
+    cp.Bits(sr.sr_reg_data);
+    cp.Bits(sr.sr_drid);
+  }
+
+  cp.Value(stall_sigs.dep_stall);
+  cp.Value(stall_sigs.v_de_br_stall);
+  cp.Value(stall_sigs.v_agex_br_stall);
+  cp.Value(stall_sigs.v_mem_br_stall);
+  cp.Value(stall_sigs.v_sub_br_stall);
+  cp.Value(stall_sigs.v_resolve_br_stall);
+  cp.Value(stall_sigs.pair_stall);
+  cp.Value(stall_sigs.mem_stall);
+  cp.Value(stall_sigs.icache_r);
+}
@@ -0,0 +1,409 @@
+/***************************************************************/
+/* Statistics Registry Implementaion                           */
+/***************************************************************/
+
+#include <cmath>
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/Statistics.h"
+    #include "../include/EventQueue.h"
+#else
+    #include "Simulator.h"
+    #include "Statistics.h"
+    #include "EventQueue.h"
+#endif
+
+Statistics::Statistics(Simulator & instance) :
+_simulator(instance),
+reset_cycle(0),
+interval(0)
+{
+
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_statistics                                 */
+/*                                                             */
+/* Purpose   : Forget the registered statistics, the           */
+/*             components register theirs again                */
+/*                                                             */
+/***************************************************************/
+void Statistics::init_statistics()
+{
+  stats.clear();
+  snapshots.clear();
+  reset_cycle = 0;
+  interval = 0;
+}
+
+void Statistics::AddScalar(const std::string & name, const std::string & description, uint64_t & counter)
+{
+  StatEntry entry;
+  entry.kind = STAT_SCALAR;
+  entry.name = name;
+  entry.description = description;
+  entry.counters = &counter;
+  entry.buckets = nullptr;
+  stats.push_back(entry);
+}
+
+void Statistics::AddVector(const std::string & name, const std::string & description, uint64_t * counters,
+                           const std::vector<std::string> & labels)
+{
+  StatEntry entry;
+  entry.kind = STAT_VECTOR;
+  entry.name = name;
+  entry.description = description;
+  entry.counters = counters;
+  entry.labels = labels;
+  entry.buckets = nullptr;
+  stats.push_back(entry);
+}
+
+void Statistics::AddHistogram(const std::string & name, const std::string & description, std::vector<uint64_t> & buckets)
+{
+  StatEntry entry;
+  entry.kind = STAT_HISTOGRAM;
+  entry.name = name;
+  entry.description = description;
+  entry.counters = nullptr;
+  entry.buckets = &buckets;
+  stats.push_back(entry);
+}
+
+void Statistics::AddFormula(const std::string & name, const std::string & description, const std::function<double()> & formula)
+{
+  StatEntry entry;
+  entry.kind = STAT_FORMULA;
+  entry.name = name;
+  entry.description = description;
+  entry.counters = nullptr;
+  entry.buckets = nullptr;
+  entry.formula = formula;
+  stats.push_back(entry);
+}
+
+/*
+* Cycles simulated since the last reset
+*/
+int Statistics::GetCycles() const
+{
+  return _simulator.GetCycles() - reset_cycle;
+}
+
+/*
+* Zero every registered counter and start counting cycles again
+*/
+void Statistics::Reset()
+{
+  for (auto & stat : stats)
+  {
+    switch (stat.kind)
+    {
+      case STAT_SCALAR:
+        *stat.counters = 0;
+        break;
+      case STAT_VECTOR:
+        for (size_t i = 0; i < stat.labels.size(); i++)
+          stat.counters[i] = 0;
+        break;
+      case STAT_HISTOGRAM:
+        for (auto & bucket : *stat.buckets)
+          bucket = 0;
+        break;
+      default:
+        break;
+    }
+  }
+  reset_cycle = simulator().GetCycles();
+  snapshots.clear();
+  ScheduleSnapshot();
+}
+
+/*
+* Take a snapshot every n cycles from now on, 0 stops
+*/
+void Statistics::SetInterval(int cycles)
+{
+  interval = cycles;
+  ScheduleSnapshot();
+}
+
+/*
+* Wake the simulator up for the cycle that ends the current interval
+*/
+void Statistics::ScheduleSnapshot()
+{
+  if (!interval)
+    return;
+  auto next = (GetCycles() / interval + 1) * interval;
+  simulator().events().Schedule(reset_cycle + next - 1);
+}
+
+/*
+* Called once a cycle, records a snapshot at the end of every interval
+*/
+void Statistics::Cycle()
+{
+  if (!interval || GetCycles() % interval)
+    return;
+
+  std::vector<std::string> names;
+  StatSnapshot snapshot;
+  snapshot.cycle = simulator().GetCycles();
+  Flatten(names, snapshot.values);
+  snapshots.push_back(snapshot);
+  ScheduleSnapshot();
+}
+
+/*
+* The value of every counter, vector counter and histogram bucket, in
+* registration order
+*/
+void Statistics::Capture(std::vector<uint64_t> & counters) const
+{
+  counters.clear();
+  for (auto & stat : stats)
+  {
+    switch (stat.kind)
+    {
+      case STAT_SCALAR:
+        counters.push_back(*stat.counters);
+        break;
+      case STAT_VECTOR:
+        counters.insert(counters.end(), stat.counters, stat.counters + stat.labels.size());
+        break;
+      case STAT_HISTOGRAM:
+        counters.insert(counters.end(), stat.buckets->begin(), stat.buckets->end());
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/*
+* Count what happened between the captures before and after times more,
+* as if the cycles in between had been simulated again
+*/
+void Statistics::Repeat(const std::vector<uint64_t> & before, const std::vector<uint64_t> & after, int times)
+{
+  size_t i = 0;
+  auto repeat = [&](uint64_t & counter) {
+    counter += (after[i] - before[i]) * times;
+    i++;
+  };
+  for (auto & stat : stats)
+  {
+    switch (stat.kind)
+    {
+      case STAT_SCALAR:
+        repeat(*stat.counters);
+        break;
+      case STAT_VECTOR:
+        for (size_t j = 0; j < stat.labels.size(); j++)
+          repeat(stat.counters[j]);
+        break;
+      case STAT_HISTOGRAM:
+        for (auto & bucket : *stat.buckets)
+          repeat(bucket);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/*
+* One name and value per scalar, formula, vector counter and
+* histogram bucket, in registration order
+*/
+void Statistics::Flatten(std::vector<std::string> & names, std::vector<double> & values)
+{
+  for (auto & stat : stats)
+  {
+    switch (stat.kind)
+    {
+      case STAT_SCALAR:
+        names.push_back(stat.name);
+        values.push_back(*stat.counters);
+        break;
+      case STAT_VECTOR:
+        for (size_t i = 0; i < stat.labels.size(); i++)
+        {
+          names.push_back(stat.name + "::" + stat.labels[i]);
+          values.push_back(stat.counters[i]);
+        }
+        break;
+      case STAT_HISTOGRAM:
+        for (size_t i = 0; i < stat.buckets->size(); i++)
+        {
+          names.push_back(stat.name + "::" + std::to_string(i));
+          values.push_back((*stat.buckets)[i]);
+        }
+        break;
+      case STAT_FORMULA:
+        names.push_back(stat.name);
+        values.push_back(stat.formula());
+        break;
+    }
+  }
+}
+
+/*
+* Counters print as integers, ratios with six significant digits
+*/
+static std::string FormatValue(double value)
+{
+  char text[32];
+  if (std::isnan(value) || std::isinf(value))
+    snprintf(text, sizeof(text), "0");
+  else if (value == std::floor(value) && std::fabs(value) < 1e15)
+    snprintf(text, sizeof(text), "%.0f", value);
+  else
+    snprintf(text, sizeof(text), "%.6g", value);
+  return text;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump every registered statistic to the output   */
+/*             file, one line per value.                       */
+/*                                                             */
+/***************************************************************/
+void Statistics::dump(FILE * dumpsim_file)
+{
+  std::vector<std::string> names;
+  std::vector<double> values;
+  Flatten(names, values);
+
+  std::vector<FILE *> files;
+  if (simulator().console())
+    files.push_back(simulator().console());
+  if (dumpsim_file)
+    files.push_back(dumpsim_file);
+
+  for (auto file : files)
+  {
+    fprintf(file, "\nStatistics (%d cycles since reset) :\n", GetCycles());
+    fprintf(file, "-------------------------------------\n");
+    size_t flat = 0;
+    for (auto & stat : stats)
+    {
+      auto count = stat.kind == STAT_VECTOR ? stat.labels.size() :
+                   stat.kind == STAT_HISTOGRAM ? stat.buckets->size() : 1;
+      for (size_t i = 0; i < count; i++, flat++)
+      {
+        if (i == 0)
+          fprintf(file, "%-44s %-12s # %s\n", names[flat].c_str(), FormatValue(values[flat]).c_str(), stat.description.c_str());
+        else
+          fprintf(file, "%-44s %s\n", names[flat].c_str(), FormatValue(values[flat]).c_str());
+      }
+    }
+    fprintf(file, "\n");
+    fflush(file);
+  }
+}
+
+/*
+* Write the statistics as a JSON object keyed by their dotted names.
+* Vectors become objects keyed by label and histograms arrays, the
+* snapshots taken so far are listed under "intervals".
+*/
+bool Statistics::WriteJSON(const char * filename)
+{
+  auto file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    simulator().Print("Error: Can't open statistics file %s\n", filename);
+    return false;
+  }
+  WriteJSON(file);
+  fclose(file);
+  return true;
+}
+
+/*
+* The JSON object of the statistics, written to an open file
+*/
+void Statistics::WriteJSON(FILE * file)
+{
+  fprintf(file, "{\n  \"cycles\": %d,\n  \"stats\": {", GetCycles());
+  for (size_t s = 0; s < stats.size(); s++)
+  {
+    auto & stat = stats[s];
+    fprintf(file, "%s\n    \"%s\": ", s ? "," : "", stat.name.c_str());
+    switch (stat.kind)
+    {
+      case STAT_SCALAR:
+        fprintf(file, "%llu", (unsigned long long)*stat.counters);
+        break;
+      case STAT_VECTOR:
+        fprintf(file, "{");
+        for (size_t i = 0; i < stat.labels.size(); i++)
+          fprintf(file, "%s\"%s\": %llu", i ? ", " : "", stat.labels[i].c_str(), (unsigned long long)stat.counters[i]);
+        fprintf(file, "}");
+        break;
+      case STAT_HISTOGRAM:
+        fprintf(file, "[");
+        for (size_t i = 0; i < stat.buckets->size(); i++)
+          fprintf(file, "%s%llu", i ? ", " : "", (unsigned long long)(*stat.buckets)[i]);
+        fprintf(file, "]");
+        break;
+      case STAT_FORMULA:
+        fprintf(file, "%s", FormatValue(stat.formula()).c_str());
+        break;
+    }
+  }
+  fprintf(file, "\n  },\n  \"intervals\": [");
+
+  std::vector<std::string> names;
+  std::vector<double> values;
+  Flatten(names, values);
+  for (size_t n = 0; n < snapshots.size(); n++)
+  {
+    fprintf(file, "%s\n    {\"cycle\": %d", n ? "," : "", snapshots[n].cycle);
+    for (size_t i = 0; i < names.size() && i < snapshots[n].values.size(); i++)
+    {
+      fprintf(file, ", \"%s\": %s", names[i].c_str(), FormatValue(snapshots[n].values[i]).c_str());
+    }
+    fprintf(file, "}");
+  }
+  fprintf(file, "%s]\n}\n", snapshots.empty() ? "" : "\n  ");
+}
+
+/*
+* Write one cycle,name,value row per value of every snapshot,
+* followed by the current values
+*/
+bool Statistics::WriteCSV(const char * filename)
+{
+  auto file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    simulator().Print("Error: Can't open statistics file %s\n", filename);
+    return false;
+  }
+
+  std::vector<std::string> names;
+  StatSnapshot current;
+  current.cycle = simulator().GetCycles();
+  Flatten(names, current.values);
+
+  fprintf(file, "cycle,name,value\n");
+  auto rows = snapshots;
+  if (rows.empty() || rows.back().cycle != current.cycle)
+    rows.push_back(current);
+  for (auto & row : rows)
+  {
+    for (size_t i = 0; i < names.size() && i < row.values.size(); i++)
+    {
+      fprintf(file, "%d,%s,%s\n", row.cycle, names[i].c_str(), FormatValue(row.values[i]).c_str());
+    }
+  }
+  fclose(file);
+  return true;
+}
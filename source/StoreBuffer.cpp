@@ -0,0 +1,241 @@
+/***************************************************************/
+/* Store Buffer Implementaion                                  */
+/***************************************************************/
+
+#ifdef __linux__
+    #include "../include/Simulator.h"
+    #include "../include/MainMemory.h"
+    #include "../include/StoreBuffer.h"
+    #include "../include/Statistics.h"
+    #include "../include/Checkpoint.h"
+#else
+    #include "Simulator.h"
+    #include "MainMemory.h"
+    #include "StoreBuffer.h"
+    #include "Statistics.h"
+    #include "Checkpoint.h"
+#endif
+
+StoreBuffer::StoreBuffer(Simulator & instance) :
+_simulator(instance),
+depth(0),
+full_this_cycle(false),
+stores(0),
+full_stalls(0),
+hidden_miss_cycles(0),
+port_wait_cycles(0),
+loads_forwarded(0),
+loads_merged(0)
+{
+
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_store_buffer                               */
+/*                                                             */
+/* Purpose   : Empty the buffer and clear the statistics       */
+/*                                                             */
+/***************************************************************/
+void StoreBuffer::init_store_buffer()
+{
+  depth = simulator().config().store_buffer_entries;
+  entries.clear();
+  stores = 0;
+  full_stalls = 0;
+  hidden_miss_cycles = 0;
+  port_wait_cycles = 0;
+  loads_forwarded = 0;
+  loads_merged = 0;
+  full_this_cycle = false;
+  occupancy = std::vector<uint64_t>(depth + 1, 0);
+}
+
+/*
+* Retire a store into the buffer. Return false, and stall the MEM stage,
+* when the buffer is full.
+*/
+bool StoreBuffer::Insert(const bits16 & address, const bits16 & data, bool we0, bool we1)
+{
+  if (IsFull())
+  {
+    full_this_cycle = true;
+    return false;
+  }
+  entries.push_back({address, data, we0, we1});
+  stores++;
+  return true;
+}
+
+/*
+* Read the word at address for a load. Bytes written by buffered stores
+* come from the buffer, the youngest store of each byte wins, and the
+* data cache is only read for the bytes the buffer does not hold. Set
+* ready_cycle as MainMemory::dcache_request does and return true if the
+* load used the data cache port.
+*/
+bool StoreBuffer::Load(const bits16 & address, bits16 & read_word, bool need_low, bool need_high, int & ready_cycle)
+{
+  bits8 low_byte, high_byte;
+  auto word = address.to_num() >> 1;
+  auto found_low = false, found_high = false;
+  for (auto it = entries.rbegin(); it != entries.rend() && !(found_low && found_high); ++it)
+  {
+    if ((it->address.to_num() >> 1) != word)
+      continue;
+    if (it->we0 && !found_low)
+    {
+      low_byte = it->data.range<7,0>();
+      found_low = true;
+    }
+    if (it->we1 && !found_high)
+    {
+      high_byte = it->data.range<15,8>();
+      found_high = true;
+    }
+  }
+
+  if ((found_low || !need_low) && (found_high || !need_high))
+  {
+    read_word.range<7,0>() = low_byte.range<7,0>();
+    read_word.range<15,8>() = high_byte.range<7,0>();
+    ready_cycle = simulator().GetCycles();
+    loads_forwarded++;
+    return false;
+  }
+
+  ready_cycle = simulator().memory().dcache_request(address, read_word);
+  if (ready_cycle == -1)
+    return true;
+  if (found_low)
+    read_word.range<7,0>() = low_byte.range<7,0>();
+  if (found_high)
+    read_word.range<15,8>() = high_byte.range<7,0>();
+  if ((found_low && need_low) || (found_high && need_high))
+    loads_merged++;
+  return true;
+}
+
+/*
+* Write the oldest store to the data cache, called once a cycle after the
+* MEM stage. A store waiting on a cache miss here would have held the
+* MEM stage without the buffer.
+*/
+void StoreBuffer::Drain(bool port_busy)
+{
+  occupancy[entries.size()]++;
+  auto pipeline_stalled = full_this_cycle;
+  full_this_cycle = false;
+  if (pipeline_stalled)
+    full_stalls++;
+
+  if (entries.empty())
+    return;
+  if (port_busy)
+  {
+    port_wait_cycles++;
+    return;
+  }
+
+  auto & head = entries.front();
+  bits16 read_word;
+  bool dcache_r = false;
+  simulator().memory().dcache_access(head.address, read_word, head.data, dcache_r, head.we0, head.we1);
+  if (!dcache_r)
+  {
+    if (!pipeline_stalled)
+      hidden_miss_cycles++;
+    return;
+  }
+  entries.pop_front();
+}
+
+/*
+* Write every buffered store to memory at once, so the memory holds the
+* final state of the program when the simulator halts
+*/
+void StoreBuffer::Flush()
+{
+  auto & memory = simulator().memory();
+  for (auto & entry : entries)
+  {
+    auto addr = entry.address >> 1;
+    if (entry.we0)
+      memory.SetLowerByteAt(addr, entry.data.range<7,0>());
+    if (entry.we1)
+      memory.SetUpperByteAt(addr, entry.data.range<15,8>());
+  }
+  entries.clear();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : RegisterStats                                   */
+/*                                                             */
+/* Purpose   : Register the store buffer counters.             */
+/*                                                             */
+/***************************************************************/
+void StoreBuffer::RegisterStats(Statistics & stats)
+{
+  stats.AddScalar("store_buffer.stores", "stores buffered", stores);
+  stats.AddScalar("store_buffer.loads_forwarded", "loads read from the buffer only", loads_forwarded);
+  stats.AddScalar("store_buffer.loads_merged", "loads merging buffer and cache bytes", loads_merged);
+  stats.AddScalar("store_buffer.hidden_miss_cycles", "store miss cycles hidden from MEM", hidden_miss_cycles);
+  stats.AddScalar("store_buffer.port_wait_cycles", "cycles waiting for the cache port", port_wait_cycles);
+  stats.AddScalar("store_buffer.full_stalls", "MEM stalls on a full buffer", full_stalls);
+  stats.AddHistogram("store_buffer.occupancy", "cycles holding n stores", occupancy);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : dump                                            */
+/*                                                             */
+/* Purpose   : Dump the store buffer statistics to the output  */
+/*             file.                                           */
+/*                                                             */
+/***************************************************************/
+void StoreBuffer::dump(FILE * dumpsim_file)
+{
+  #define PRINT_AND_DUMP(...) \
+      do { \
+          simulator().Print(__VA_ARGS__); \
+          if (dumpsim_file) { fprintf(dumpsim_file, __VA_ARGS__); } \
+      } while (0)
+
+  uint64_t cycles = 0;
+  for (auto count : occupancy)
+    cycles += count;
+
+  PRINT_AND_DUMP("\nStore buffer (%d entries) :\n", depth);
+  PRINT_AND_DUMP("-------------------------------------\n");
+  PRINT_AND_DUMP("Stores buffered      : %llu\n", (unsigned long long)stores);
+  PRINT_AND_DUMP("Loads forwarded      : %llu\n", (unsigned long long)loads_forwarded);
+  PRINT_AND_DUMP("Loads merged         : %llu\n", (unsigned long long)loads_merged);
+  PRINT_AND_DUMP("Store misses hidden  : %llu\n", (unsigned long long)hidden_miss_cycles);
+  PRINT_AND_DUMP("Waiting for the port : %llu\n", (unsigned long long)port_wait_cycles);
+  PRINT_AND_DUMP("Full buffer stalls   : %llu\n", (unsigned long long)full_stalls);
+  for (size_t i = 0; i < occupancy.size(); i++)
+    PRINT_AND_DUMP("Cycles holding %-2zu    : %llu (%.1f%%)\n", i, (unsigned long long)occupancy[i],
+                   cycles ? 100.0 * occupancy[i] / cycles : 0.0);
+  PRINT_AND_DUMP("\n");
+  if (dumpsim_file)
+    fflush(dumpsim_file);
+
+  #undef PRINT_AND_DUMP
+}
+
+/*
+* The stores still waiting for the data cache
+*/
+void StoreBuffer::Serialize(Checkpoint & cp)
+{
+  cp.Size(entries);
+  for (auto & entry : entries)
+  {
+    cp.Bits(entry.address);
+    cp.Bits(entry.data);
+    cp.Value(entry.we0);
+    cp.Value(entry.we1);
+  }
+  cp.Value(full_this_cycle);
+}
@@ -6,9 +6,11 @@
 #ifdef __linux__ 
     #include "../include/instruction.h"
     #include "../include/Disassembler.h"
+    #include "../include/Checkpoint.h"
 #else
     #include "instruction.h"
     #include "Disassembler.h"
+    #include "Checkpoint.h"
 #endif
 
 /**
@@ -44,9 +46,15 @@ Instruction::Instruction(Simulator & instance, const bits16 & instruction_bits)
     ADDRESS = 0;
     DRID = 0;
     CC = 0;
+    PRED_PC = 0;
+    ras_checkpoint = RAS_Checkpoint();
+    FUSED_ALU = nullptr;
     
     // Initialize pipeline tracking
+    seq = 0;
     fetch_cycle = -1;
+    squashed = false;
+    scoreboard = 0;
     mem_addr = 0;
     mem_addr_valid = false;
     current_stage = "";
@@ -71,3 +79,58 @@ void Instruction::recordStage(int cycle, const std::string& stage) {
 void Instruction::recordStall(int cycle, const std::string& stage) {
     cycle_history[cycle] = stage + "*";
 }
+
+/**
+ * @brief Write or read every field but IR, which the checkpoint keeps in
+ * front of the instruction to create it with.
+ * 
+ * @param cp The checkpoint being saved or restored
+ */
+void Instruction::Serialize(Checkpoint & cp) {
+    cp.Bits(PC);
+    cp.Bits(NPC);
+    cp.Bits(DATA);
+    cp.Bits(SR1);
+    cp.Bits(SR2);
+    cp.Bits(ALU_RESULT);
+    cp.Bits(ADDRESS);
+    cp.Bits(DRID);
+    cp.Bits(CC);
+    cp.Bits(PRED_PC);
+    cp.Value(ras_checkpoint.tos);
+    cp.Value(ras_checkpoint.count);
+    cp.Value(ras_checkpoint.top);
+    cp.Value(ras_checkpoint.ghr);
+    cp.Reference(FUSED_ALU);
+    cp.Bits(AGEX_CS);
+    cp.Bits(MEM_CS);
+    cp.Bits(SR_CS);
+
+    cp.Value(seq);
+    cp.Value(fetch_cycle);
+    cp.Value(squashed);
+    cp.Value(scoreboard);
+
+    uint32_t stages = cycle_history.size();
+    cp.Value(stages);
+    if (cp.IsRestoring()) {
+        cycle_history.clear();
+        for (uint32_t i = 0; i < stages && !cp.IsCorrupt(); i++) {
+            int cycle = 0;
+            std::string stage;
+            cp.Value(cycle);
+            cp.String(stage);
+            cycle_history[cycle] = stage;
+        }
+    } else {
+        for (auto & entry : cycle_history) {
+            int cycle = entry.first;
+            cp.Value(cycle);
+            cp.String(entry.second);
+        }
+    }
+
+    cp.Value(mem_addr);
+    cp.Value(mem_addr_valid);
+    cp.String(current_stage);
+}